@@ -1,5 +1,6 @@
 #include <invictus2/drivers/sx128x_hal.h>
 #include <invictus2/drivers/sx128x_context.h>
+#include <invictus2/trace.h>
 
 #include <zephyr/device.h>
 #include <zephyr/drivers/spi.h>
@@ -82,7 +83,9 @@ sx128x_hal_status_t sx128x_hal_write(const void *context, const uint8_t *command
         .count = ARRAY_SIZE(tx_bufs),
     };
 
+    TRACE_BEGIN(TRACE_SX128X_SPI);
     int ret = spi_write_dt(&config->spi, &tx_buf_set);
+    TRACE_END(TRACE_SX128X_SPI);
     if (ret < 0)
     {
         LOG_ERR("Failed to write to SPI device: %d", ret);
@@ -125,7 +128,9 @@ sx128x_hal_status_t sx128x_hal_read(const void *context, const uint8_t *command,
     const struct spi_buf_set tx_buf_set = {.buffers = tx_bufs, .count = ARRAY_SIZE(tx_bufs)};
     const struct spi_buf_set rx_buf_set = {.buffers = rx_bufs, .count = ARRAY_SIZE(rx_bufs)};
 
+    TRACE_BEGIN(TRACE_SX128X_SPI);
     int ret = spi_transceive_dt(&config->spi, &tx_buf_set, &rx_buf_set);
+    TRACE_END(TRACE_SX128X_SPI);
     if (ret < 0)
     {
         LOG_ERR("Failed to read from SPI device: %d", ret);
@@ -0,0 +1,133 @@
+/**
+ * @file hydra_modbus.h
+ *
+ * @brief Modbus register map shared by the HYDRA firmware (server) and the OBC (client).
+ *
+ * Input registers hold the latest sensor sample, coils hold the solenoid states. Both
+ * blocks start at address 0 on every variant. The enum order is the register order, so
+ * the OBC board unions and the HYDRA sample buffers must follow it.
+ *
+ * The HYDRA_IR_TIME_COUNT input registers right after the filtered inputs of each variant
+ * (at HYDRA_IR_ADDR_START + HYDRA_*_IR_COUNT) hold the time the sample was taken at, in
+ * the OBC timebase, low word first (see invictus2/timesync.h). A single block read returns
+ * a sample together with its time.
+ *
+ * The input registers at HYDRA_IR_ADDR_START are filtered and in engineering units:
+ * pressures in deci-bar, temperatures in deci-ºC (int16_t, two's complement). The same
+ * inputs, unfiltered, are repeated in the same order at HYDRA_IR_RAW_ADDR_START: averaged
+ * ADC codes for pressure transducers, deci-ºC for temperature sensors. A temperature
+ * sensor without a reading yet, or without a driver, reads HYDRA_TEMPERATURE_INVALID in
+ * both blocks, never an in-range value.
+ *
+ * Every coil also has a holding register at HYDRA_HR_PULSE_ADDR_START + coil. Writing N
+ * opens the valve for N ms and closes it again without further traffic; writing 0 cancels
+ * the pulse and closes the valve. Reads return the time left on the pulse, in ms.
+ *
+ * Boards with a proportional valve controller expose it in the holding registers at
+ * HYDRA_HR_CONTROL_ADDR_START, see enum hydra_control_hr. The setpoint is in the units of
+ * the controlled input register, gains are unsigned Q8.8 (256 = 1.0). The setpoint comes
+ * before the enable flag, a multiple register write stores them in that order, so the loop
+ * is never enabled ahead of its setpoint. The loop runs on a lease: unless the setpoint or
+ * the enable flag is written again within CONFIG_HYDRA_CONTROL_LEASE_MSEC, the board closes
+ * the valve and clears the enable flag, so a silent OBC never leaves it regulating.
+ *
+ * The OBC broadcasts its time to the holding registers at HYDRA_HR_TIME_ADDR_START.
+ */
+
+#ifndef INVICTUS2_HYDRA_MODBUS_H_
+#define INVICTUS2_HYDRA_MODBUS_H_
+
+#include <invictus2/timesync.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HYDRA_IR_ADDR_START     0
+#define HYDRA_IR_TIME_COUNT     TIMESYNC_MODBUS_HR_COUNT
+#define HYDRA_IR_RAW_ADDR_START 64
+#define HYDRA_COIL_ADDR_START   0
+
+#define HYDRA_TEMPERATURE_INVALID ((uint16_t)INT16_MIN) // -3276.8 ºC, no reading
+
+#define HYDRA_HR_PULSE_ADDR_START   0
+#define HYDRA_HR_CONTROL_ADDR_START 32
+#define HYDRA_HR_TIME_ADDR_START    TIMESYNC_MODBUS_HR_ADDR
+
+// --- Upper Feed (UF) ---
+
+enum hydra_uf_ir {
+    HYDRA_UF_IR_TEMPERATURE1 = 0,
+    HYDRA_UF_IR_TEMPERATURE2,
+    HYDRA_UF_IR_TEMPERATURE3,
+
+    HYDRA_UF_IR_COUNT,
+};
+
+enum hydra_uf_coil {
+    HYDRA_UF_COIL_PRESSURIZING_VALVE = 0,
+    HYDRA_UF_COIL_VENTING_VALVE,
+
+    HYDRA_UF_COIL_COUNT,
+};
+
+// --- Lower Feed (LF) ---
+
+enum hydra_lf_ir {
+    HYDRA_LF_IR_TEMPERATURE1 = 0,
+    HYDRA_LF_IR_TEMPERATURE2,
+    HYDRA_LF_IR_PRESSURE,
+    HYDRA_LF_IR_CC_PRESSURE,
+
+    HYDRA_LF_IR_COUNT,
+};
+
+enum hydra_lf_coil {
+    HYDRA_LF_COIL_ABORT_VALVE = 0,
+    HYDRA_LF_COIL_MAIN_VALVE,
+
+    HYDRA_LF_COIL_COUNT,
+};
+
+// --- Filling Station (FS) ---
+
+enum hydra_fs_ir {
+    HYDRA_FS_IR_N2O_PRESSURE = 0,
+    HYDRA_FS_IR_N2_PRESSURE,
+    HYDRA_FS_IR_QUICK_DC_PRESSURE,
+    HYDRA_FS_IR_N2O_TEMPERATURE1, // before solenoid
+    HYDRA_FS_IR_N2O_TEMPERATURE2, // after solenoid
+    HYDRA_FS_IR_N2_TEMPERATURE,
+
+    HYDRA_FS_IR_COUNT,
+};
+
+enum hydra_fs_coil {
+    HYDRA_FS_COIL_N2O_FILL_VALVE = 0,
+    HYDRA_FS_COIL_N2_FILL_VALVE,
+    HYDRA_FS_COIL_N2O_PURGE_VALVE,
+    HYDRA_FS_COIL_N2_PURGE_VALVE,
+    HYDRA_FS_COIL_N2O_QUICK_DC,
+    HYDRA_FS_COIL_N2_QUICK_DC,
+
+    HYDRA_FS_COIL_COUNT,
+};
+
+// --- Proportional valve controller ---
+
+enum hydra_control_hr {
+    HYDRA_CONTROL_HR_SETPOINT = 0,
+    HYDRA_CONTROL_HR_ENABLE, // 0 closes the valve and stops the loop, 1 runs it (leased)
+    HYDRA_CONTROL_HR_KP,
+    HYDRA_CONTROL_HR_KI, // Per control period
+    HYDRA_CONTROL_HR_KD, // Per control period
+    HYDRA_CONTROL_HR_OUTPUT, // Read only, last output (DAC code or servo deci-degrees)
+
+    HYDRA_CONTROL_HR_COUNT,
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INVICTUS2_HYDRA_MODBUS_H_
@@ -0,0 +1,103 @@
+/**
+ * @file nav_link.h
+ *
+ * @brief Framing of the navigator <-> OBC UART link.
+ *
+ * The navigator streams its samples to the OBC, the OBC sends time sync frames back (see
+ * invictus2/timesync.h). Every frame carries a batch of samples of one type:
+ *
+ *   header (type, count, seq) | count samples | CRC-16 (little endian)
+ *
+ * The CRC is CRC-16/CCITT-FALSE (crc16_itu_t seeded with 0xFFFF) over the header and the
+ * samples. The whole frame is then COBS encoded and terminated by a 0x00 byte, so a
+ * receiver joining mid-stream or losing bytes resynchronizes on the next delimiter.
+ *
+ * Samples are sent as their in-memory representation, both ends are little endian
+ * RP2040s built with the same structure layout.
+ */
+
+#ifndef INVICTUS2_NAV_LINK_H_
+#define INVICTUS2_NAV_LINK_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/toolchain.h>
+
+#include <invictus2/navigator_sensors.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NAV_LINK_MAX_BATCH 8 // Samples per frame
+
+enum nav_link_type {
+    NAV_LINK_SENSORS = 1, // navigator_sample_t, navigator -> OBC
+    NAV_LINK_KALMAN,      // kalman_sample_t, navigator -> OBC
+    NAV_LINK_SYNC,        // struct nav_link_sync, OBC -> navigator
+};
+
+struct nav_link_header {
+    uint8_t type;
+    uint8_t count; // Samples in the frame, 1 to NAV_LINK_MAX_BATCH
+    uint16_t seq;  // Frame counter, gaps are lost frames
+};
+
+struct nav_link_sync {
+    uint64_t master_us; // OBC time when the frame started to be sent
+};
+
+#define NAV_LINK_CRC_SIZE 2
+#define NAV_LINK_MAX_PAYLOAD                                                            \
+    (sizeof(struct nav_link_header) + NAV_LINK_MAX_BATCH * sizeof(navigator_sample_t) + \
+     NAV_LINK_CRC_SIZE)
+
+// COBS adds one byte per 254, plus the leading code byte and the delimiter
+#define NAV_LINK_MAX_FRAME (NAV_LINK_MAX_PAYLOAD + NAV_LINK_MAX_PAYLOAD / 254 + 2)
+
+// A decoded, CRC checked frame. samples points into the decoder buffer and is only valid
+// during the callback. It is only 4 byte aligned, copy the samples out before using them.
+struct nav_link_frame {
+    struct nav_link_header header;
+    const void *samples;
+};
+
+typedef void (*nav_link_frame_cb_t)(const struct nav_link_frame *frame, void *user_data);
+
+struct nav_link_stats {
+    uint32_t frames;
+    uint32_t crc_errors;
+    uint32_t framing_errors; // Bad COBS, bad length, unknown type or oversized frame
+    uint32_t lost_frames;    // From sequence gaps
+};
+
+struct nav_link_decoder {
+    uint8_t buf[NAV_LINK_MAX_FRAME] __aligned(4); // Keeps the decoded samples word aligned
+    size_t len;
+    bool overflow; // Current frame too long, dropped up to the next delimiter
+    bool synced;   // A frame was received, next_seq is meaningful
+    uint16_t next_seq;
+    struct nav_link_stats stats;
+};
+
+// Size of one sample of the given type, 0 if the type is unknown
+size_t nav_link_sample_size(uint8_t type);
+
+// Encode count samples into out, delimiter included
+// Returns the number of bytes written, 0 if count or out_size is too small for the frame
+size_t nav_link_encode(uint8_t type, uint16_t seq, const void *samples, uint8_t count,
+                       uint8_t *out, size_t out_size);
+
+void nav_link_decoder_init(struct nav_link_decoder *dec);
+
+// Feed received bytes, cb is called for every valid frame they complete
+void nav_link_decode(struct nav_link_decoder *dec, const uint8_t *data, size_t len,
+                     nav_link_frame_cb_t cb, void *user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INVICTUS2_NAV_LINK_H_
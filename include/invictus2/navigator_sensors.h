@@ -0,0 +1,68 @@
+/**
+ * @file navigator_sensors.h
+ *
+ * @brief Navigation data exchanged between the navigator board and the OBC.
+ *
+ * navigator_sensors_t holds one sample per IMU output period. The barometer, magnetometer
+ * and GPS fields update at their own, lower rates and hold their latest reading in between.
+ *
+ * kalman_data_t is the navigation estimate, see the OBC kalman service.
+ *
+ * Both are exchanged and published as samples, stamped with the time they were taken at
+ * in the OBC timebase (see invictus2/timesync.h).
+ */
+
+#ifndef INVICTUS2_NAVIGATOR_SENSORS_H_
+#define INVICTUS2_NAVIGATOR_SENSORS_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    // GPS:
+    uint32_t gps_latitude_u32;  // reinterpret-casted float bits
+    uint32_t gps_longitude_u32; // reinterpret-casted float bits
+    uint16_t gps_altitude;      // altitude in meters
+    uint16_t gps_hspeed;        // horizontal speed (units TBD)
+    uint8_t gps_sats;           // gps number of satelites
+    uint8_t _reserved;          // extra byte for alignment
+
+    // Barometers: pressure in deci-hPa, 0 if not available
+    uint16_t baro1, baro2;
+
+    // IMU, body frame:
+    int16_t mag_x, mag_y, mag_z;       // Magnetometer, in 0.1 uT
+    int16_t gyro_x, gyro_y, gyro_z;    // Gyroscope, in 0.1 deg/s
+    int16_t accel_x, accel_y, accel_z; // Accelerometer, in mg (reads +1000 on z at rest)
+} navigator_sensors_t;
+
+typedef struct
+{
+    int16_t vertical_speed;        // dm/s, positive up
+    int16_t vertical_acceleration; // dm/s^2, without gravity
+    int16_t altitude;              // m above the pad
+    int16_t max_altitude;          // m above the pad
+    int16_t quaternions[4];        // w, x, y, z body to world (z up), Q14
+} kalman_data_t;
+
+typedef struct
+{
+    uint64_t timestamp_us; // IMU sample time
+    navigator_sensors_t sensors;
+} navigator_sample_t;
+
+typedef struct
+{
+    uint64_t timestamp_us; // Time of the navigator sample the estimate is for
+    kalman_data_t kalman;
+} kalman_sample_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INVICTUS2_NAVIGATOR_SENSORS_H_
@@ -0,0 +1,133 @@
+/**
+ * @file sd_log.h
+ *
+ * @brief On-card format of the OBC flight logs, and recovery of logs cut by a power loss.
+ *
+ * A log is a sequence of SD_LOG_BLOCK_SIZE byte blocks, one per card sector, written in
+ * order and never rewritten. Every block starts with a struct sd_log_block_hdr:
+ *
+ *   magic | session | seq | CRC-32 | record count | used bytes | records... | zeros
+ *
+ * seq is the index of the block in the log, session tells the blocks of this log apart
+ * from stale ones left on the card by an older one. The CRC is CRC-32/IEEE (crc32_ieee)
+ * over the whole block with the crc field zeroed, so a block torn by a power loss, or
+ * never written at all, fails the check.
+ *
+ * Records never cross a block, each is a struct sd_log_record_hdr followed by len bytes
+ * of payload. The first record of block 0 is an SD_LOG_REC_FILE_HDR.
+ *
+ * As blocks are only appended, the valid blocks of a log are a prefix of it, but for the
+ * holes left by failed writes, each up to a write long: the blocks after one are still at
+ * their place. After a reset sd_log_scan() finds its end with a binary search over the
+ * block sequence numbers, reading O(log n) blocks instead of the whole log, and looks a
+ * write past every invalid block it lands on for the rest of the log. The card may program
+ * the sectors of a multi-block write in any order, so the blocks within window of the end
+ * found are then checked one by one.
+ *
+ * All fields are little endian, as laid out in memory on the OBC.
+ */
+
+#ifndef INVICTUS2_SD_LOG_H_
+#define INVICTUS2_SD_LOG_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <zephyr/toolchain.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SD_LOG_BLOCK_SIZE  512
+#define SD_LOG_BLOCK_MAGIC 0x4b4c4249 // "IBLK"
+#define SD_LOG_MAGIC       0x474f4c49 // "ILOG", in the file header record
+#define SD_LOG_VERSION     2
+
+struct sd_log_block_hdr {
+    uint32_t magic;   // SD_LOG_BLOCK_MAGIC
+    uint32_t session; // Same on every block of a log, see struct sd_log_file_hdr
+    uint32_t seq;     // Index of the block in the log
+    uint32_t crc;     // CRC-32 of the block, computed with this field set to 0
+    uint16_t records; // Records in the block
+    uint16_t used;    // Bytes of records after the header
+};
+
+#define SD_LOG_BLOCK_PAYLOAD (SD_LOG_BLOCK_SIZE - sizeof(struct sd_log_block_hdr))
+
+struct sd_log_block {
+    struct sd_log_block_hdr hdr;
+    uint8_t data[SD_LOG_BLOCK_PAYLOAD];
+} __aligned(4);
+
+enum sd_log_record_type {
+    SD_LOG_REC_NONE = 0,
+    SD_LOG_REC_FILE_HDR,      // struct sd_log_file_hdr
+    SD_LOG_REC_THERMO,        // thermo_sample_t
+    SD_LOG_REC_PRESSURE,      // pressure_sample_t
+    SD_LOG_REC_WEIGHT,        // weight_sample_t
+    SD_LOG_REC_NAVIGATOR,     // navigator_sample_t
+    SD_LOG_REC_KALMAN,        // kalman_sample_t
+    SD_LOG_REC_ROCKET_STATE,  // state_data_t
+    SD_LOG_REC_MODBUS_HEALTH, // modbus_health_t
+    SD_LOG_REC_PACKET,        // generic_packet_t, as received from the ground station
+    SD_LOG_REC_CMD_LATENCY,   // cmd_latency_t
+    SD_LOG_REC_HEALTH,        // health_sample_t
+    SD_LOG_REC_BUS_STATS,     // bus_stats_t
+
+    _SD_LOG_REC_MAX
+};
+
+struct sd_log_record_hdr {
+    uint8_t type;     // enum sd_log_record_type
+    uint8_t len;      // Payload bytes following the header
+    uint16_t dropped; // Records dropped right before this one, saturating
+    uint32_t time_us; // OBC uptime when the record was logged, lower 32 bits
+};
+
+struct sd_log_file_hdr {
+    uint32_t magic;       // SD_LOG_MAGIC
+    uint16_t version;     // SD_LOG_VERSION
+    uint16_t buf_sectors; // Blocks per write, the most a power loss can cut from the log
+    uint64_t start_us;    // OBC uptime when logging started, its low word is the session
+};
+
+// Empty block seq of the log session
+void sd_log_block_init(struct sd_log_block *blk, uint32_t session, uint32_t seq);
+
+// Append a record, false if it does not fit in the block
+bool sd_log_block_append(struct sd_log_block *blk, const struct sd_log_record_hdr *hdr,
+                         const void *payload);
+
+// Compute the CRC, once no more records are appended
+void sd_log_block_seal(struct sd_log_block *blk);
+
+// blk is block seq of the log session, intact
+bool sd_log_block_is_valid(const struct sd_log_block *blk, uint32_t session, uint32_t seq);
+
+// Read block index of the log into blk, returns 0 or <0 on error
+typedef int (*sd_log_read_block_t)(void *ctx, uint32_t index, struct sd_log_block *blk);
+
+struct sd_log_scan {
+    uint32_t session; // From block 0
+    uint32_t blocks;  // The log ends after this many blocks, 0 if block 0 is not valid
+    uint32_t lost;    // Invalid blocks before the end, torn or not written, near the end
+    uint32_t reads;   // Blocks read by the scan
+};
+
+/**
+ * @brief Find the end of a log of up to block_count blocks.
+ *
+ * @param read   Block reader, read errors count as invalid blocks.
+ * @param window Blocks on either side of the binary search result checked one by one,
+ *               and the longest hole skipped, at least the blocks per write.
+ * @param blk    Scratch block.
+ */
+void sd_log_scan(sd_log_read_block_t read, void *ctx, uint32_t block_count, uint32_t window,
+                 struct sd_log_block *blk, struct sd_log_scan *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INVICTUS2_SD_LOG_H_
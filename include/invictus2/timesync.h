@@ -0,0 +1,93 @@
+/**
+ * @file timesync.h
+ *
+ * @brief Common timebase of the OBC, navigator and HYDRA boards.
+ *
+ * The OBC is the time master: its uptime, in microseconds, is the timebase every published
+ * sample is stamped in. It periodically broadcasts its current time to the slaves:
+ *
+ *   - on the Modbus bus, as a broadcast (unit ID 0) write of TIMESYNC_MODBUS_HR_COUNT
+ *     holding registers at TIMESYNC_MODBUS_HR_ADDR, low word first;
+ *   - on the navigator UART, as a NAV_LINK_SYNC frame (see invictus2/nav_link.h).
+ *
+ * Slaves pair every received master time with their own uptime at reception, minus the
+ * known transmission latency of the sync frame, and feed it to a struct timesync. It keeps
+ * a linear model of the master clock (offset and drift) that is slewed towards every new
+ * sync point, so the converted timestamps stay monotonic and free of the jitter of a
+ * single sync frame. The slew only lasts as long as the last interval between sync points:
+ * past it, with the error absorbed, the model runs on the drift alone until the next one.
+ * Errors above CONFIG_TIMESYNC_STEP_THRESHOLD_USEC, such as the first sync point after
+ * either board rebooted, step the model instead.
+ *
+ * Until the first sync point, timesync_to_master() returns the local uptime unchanged.
+ */
+
+#ifndef INVICTUS2_TIMESYNC_H_
+#define INVICTUS2_TIMESYNC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Holding registers every Modbus slave serves the master time at, write only
+#define TIMESYNC_MODBUS_HR_ADDR  48
+#define TIMESYNC_MODBUS_HR_COUNT 4
+
+struct timesync {
+    uint64_t local_us;     // Local uptime of the last sync point
+    uint64_t master_us;    // Master time estimated for local_us
+    int32_t drift_ppb;     // Rate of the master clock relative to the local one, minus one
+    int32_t slew_ppb;      // Rate correction absorbing the last error until the next sync
+    uint32_t slew_us;      // Local time from local_us the slew lasts for, the last interval
+    int32_t last_error_us; // Master time minus the estimate, at the last sync point
+    uint32_t syncs;        // Sync points received
+    uint32_t steps;        // Sync points that stepped the model instead of slewing it
+};
+
+// Local uptime in us: the clock every board stamps with, and the master time on the OBC.
+// Needs CONFIG_SYS_CLOCK_TICKS_PER_SEC=1000000 for full resolution.
+static inline uint64_t timesync_uptime_us(void)
+{
+    return k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+void timesync_init(struct timesync *ts);
+
+// Add a sync point: master_us was the master time at local uptime local_us
+void timesync_update(struct timesync *ts, uint64_t master_us, uint64_t local_us);
+
+// Master time at local uptime local_us
+uint64_t timesync_to_master(const struct timesync *ts, uint64_t local_us);
+
+static inline bool timesync_is_synced(const struct timesync *ts)
+{
+    return ts->syncs > 0;
+}
+
+// 64 bit time <-> TIMESYNC_MODBUS_HR_COUNT registers, low word first
+static inline void timesync_to_regs(uint64_t time_us, uint16_t regs[TIMESYNC_MODBUS_HR_COUNT])
+{
+    for (int i = 0; i < TIMESYNC_MODBUS_HR_COUNT; i++) {
+        regs[i] = (uint16_t)(time_us >> (16 * i));
+    }
+}
+
+static inline uint64_t timesync_from_regs(const uint16_t regs[TIMESYNC_MODBUS_HR_COUNT])
+{
+    uint64_t time_us = 0;
+    for (int i = 0; i < TIMESYNC_MODBUS_HR_COUNT; i++) {
+        time_us |= (uint64_t)regs[i] << (16 * i);
+    }
+    return time_us;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INVICTUS2_TIMESYNC_H_
@@ -0,0 +1,123 @@
+/**
+ * @file trace.h
+ *
+ * @brief Cycle accurate timing probes for the hot paths of the firmware.
+ *
+ * Probes are placed in pairs around the code to measure, or alone to mark an instant:
+ *
+ *   TRACE_BEGIN(TRACE_SM_RUN);
+ *   smf_run_state(SMF_CTX(&sm_obj));
+ *   TRACE_END(TRACE_SM_RUN);
+ *
+ * Timestamps are k_cycle_get_32() readings, CPU cycles on the RP2040 (SysTick). A probe
+ * costs a cycle counter read and a few atomic operations, it never blocks and can be used
+ * from ISRs. Every probe appends an event to a ring of the CPU it runs on, and every
+ * TRACE_END() also adds the time since its TRACE_BEGIN() to a log2 histogram of the probe.
+ *
+ * Without CONFIG_INVICTUS_TRACE the macros expand to nothing.
+ *
+ * trace_export() serializes the rings and the histograms, oldest events first:
+ *
+ *   struct trace_export_hdr | struct trace_event * events | struct trace_hist * probes
+ *
+ * All fields are little endian, as laid out in memory on the OBC.
+ */
+
+#ifndef INVICTUS2_TRACE_H_
+#define INVICTUS2_TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRACE_EXPORT_MAGIC   0x43525449 // "ITRC"
+#define TRACE_EXPORT_VERSION 1
+#define TRACE_HIST_BUCKETS   32 // Bucket b counts durations in [2^b, 2^(b+1)) cycles
+
+enum trace_probe {
+    TRACE_ZBUS_PUB = 0, // zbus_chan_pub() calls, synchronous listeners included
+    TRACE_SM_RUN,       // smf_run_state()
+    TRACE_SM_WORK,      // State machine work handlers
+    TRACE_MODBUS_WORK,  // Modbus work handlers
+    TRACE_MODBUS_XFER,  // Modbus transactions
+    TRACE_NAV_FRAME,    // Navigator frame decoding and publishing
+    TRACE_KALMAN_STEP,  // Kalman filter steps
+    TRACE_SD_WRITE,     // SD logger writes
+    TRACE_SX128X_SPI,   // SX128x SPI transfers
+
+    _TRACE_PROBE_MAX
+};
+
+enum trace_event_type {
+    TRACE_EVENT_BEGIN = 0,
+    TRACE_EVENT_END,
+    TRACE_EVENT_MARK,
+};
+
+struct trace_event {
+    uint32_t cycles; // k_cycle_get_32() at the event
+    uint8_t probe;   // enum trace_probe
+    uint8_t type;    // enum trace_event_type
+    uint8_t cpu;
+    uint8_t isr; // 1 if recorded from an ISR
+};
+
+struct trace_hist {
+    uint32_t count;      // Durations recorded
+    uint32_t max_cycles; // Longest duration recorded
+    uint32_t buckets[TRACE_HIST_BUCKETS];
+};
+
+struct trace_export_hdr {
+    uint32_t magic;          // TRACE_EXPORT_MAGIC
+    uint16_t version;        // TRACE_EXPORT_VERSION
+    uint8_t cpus;            // Rings, events are grouped by CPU
+    uint8_t probes;          // Histograms following the events, _TRACE_PROBE_MAX
+    uint32_t cycles_per_sec; // Cycle counter frequency
+    uint32_t events;         // Events following the header
+};
+
+struct trace_stats {
+    uint32_t count;
+    uint32_t max_cycles;
+    uint32_t p50_cycles; // Percentiles, upper bound of the histogram bucket they fall in
+    uint32_t p99_cycles;
+};
+
+uint32_t trace_begin(enum trace_probe probe);
+void trace_end(enum trace_probe probe, uint32_t start);
+void trace_mark(enum trace_probe probe);
+
+const char *trace_probe_name(enum trace_probe probe);
+
+void trace_get_hist(enum trace_probe probe, struct trace_hist *hist);
+void trace_get_stats(enum trace_probe probe, struct trace_stats *stats);
+
+// Clear the rings and the histograms
+void trace_reset(void);
+
+// Sink for trace_export(), returns 0 or <0 on error
+typedef int (*trace_write_t)(void *ctx, const void *data, size_t len);
+
+// Write a snapshot of the rings and histograms, recording is paused meanwhile.
+// Returns 0 or the first error of write.
+int trace_export(trace_write_t write, void *ctx);
+
+#ifdef CONFIG_INVICTUS_TRACE
+#define TRACE_BEGIN(probe) const uint32_t trace_start_##probe = trace_begin(probe)
+#define TRACE_END(probe)   trace_end(probe, trace_start_##probe)
+#define TRACE_MARK(probe)  trace_mark(probe)
+#else
+#define TRACE_BEGIN(probe)
+#define TRACE_END(probe)
+#define TRACE_MARK(probe)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INVICTUS2_TRACE_H_
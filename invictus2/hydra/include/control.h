@@ -0,0 +1,48 @@
+// HYDRA proportional valve control
+// Closes a PID loop from one sensor input to the proportional valve output (AD559x DAC or
+// servo). The setpoint, gains and enable flag are the holding registers of enum
+// hydra_control_hr, written by the OBC over Modbus.
+
+#ifndef HYDRA_CONTROL_H_
+#define HYDRA_CONTROL_H_
+
+#include <errno.h>
+#include <stdint.h>
+
+#include <invictus2/hydra_modbus.h>
+
+#if defined(CONFIG_HYDRA_CONTROL)
+
+// Drive the output to closed and start the control thread, disabled
+// Expects valves_init() and sensors_init() to have been called
+// Returns 0 on success, <0 on error
+int control_init(void);
+
+// Read a control register, see enum hydra_control_hr
+// Returns 0 on success, -ENOTSUP for unknown registers
+int control_reg_rd(uint16_t reg, uint16_t *value);
+
+// Write a control register. Takes effect on the next control period.
+// Returns 0 on success, -ENOTSUP for unknown or read only registers
+int control_reg_wr(uint16_t reg, uint16_t value);
+
+#else
+
+static inline int control_init(void)
+{
+    return 0;
+}
+
+static inline int control_reg_rd(uint16_t reg, uint16_t *value)
+{
+    return -ENOTSUP;
+}
+
+static inline int control_reg_wr(uint16_t reg, uint16_t value)
+{
+    return -ENOTSUP;
+}
+
+#endif // CONFIG_HYDRA_CONTROL
+
+#endif // HYDRA_CONTROL_H_
@@ -0,0 +1,29 @@
+// HYDRA fixed-point sensor filters
+// One filter instance per input; the filter kind is selected at build time through
+// CONFIG_HYDRA_FILTER_*. All arithmetic is integer, the board has no FPU.
+
+#ifndef HYDRA_FILTER_H_
+#define HYDRA_FILTER_H_
+
+#include <stdint.h>
+
+#if defined(CONFIG_HYDRA_FILTER_MOVING_AVERAGE) || defined(CONFIG_HYDRA_FILTER_MEDIAN)
+#define HYDRA_FILTER_WINDOW CONFIG_HYDRA_FILTER_WINDOW
+#else
+#define HYDRA_FILTER_WINDOW 1
+#endif
+
+struct filter {
+    int32_t acc; // IIR: output in Q8. Moving average: sum of the window
+    int32_t window[HYDRA_FILTER_WINDOW];
+    uint8_t head;
+    uint8_t count; // Samples seen, saturating at the window size
+};
+
+// Clear the filter history, the next sample primes it
+void filter_reset(struct filter *f);
+
+// Feed a new sample and get the filtered value, in the same unit as the input
+int32_t filter_update(struct filter *f, int32_t in);
+
+#endif // HYDRA_FILTER_H_
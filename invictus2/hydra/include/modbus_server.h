@@ -0,0 +1,14 @@
+// HYDRA Modbus RTU server
+// Serves the latest sensor sample as input registers, the solenoids as coils and the valve
+// pulses and control loop as holding registers, following the register map shared with the
+// OBC in invictus2/hydra_modbus.h. Also receives the OBC time broadcasts (see timebase.h).
+
+#ifndef HYDRA_MODBUS_SERVER_H_
+#define HYDRA_MODBUS_SERVER_H_
+
+// Start the Modbus server on the modbus-rtu interface, with this variant's slave ID
+// Expects valves_init() and sensors_init() to have been called
+// Returns 0 on success, <0 on error
+int modbus_server_init(void);
+
+#endif // HYDRA_MODBUS_SERVER_H_
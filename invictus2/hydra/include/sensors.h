@@ -0,0 +1,36 @@
+// HYDRA sensor sampling
+// Samples every input of the selected variant at a fixed rate, oversampling the ADC inputs,
+// then filters and converts them into a double buffer, so readers always get a complete
+// sample without touching the hardware.
+
+#ifndef HYDRA_SENSORS_H_
+#define HYDRA_SENSORS_H_
+
+#include <stdint.h>
+
+#include <invictus2/hydra_modbus.h>
+
+#if defined(CONFIG_HYDRA_UF)
+#define HYDRA_IR_COUNT HYDRA_UF_IR_COUNT
+#elif defined(CONFIG_HYDRA_LF)
+#define HYDRA_IR_COUNT HYDRA_LF_IR_COUNT
+#elif defined(CONFIG_HYDRA_FS)
+#define HYDRA_IR_COUNT HYDRA_FS_IR_COUNT
+#endif
+
+struct sensors_sample {
+    uint64_t timestamp_us;         // Start of the sample, in the OBC timebase
+    uint32_t seq;                  // Incremented on every completed sample
+    uint16_t regs[HYDRA_IR_COUNT]; // Filtered values in engineering units, see hydra_modbus.h
+    uint16_t raw[HYDRA_IR_COUNT];  // Unfiltered values, in the same order
+};
+
+// Configure the inputs of this variant and start the sampling thread
+// Returns 0 on success, <0 on error (sampling is not started)
+int sensors_init(void);
+
+// Latest complete sample. Never blocks; a buffer is only rewritten a full sampling period
+// after it has been superseded, so it can be read from directly.
+const struct sensors_sample *sensors_latest(void);
+
+#endif // HYDRA_SENSORS_H_
@@ -0,0 +1,17 @@
+// HYDRA synchronized timebase
+// Tracks the OBC clock from the time sync broadcasts on the Modbus bus (see
+// invictus2/timesync.h), so samples are stamped in the timebase shared by every board.
+// Until the first broadcast, times are the HYDRA uptime.
+
+#ifndef HYDRA_TIMEBASE_H_
+#define HYDRA_TIMEBASE_H_
+
+#include <stdint.h>
+
+// Sync point: the OBC sent master_us, received here at uptime rx_us
+void timebase_sync(uint64_t master_us, uint64_t rx_us);
+
+// Current time, in the OBC timebase
+uint64_t timebase_now_us(void);
+
+#endif // HYDRA_TIMEBASE_H_
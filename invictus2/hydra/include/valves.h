@@ -1,6 +1,6 @@
 // Simple valve control API for HYDRA
 // - Solenoid valves are toggled via GPIO (from board DTS node labels)
-// - A servo valve helper (PWM angle) remains available for compatibility
+// - Proportional valves are driven by the AD559x DAC or by a servo on PWM
 
 #include <stdbool.h>
 #include <stdint.h>
@@ -25,14 +25,32 @@ int valves_init(void);
 // Set a valve state: open = true to energize coil, false to close
 int valve_set(hydra_valve_t id, bool open);
 
-// Open a valve for a duration in milliseconds, then auto-close
+// Open a valve for a duration in microseconds, then auto-close. Does not block: pulses on
+// different valves run concurrently, and a new pulse on the same valve restarts it.
+// valve_set() on a pulsing valve cancels the pulse.
+int valve_pulse_us(hydra_valve_t id, uint32_t us);
+
+// Open a valve for a duration in milliseconds, then auto-close (non-blocking)
 int valve_open_ms(hydra_valve_t id, uint32_t ms);
 
+// Cancel a running pulse and close the valve
+int valve_pulse_cancel(hydra_valve_t id);
+
+// Time left on a valve's pulse in microseconds, 0 if it is not pulsing
+uint32_t valve_pulse_remaining_us(hydra_valve_t id);
+
 // Query cached state
 bool valve_is_open(hydra_valve_t id);
 
-// PWM servo valve control 
-void valve_pwm_set_angle(float angle);
+#define HYDRA_SERVO_MAX_DECIDEG 2700
+
+// Set the servo valve angle, in deci-degrees [0, HYDRA_SERVO_MAX_DECIDEG]
+void valve_pwm_set_angle(uint16_t decideg);
+
+// Write a DAC output, idx being the index into the zephyr,user dac-channel-id list.
+// Values above valve_dac_max() are clamped.
+// Returns 0 on success, -ENODEV if the DAC failed to initialize, <0 on error
+int valve_dac_write(uint8_t idx, uint16_t value);
 
-// Configure a given DAC channel
-bool valve_dac_configure(hydra_valve_t id, uint16_t value);
+// Full scale DAC code
+uint16_t valve_dac_max(void);
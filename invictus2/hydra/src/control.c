@@ -0,0 +1,195 @@
+// HYDRA proportional valve control implementation
+//
+// The loop runs in its own thread, paced by a kernel timer and above the sampling thread
+// so sensor conversions never delay it. The DAC sits on I2C, which rules out computing the
+// output in the timer expiry function itself.
+//
+// The OBC holds the loop on a lease, renewed by every write of the setpoint or the enable
+// flag. A loop left running by an OBC that went silent closes the valve by itself.
+//
+// All the arithmetic is integer: gains are Q8.8, the integral is kept in Q8 and clamped to
+// the output range (anti-windup), and the derivative acts on the measurement so setpoint
+// steps do not kick the valve.
+#include "control.h"
+#include "sensors.h"
+#include "valves.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_REGISTER(control, LOG_LEVEL_INF);
+
+#define GAIN_SHIFT 8
+
+BUILD_ASSERT(CONFIG_HYDRA_CONTROL_INPUT < HYDRA_IR_COUNT,
+             "The controlled input must be one of this variant's input registers");
+
+// Written by the Modbus server, read by the control thread
+static atomic_t s_regs[HYDRA_CONTROL_HR_COUNT] = {
+    [HYDRA_CONTROL_HR_KP] = ATOMIC_INIT(CONFIG_HYDRA_CONTROL_KP),
+    [HYDRA_CONTROL_HR_KI] = ATOMIC_INIT(CONFIG_HYDRA_CONTROL_KI),
+    [HYDRA_CONTROL_HR_KD] = ATOMIC_INIT(CONFIG_HYDRA_CONTROL_KD),
+};
+static uint32_t s_lease_ms; // Uptime of the last setpoint or enable write
+static struct k_spinlock s_lease_lock; // Renewals against expiry
+
+struct pid_state {
+    int64_t integral; // Q8, in output units
+    int32_t last_input;
+    uint32_t last_seq;
+    bool running;
+};
+
+K_TIMER_DEFINE(s_control_timer, NULL, NULL);
+K_THREAD_STACK_DEFINE(s_control_stack, CONFIG_HYDRA_CONTROL_STACK_SIZE);
+static struct k_thread s_control_thread;
+
+static uint16_t output_max(void)
+{
+#if defined(CONFIG_HYDRA_CONTROL_OUTPUT_DAC)
+    return valve_dac_max();
+#else
+    return HYDRA_SERVO_MAX_DECIDEG;
+#endif
+}
+
+static int output_write(uint16_t value)
+{
+    atomic_set(&s_regs[HYDRA_CONTROL_HR_OUTPUT], value);
+
+#if defined(CONFIG_HYDRA_CONTROL_OUTPUT_DAC)
+    return valve_dac_write(CONFIG_HYDRA_CONTROL_DAC_CHANNEL, value);
+#else
+    valve_pwm_set_angle(value);
+    return 0;
+#endif
+}
+
+static uint16_t pid_step(struct pid_state *pid, int32_t input)
+{
+    const int64_t kp = atomic_get(&s_regs[HYDRA_CONTROL_HR_KP]);
+    const int64_t ki = atomic_get(&s_regs[HYDRA_CONTROL_HR_KI]);
+    const int64_t kd = atomic_get(&s_regs[HYDRA_CONTROL_HR_KD]);
+    const int64_t max = (int64_t)output_max() << GAIN_SHIFT;
+
+    const int32_t error = (int32_t)atomic_get(&s_regs[HYDRA_CONTROL_HR_SETPOINT]) - input;
+
+    pid->integral = CLAMP(pid->integral + ki * error, 0, max);
+
+    const int64_t out =
+        kp * error + pid->integral - kd * (input - pid->last_input);
+
+    pid->last_input = input;
+    return (uint16_t)(CLAMP(out, 0, max) >> GAIN_SHIFT);
+}
+
+static void control_thread_entry(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    struct pid_state pid = {0};
+
+    k_timer_start(&s_control_timer, K_NO_WAIT, K_MSEC(CONFIG_HYDRA_CONTROL_PERIOD_MSEC));
+
+    while (true) {
+        k_timer_status_sync(&s_control_timer);
+
+        const struct sensors_sample *sample = sensors_latest();
+        const int32_t input = sample->regs[CONFIG_HYDRA_CONTROL_INPUT];
+
+        k_spinlock_key_t key = k_spin_lock(&s_lease_lock);
+        const uint32_t lease_age_ms = k_uptime_get_32() - s_lease_ms;
+        const bool expired = atomic_get(&s_regs[HYDRA_CONTROL_HR_ENABLE]) &&
+                             lease_age_ms > CONFIG_HYDRA_CONTROL_LEASE_MSEC;
+        if (expired) {
+            // Not renewed by the OBC: cleared, the branch below closes the valve
+            atomic_set(&s_regs[HYDRA_CONTROL_HR_ENABLE], 0);
+        }
+        k_spin_unlock(&s_lease_lock, key);
+
+        if (expired) {
+            LOG_WRN("Control lease expired, %u ms without a write", lease_age_ms);
+        }
+
+        if (!atomic_get(&s_regs[HYDRA_CONTROL_HR_ENABLE])) {
+            if (pid.running) {
+                pid.running = false;
+                output_write(0);
+                LOG_INF("Control loop stopped");
+            }
+            continue;
+        }
+
+        if (!pid.running) {
+            // Bumpless start: no integral history, no derivative kick
+            pid = (struct pid_state){.last_input = input, .last_seq = sample->seq};
+            pid.running = true;
+            LOG_INF("Control loop started, setpoint %ld",
+                    atomic_get(&s_regs[HYDRA_CONTROL_HR_SETPOINT]));
+        } else if (sample->seq == pid.last_seq) {
+            continue; // Nothing new to act on, hold the output
+        }
+
+        pid.last_seq = sample->seq;
+
+        int rc = output_write(pid_step(&pid, input));
+        if (rc) {
+            LOG_WRN_ONCE("Control output write failed: %d", rc);
+        }
+    }
+}
+
+int control_reg_rd(uint16_t reg, uint16_t *value)
+{
+    if (reg >= HYDRA_CONTROL_HR_COUNT) {
+        return -ENOTSUP;
+    }
+
+    *value = (uint16_t)atomic_get(&s_regs[reg]);
+    return 0;
+}
+
+int control_reg_wr(uint16_t reg, uint16_t value)
+{
+    if (reg >= HYDRA_CONTROL_HR_COUNT || reg == HYDRA_CONTROL_HR_OUTPUT) {
+        return -ENOTSUP;
+    }
+
+    if (reg == HYDRA_CONTROL_HR_ENABLE && value > 1) {
+        return -EINVAL;
+    }
+
+    if (reg == HYDRA_CONTROL_HR_SETPOINT || reg == HYDRA_CONTROL_HR_ENABLE) {
+        k_spinlock_key_t key = k_spin_lock(&s_lease_lock);
+        s_lease_ms = k_uptime_get_32();
+        atomic_set(&s_regs[reg], value);
+        k_spin_unlock(&s_lease_lock, key);
+        return 0;
+    }
+
+    atomic_set(&s_regs[reg], value);
+    return 0;
+}
+
+int control_init(void)
+{
+    int rc = output_write(0);
+    if (rc) {
+        LOG_ERR("Control output not available: %d", rc);
+        return rc;
+    }
+
+    k_tid_t tid = k_thread_create(&s_control_thread, s_control_stack,
+                                  K_THREAD_STACK_SIZEOF(s_control_stack), control_thread_entry,
+                                  NULL, NULL, NULL, CONFIG_HYDRA_CONTROL_THREAD_PRIO, 0,
+                                  K_NO_WAIT);
+    k_thread_name_set(tid, "control");
+
+    LOG_INF("Control loop on input %d every %d ms, output range [0, %u]",
+            CONFIG_HYDRA_CONTROL_INPUT, CONFIG_HYDRA_CONTROL_PERIOD_MSEC, output_max());
+    return 0;
+}
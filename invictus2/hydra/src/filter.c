@@ -0,0 +1,83 @@
+// HYDRA fixed-point sensor filters implementation
+#include "filter.h"
+
+#include <string.h>
+#include <zephyr/sys/util.h>
+
+#define IIR_FRAC_BITS 8
+
+void filter_reset(struct filter *f)
+{
+    memset(f, 0, sizeof(*f));
+}
+
+#if defined(CONFIG_HYDRA_FILTER_IIR)
+
+int32_t filter_update(struct filter *f, int32_t in)
+{
+    const int32_t in_q = in * (1 << IIR_FRAC_BITS);
+
+    if (f->count == 0) {
+        // Start from the first sample instead of ramping up from 0
+        f->acc = in_q;
+        f->count = 1;
+    } else {
+        f->acc += (in_q - f->acc) / (1 << CONFIG_HYDRA_FILTER_IIR_SHIFT);
+    }
+
+    // Round to nearest, symmetric around 0 for negative temperatures
+    const int32_t half = 1 << (IIR_FRAC_BITS - 1);
+    return (f->acc >= 0 ? f->acc + half : f->acc - half) / (1 << IIR_FRAC_BITS);
+}
+
+#elif defined(CONFIG_HYDRA_FILTER_MOVING_AVERAGE)
+
+int32_t filter_update(struct filter *f, int32_t in)
+{
+    // Running sum: O(1) per sample whatever the window size
+    if (f->count == HYDRA_FILTER_WINDOW) {
+        f->acc -= f->window[f->head];
+    } else {
+        f->count++;
+    }
+
+    f->acc += in;
+    f->window[f->head] = in;
+    f->head = (f->head + 1) % HYDRA_FILTER_WINDOW;
+
+    return f->acc / f->count;
+}
+
+#elif defined(CONFIG_HYDRA_FILTER_MEDIAN)
+
+int32_t filter_update(struct filter *f, int32_t in)
+{
+    int32_t sorted[HYDRA_FILTER_WINDOW];
+
+    f->window[f->head] = in;
+    f->head = (f->head + 1) % HYDRA_FILTER_WINDOW;
+    f->count = MIN(f->count + 1, HYDRA_FILTER_WINDOW);
+
+    // Insertion sort, the window is at most 15 samples
+    for (int i = 0; i < f->count; ++i) {
+        int32_t v = f->window[i];
+        int j = i - 1;
+        while (j >= 0 && sorted[j] > v) {
+            sorted[j + 1] = sorted[j];
+            --j;
+        }
+        sorted[j + 1] = v;
+    }
+
+    return sorted[f->count / 2];
+}
+
+#else
+
+int32_t filter_update(struct filter *f, int32_t in)
+{
+    ARG_UNUSED(f);
+    return in;
+}
+
+#endif
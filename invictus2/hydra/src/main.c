@@ -1,12 +1,14 @@
 #include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "control.h"
+#include "modbus_server.h"
+#include "sensors.h"
 #include "valves.h"
 #include "pwm.h"
 
-#define MAIN_DELAY 1000
-
 LOG_MODULE_REGISTER(main, LOG_LEVEL_INF);
 
-void setup() {
+int setup() {
     pwm_init();
     LOG_INF("PWM initialized");
     int rc = valves_init();
@@ -15,20 +17,26 @@ void setup() {
     } else {
         LOG_INF("Valves initialized");
     }
-}
 
-void loop() {
-    k_sleep(K_MSEC(MAIN_DELAY));
-    valve_pwm_set_angle(0.0f);
-    k_sleep(K_MSEC(MAIN_DELAY));
-    valve_pwm_set_angle(180.0f);
+    rc = sensors_init();
+    if (rc) {
+        LOG_ERR("Sensors init failed: %d", rc);
+        return rc;
+    }
+
+    rc = control_init();
+    if (rc) {
+        LOG_ERR("Control loop init failed: %d", rc);
+        return rc;
+    }
+
+    return modbus_server_init();
 }
 
 int main(void)
 {
-    setup();
-    while(1) {
-        loop();
-    }
-    k_oops(); // should never reach here
-}
\ No newline at end of file
+    LOG_INF("HYDRA %s starting", CONFIG_HYDRA_VARIANT);
+
+    // Sampling and the Modbus server run on their own, there is nothing left for main to do
+    return setup();
+}
@@ -0,0 +1,211 @@
+// HYDRA Modbus RTU server implementation
+#include "modbus_server.h"
+
+#include <zephyr/device.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/modbus/modbus.h>
+#include <zephyr/sys/util.h>
+
+#include "control.h"
+#include "sensors.h"
+#include "timebase.h"
+#include "valves.h"
+
+LOG_MODULE_REGISTER(modbus_server, LOG_LEVEL_INF);
+
+#define MODBUS_NODE DT_ALIAS(modbus_rtu)
+#define MODBUS_BAUD DT_PROP(DT_PARENT(MODBUS_NODE), current_speed)
+
+// RTU silence between two frames, 3.5 characters of 11 bits, fixed above 19200 bd
+#define MODBUS_FRAME_GAP_US                                                                   \
+    (MODBUS_BAUD <= 19200 ? 35 * 11 * USEC_PER_SEC / 10 / MODBUS_BAUD : 1750)
+
+// Coil -> valve wiring, per variant
+static const hydra_valve_t s_coil_valves[] = {
+#if defined(CONFIG_HYDRA_UF)
+    [HYDRA_UF_COIL_PRESSURIZING_VALVE] = HYDRA_VALVE_SOL1,
+    [HYDRA_UF_COIL_VENTING_VALVE] = HYDRA_VALVE_SOL2,
+#elif defined(CONFIG_HYDRA_LF)
+    [HYDRA_LF_COIL_ABORT_VALVE] = HYDRA_VALVE_SOL1,
+    [HYDRA_LF_COIL_MAIN_VALVE] = HYDRA_VALVE_STEEL1,
+#elif defined(CONFIG_HYDRA_FS)
+    [HYDRA_FS_COIL_N2O_FILL_VALVE] = HYDRA_VALVE_SOL1,
+    [HYDRA_FS_COIL_N2_FILL_VALVE] = HYDRA_VALVE_SOL2,
+    [HYDRA_FS_COIL_N2O_PURGE_VALVE] = HYDRA_VALVE_SOL3,
+    [HYDRA_FS_COIL_N2_PURGE_VALVE] = HYDRA_VALVE_STEEL1,
+    [HYDRA_FS_COIL_N2O_QUICK_DC] = HYDRA_VALVE_QDC_N2O,
+    [HYDRA_FS_COIL_N2_QUICK_DC] = HYDRA_VALVE_QDC_N2,
+#endif
+};
+
+BUILD_ASSERT(HYDRA_HR_PULSE_ADDR_START + ARRAY_SIZE(s_coil_valves) <= HYDRA_HR_CONTROL_ADDR_START,
+             "Pulse and control holding registers overlap");
+BUILD_ASSERT(HYDRA_HR_CONTROL_ADDR_START + HYDRA_CONTROL_HR_COUNT <= HYDRA_HR_TIME_ADDR_START,
+             "Control and time holding registers overlap");
+BUILD_ASSERT(HYDRA_IR_COUNT + HYDRA_IR_TIME_COUNT <= HYDRA_IR_RAW_ADDR_START,
+             "Sample time and raw input registers overlap");
+
+// Sample being served to the current request, see input_reg_rd()
+static const struct sensors_sample *s_snapshot;
+static uint16_t s_next_ir_addr;
+static uint64_t s_last_ir_us;
+
+// Time sync broadcast being received, see time_reg_wr()
+static uint16_t s_time_regs[TIMESYNC_MODBUS_HR_COUNT];
+static uint64_t s_time_rx_us;
+
+// Addresses below the block start wrap around and are rejected along with the ones above it
+static int coil_index(uint16_t addr)
+{
+    const uint16_t idx = addr - HYDRA_COIL_ADDR_START;
+    return idx < ARRAY_SIZE(s_coil_valves) ? idx : -ENOTSUP;
+}
+
+static int coil_rd(uint16_t addr, bool *state)
+{
+    int idx = coil_index(addr);
+    if (idx < 0) {
+        return idx;
+    }
+
+    *state = valve_is_open(s_coil_valves[idx]);
+    return 0;
+}
+
+static int coil_wr(uint16_t addr, bool state)
+{
+    int idx = coil_index(addr);
+    if (idx < 0) {
+        return idx;
+    }
+
+    LOG_INF("Coil %u -> %s", addr, state ? "OPEN" : "CLOSED");
+    return valve_set(s_coil_valves[idx], state);
+}
+
+// The server hands the registers of a write over one at a time, in ascending order, once
+// the whole frame was received. The uptime at the first one is the reception time.
+static int time_reg_wr(uint16_t idx, uint16_t reg)
+{
+    if (idx == 0) {
+        s_time_rx_us = timesync_uptime_us();
+    }
+
+    s_time_regs[idx] = reg;
+
+    if (idx == TIMESYNC_MODBUS_HR_COUNT - 1) {
+        timebase_sync(timesync_from_regs(s_time_regs), s_time_rx_us);
+    }
+
+    return 0;
+}
+
+static int holding_reg_rd(uint16_t addr, uint16_t *reg)
+{
+    const uint16_t idx = addr - HYDRA_HR_PULSE_ADDR_START;
+    if (idx >= ARRAY_SIZE(s_coil_valves)) {
+        return control_reg_rd(addr - HYDRA_HR_CONTROL_ADDR_START, reg);
+    }
+
+    const uint32_t remaining_ms =
+        DIV_ROUND_UP(valve_pulse_remaining_us(s_coil_valves[idx]), USEC_PER_MSEC);
+    *reg = (uint16_t)MIN(remaining_ms, UINT16_MAX);
+    return 0;
+}
+
+static int holding_reg_wr(uint16_t addr, uint16_t reg)
+{
+    const uint16_t time_idx = addr - HYDRA_HR_TIME_ADDR_START;
+    if (time_idx < TIMESYNC_MODBUS_HR_COUNT) {
+        return time_reg_wr(time_idx, reg);
+    }
+
+    const uint16_t idx = addr - HYDRA_HR_PULSE_ADDR_START;
+    if (idx >= ARRAY_SIZE(s_coil_valves)) {
+        return control_reg_wr(addr - HYDRA_HR_CONTROL_ADDR_START, reg);
+    }
+
+    if (reg == 0) {
+        return valve_pulse_cancel(s_coil_valves[idx]);
+    }
+
+    return valve_open_ms(s_coil_valves[idx], reg);
+}
+
+static int input_reg_rd(uint16_t addr, uint16_t *reg)
+{
+    const uint16_t filtered_idx = addr - HYDRA_IR_ADDR_START;
+    const uint16_t time_idx = filtered_idx - HYDRA_IR_COUNT;
+    const uint16_t raw_idx = addr - HYDRA_IR_RAW_ADDR_START;
+
+    if (filtered_idx >= HYDRA_IR_COUNT + HYDRA_IR_TIME_COUNT && raw_idx >= HYDRA_IR_COUNT) {
+        return -ENOTSUP;
+    }
+
+    // The server asks for the registers of a request one at a time, back to back and in
+    // ascending order, and tells nothing of where a request starts. Any two requests are a
+    // frame gap apart at least, the response to the first one in between: latch the sample
+    // on the first register of each request, so a block read never mixes two samples and
+    // the next block, even at the next address, gets a fresh one.
+    const uint64_t now_us = timesync_uptime_us();
+    if (s_snapshot == NULL || addr != s_next_ir_addr ||
+        now_us - s_last_ir_us >= MODBUS_FRAME_GAP_US) {
+        s_snapshot = sensors_latest();
+    }
+
+    s_next_ir_addr = addr + 1;
+    s_last_ir_us = now_us;
+
+    if (filtered_idx < HYDRA_IR_COUNT) {
+        *reg = s_snapshot->regs[filtered_idx];
+    } else if (time_idx < HYDRA_IR_TIME_COUNT) {
+        *reg = (uint16_t)(s_snapshot->timestamp_us >> (16 * time_idx));
+    } else {
+        *reg = s_snapshot->raw[raw_idx];
+    }
+
+    return 0;
+}
+
+static struct modbus_user_callbacks s_callbacks = {
+    .coil_rd = coil_rd,
+    .coil_wr = coil_wr,
+    .input_reg_rd = input_reg_rd,
+    .holding_reg_rd = holding_reg_rd,
+    .holding_reg_wr = holding_reg_wr,
+};
+
+int modbus_server_init(void)
+{
+    const struct modbus_iface_param param = {
+        .mode = MODBUS_MODE_RTU,
+        .server =
+            {
+                .user_cb = &s_callbacks,
+                .unit_id = CONFIG_HYDRA_MODBUS_SLAVE_ID,
+            },
+        .serial =
+            {
+                .baud = MODBUS_BAUD,
+                // NOTE: In RTU mode, modbus uses CRC checks, so parity can be NONE
+                .parity = UART_CFG_PARITY_NONE,
+            },
+    };
+
+    const int iface = modbus_iface_get_by_name(DEVICE_DT_NAME(MODBUS_NODE));
+    if (iface < 0) {
+        LOG_ERR("Failed to get iface index for %s", DEVICE_DT_NAME(MODBUS_NODE));
+        return iface;
+    }
+
+    int rc = modbus_init_server(iface, param);
+    if (rc) {
+        LOG_ERR("Modbus server init failed: %d", rc);
+        return rc;
+    }
+
+    LOG_INF("Modbus server up (%s), slave ID %d, %d IRs, %d coils", CONFIG_HYDRA_VARIANT,
+            CONFIG_HYDRA_MODBUS_SLAVE_ID, HYDRA_IR_COUNT, (int)ARRAY_SIZE(s_coil_valves));
+    return 0;
+}
@@ -22,7 +22,7 @@ void pwm_set_duty_cycle(uint32_t channel, uint32_t period_us, uint32_t pulse_us)
         LOG_INF("Error %d: failed to set pulse width!\n", ret); 
         return;
     }
-    LOG_INF("Successfully set pwm period %d us and pulse %d us on channel %d\n", period_us, pulse_us, channel);
+    LOG_DBG("Successfully set pwm period %d us and pulse %d us on channel %d\n", period_us, pulse_us, channel);
 }
 
 void pwm_init() {
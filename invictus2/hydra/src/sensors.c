@@ -0,0 +1,242 @@
+// HYDRA sensor sampling implementation
+//
+// Neither the RP2040 ADC driver nor the AD559x (I2C) driver can stream samples over DMA,
+// so a dedicated thread paced by a timer does the conversions instead. It fills the back
+// half of a double buffer and publishes it with a single atomic index flip, which keeps
+// the Modbus server path free of I2C/SPI transactions and locks.
+//
+// Per input and per sample: ADC inputs average 2^CONFIG_HYDRA_SENSORS_OVERSAMPLING
+// back-to-back conversions, the result goes through the configured filter, and only the
+// filtered value is converted to engineering units.
+#include "sensors.h"
+#include "filter.h"
+#include "timebase.h"
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/adc.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_REGISTER(sensors, LOG_LEVEL_INF);
+
+#define AD559X_ADC_NODE DT_NODELABEL(ad559x_adc)
+#define OVERSAMPLING    BIT(CONFIG_HYDRA_SENSORS_OVERSAMPLING)
+
+enum input_type {
+    INPUT_ADC = 0, // Pressure transducer on the AD559x
+    INPUT_THERMO,  // Temperature sensor, already in deci-ºC
+};
+
+struct sensor_input {
+    enum input_type type;
+    union {
+        struct adc_dt_spec adc;
+        const struct device *thermo;
+    };
+};
+
+#define ADC_INPUT(ch) {.type = INPUT_ADC, .adc = ADC_DT_SPEC_STRUCT(AD559X_ADC_NODE, ch)}
+
+#if DT_HAS_COMPAT_STATUS_OKAY(maxim_max31865)
+#define THERMO_INPUT(node) {.type = INPUT_THERMO, .thermo = DEVICE_DT_GET(DT_NODELABEL(node))}
+#else
+// TODO: the thermo nodes have no compatible yet (see the board dts), they read as invalid
+#define THERMO_INPUT(node) {.type = INPUT_THERMO, .thermo = NULL}
+#endif
+
+// Register index -> physical input, per variant
+static const struct sensor_input s_inputs[HYDRA_IR_COUNT] = {
+#if defined(CONFIG_HYDRA_UF)
+    [HYDRA_UF_IR_TEMPERATURE1] = THERMO_INPUT(thermo1),
+    [HYDRA_UF_IR_TEMPERATURE2] = THERMO_INPUT(thermo2),
+    [HYDRA_UF_IR_TEMPERATURE3] = THERMO_INPUT(thermo3),
+#elif defined(CONFIG_HYDRA_LF)
+    [HYDRA_LF_IR_TEMPERATURE1] = THERMO_INPUT(thermo1),
+    [HYDRA_LF_IR_TEMPERATURE2] = THERMO_INPUT(thermo2),
+    [HYDRA_LF_IR_PRESSURE] = ADC_INPUT(0),
+    [HYDRA_LF_IR_CC_PRESSURE] = ADC_INPUT(1),
+#elif defined(CONFIG_HYDRA_FS)
+    [HYDRA_FS_IR_N2O_PRESSURE] = ADC_INPUT(0),
+    [HYDRA_FS_IR_N2_PRESSURE] = ADC_INPUT(1),
+    [HYDRA_FS_IR_QUICK_DC_PRESSURE] = ADC_INPUT(2),
+    [HYDRA_FS_IR_N2O_TEMPERATURE1] = THERMO_INPUT(thermo1),
+    [HYDRA_FS_IR_N2O_TEMPERATURE2] = THERMO_INPUT(thermo2),
+    [HYDRA_FS_IR_N2_TEMPERATURE] = THERMO_INPUT(thermo3),
+#endif
+};
+
+static struct filter s_filters[HYDRA_IR_COUNT];
+static struct sensors_sample s_buffers[2];
+static atomic_t s_front = ATOMIC_INIT(0);
+
+K_TIMER_DEFINE(s_sample_timer, NULL, NULL);
+K_THREAD_STACK_DEFINE(s_sensors_stack, CONFIG_HYDRA_SENSORS_STACK_SIZE);
+static struct k_thread s_sensors_thread;
+
+static int read_adc(const struct adc_dt_spec *spec, int32_t *value)
+{
+    int16_t raw[OVERSAMPLING];
+    const struct adc_sequence_options options = {
+        .extra_samplings = OVERSAMPLING - 1,
+    };
+    struct adc_sequence sequence = {
+        .options = &options,
+        .buffer = raw,
+        .buffer_size = sizeof(raw),
+    };
+
+    int rc = adc_sequence_init_dt(spec, &sequence);
+    if (rc == 0) {
+        rc = adc_read_dt(spec, &sequence);
+    }
+
+    if (rc) {
+        return rc;
+    }
+
+    int32_t sum = 0;
+    for (int i = 0; i < OVERSAMPLING; ++i) {
+        sum += raw[i];
+    }
+
+    *value = (sum + OVERSAMPLING / 2) >> CONFIG_HYDRA_SENSORS_OVERSAMPLING;
+    return 0;
+}
+
+static int read_thermo(const struct device *dev, int32_t *value)
+{
+    if (dev == NULL) {
+        return -ENODEV;
+    }
+
+    struct sensor_value temp;
+    int rc = sensor_sample_fetch(dev);
+    if (rc == 0) {
+        rc = sensor_channel_get(dev, SENSOR_CHAN_AMBIENT_TEMP, &temp);
+    }
+
+    if (rc == 0) {
+        *value = temp.val1 * 10 + temp.val2 / 100000;
+    }
+    return rc;
+}
+
+static int read_input(const struct sensor_input *in, int32_t *value)
+{
+    switch (in->type) {
+    case INPUT_ADC:
+        return read_adc(&in->adc, value);
+    case INPUT_THERMO:
+        return read_thermo(in->thermo, value);
+    default:
+        return -EINVAL;
+    }
+}
+
+// Filtered input value -> register value, in the units of hydra_modbus.h
+static uint16_t to_register(const struct sensor_input *in, int32_t value)
+{
+    switch (in->type) {
+    case INPUT_ADC: {
+        const int32_t full_scale = BIT_MASK(in->adc.resolution);
+        const int32_t dbar = (value * CONFIG_HYDRA_PRESSURE_FULL_SCALE_DBAR + full_scale / 2) /
+                             full_scale;
+        return (uint16_t)CLAMP(dbar, 0, UINT16_MAX);
+    }
+    case INPUT_THERMO:
+        // INT16_MIN is HYDRA_TEMPERATURE_INVALID
+        return (uint16_t)(int16_t)CLAMP(value, INT16_MIN + 1, INT16_MAX);
+    default:
+        return 0;
+    }
+}
+
+static void sensors_thread_entry(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    uint32_t seq = 0;
+
+    k_timer_start(&s_sample_timer, K_NO_WAIT,
+                  K_MSEC(CONFIG_HYDRA_SENSORS_SAMPLE_INTERVAL_MSEC));
+
+    while (true) {
+        k_timer_status_sync(&s_sample_timer);
+
+        const atomic_val_t front = atomic_get(&s_front);
+        const struct sensors_sample *prev = &s_buffers[front];
+        struct sensors_sample *next = &s_buffers[!front];
+
+        next->timestamp_us = timebase_now_us();
+
+        for (int i = 0; i < HYDRA_IR_COUNT; ++i) {
+            int32_t value;
+            int rc = read_input(&s_inputs[i], &value);
+            if (rc) {
+                // Hold the last good value rather than serving a stale or partial one,
+                // invalid until there is one (see sensors_init())
+                next->raw[i] = prev->raw[i];
+                next->regs[i] = prev->regs[i];
+                LOG_WRN_ONCE("Input %d read failed: %d", i, rc);
+                continue;
+            }
+
+            next->raw[i] = (uint16_t)value;
+            next->regs[i] = to_register(&s_inputs[i], filter_update(&s_filters[i], value));
+        }
+
+        next->seq = ++seq;
+        atomic_set(&s_front, !front);
+    }
+}
+
+const struct sensors_sample *sensors_latest(void)
+{
+    return &s_buffers[atomic_get(&s_front)];
+}
+
+int sensors_init(void)
+{
+    for (int i = 0; i < HYDRA_IR_COUNT; ++i) {
+        const struct sensor_input *in = &s_inputs[i];
+        filter_reset(&s_filters[i]);
+
+        if (in->type == INPUT_THERMO) {
+            for (int b = 0; b < ARRAY_SIZE(s_buffers); ++b) {
+                s_buffers[b].regs[i] = HYDRA_TEMPERATURE_INVALID;
+                s_buffers[b].raw[i] = HYDRA_TEMPERATURE_INVALID;
+            }
+        }
+
+        if (in->type == INPUT_ADC) {
+            if (!adc_is_ready_dt(&in->adc)) {
+                LOG_ERR("ADC for input %d not ready", i);
+                return -ENODEV;
+            }
+
+            int rc = adc_channel_setup_dt(&in->adc);
+            if (rc) {
+                LOG_ERR("ADC channel %d setup failed: %d", in->adc.channel_id, rc);
+                return rc;
+            }
+        } else if (in->thermo != NULL && !device_is_ready(in->thermo)) {
+            LOG_ERR("Thermo for input %d not ready", i);
+            return -ENODEV;
+        }
+    }
+
+    k_tid_t tid = k_thread_create(&s_sensors_thread, s_sensors_stack,
+                                  K_THREAD_STACK_SIZEOF(s_sensors_stack), sensors_thread_entry,
+                                  NULL, NULL, NULL, CONFIG_HYDRA_SENSORS_THREAD_PRIO, 0,
+                                  K_NO_WAIT);
+    k_thread_name_set(tid, "sensors");
+
+    LOG_INF("Sampling %d inputs every %d ms, %lu conversions per ADC sample", HYDRA_IR_COUNT,
+            CONFIG_HYDRA_SENSORS_SAMPLE_INTERVAL_MSEC, OVERSAMPLING);
+    return 0;
+}
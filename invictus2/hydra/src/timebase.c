@@ -0,0 +1,40 @@
+// HYDRA synchronized timebase implementation
+#include "timebase.h"
+
+#include <invictus2/timesync.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(timebase, LOG_LEVEL_INF);
+
+// Written from the Modbus server, read from the sampling thread
+static struct timesync s_sync;
+static struct k_spinlock s_lock;
+
+void timebase_sync(uint64_t master_us, uint64_t rx_us)
+{
+    const uint64_t local_us = rx_us - CONFIG_HYDRA_TIMESYNC_LATENCY_USEC;
+
+    k_spinlock_key_t key = k_spin_lock(&s_lock);
+    const uint32_t steps = s_sync.steps;
+    timesync_update(&s_sync, master_us, local_us);
+    const bool stepped = s_sync.syncs == 1 || s_sync.steps != steps;
+    const int32_t error_us = s_sync.last_error_us;
+    k_spin_unlock(&s_lock, key);
+
+    if (stepped) {
+        LOG_INF("Timebase stepped by %d us", error_us);
+    }
+}
+
+uint64_t timebase_now_us(void)
+{
+    const uint64_t local_us = timesync_uptime_us();
+
+    k_spinlock_key_t key = k_spin_lock(&s_lock);
+    const uint64_t now_us = timesync_to_master(&s_sync, local_us);
+    k_spin_unlock(&s_lock, key);
+
+    return now_us;
+}
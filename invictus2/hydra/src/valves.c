@@ -6,11 +6,18 @@
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/sys/util.h>
+#include <zephyr/drivers/dac.h>
 #include "gpio.h"
-#include <zephyr/drivers/mfd/ad559x.h>
 
 LOG_MODULE_REGISTER(valves, LOG_LEVEL_INF);
 
+#define USER_NODE      DT_PATH(zephyr_user)
+#define DAC_RESOLUTION DT_PROP(USER_NODE, dac_resolution)
+
+#define SERVO_PERIOD_US    20000
+#define SERVO_MIN_PULSE_US 500
+#define SERVO_MAX_PULSE_US 2500
+
 // Names aligned with GPIO mapping in hydra GPIO layer
 
 // Human-friendly names aligned with s_valve_specs
@@ -26,30 +33,65 @@ static const char *const s_valve_names[HYDRA_VALVE_COUNT] = {
 
 static bool s_open_state[HYDRA_VALVE_COUNT];
 
-const struct device *mfd_dev = DEVICE_DT_GET(DT_ALIAS(dac));
-bool dac_initialized = false;
+// One timer per valve so pulses on different valves never wait on each other. Expiry runs
+// in ISR context, which only costs a GPIO register write.
+static struct k_timer s_pulse_timers[HYDRA_VALVE_COUNT];
+
+static const struct device *const s_dac_dev = DEVICE_DT_GET(DT_ALIAS(dac));
+static const uint8_t s_dac_channels[] = DT_PROP(USER_NODE, dac_channel_id);
+static bool s_dac_ready;
+
+static int valve_write(hydra_valve_t id, bool open)
+{
+    int r = gpio_set_valve((int)id, open);
+    if (r == 0) {
+        s_open_state[id] = open;
+        LOG_DBG("Valve %u set to %s", id, open ? "OPEN" : "CLOSED");
+    }
+    return r;
+}
+
+static void pulse_expiry(struct k_timer *timer)
+{
+    const hydra_valve_t id = (hydra_valve_t)(timer - s_pulse_timers);
+
+    if (valve_write(id, false)) {
+        LOG_ERR("Failed to close %s after pulse", s_valve_names[id]);
+    }
+}
 
 int valves_init(void)
 {
     memset(s_open_state, 0, sizeof(s_open_state));
+    for (int i = 0; i < HYDRA_VALVE_COUNT; ++i) {
+        k_timer_init(&s_pulse_timers[i], pulse_expiry, NULL);
+    }
+
     int rc = gpio_init_valves();
     if (rc == 0) {
         LOG_INF("Valves initialized (%d)", HYDRA_VALVE_COUNT);
     }
 
-    if (mfd_dev == NULL)
-    {
-        LOG_ERR("Failed to initialize MFD device");
-
-        return 0;
+    // The solenoids work without the DAC, so its failures are not fatal
+    if (!device_is_ready(s_dac_dev)) {
+        LOG_ERR("DAC device is not ready");
+        return rc;
     }
 
-    if (!device_is_ready(mfd_dev))
-    {
-        LOG_ERR("MFD device is not ready");
-        return 0;
+    for (size_t i = 0; i < ARRAY_SIZE(s_dac_channels); ++i) {
+        const struct dac_channel_cfg cfg = {
+            .channel_id = s_dac_channels[i],
+            .resolution = DAC_RESOLUTION,
+        };
+
+        int r = dac_channel_setup(s_dac_dev, &cfg);
+        if (r) {
+            LOG_ERR("DAC channel %u setup failed: %d", s_dac_channels[i], r);
+            return rc;
+        }
     }
 
+    s_dac_ready = true;
     return rc;
 }
 
@@ -59,12 +101,9 @@ int valve_set(hydra_valve_t id, bool open)
         return -EINVAL;
     }
 
-    int r = gpio_set_valve((int)id, open);
-    if (r == 0) {
-        s_open_state[id] = open;
-        LOG_DBG("Valve %u set to %s", id, open ? "OPEN" : "CLOSED");
-    }
-    return r;
+    // An explicit command always wins over a running pulse
+    k_timer_stop(&s_pulse_timers[id]);
+    return valve_write(id, open);
 }
 
 int valve_toggle(hydra_valve_t id)
@@ -96,37 +135,69 @@ bool valve_is_open(hydra_valve_t id)
     return s_open_state[id];
 }
 
-int valve_open_ms(hydra_valve_t id, uint32_t ms)
+int valve_pulse_us(hydra_valve_t id, uint32_t us)
 {
-    int r = valve_set(id, true);
+    if (id < 0 || id >= HYDRA_VALVE_COUNT || us == 0) {
+        return -EINVAL;
+    }
+
+    // A running pulse expiring between the write and the restart below would close the
+    // valve under the new one, stop it first
+    k_timer_stop(&s_pulse_timers[id]);
+
+    int r = valve_write(id, true);
     if (r) return r;
-    k_msleep(ms);
-    return valve_set(id, false);
+
+    k_timer_start(&s_pulse_timers[id], K_USEC(us), K_NO_WAIT);
+    LOG_INF("Pulsing %s for %u us", s_valve_names[id], us);
+    return 0;
 }
 
-bool valve_dac_configure(hydra_valve_t id, uint16_t value)
+int valve_open_ms(hydra_valve_t id, uint32_t ms)
 {
-    if (!dac_initialized)
-    {
-        LOG_ERR("can't configure DAC");
-        return false;
+    if (ms > UINT32_MAX / USEC_PER_MSEC) {
+        return -EINVAL;
     }
+    return valve_pulse_us(id, ms * USEC_PER_MSEC);
+}
 
-    LOG_INF("Configuring DAC %d with %d", id, value);
-    return mfd_ad559x_write_dac_chan(mfd_dev, id, value) == 0;
+int valve_pulse_cancel(hydra_valve_t id)
+{
+    return valve_set(id, false);
 }
 
-// Sets the servo angle in degrees [0, 270]
-void valve_pwm_set_angle(float angle)
+uint32_t valve_pulse_remaining_us(hydra_valve_t id)
 {
-    if (angle < 0) angle = 0;
-    if (angle > 270) angle = 270;
+    if (id < 0 || id >= HYDRA_VALVE_COUNT) return 0;
+    return (uint32_t)k_ticks_to_us_ceil64(k_timer_remaining_ticks(&s_pulse_timers[id]));
+}
 
-    const int minPulse = 500;   // microseconds
-    const int maxPulse = 2500;  // microseconds
-    const int angleRange = 270;
+uint16_t valve_dac_max(void)
+{
+    return BIT_MASK(DAC_RESOLUTION);
+}
 
-    int pulseWidth = minPulse + (int)((angle / angleRange) * (maxPulse - minPulse));
+int valve_dac_write(uint8_t idx, uint16_t value)
+{
+    if (!s_dac_ready) {
+        return -ENODEV;
+    }
+
+    if (idx >= ARRAY_SIZE(s_dac_channels)) {
+        return -EINVAL;
+    }
 
-    pwm_set_duty_cycle(5, 20000, pulseWidth); // Channel 5, 20ms period, pulse width calculated above
-}
\ No newline at end of file
+    return dac_write_value(s_dac_dev, s_dac_channels[idx], MIN(value, valve_dac_max()));
+}
+
+void valve_pwm_set_angle(uint16_t decideg)
+{
+    decideg = MIN(decideg, HYDRA_SERVO_MAX_DECIDEG);
+
+    const uint32_t range_us = SERVO_MAX_PULSE_US - SERVO_MIN_PULSE_US;
+    const uint32_t pulse_us =
+        SERVO_MIN_PULSE_US +
+        (decideg * range_us + HYDRA_SERVO_MAX_DECIDEG / 2) / HYDRA_SERVO_MAX_DECIDEG;
+
+    pwm_set_duty_cycle(CONFIG_HYDRA_SERVO_PWM_CHANNEL, SERVO_PERIOD_US, pulse_us);
+}
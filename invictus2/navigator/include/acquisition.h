@@ -0,0 +1,40 @@
+// Navigator sensor acquisition
+// Reads the IMU at its full output rate through its FIFO, merges the latest barometer and
+// magnetometer readings into every IMU sample and queues the result for the OBC link.
+
+#ifndef NAVIGATOR_ACQUISITION_H_
+#define NAVIGATOR_ACQUISITION_H_
+
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+
+#include <invictus2/navigator_sensors.h>
+
+struct acq_sample {
+    uint32_t seq;          // IMU frame counter, gaps are frames lost to a full queue or FIFO
+                           // (estimated from the time an overrun spans)
+    uint32_t timestamp_us; // Navigator uptime when the IMU frame was sampled
+    navigator_sensors_t sensors;
+};
+
+struct acq_stats {
+    uint32_t imu_samples;
+    uint32_t baro_samples;
+    uint32_t batches;       // FIFO bursts read
+    uint32_t max_batch;     // Largest burst, in frames
+    uint32_t fifo_overruns; // Times the IMU FIFO filled up before it was read
+    uint32_t queue_drops;   // Samples dropped because the queue was full
+    uint32_t errors;        // Failed bus transactions
+};
+
+// Configure the sensors and start the acquisition thread
+// Returns 0 on success, <0 on error (acquisition is not started)
+int acquisition_init(void);
+
+// Next sample, in acquisition order. Returns 0 or -EAGAIN on timeout.
+int acquisition_get(struct acq_sample *sample, k_timeout_t timeout);
+
+void acquisition_get_stats(struct acq_stats *stats);
+
+#endif // NAVIGATOR_ACQUISITION_H_
@@ -0,0 +1,65 @@
+// BMI323 IMU over SPI, FIFO only
+// Zephyr's bmi323 driver reads one sample per sensor_sample_fetch(), this keeps the IMU
+// buffering accelerometer and gyroscope frames in its FIFO and reads them back in bursts.
+
+#ifndef NAVIGATOR_BMI323_H_
+#define NAVIGATOR_BMI323_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/spi.h>
+
+#define BMI323_FIFO_WORDS 1024 // 2 KiB
+
+enum bmi323_odr {
+    BMI323_ODR_400_HZ = 0xA,
+    BMI323_ODR_800_HZ = 0xB,
+    BMI323_ODR_1600_HZ = 0xC,
+};
+
+// One FIFO frame, raw counts in the full scale of the configured ranges
+struct bmi323_frame {
+    int16_t accel[3];
+    int16_t gyro[3];
+};
+
+#define BMI323_FRAME_WORDS (sizeof(struct bmi323_frame) / sizeof(uint16_t))
+
+// Accelerometer word of a frame the IMU had no new data for
+#define BMI323_FIFO_DUMMY 0x7F01
+
+struct bmi323 {
+    struct spi_dt_spec spi;
+    struct gpio_dt_spec irq;
+    struct gpio_callback irq_cb;
+    void (*on_watermark)(void); // Called from the INT1 ISR
+};
+
+struct bmi323_config {
+    enum bmi323_odr odr;     // Shared by the accelerometer and gyroscope
+    uint8_t accel_range_g;   // 2, 4, 8 or 16
+    uint16_t gyro_range_dps; // 125, 250, 500, 1000 or 2000
+    uint16_t watermark;      // FIFO frames that raise INT1
+};
+
+// Reset and configure the IMU, flush its FIFO and enable the watermark interrupt
+// Returns 0 on success, <0 on error
+int bmi323_setup(struct bmi323 *imu, const struct bmi323_config *cfg);
+
+// Frames waiting in the FIFO. *overrun is set when the FIFO is full and old frames were
+// overwritten. Returns <0 on error.
+int bmi323_fifo_frames(struct bmi323 *imu, bool *overrun);
+
+// Read n frames in one SPI transaction
+// Returns 0 on success, <0 on error
+int bmi323_fifo_read(struct bmi323 *imu, struct bmi323_frame *frames, uint16_t n);
+
+// Frames without new data still take their slot in the FIFO, so they keep the timing
+static inline bool bmi323_frame_valid(const struct bmi323_frame *frame)
+{
+    return (uint16_t)frame->accel[0] != BMI323_FIFO_DUMMY;
+}
+
+#endif // NAVIGATOR_BMI323_H_
@@ -0,0 +1,24 @@
+// Navigator <-> OBC link
+// Forwards the acquired samples to the OBC over UART, batched into nav_link frames (see
+// invictus2/nav_link.h), and tracks the OBC clock from the time sync frames it sends back.
+// Samples are stamped in the OBC timebase, in navigator uptime until the first sync frame.
+
+#ifndef NAVIGATOR_OBC_LINK_H_
+#define NAVIGATOR_OBC_LINK_H_
+
+#include <stdint.h>
+
+struct obc_link_stats {
+    uint32_t frames;
+    uint32_t samples;
+    uint32_t tx_errors;
+    uint32_t syncs;        // Time sync frames received
+    int32_t sync_error_us; // OBC time minus its estimate, at the last sync frame
+};
+
+// Start streaming, returns 0 on success, <0 on error
+int obc_link_init(void);
+
+void obc_link_get_stats(struct obc_link_stats *stats);
+
+#endif // NAVIGATOR_OBC_LINK_H_
@@ -0,0 +1,346 @@
+// Navigator acquisition implementation
+//
+// The BMI323 buffers IMU frames in its FIFO and raises INT1 once
+// CONFIG_NAV_IMU_FIFO_WATERMARK frames are waiting. The acquisition thread then drains the
+// FIFO in bursts, one SPI transaction each, so the bus and the CPU are busy once per batch
+// instead of once per sample and a late wake-up costs latency, not samples.
+//
+// The barometers and the magnetometer are slower. They are read on the LPS22DF data-ready
+// interrupt and their latest values are merged into every IMU sample. The FIFO is only
+// drained on the watermark, or once it has not been for IMU_TIMEOUT_MS.
+//
+// Frames are one output period apart. Without an overrun a drain continues from the last
+// frame stamped, and the interrupt time, at which the watermark frame was written, only
+// corrects the drift between the IMU and the MCU clocks. Timestamps never go backwards.
+#include "acquisition.h"
+#include "bmi323.h"
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_REGISTER(acquisition, LOG_LEVEL_INF);
+
+#define IMU_NODE       DT_NODELABEL(bosch_bmi323)
+#define IMU_PERIOD_US  (USEC_PER_SEC / CONFIG_NAV_IMU_ODR_HZ)
+#define IMU_WATERMARK  CONFIG_NAV_IMU_FIFO_WATERMARK
+#define IMU_MAX_BATCH  CONFIG_NAV_IMU_FIFO_MAX_BATCH
+#define IMU_TIMEOUT_MS 100 // No watermark for this long: drain anyway, an edge was missed
+
+#define EVT_IMU  BIT(0)
+#define EVT_BARO BIT(1)
+
+#if CONFIG_NAV_IMU_ODR_HZ == 400
+#define IMU_ODR BMI323_ODR_400_HZ
+#elif CONFIG_NAV_IMU_ODR_HZ == 800
+#define IMU_ODR BMI323_ODR_800_HZ
+#else
+#define IMU_ODR BMI323_ODR_1600_HZ
+#endif
+
+static void imu_watermark_isr(void);
+
+static struct bmi323 s_imu = {
+    .spi = SPI_DT_SPEC_GET(IMU_NODE, SPI_WORD_SET(8) | SPI_TRANSFER_MSB, 0),
+    .irq = GPIO_DT_SPEC_GET(IMU_NODE, int_gpios),
+    .on_watermark = imu_watermark_isr,
+};
+
+static const struct device *const s_baro1 = DEVICE_DT_GET(DT_NODELABEL(st_lps22df));
+// Optional, NULL when absent from the devicetree or not ready
+static const struct device *s_baro2 = DEVICE_DT_GET_OR_NULL(DT_NODELABEL(bosch_bmp581));
+static const struct device *s_mag = DEVICE_DT_GET_OR_NULL(DT_NODELABEL(st_lis2mdl));
+
+static struct bmi323_frame s_frames[IMU_MAX_BATCH];
+static navigator_sensors_t s_slow; // Latest barometer and magnetometer readings
+static struct acq_stats s_stats;
+static atomic_t s_irq_us;
+static uint32_t s_seq;
+static uint32_t s_last_us; // Timestamp of the last frame queued
+static bool s_stamped;     // s_last_us is valid
+
+K_EVENT_DEFINE(s_events);
+K_MSGQ_DEFINE(s_queue, sizeof(struct acq_sample), CONFIG_NAV_ACQ_QUEUE_DEPTH, 4);
+K_THREAD_STACK_DEFINE(s_acq_stack, CONFIG_NAV_ACQ_STACK_SIZE);
+static struct k_thread s_acq_thread;
+
+static uint32_t now_us(void)
+{
+    return (uint32_t)k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+static void imu_watermark_isr(void)
+{
+    atomic_set(&s_irq_us, (atomic_val_t)now_us());
+    k_event_post(&s_events, EVT_IMU);
+}
+
+static void baro_drdy_handler(const struct device *dev, const struct sensor_trigger *trig)
+{
+    ARG_UNUSED(dev);
+    ARG_UNUSED(trig);
+
+    k_event_post(&s_events, EVT_BARO);
+}
+
+// kPa -> deci-hPa
+static uint16_t to_dhpa(const struct sensor_value *kpa)
+{
+    const int32_t dhpa = kpa->val1 * 100 + kpa->val2 / 10000;
+    return (uint16_t)CLAMP(dhpa, 0, UINT16_MAX);
+}
+
+// Gauss -> 0.1 uT
+static int16_t to_dut(const struct sensor_value *gauss)
+{
+    const int32_t dut = gauss->val1 * 1000 + gauss->val2 / 1000;
+    return (int16_t)CLAMP(dut, INT16_MIN, INT16_MAX);
+}
+
+static uint16_t read_baro(const struct device *dev)
+{
+    struct sensor_value press;
+
+    if (dev == NULL) {
+        return 0;
+    }
+
+    int rc = sensor_sample_fetch(dev);
+    if (rc == 0) {
+        rc = sensor_channel_get(dev, SENSOR_CHAN_PRESS, &press);
+    }
+
+    if (rc) {
+        s_stats.errors++;
+        return 0;
+    }
+
+    return to_dhpa(&press);
+}
+
+static void read_slow_sensors(void)
+{
+    s_slow.baro1 = read_baro(s_baro1);
+    s_slow.baro2 = read_baro(s_baro2);
+    s_stats.baro_samples++;
+
+    if (s_mag == NULL) {
+        return;
+    }
+
+    struct sensor_value magn[3];
+    int rc = sensor_sample_fetch(s_mag);
+    if (rc == 0) {
+        rc = sensor_channel_get(s_mag, SENSOR_CHAN_MAGN_XYZ, magn);
+    }
+
+    if (rc) {
+        s_stats.errors++;
+        return;
+    }
+
+    s_slow.mag_x = to_dut(&magn[0]);
+    s_slow.mag_y = to_dut(&magn[1]);
+    s_slow.mag_z = to_dut(&magn[2]);
+}
+
+static void queue_frame(const struct bmi323_frame *frame, uint32_t timestamp_us)
+{
+    // Full scale is +-range over the int16 span
+    const int32_t accel_scale = CONFIG_NAV_IMU_ACCEL_RANGE_G * 1000; // mg
+    const int32_t gyro_scale = CONFIG_NAV_IMU_GYRO_RANGE_DPS * 10;   // 0.1 deg/s
+
+    struct acq_sample sample = {
+        .seq = s_seq++,
+        .timestamp_us = timestamp_us,
+        .sensors = s_slow,
+    };
+
+    sample.sensors.accel_x = (int16_t)((frame->accel[0] * accel_scale) >> 15);
+    sample.sensors.accel_y = (int16_t)((frame->accel[1] * accel_scale) >> 15);
+    sample.sensors.accel_z = (int16_t)((frame->accel[2] * accel_scale) >> 15);
+    sample.sensors.gyro_x = (int16_t)((frame->gyro[0] * gyro_scale) >> 15);
+    sample.sensors.gyro_y = (int16_t)((frame->gyro[1] * gyro_scale) >> 15);
+    sample.sensors.gyro_z = (int16_t)((frame->gyro[2] * gyro_scale) >> 15);
+
+    if (k_msgq_put(&s_queue, &sample, K_NO_WAIT)) {
+        s_stats.queue_drops++;
+    }
+}
+
+// Sample time of the first of frames in the FIFO
+static uint32_t first_frame_us(int frames, bool watermark, bool overrun)
+{
+    // Time of the newest frame, the watermark one was written when INT1 fired
+    uint32_t newest_us;
+    if (watermark && frames >= IMU_WATERMARK) {
+        newest_us = (uint32_t)atomic_get(&s_irq_us) + (frames - IMU_WATERMARK) * IMU_PERIOD_US;
+    } else {
+        newest_us = now_us();
+    }
+
+    const uint32_t ref_us = newest_us - (frames - 1) * IMU_PERIOD_US;
+    if (!s_stamped) {
+        return ref_us;
+    }
+
+    // Frames were lost, the reference is all there is, as long as it does not go back
+    const uint32_t next_us = s_last_us + IMU_PERIOD_US;
+    const int32_t drift = (int32_t)(ref_us - next_us);
+    if (overrun) {
+        return next_us + MAX(drift, 0);
+    }
+
+    // Right after the last frame, only follow the reference slowly: it jitters by up to a
+    // period when it comes from now_us()
+    return next_us + MAX(drift / 8, -(int32_t)IMU_PERIOD_US / 2);
+}
+
+static void drain_imu(bool watermark)
+{
+    bool overrun;
+    int frames = bmi323_fifo_frames(&s_imu, &overrun);
+    if (frames < 0) {
+        s_stats.errors++;
+        return;
+    }
+
+    if (overrun) {
+        s_stats.fifo_overruns++;
+        LOG_WRN_ONCE("IMU FIFO overrun, samples lost");
+    }
+
+    if (frames == 0) {
+        return;
+    }
+
+    uint32_t t_us = first_frame_us(frames, watermark, overrun);
+
+    // The frames an overrun lost still take their sequence numbers, gaps show them
+    if (overrun && s_stamped) {
+        s_seq += (t_us - s_last_us + IMU_PERIOD_US / 2) / IMU_PERIOD_US - 1;
+    }
+
+    while (frames > 0) {
+        const uint16_t n = MIN(frames, IMU_MAX_BATCH);
+
+        if (bmi323_fifo_read(&s_imu, s_frames, n)) {
+            s_stats.errors++;
+            return;
+        }
+
+        for (uint16_t i = 0; i < n; i++, t_us += IMU_PERIOD_US) {
+            if (bmi323_frame_valid(&s_frames[i])) {
+                queue_frame(&s_frames[i], t_us);
+            }
+        }
+
+        // Invalid frames still took their period
+        s_last_us = t_us - IMU_PERIOD_US;
+        s_stamped = true;
+
+        s_stats.imu_samples += n;
+        s_stats.batches++;
+        s_stats.max_batch = MAX(s_stats.max_batch, n);
+
+        frames -= n;
+    }
+}
+
+static void acquisition_thread_entry(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    int64_t last_drain = k_uptime_get();
+
+    while (true) {
+        const uint32_t events =
+            k_event_wait(&s_events, EVT_IMU | EVT_BARO, false, K_MSEC(IMU_TIMEOUT_MS));
+        k_event_clear(&s_events, events);
+
+        // Slow sensors first, so the IMU batch carries the freshest pressure
+        if (events & EVT_BARO) {
+            read_slow_sensors();
+        }
+
+        // A barometer wake-up does not drain a FIFO below the watermark, unless an edge was
+        // missed: the barometer alone would keep the wait from timing out
+        if ((events & EVT_IMU) || k_uptime_get() - last_drain >= IMU_TIMEOUT_MS) {
+            drain_imu(events & EVT_IMU);
+            last_drain = k_uptime_get();
+        }
+    }
+}
+
+int acquisition_get(struct acq_sample *sample, k_timeout_t timeout)
+{
+    return k_msgq_get(&s_queue, sample, timeout);
+}
+
+void acquisition_get_stats(struct acq_stats *stats)
+{
+    // Only the acquisition thread writes them, it cannot run while interrupts are locked
+    const unsigned int key = irq_lock();
+    *stats = s_stats;
+    irq_unlock(key);
+}
+
+static int setup_slow_sensors(void)
+{
+    if (!device_is_ready(s_baro1)) {
+        LOG_ERR("Barometer %s not ready", s_baro1->name);
+        return -ENODEV;
+    }
+
+    if (s_baro2 != NULL && !device_is_ready(s_baro2)) {
+        LOG_WRN("Barometer %s not ready, baro2 disabled", s_baro2->name);
+        s_baro2 = NULL;
+    }
+
+    if (s_mag != NULL && !device_is_ready(s_mag)) {
+        LOG_WRN("Magnetometer %s not ready, disabled", s_mag->name);
+        s_mag = NULL;
+    }
+
+    const struct sensor_trigger drdy = {
+        .type = SENSOR_TRIG_DATA_READY,
+        .chan = SENSOR_CHAN_ALL,
+    };
+
+    return sensor_trigger_set(s_baro1, &drdy, baro_drdy_handler);
+}
+
+int acquisition_init(void)
+{
+    const struct bmi323_config imu_cfg = {
+        .odr = IMU_ODR,
+        .accel_range_g = CONFIG_NAV_IMU_ACCEL_RANGE_G,
+        .gyro_range_dps = CONFIG_NAV_IMU_GYRO_RANGE_DPS,
+        .watermark = IMU_WATERMARK,
+    };
+
+    int rc = setup_slow_sensors();
+    if (rc) {
+        LOG_ERR("Barometer setup failed: %d", rc);
+        return rc;
+    }
+
+    rc = bmi323_setup(&s_imu, &imu_cfg);
+    if (rc) {
+        LOG_ERR("IMU setup failed: %d", rc);
+        return rc;
+    }
+
+    k_tid_t tid = k_thread_create(&s_acq_thread, s_acq_stack,
+                                  K_THREAD_STACK_SIZEOF(s_acq_stack), acquisition_thread_entry,
+                                  NULL, NULL, NULL, CONFIG_NAV_ACQ_THREAD_PRIO, 0, K_NO_WAIT);
+    k_thread_name_set(tid, "acquisition");
+
+    LOG_INF("IMU at %d Hz, read every %d frames", CONFIG_NAV_IMU_ODR_HZ, IMU_WATERMARK);
+    return 0;
+}
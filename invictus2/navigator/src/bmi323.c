@@ -0,0 +1,237 @@
+// BMI323 FIFO implementation
+//
+// Registers are 16 bit, little endian. An SPI read returns one dummy byte after the
+// address byte. FIFO_DATA does not auto-increment, so a burst read from it returns
+// consecutive FIFO words and a whole batch costs one transaction, which the RP2040 SPI
+// driver moves with DMA.
+#include "bmi323.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_REGISTER(bmi323, LOG_LEVEL_INF);
+
+#define REG_CHIP_ID         0x00
+#define REG_ERR             0x01
+#define REG_FIFO_FILL_LEVEL 0x15
+#define REG_FIFO_DATA       0x16
+#define REG_ACC_CONF        0x20
+#define REG_GYR_CONF        0x21
+#define REG_FIFO_WATERMARK  0x35
+#define REG_FIFO_CONF       0x36
+#define REG_FIFO_CTRL       0x37
+#define REG_IO_INT_CTRL     0x38
+#define REG_INT_CONF        0x39
+#define REG_INT_MAP2        0x3B
+#define REG_CMD             0x7E
+
+#define CHIP_ID             0x43
+#define CMD_SOFT_RESET      0xDEAF
+#define SPI_READ            BIT(7)
+#define FIFO_FILL_MASK      GENMASK(10, 0)
+#define CONF_MODE_HIGH_PERF (0x7 << 12)
+#define CONF_RANGE_SHIFT    4
+#define ERR_CONF_MASK       (BIT(5) | BIT(6)) // acc_conf_err, gyr_conf_err
+#define FIFO_CONF_ACC_EN    BIT(9)
+#define FIFO_CONF_GYR_EN    BIT(10)
+#define FIFO_CTRL_FLUSH     BIT(0)
+#define IO_INT1_OUTPUT_EN   BIT(2) // Push-pull, active low (int1_lvl = 0)
+#define INT_MAP2_FWM_INT1   (1 << 8)
+
+static int reg_read(struct bmi323 *imu, uint8_t reg, uint16_t *value)
+{
+    uint8_t addr = reg | SPI_READ;
+    uint8_t data[2];
+
+    const struct spi_buf tx_buf = {.buf = &addr, .len = 1};
+    const struct spi_buf rx_bufs[] = {
+        {.buf = NULL, .len = 2}, // Address and dummy byte
+        {.buf = data, .len = sizeof(data)},
+    };
+    const struct spi_buf_set tx = {.buffers = &tx_buf, .count = 1};
+    const struct spi_buf_set rx = {.buffers = rx_bufs, .count = ARRAY_SIZE(rx_bufs)};
+
+    int rc = spi_transceive_dt(&imu->spi, &tx, &rx);
+    if (rc == 0) {
+        *value = sys_get_le16(data);
+    }
+    return rc;
+}
+
+static int reg_write(struct bmi323 *imu, uint8_t reg, uint16_t value)
+{
+    uint8_t data[3] = {reg};
+    sys_put_le16(value, &data[1]);
+
+    const struct spi_buf tx_buf = {.buf = data, .len = sizeof(data)};
+    const struct spi_buf_set tx = {.buffers = &tx_buf, .count = 1};
+
+    return spi_write_dt(&imu->spi, &tx);
+}
+
+static uint16_t accel_range_bits(uint8_t range_g)
+{
+    switch (range_g) {
+    case 2:
+        return 0;
+    case 4:
+        return 1;
+    case 8:
+        return 2;
+    default:
+        return 3; // 16 g
+    }
+}
+
+static uint16_t gyro_range_bits(uint16_t range_dps)
+{
+    switch (range_dps) {
+    case 125:
+        return 0;
+    case 250:
+        return 1;
+    case 500:
+        return 2;
+    case 1000:
+        return 3;
+    default:
+        return 4; // 2000 dps
+    }
+}
+
+static void irq_handler(const struct device *port, struct gpio_callback *cb, uint32_t pins)
+{
+    ARG_UNUSED(port);
+    ARG_UNUSED(pins);
+
+    struct bmi323 *imu = CONTAINER_OF(cb, struct bmi323, irq_cb);
+    if (imu->on_watermark != NULL) {
+        imu->on_watermark();
+    }
+}
+
+static int setup_irq(struct bmi323 *imu)
+{
+    if (!gpio_is_ready_dt(&imu->irq)) {
+        return -ENODEV;
+    }
+
+    int rc = gpio_pin_configure_dt(&imu->irq, GPIO_INPUT);
+    if (rc) {
+        return rc;
+    }
+
+    gpio_init_callback(&imu->irq_cb, irq_handler, BIT(imu->irq.pin));
+    rc = gpio_add_callback_dt(&imu->irq, &imu->irq_cb);
+    if (rc) {
+        return rc;
+    }
+
+    return gpio_pin_interrupt_configure_dt(&imu->irq, GPIO_INT_EDGE_TO_ACTIVE);
+}
+
+int bmi323_setup(struct bmi323 *imu, const struct bmi323_config *cfg)
+{
+    if (!spi_is_ready_dt(&imu->spi)) {
+        return -ENODEV;
+    }
+
+    if (cfg->watermark == 0 || cfg->watermark * BMI323_FRAME_WORDS >= BMI323_FIFO_WORDS) {
+        return -EINVAL;
+    }
+
+    uint16_t value;
+
+    // The interface comes up in I2C mode, the first chip select edge switches it to SPI
+    (void)reg_read(imu, REG_CHIP_ID, &value);
+
+    int rc = reg_write(imu, REG_CMD, CMD_SOFT_RESET);
+    if (rc) {
+        return rc;
+    }
+
+    k_msleep(2);
+    (void)reg_read(imu, REG_CHIP_ID, &value);
+
+    rc = reg_read(imu, REG_CHIP_ID, &value);
+    if (rc) {
+        return rc;
+    }
+
+    if ((value & 0xFF) != CHIP_ID) {
+        LOG_ERR("Unexpected chip id 0x%02x", value & 0xFF);
+        return -ENODEV;
+    }
+
+    const uint16_t acc_conf =
+        CONF_MODE_HIGH_PERF | (accel_range_bits(cfg->accel_range_g) << CONF_RANGE_SHIFT) |
+        cfg->odr;
+    const uint16_t gyr_conf =
+        CONF_MODE_HIGH_PERF | (gyro_range_bits(cfg->gyro_range_dps) << CONF_RANGE_SHIFT) |
+        cfg->odr;
+
+    const struct {
+        uint8_t reg;
+        uint16_t value;
+    } writes[] = {
+        {REG_ACC_CONF, acc_conf},
+        {REG_GYR_CONF, gyr_conf},
+        {REG_FIFO_CONF, FIFO_CONF_ACC_EN | FIFO_CONF_GYR_EN},
+        {REG_FIFO_WATERMARK, cfg->watermark * BMI323_FRAME_WORDS},
+        {REG_IO_INT_CTRL, IO_INT1_OUTPUT_EN},
+        {REG_INT_CONF, 0}, // Non latched, INT1 follows the watermark condition
+        {REG_INT_MAP2, INT_MAP2_FWM_INT1},
+        {REG_FIFO_CTRL, FIFO_CTRL_FLUSH},
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(writes); i++) {
+        rc = reg_write(imu, writes[i].reg, writes[i].value);
+        if (rc) {
+            return rc;
+        }
+    }
+
+    rc = reg_read(imu, REG_ERR, &value);
+    if (rc) {
+        return rc;
+    }
+
+    if (value & ERR_CONF_MASK) {
+        LOG_ERR("Sensor configuration rejected: 0x%04x", value);
+        return -EINVAL;
+    }
+
+    return setup_irq(imu);
+}
+
+int bmi323_fifo_frames(struct bmi323 *imu, bool *overrun)
+{
+    uint16_t fill;
+
+    int rc = reg_read(imu, REG_FIFO_FILL_LEVEL, &fill);
+    if (rc) {
+        return rc;
+    }
+
+    fill &= FIFO_FILL_MASK;
+    *overrun = fill > BMI323_FIFO_WORDS - BMI323_FRAME_WORDS;
+    return fill / BMI323_FRAME_WORDS;
+}
+
+int bmi323_fifo_read(struct bmi323 *imu, struct bmi323_frame *frames, uint16_t n)
+{
+    uint8_t addr = REG_FIFO_DATA | SPI_READ;
+
+    const struct spi_buf tx_buf = {.buf = &addr, .len = 1};
+    const struct spi_buf rx_bufs[] = {
+        {.buf = NULL, .len = 2}, // Address and dummy byte
+        {.buf = frames, .len = n * sizeof(*frames)},
+    };
+    const struct spi_buf_set tx = {.buffers = &tx_buf, .count = 1};
+    const struct spi_buf_set rx = {.buffers = rx_bufs, .count = ARRAY_SIZE(rx_bufs)};
+
+    // FIFO words are little endian like the RP2040, frames are read in place
+    return spi_transceive_dt(&imu->spi, &tx, &rx);
+}
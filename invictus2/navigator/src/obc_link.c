@@ -0,0 +1,194 @@
+// Navigator <-> OBC link implementation
+//
+// Samples leave the acquisition queue in the bursts the IMU FIFO produces them in, so a
+// batch is simply whatever is queued, up to NAV_LINK_MAX_BATCH samples. Two frame buffers
+// alternate: the next frame is encoded while the UART sends the previous one with the async
+// API, so the thread only waits on the UART when the link is the bottleneck.
+//
+// The OBC only sends time sync frames, a few bytes a second. They are decoded straight from
+// the UART callback, so the reception time they are paired with is not delayed by the
+// scheduling of any thread.
+#include "obc_link.h"
+#include "acquisition.h"
+
+#include <string.h>
+
+#include <invictus2/nav_link.h>
+#include <invictus2/timesync.h>
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(obc_link, LOG_LEVEL_INF);
+
+static const struct device *const s_uart = DEVICE_DT_GET(DT_ALIAS(obc_uart));
+
+static uint8_t s_tx_bufs[2][NAV_LINK_MAX_FRAME];
+static navigator_sample_t s_batch[NAV_LINK_MAX_BATCH];
+static struct obc_link_stats s_stats;
+
+static uint8_t s_rx_bufs[2][32];
+static uint8_t s_next_rx_buf;
+static struct nav_link_decoder s_rx_decoder;
+static uint64_t s_rx_time_us; // Uptime the last received chunk completed at
+
+static struct timesync s_sync; // OBC clock model, only touched with interrupts locked
+
+K_SEM_DEFINE(s_tx_idle, 1, 1);
+K_THREAD_STACK_DEFINE(s_link_stack, CONFIG_NAV_LINK_STACK_SIZE);
+static struct k_thread s_link_thread;
+
+static int rx_enable(void)
+{
+    int rc = uart_rx_enable(s_uart, s_rx_bufs[s_next_rx_buf], sizeof(s_rx_bufs[0]),
+                            CONFIG_NAV_LINK_RX_TIMEOUT_USEC);
+    s_next_rx_buf = !s_next_rx_buf;
+    return rc;
+}
+
+// Runs in the UART callback (ISR), to_obc_time() locks interrupts to read s_sync
+static void on_rx_frame(const struct nav_link_frame *frame, void *user_data)
+{
+    ARG_UNUSED(user_data);
+
+    if (frame->header.type != NAV_LINK_SYNC) {
+        return;
+    }
+
+    struct nav_link_sync sync;
+    memcpy(&sync, frame->samples, sizeof(sync));
+
+    timesync_update(&s_sync, sync.master_us, s_rx_time_us - CONFIG_NAV_TIMESYNC_LATENCY_USEC);
+    s_stats.syncs++;
+    s_stats.sync_error_us = s_sync.last_error_us;
+}
+
+static void uart_cb(const struct device *dev, struct uart_event *evt, void *user_data)
+{
+    ARG_UNUSED(user_data);
+
+    switch (evt->type) {
+    case UART_RX_RDY:
+        s_rx_time_us = timesync_uptime_us();
+        nav_link_decode(&s_rx_decoder, &evt->data.rx.buf[evt->data.rx.offset],
+                        evt->data.rx.len, on_rx_frame, NULL);
+        break;
+    case UART_RX_BUF_REQUEST:
+        uart_rx_buf_rsp(dev, s_rx_bufs[s_next_rx_buf], sizeof(s_rx_bufs[0]));
+        s_next_rx_buf = !s_next_rx_buf;
+        break;
+    case UART_RX_DISABLED:
+        // After a line error, the OBC keeps sending sync frames
+        rx_enable();
+        break;
+    case UART_TX_DONE:
+        k_sem_give(&s_tx_idle);
+        break;
+    case UART_TX_ABORTED:
+        s_stats.tx_errors++;
+        k_sem_give(&s_tx_idle);
+        break;
+    default:
+        break;
+    }
+}
+
+// Acquisition timestamp (low 32 bits of the uptime, recent) -> OBC time
+static uint64_t to_obc_time(uint32_t timestamp_us)
+{
+    const uint64_t now = timesync_uptime_us();
+    const uint64_t local = now - (uint32_t)((uint32_t)now - timestamp_us);
+
+    const unsigned int key = irq_lock();
+    const uint64_t obc_us = timesync_to_master(&s_sync, local);
+    irq_unlock(key);
+
+    return obc_us;
+}
+
+static uint8_t collect_batch(void)
+{
+    struct acq_sample sample;
+    uint8_t n = 0;
+
+    // Block for the first sample only, the rest of its FIFO burst is already queued
+    k_timeout_t timeout = K_FOREVER;
+
+    while (n < NAV_LINK_MAX_BATCH && acquisition_get(&sample, timeout) == 0) {
+        s_batch[n].timestamp_us = to_obc_time(sample.timestamp_us);
+        s_batch[n].sensors = sample.sensors;
+        n++;
+        timeout = K_NO_WAIT;
+    }
+
+    return n;
+}
+
+static void link_thread_entry(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    uint16_t seq = 0;
+    int next = 0;
+
+    while (true) {
+        const uint8_t n = collect_batch();
+        const size_t len = nav_link_encode(NAV_LINK_SENSORS, seq, s_batch, n,
+                                           s_tx_bufs[next], sizeof(s_tx_bufs[next]));
+
+        // The other buffer may still be on the wire
+        k_sem_take(&s_tx_idle, K_FOREVER);
+
+        int rc = uart_tx(s_uart, s_tx_bufs[next], len, SYS_FOREVER_US);
+        if (rc) {
+            s_stats.tx_errors++;
+            k_sem_give(&s_tx_idle);
+            continue;
+        }
+
+        seq++;
+        next = !next;
+        s_stats.frames++;
+        s_stats.samples += n;
+    }
+}
+
+void obc_link_get_stats(struct obc_link_stats *stats)
+{
+    const unsigned int key = irq_lock();
+    *stats = s_stats;
+    irq_unlock(key);
+}
+
+int obc_link_init(void)
+{
+    if (!device_is_ready(s_uart)) {
+        LOG_ERR("OBC UART not ready");
+        return -ENODEV;
+    }
+
+    int rc = uart_callback_set(s_uart, uart_cb, NULL);
+    if (rc) {
+        LOG_ERR("UART async API not available: %d", rc);
+        return rc;
+    }
+
+    nav_link_decoder_init(&s_rx_decoder);
+    timesync_init(&s_sync);
+
+    rc = rx_enable();
+    if (rc) {
+        LOG_ERR("Failed to start OBC reception: %d", rc);
+        return rc;
+    }
+
+    k_tid_t tid = k_thread_create(&s_link_thread, s_link_stack,
+                                  K_THREAD_STACK_SIZEOF(s_link_stack), link_thread_entry, NULL,
+                                  NULL, NULL, CONFIG_NAV_LINK_THREAD_PRIO, 0, K_NO_WAIT);
+    k_thread_name_set(tid, "obc_link");
+    return 0;
+}
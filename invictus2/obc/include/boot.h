@@ -0,0 +1,38 @@
+#ifndef OBC_BOOT_H_
+#define OBC_BOOT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Staged, concurrent bring-up of the services.
+//
+// A stage holds services that only depend on the earlier stages. Each service of a stage
+// is set up then started by a boot thread of its own, up to CONFIG_BOOT_THREADS at a time,
+// so a service waiting on its hardware does not hold the others back. The next stage only
+// begins once every service of the current one is up, a failed setup ends the boot.
+//
+// The time from reset to the first telemetry message, the first sample, estimate or
+// rocket state published on zbus, is measured and logged.
+
+struct boot_service
+{
+    const char *name;
+    uint8_t stage;
+    bool (*setup)(void); // Optional
+    void (*start)(void); // Optional, once setup succeeded
+};
+
+struct boot_stats
+{
+    uint32_t services_up_ms;     // Uptime once the last stage is up, 0 until then
+    uint32_t first_telemetry_ms; // Uptime of the first telemetry message, 0 until then
+    const char *first_telemetry; // Channel it was published on, NULL until then
+};
+
+// Returns false if a service failed to set up
+bool boot_run(const struct boot_service *services, size_t count);
+
+void boot_get_stats(struct boot_stats *stats);
+
+#endif // OBC_BOOT_H_
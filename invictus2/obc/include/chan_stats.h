@@ -0,0 +1,67 @@
+#ifndef OBC_CHAN_STATS_H_
+#define OBC_CHAN_STATS_H_
+
+#include <stdint.h>
+
+#include "data_models.h"
+
+#include "zephyr/kernel.h"
+#include "zephyr/sys/atomic.h"
+#include "zephyr/zbus/zbus.h"
+
+// Per channel zbus statistics, to tell which channels should rather be message queues.
+//
+// The user data of each channel of main.c is its struct chan_stats, CHAN_STATS(). Publishes
+// and reads go through chan_stats_pub() and chan_stats_read(), listeners are defined with
+// CHAN_STATS_LISTENER_DEFINE(), which time them. A channel without statistics, NULL user
+// data, is passed through as is.
+//
+// Every CONFIG_CHAN_STATS_INTERVAL_MSEC the counters are turned into a bus_stats_t, the
+// rates and maxima over the last period, published on chan_bus_stats, which the SD logger
+// records, and shown by the `bus` shell command. They are not sent to the ground, the OBC has
+// no downlink yet. A bus_stats_t is larger than a packet payload, it will take a frame per
+// group of channels.
+
+struct chan_stats
+{
+    atomic_t pubs;
+    atomic_t pub_errors;
+    atomic_t read_busy;
+    atomic_t listener_runs;
+    atomic_t listener_cycles; // Sum, wraps around, only differences matter
+    atomic_t max_pub_cycles;  // Maxima since the last sample
+    atomic_t max_listener_cycles;
+    atomic_t max_latency_cycles;
+    atomic_t max_read_cycles;
+    uint32_t pub_start; // Cycles, of the publish running the listeners
+};
+
+extern struct chan_stats chan_stats[_BUS_CHAN_MAX];
+
+// User data of the channel
+#define CHAN_STATS(_id) (&chan_stats[_id])
+
+int chan_stats_pub(const struct zbus_channel *chan, const void *msg, k_timeout_t timeout);
+int chan_stats_read(const struct zbus_channel *chan, void *msg, k_timeout_t timeout);
+
+uint32_t chan_stats_listener_begin(const struct zbus_channel *chan);
+void chan_stats_listener_end(const struct zbus_channel *chan, uint32_t start);
+
+// ZBUS_LISTENER_DEFINE() timing the callback
+#define CHAN_STATS_LISTENER_DEFINE(_name, _cb)                                                \
+    static void _name##_timed_cb(const struct zbus_channel *chan)                             \
+    {                                                                                         \
+        const uint32_t start = chan_stats_listener_begin(chan);                               \
+        _cb(chan);                                                                            \
+        chan_stats_listener_end(chan, start);                                                 \
+    }                                                                                         \
+    ZBUS_LISTENER_DEFINE(_name, _name##_timed_cb)
+
+void chan_stats_start(void);
+
+const char *chan_stats_name(bus_chan_t chan);
+
+// Latest sample, zeroed until the first one is taken
+void chan_stats_get(bus_stats_t *stats);
+
+#endif // OBC_CHAN_STATS_H_
@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 
+#include "invictus2/navigator_sensors.h"
+
 typedef enum
 {
     _MAIN_STATE_START = 0,
@@ -141,6 +143,9 @@ typedef union
     uint16_t raw;
 } actuators_bitmap_t;
 
+// A thermocouple without a reading, served as such by the HYDRA (HYDRA_TEMPERATURE_INVALID)
+#define THERMO_INVALID INT16_MIN
+
 typedef union
 {
     struct
@@ -186,33 +191,152 @@ typedef union
     uint16_t raw[5];
 } loadcell_weights_t;
 
+// navigator_sensors_t and kalman_data_t are shared with the navigator, see
+// invictus2/navigator_sensors.h
+
+// Sensor channel messages: the readings stamped with the time they were taken at, in the
+// OBC timebase (see invictus2/timesync.h). Only the readings go into system_data_t.
+typedef struct
+{
+    uint64_t timestamp_us; // Oldest of the HYDRA samples merged, 0 if none is connected
+    thermocouples_t thermocouples;
+} thermo_sample_t;
+
+typedef struct
+{
+    uint64_t timestamp_us; // Oldest of the HYDRA samples merged, 0 if none is connected
+    pressures_t pressures;
+} pressure_sample_t;
+
+typedef struct
+{
+    uint64_t timestamp_us; // When the LIFT boards were read, they do not serve a sample time
+    loadcell_weights_t weights;
+} weight_sample_t;
+
+// Modbus slaves tracked by the bus health monitor
+typedef enum
+{
+    MODBUS_SLAVE_UF_HYDRA = 0,
+    MODBUS_SLAVE_LF_HYDRA,
+    MODBUS_SLAVE_FS_HYDRA,
+    MODBUS_SLAVE_ROCKET_LIFT,
+    MODBUS_SLAVE_FS_LIFT,
+
+    _MODBUS_SLAVE_COUNT,
+} modbus_slave_t;
+
 typedef struct
 {
-    // GPS:
-    uint32_t gps_latitude_u32;  // reinterpret-casted float bits
-    uint32_t gps_longitude_u32; // reinterpret-casted float bits
-    uint16_t gps_altitude;      // altitude in meters
-    uint16_t gps_hspeed;        // horizontal speed (units TBD)
-    uint8_t gps_sats;           // gps number of satelites
-    uint8_t _reserved;          // extra byte for alignment
+    uint8_t slave_id;
+    uint8_t is_connected;
+    uint16_t consecutive_errors;
+    uint32_t total_reads;
+    uint32_t total_errors;
+    uint32_t avg_latency_us;
+    uint32_t max_latency_us;
+    uint32_t backoff_ms; // 0 while the slave is connected
+} modbus_slave_health_t;
 
-    // Barometers:
-    uint16_t baro1, baro2;
+typedef struct
+{
+    modbus_slave_health_t slaves[_MODBUS_SLAVE_COUNT];
+} modbus_health_t;
 
-    // IMU:
-    int16_t mag_x, mag_y, mag_z;       // Magnetometer
-    int16_t gyro_x, gyro_y, gyro_z;    // Gyroscope
-    int16_t accel_x, accel_y, accel_z; // Accelerometer
-} navigator_sensors_t;
+// Stages a ground command goes through, in order, see services/cmd_latency.h
+typedef enum
+{
+    CMD_STAGE_RX = 0,       // Received from the radio (or the shell)
+    CMD_STAGE_PUBLISHED,    // Published on chan_packets, synchronous listeners done
+    CMD_STAGE_SM_COMMAND,   // Taken by the state machine command work
+    CMD_STAGE_SM_RUN,       // State machine run with the command
+    CMD_STAGE_ACTUATORS,    // Resulting actuator state published on chan_actuators
+    CMD_STAGE_MODBUS_WRITE, // Valve write on the Modbus bus done
+
+    _CMD_STAGE_MAX,
+} cmd_stage_t;
+
+// Latency of one command, published on chan_cmd_latency once it is done
+typedef struct
+{
+    uint32_t id;                       // Correlation ID, in order of reception
+    uint8_t command_id;                // command_t
+    uint8_t last_stage;                // Last cmd_stage_t the command reached
+    uint32_t stage_us[_CMD_STAGE_MAX]; // Time from reception to each stage, 0 if skipped
+    uint64_t rx_timestamp_us;          // Reception time, OBC uptime
+} cmd_latency_t;
+
+// Threads and work queues monitored by the health service, see services/health.h
+typedef enum
+{
+    HEALTH_SYS_WORK_Q = 0,
+    HEALTH_SM_WORK_Q,
+    HEALTH_FLIGHT_EXEC,
+    HEALTH_KALMAN_WORK_Q,
+    HEALTH_NAVIGATOR_WORK_Q,
+    HEALTH_SD_LOGGER_WORK_Q,
+    HEALTH_MODBUS_WORK_Q,
+    HEALTH_LORA,
+    HEALTH_SUPERVISOR,
+
+    _HEALTH_SERVICE_MAX,
+} health_service_t;
+
+typedef struct
+{
+    uint16_t cpu_permille; // Share of the CPU time over the last period
+    uint16_t stack_used;   // Stack high-water mark, in bytes
+    uint16_t stack_size;   // 0 if the service is not running
+    uint8_t backlog;       // Work items pending on the queue, 0 for plain threads
+    uint8_t max_backlog;   // Since boot
+} health_service_sample_t;
+
+typedef struct
+{
+    uint64_t timestamp_us;
+    uint16_t cpu_load_permille; // Non-idle share of the CPU time over the last period
+    uint16_t period_ms;
+    health_service_sample_t services[_HEALTH_SERVICE_MAX];
+} health_sample_t;
+
+// Channels profiled by the channel statistics, see chan_stats.h
+typedef enum
+{
+    BUS_CHAN_THERMO = 0,
+    BUS_CHAN_PRESSURE,
+    BUS_CHAN_WEIGHT,
+    BUS_CHAN_NAVIGATOR,
+    BUS_CHAN_KALMAN,
+    BUS_CHAN_ACTUATORS,
+    BUS_CHAN_MODBUS_HEALTH,
+    BUS_CHAN_PACKETS,
+    BUS_CHAN_ROCKET_STATE,
+    BUS_CHAN_HEALTH,
+    BUS_CHAN_CMD_LATENCY,
+    BUS_CHAN_BUS_STATS,
+
+    _BUS_CHAN_MAX,
+} bus_chan_t;
+
+// Over the last period, all times in us
+typedef struct
+{
+    uint16_t pubs_per_sec;
+    uint16_t pub_errors;      // Publishes that failed or timed out
+    uint16_t max_pub_us;      // Publish call, synchronous listeners included
+    uint16_t avg_listener_us; // Per listener run
+    uint16_t max_listener_us;
+    uint16_t max_latency_us; // From the publish call to a listener running
+    uint16_t read_busy;      // Reads that timed out waiting for the channel
+    uint16_t max_read_us;    // Read call, waiting for the channel included
+} bus_chan_sample_t;
 
 typedef struct
 {
-    int16_t vertical_speed;
-    int16_t vertical_acceleration;
-    int16_t altitude;
-    int16_t max_altitude;
-    int16_t quaternions[4];
-} kalman_data_t;
+    uint64_t timestamp_us;
+    uint16_t period_ms;
+    bus_chan_sample_t chans[_BUS_CHAN_MAX];
+} bus_stats_t;
 
 typedef struct state_data_s
 {
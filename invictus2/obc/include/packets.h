@@ -103,6 +103,7 @@ enum manual_cmd_e
     MANUAL_CMD_VALVE_MS,
     MANUAL_CMD_LOADCELL_TARE,
     MANUAL_CMD_TANK_TARE,
+    MANUAL_CMD_FILL_CONTROL,
 
     _MANUAL_CMD_MAX
 };
@@ -124,6 +125,13 @@ struct manual_tare_s
     uint8_t id; // loadcell or tank id
 };
 
+// Proportional fill valve loop of the filling station hydra, only enabled while filling
+struct manual_fill_control_s
+{
+    uint16_t setpoint; // deci-bar
+    uint8_t enable;    // boolean: 0 closes the valve and stops the loop, 1 runs it
+};
+
 // same logic as struct fill_exec_s
 struct manual_exec_s
 {
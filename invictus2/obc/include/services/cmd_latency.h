@@ -0,0 +1,62 @@
+#ifndef OBC_CMD_LATENCY_H_
+#define OBC_CMD_LATENCY_H_
+
+#include <stdint.h>
+
+#include "data_models.h"
+
+// End-to-end latency of the ground commands, from reception on the radio to the valve
+// write on the Modbus bus.
+//
+// Every received command gets a correlation ID and its reception time, then the services
+// it goes through stamp the stages (cmd_stage_t) they complete for it, by ID. The ID goes
+// along with the command: the listeners of chan_packets take it with cmd_latency_last()
+// and keep it in their queue entry, so commands queued behind each other are each stamped
+// on their own. The first stamp of a stage wins, a command only goes through the stages
+// that apply to it (e.g. a valve pulse goes straight from chan_packets to the Modbus
+// service).
+//
+// Up to CONFIG_CMD_LATENCY_TRACED commands are traced at once. A command is done once it
+// reaches CMD_STAGE_MODBUS_WRITE, after CONFIG_CMD_LATENCY_TIMEOUT_MSEC or when the oldest
+// one makes room for a new command. Its cmd_latency_t is then published on
+// chan_cmd_latency and accounted in the per stage statistics.
+//
+// The latencies are recorded by the SD logger and shown by the `latency` shell command.
+// They are not sent to the ground: the OBC has no downlink yet, the LoRa service is not
+// brought up at boot and no OBC to ground packet is sent. Once there is one, a cmd_latency_t
+// fits a packet payload.
+
+struct cmd_latency_stage_stats
+{
+    uint32_t count;   // Commands that reached the stage
+    uint32_t last_us; // Time from reception, for the last of them
+    uint32_t max_us;
+    uint32_t avg_us;
+};
+
+struct cmd_latency_stats
+{
+    uint32_t commands; // Commands done
+    struct cmd_latency_stage_stats stages[_CMD_STAGE_MAX];
+    uint32_t last_total_us; // Reception to last stage reached, for the last command
+    uint32_t max_total_us;
+};
+
+// No command, e.g. a state machine run without one. Never given to a command.
+#define CMD_LATENCY_NONE 0
+
+// Stamp CMD_STAGE_RX for a new command, returns its ID
+uint32_t cmd_latency_rx(uint8_t command_id);
+
+// Stamp a stage of a command. Ignored for CMD_LATENCY_NONE or a command already done, but
+// recorded as the last one for the stage all the same.
+void cmd_latency_stamp(uint32_t id, cmd_stage_t stage);
+
+// ID of the last command stamped at a stage. For the synchronous listeners of the channel
+// published right after the stamp, they run in the publisher's thread: CMD_STAGE_RX for
+// chan_packets, CMD_STAGE_SM_RUN for chan_actuators.
+uint32_t cmd_latency_last(cmd_stage_t stage);
+
+void cmd_latency_get_stats(struct cmd_latency_stats *stats);
+
+#endif // OBC_CMD_LATENCY_H_
@@ -0,0 +1,27 @@
+#ifndef OBC_CONFIG_STORE_H_
+#define OBC_CONFIG_STORE_H_
+
+#include <stdbool.h>
+
+#include "services/state_machine/main_sm_config.h"
+
+// Keeps the state machine configuration (filling thresholds and flight parameters) in an
+// NVS file system on the storage_partition flash partition, so the values set with
+// CMD_FILL_EXEC survive a reset. NVS spreads the writes over the partition sectors and
+// checks every entry with a CRC.
+//
+// The configuration is stored as a single versioned entry, an entry written by a firmware
+// with a different struct sm_config layout is ignored and the defaults are used instead.
+// Saves are coalesced: the flash is only written once the configuration has not changed
+// for CONFIG_CONFIG_STORE_SAVE_DELAY_MSEC, and not at all if it is the one stored. A save
+// due in flight mode (sm_flight_mode()) waits until the state machine is back on the ground.
+
+bool config_store_service_setup(void);
+
+// Overwrite config with the stored one, false (config untouched) if there is none
+bool config_store_load(struct sm_config *config);
+
+// Schedule config to be written, it is copied so the caller may keep changing it
+void config_store_save(const struct sm_config *config);
+
+#endif // OBC_CONFIG_STORE_H_
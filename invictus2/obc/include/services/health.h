@@ -0,0 +1,32 @@
+#ifndef OBC_HEALTH_H_
+#define OBC_HEALTH_H_
+
+#include <stdbool.h>
+
+#include "data_models.h"
+
+#include "zephyr/kernel.h"
+
+// CPU and stack utilization of the service threads and work queues.
+//
+// Services register the thread or work queue they run on, then every
+// CONFIG_HEALTH_SAMPLE_INTERVAL_MSEC the health service samples for each of them the share
+// of CPU time used since the previous sample, the stack high-water mark and, for work
+// queues, the number of pending work items. The health_sample_t is published on
+// chan_health, which the SD logger records, and shown by the `health` shell command.
+//
+// A stack going over CONFIG_HEALTH_STACK_WARN_PERCENT of its size is logged.
+
+bool health_service_setup(void);
+void health_service_start(void);
+
+// Once the thread or work queue is started, not before
+void health_register_thread(health_service_t service, k_tid_t thread);
+void health_register_work_q(health_service_t service, struct k_work_q *work_q);
+
+const char *health_service_name(health_service_t service);
+
+// Latest sample, zeroed until the first one is taken
+void health_get_sample(health_sample_t *sample);
+
+#endif // OBC_HEALTH_H_
@@ -0,0 +1,24 @@
+#ifndef OBC_KALMAN_H_
+#define OBC_KALMAN_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Runs the navigation filter (services/kalman/filter.h) on every navigator sample and
+// publishes the estimate on chan_kalman_data.
+
+struct kalman_stats
+{
+    uint32_t runs;
+    uint32_t dropped; // Samples that found the queue full
+    uint32_t last_us; // Filter update time of the last sample
+    uint32_t max_us;
+    uint32_t avg_us;
+};
+
+bool kalman_service_setup(void);
+void kalman_service_start(void);
+
+void kalman_get_stats(struct kalman_stats *stats);
+
+#endif // OBC_KALMAN_H_
@@ -0,0 +1,83 @@
+#ifndef KALMAN_FILTER_H_
+#define KALMAN_FILTER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "data_models.h"
+
+/*
+ * Navigation filter, integer only at run time.
+ *
+ * Attitude: the gyro rates are integrated into a Q30 quaternion (body to world, z up),
+ * aligned to gravity while the rocket sits still on the pad.
+ *
+ * Vertical channel: a two state (altitude, vertical speed) Kalman filter, driven by the
+ * world frame vertical acceleration on every IMU sample and corrected by the barometric
+ * altitude every baro_decimation samples. Its gains are the steady state ones for those
+ * rates and noise figures, solved once at init (in float) so the update is a handful of
+ * integer multiply-adds. Altitudes are relative to the pressure seen at alignment.
+ *
+ * Every update propagates over the time since the previous sample, so a sample lost on
+ * the navigator link does not lose its share of the motion. Gaps are capped at
+ * KF_MAX_DT_US, a longer one is a link restart, not motion to integrate.
+ *
+ * Units follow navigator_sensors_t and kalman_data_t, see data_models.h.
+ */
+
+#define KF_Q30_ONE   (1 << 30)
+#define KF_MAX_DT_US 100000
+
+struct kf_params
+{
+    uint32_t imu_period_us;    // Nominal, the gains are solved for it
+    uint16_t baro_decimation;  // IMU samples per baro correction
+    uint32_t accel_noise_mms2; // Vertical acceleration process noise, 1 sigma
+    uint32_t baro_noise_mm;    // Barometric altitude noise, 1 sigma
+    uint16_t launch_accel_mg;  // Acceleration that ends pad alignment
+    uint16_t align_samples;    // Still samples needed to (re)align on the pad
+};
+
+struct kf_state
+{
+    /* Vertical channel, in um and um/s to keep the per sample increments */
+    int64_t altitude_um;
+    int64_t speed_ums;
+    int32_t max_altitude_m;
+    int32_t accel_mms2;
+
+    int32_t q[4]; // w, x, y, z in Q30
+
+    /* Precomputed at init */
+    uint32_t period_us;     // Nominal IMU period
+    int32_t gyro_half_q46;  // 0.1 deg/s -> half rotation angle per us, Q46
+    int32_t k_alt_q16;      // Altitude gain, Q16
+    int32_t k_speed_q16;    // Speed gain in 1/s, Q16
+    uint16_t baro_decimation;
+    uint16_t launch_accel_mg;
+    uint16_t align_samples;
+
+    /* Pad alignment */
+    bool launched;
+    uint16_t still_samples;
+    uint16_t since_baro;
+    int32_t accel_sum[3];
+    uint32_t baro_sum;
+    bool aligned;
+    int32_t ground_altitude_mm; // ISA altitude of the alignment pressure
+};
+
+// Solve the gains and reset the state, returns false on invalid parameters
+bool kf_init(struct kf_state *kf, const struct kf_params *params);
+
+// Feed one navigator sample, dt_us after the previous one. 0 for the nominal IMU period,
+// e.g. on the first sample.
+void kf_update(struct kf_state *kf, const navigator_sensors_t *sample, uint32_t dt_us);
+
+// Current estimate, in kalman_data_t units
+void kf_output(const struct kf_state *kf, kalman_data_t *out);
+
+// ISA pressure altitude of a pressure in deci-hPa, in mm
+int32_t kf_baro_altitude_mm(uint16_t pressure_dhpa);
+
+#endif // KALMAN_FILTER_H_
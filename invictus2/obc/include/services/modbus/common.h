@@ -2,15 +2,74 @@
 #define MODBUS_COMMON_H
 
 #include <stdint.h>
+#include <stdbool.h>
+
+// Per-slave bus health, updated on every transaction with that slave.
+struct modbus_slave_health {
+    uint32_t total_reads;        // Transactions attempted (probes included)
+    uint32_t total_errors;       // Transactions that failed
+    uint16_t consecutive_errors; // Failures since the last successful transaction
+    uint16_t skipped_polls;      // Polls skipped while backing off since the last probe
+
+    uint32_t last_latency_us; // Duration of the last transaction
+    uint32_t max_latency_us;  // Worst transaction duration seen
+    uint32_t avg_latency_us;  // Exponential moving average (1/8 weight) of durations
+
+    uint32_t backoff_ms;  // Current probe interval while disconnected
+    int64_t next_poll_ms; // Uptime at which the next probe is allowed
+};
 
 struct modbus_slave_metadata {
-    uint8_t slave_id;     // Modbus slave ID
-    uint8_t is_connected; // Connection status
-    uint16_t ir_start;    // Start address for input registers
+    uint8_t slave_id;      // Modbus slave ID
+    uint8_t is_connected;  // Connection status
+    uint8_t was_connected; // Answered at least once since boot, zero until then
+    uint16_t ir_start;     // Start address for input registers
+
+    struct modbus_slave_health health;
 };
 
-void modbus_slave_check_connection(const int read_result,
+/**
+ * Update the connection status and health counters of a slave after a transaction.
+ *
+ * A slave is only flagged as disconnected after CONFIG_MODBUS_HEALTH_FAIL_THRESHOLD
+ * consecutive failures, after which it is backed off exponentially, starting at
+ * CONFIG_MODBUS_HEALTH_BACKOFF_MIN_MSEC and capped at CONFIG_MODBUS_HEALTH_BACKOFF_MAX_MSEC.
+ *
+ * @param read_result Return code of the modbus transaction.
+ * @param latency_us Duration of the transaction, in microseconds.
+ * @param meta Slave metadata to update.
+ * @param label Human readable slave name, used for logging.
+ */
+void modbus_slave_check_connection(const int read_result, const uint32_t latency_us,
                                    struct modbus_slave_metadata *const meta,
                                    const char *const label);
 
+/**
+ * Read the input registers of a slave, honouring its health state.
+ *
+ * Connected slaves are read normally. Disconnected slaves are skipped until their backoff
+ * expires; they are then probed with a single register read, the shortest frame the bus
+ * allows, and only if the probe succeeds is the full register block read.
+ *
+ * @param client_iface The Modbus client interface to use for reading.
+ * @param meta Slave metadata, holding the slave ID, register start and health state.
+ * @param regs Destination buffer.
+ * @param count Number of registers to read.
+ * @param label Human readable slave name, used for logging.
+ * @returns 0 on success, -EAGAIN if the slave is backing off, or the modbus error code.
+ */
+int modbus_slave_read_irs(const int client_iface, struct modbus_slave_metadata *const meta,
+                          uint16_t *const regs, const uint16_t count, const char *const label);
+
+/**
+ * Broadcast the OBC time to every slave, see invictus2/timesync.h.
+ *
+ * Slaves never answer a broadcast. The client may still wait for an answer, its timeout is
+ * not reported as an error.
+ *
+ * @param client_iface The Modbus client interface to use for writing.
+ * @returns 0 on success, or the modbus error code.
+ */
+int modbus_broadcast_time(const int client_iface);
+
 #endif // MODBUS_COMMON_H
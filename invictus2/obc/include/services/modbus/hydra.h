@@ -4,11 +4,15 @@
 #include "services/modbus/common.h"
 #include "data_models.h"
 
+#include "invictus2/hydra_modbus.h"
+
 #include <stdbool.h>
 
 // NOTE: Solenoids are represented as modbus coils.
 // Sensors are represented as modbus input registers.
-// Temperatures in ºC. Pressures in Bar.
+// Temperatures in deci-ºC (signed). Pressures in deci-bar. Values are filtered on the HYDRA.
+// The register layout is shared with the HYDRA firmware, see invictus2/hydra_modbus.h.
+// Every block read ends with the time the HYDRA took the sample at, in the OBC timebase.
 
 // Upper Feed (UF) Hydraulic Regulation and Actuation (HYDRA) board structure
 struct uf_hydra {
@@ -22,14 +26,16 @@ struct uf_hydra {
         };
         uint8_t raw;
     } solenoids;
+    bool solenoids_written; // The board holds solenoids, see hydra_boards_write_valves()
 
     union uf_sensors {
         struct {
             uint16_t uf_temperature1;
             uint16_t uf_temperature2;
             uint16_t uf_temperature3;
+            uint16_t sample_time[HYDRA_IR_TIME_COUNT];
         };
-        uint16_t raw[3];
+        uint16_t raw[3 + HYDRA_IR_TIME_COUNT];
     } sensors;
 };
 
@@ -46,6 +52,7 @@ struct lf_hydra {
         };
         uint8_t raw;
     } solenoids;
+    bool solenoids_written;
 
     union lf_sensors {
         struct {
@@ -53,8 +60,9 @@ struct lf_hydra {
             uint16_t lf_temperature2;
             uint16_t lf_pressure;
             uint16_t cc_pressure;
+            uint16_t sample_time[HYDRA_IR_TIME_COUNT];
         };
-        uint16_t raw[4];
+        uint16_t raw[4 + HYDRA_IR_TIME_COUNT];
     } sensors;
 };
 
@@ -74,6 +82,7 @@ struct fs_hydra {
         };
         uint8_t raw;
     } solenoids;
+    bool solenoids_written;
 
     union fs_sensors {
         struct {
@@ -86,8 +95,10 @@ struct fs_hydra {
             uint16_t n2o_temperature1; // temperature before solenoid
             uint16_t n2o_temperature2; // temperature after solenoid
             uint16_t n2_temperature;
+
+            uint16_t sample_time[HYDRA_IR_TIME_COUNT];
         };
-        uint16_t raw[6];
+        uint16_t raw[6 + HYDRA_IR_TIME_COUNT];
     } sensors;
 };
 
@@ -120,15 +131,69 @@ void hydra_boards_init(struct hydra_boards *const hb);
  * @returns void.
  *
  * @note This function flags the connection status of each hydra based on the read result.
- *       If the read is successful, it sets the `is_connected` flag to true.
- *       If the read fails, it sets the `is_connected` flag to false and logs a warning.
+ *       Reads go through modbus_slave_read_irs(), so boards that stopped answering are
+ *       backed off and only probed periodically instead of stalling the bus every cycle.
  */
 
 void hydra_boards_read_irs(const int client_iface, struct hydra_boards *const hb,
                            const bool fs_disabled);
 
+/**
+ * Open a valve for a fixed time, timed by the HYDRA board that drives it.
+ *
+ * Writes the duration to the valve's pulse holding register; the HYDRA closes the valve
+ * on its own when it expires, so no further bus traffic is needed.
+ *
+ * @param client_iface The Modbus client interface to use for writing.
+ * @param hb Pointer to the hydras structure.
+ * @param valve Valve to pulse.
+ * @param duration_ms Pulse duration in ms, 0 cancels a running pulse and closes the valve.
+ * @returns 0 on success, -EINVAL if no hydra drives the valve, or the modbus error code.
+ */
+int hydra_boards_valve_pulse(const int client_iface, const struct hydra_boards *const hb,
+                             const valve_t valve, const uint16_t duration_ms);
+
+/**
+ * Drive the hydra valves to the actuator state of the state machine.
+ *
+ * Each board whose valves differ from the last state written to it gets all its coils in a
+ * single transaction, the others are left alone. A board whose write failed is written
+ * again on the next call. The filling station is skipped once disabled.
+ *
+ * @param client_iface The Modbus client interface to use for writing.
+ * @param hb Pointer to the hydras structure.
+ * @param actuators Valve states to write, the e-matches are not on the hydras.
+ * @param fs_disabled Leave the filling station hydra alone.
+ * @returns 0 once every board holds its valve states, or the first modbus error code.
+ */
+int hydra_boards_write_valves(const int client_iface, struct hydra_boards *const hb,
+                              const actuators_bitmap_t actuators, const bool fs_disabled);
+
+/**
+ * Set the filling station proportional valve controller.
+ *
+ * Writes the setpoint and then the enable flag in a single transaction, so the loop never
+ * runs with a stale setpoint.
+ *
+ * @param client_iface The Modbus client interface to use for writing.
+ * @param hb Pointer to the hydras structure.
+ * @param enable Run the loop, or close the valve and stop it.
+ * @param setpoint Regulated value, in the units of the controlled input register (deci-bar
+ * for pressures).
+ * @returns 0 on success, or the modbus error code.
+ */
+int hydra_boards_fill_control(const int client_iface, const struct hydra_boards *const hb,
+                              const bool enable, const uint16_t setpoint);
+
+/**
+ * Merge the latest board readings into the zbus representations.
+ *
+ * Each is stamped with the oldest sample time of the connected boards it merges, see
+ * invictus2/timesync.h, or 0 if none of them is connected.
+ */
 void hydra_boards_irs_to_zbus_rep(const struct hydra_boards *const hb,
-                                  thermocouples_t *const thermocouples,
-                                  pressures_t *const pressures, const bool fs_disabled);
+                                  thermo_sample_t *const thermo_sample,
+                                  pressure_sample_t *const pressure_sample,
+                                  const bool fs_disabled);
 
 #endif // HYDRA_H_
@@ -70,8 +70,8 @@ void lift_boards_init(struct lift_boards *const lb);
  * @returns void.
  *
  * @note This function flags the connection status of each lift board based on the read result.
- *       If the read is successful, it sets the `is_connected` flag to true.
- *       If the read fails, it sets the `is_connected` flag to false and logs a warning.
+ *       Reads go through modbus_slave_read_irs(), so boards that stopped answering are
+ *       backed off and only probed periodically instead of stalling the bus every cycle.
  */
 void lift_boards_read_irs(const int client_iface, struct lift_boards *const lb,
                           const bool fs_disconnected);
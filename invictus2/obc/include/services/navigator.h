@@ -2,8 +2,28 @@
 #define OBC_NAVIGATOR_H_
 
 #include <stdbool.h>
+#include <stdint.h>
+
+#include "invictus2/nav_link.h"
+
+// Receives the navigator stream (invictus2/nav_link.h) and publishes every sample on
+// chan_navigator_sensors, or chan_kalman_data for estimates. Sends the navigator a time
+// sync frame every CONFIG_TIMESYNC_BROADCAST_INTERVAL_MSEC, so its samples are stamped in
+// the OBC timebase.
+
+struct navigator_stats
+{
+    struct nav_link_stats link;
+    uint32_t rx_dropped;     // Bytes lost to a full receive ring
+    uint32_t uart_errors;    // Receiver stops (framing, parity, overrun, break)
+    uint32_t publish_errors; // Samples that could not be published
+    uint32_t syncs_sent;     // Time sync frames sent
+    uint32_t sync_skipped;   // Time sync frames skipped, the previous one still being sent
+};
 
 bool navigator_service_setup(void);
 void navigator_service_start(void);
 
+void navigator_get_stats(struct navigator_stats *stats);
+
 #endif // OBC_NAVIGATOR_H_
@@ -0,0 +1,50 @@
+#ifndef OBC_SD_LOGGER_H_
+#define OBC_SD_LOGGER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "invictus2/sd_log.h"
+
+// Logs every sensor, estimate, state, bus health and command message published on zbus to
+// a binary file on the SD card, between MANUAL_CMD_SD_LOG_START and MANUAL_CMD_SD_LOG_STOP.
+// The file format is described in invictus2/sd_log.h.
+//
+// Records are serialized from the zbus listener, in the publisher's context, into the
+// log blocks of the active one of two RAM buffers of CONFIG_SD_LOGGER_BUF_SIZE bytes. Once
+// full it is handed to a low priority writer thread and the other one is filled meanwhile,
+// so producers never wait on the card: a record that finds both buffers full is dropped
+// and counted. The card only ever sees whole buffer writes, a multiple of the sector size.
+//
+// While the rocket is ARMED, records go to a RAM ring of CONFIG_SD_LOGGER_PRETRIGGER_BLOCKS
+// log blocks instead, overwriting the oldest ones. Leaving ARMED (liftoff, abort or disarm)
+// triggers the recorder: the ring is frozen and written out, so the log keeps the window
+// right before the trigger whatever the time spent armed, then live logging resumes.
+//
+// When the card is mounted, the last log left on it is checked and trimmed to its last
+// valid block, in case logging was cut by a reset or a power loss.
+
+struct sd_logger_stats
+{
+    bool logging;
+    uint32_t file_index;    // The current or last file is LOG<file_index>.BIN
+    uint32_t records;       // Records logged to the current or last file
+    uint32_t dropped;       // Records lost to both buffers being full
+    uint32_t bytes_written; // Bytes written to the card, current or last file
+    uint32_t write_errors;
+    uint32_t last_write_us; // Time taken by the last buffer write
+    uint32_t max_write_us;
+    uint32_t pretrigger_blocks; // Blocks of pre-trigger window written, current or last file
+};
+
+bool sd_logger_service_setup(void);
+void sd_logger_service_start(void);
+
+// Also requested with MANUAL_CMD_SD_LOG_START / STOP, the file is opened and closed by the
+// writer thread
+void sd_logger_start(void);
+void sd_logger_stop(void);
+
+void sd_logger_get_stats(struct sd_logger_stats *stats);
+
+#endif // OBC_SD_LOGGER_H_
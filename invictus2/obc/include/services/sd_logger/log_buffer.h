@@ -0,0 +1,108 @@
+#ifndef SD_LOGGER_LOG_BUFFER_H_
+#define SD_LOGGER_LOG_BUFFER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "invictus2/sd_log.h"
+
+#include "zephyr/sys/util.h"
+
+/*
+ * Block buffering of the SD logger, with no locking and no I/O: the service calls it under
+ * its lock and writes what it hands over to the card.
+ *
+ * Double buffer: producers append records to the blocks of bufs[active], in order. A
+ * record that does not fit in the last block of the buffer swaps the two, unless
+ * bufs[!active] is still waiting to be written (buf_pending), then it is dropped. The
+ * writer seals (CRCs) the blocks of the pending buffer and writes it at once. Only the
+ * writer touches the blocks of the pending buffer.
+ *
+ * Pre-trigger recorder: once armed the records go to a ring of ring_blocks blocks instead,
+ * the oldest block being overwritten once it is full. The trigger freezes the ring, its
+ * blocks are numbered in order and handed to the writer, and live records go to the
+ * double buffer again, numbered after them. Block seq always is its offset in the file,
+ * as long as the writer writes everything in numbering order: the pending buffer, the
+ * frozen ring, then the active buffer.
+ */
+
+// Returned by the calls below, work for the writer
+#define LOG_BUFFER_WRITE BIT(0) // A buffer was handed over, see log_buffer_pending()
+#define LOG_BUFFER_DRAIN BIT(1) // The ring was frozen, see log_buffer_frozen()
+
+enum log_buffer_recorder
+{
+    LOG_BUFFER_REC_OFF = 0,
+    LOG_BUFFER_REC_ARMING,     // Waiting for the double buffer to be free to hand its blocks
+    LOG_BUFFER_REC_PRETRIGGER, // Records go to the ring
+};
+
+struct log_buffer_run
+{
+    struct sd_log_block *blocks;
+    uint16_t count;
+};
+
+struct log_buffer
+{
+    /* Storage, set by the owner */
+    struct sd_log_block *bufs[2];
+    uint16_t buf_blocks;
+    struct sd_log_block *ring;
+    uint16_t ring_blocks; // 0 disables the recorder
+
+    /* Double buffer */
+    uint8_t active;
+    uint16_t cur_block;      // Block of bufs[active] records are appended to
+    uint16_t pending_blocks; // Blocks of bufs[!active] to write
+    bool buf_pending;
+    uint32_t next_seq;
+    uint32_t session;
+
+    /* Pre-trigger ring */
+    uint16_t ring_head;  // Block of the ring records are appended to
+    uint16_t ring_count; // Blocks in use, ring_head included
+    uint16_t ring_first; // Oldest block, once frozen
+    bool ring_draining;  // Frozen, waiting to be written
+    enum log_buffer_recorder recorder;
+
+    uint16_t dropped_since_last;
+    uint32_t records; // Appended and not overwritten in the ring
+    uint32_t dropped; // Lost to both buffers being full
+};
+
+// Start a log, block 0 of the session goes first
+void log_buffer_start(struct log_buffer *lb, uint32_t session);
+
+// Append a record, or drop it when both buffers are full
+uint32_t log_buffer_append(struct log_buffer *lb, enum sd_log_record_type type,
+                           const void *msg, size_t len, uint32_t time_us);
+
+// Send the records to the ring, as soon as the blocks logged so far can be written. Ignored
+// without a ring or while the last one is still being written.
+uint32_t log_buffer_arm(struct log_buffer *lb);
+
+// Freeze the ring and resume logging to the double buffer after it
+uint32_t log_buffer_trigger(struct log_buffer *lb);
+
+// Trigger an armed recorder for the last time, the log is closed
+void log_buffer_stop(struct log_buffer *lb);
+
+// The buffer to write, 0 blocks if none is pending or if it goes after the frozen ring
+uint16_t log_buffer_pending(const struct log_buffer *lb, struct sd_log_block **blocks);
+
+// The pending buffer was written
+uint32_t log_buffer_written(struct log_buffer *lb);
+
+// The frozen ring to write, oldest block first, as up to two runs. Returns the run count,
+// 0 if the ring is not frozen.
+size_t log_buffer_frozen(const struct log_buffer *lb, struct log_buffer_run runs[2]);
+
+// The frozen ring was written
+uint32_t log_buffer_drained(struct log_buffer *lb);
+
+// The blocks of the active buffer holding records, written last when the log is closed
+uint16_t log_buffer_partial(const struct log_buffer *lb, struct sd_log_block **blocks);
+
+#endif // SD_LOGGER_LOG_BUFFER_H_
@@ -3,26 +3,27 @@
 
 #include <stdint.h>
 
-// NOTE: Pressures in bar
-//       weights in kg
-//       temperatures in ºC
+// NOTE: Pressures in deci-bar
+//       weights in grams
+//       temperatures in deci-ºC
+// Same units as the fill command parameters and the HYDRA input registers.
 
-#define SAFE_PAUSE_TARGET_N2O_TANK_P  50
-#define SAFE_PAUSE_TRIGGER_N2O_TANK_P 52
+#define SAFE_PAUSE_TARGET_N2O_TANK_P  500
+#define SAFE_PAUSE_TRIGGER_N2O_TANK_P 520
 
-#define FILL_N2_TARGET_N2_TANK_P  200
-#define FILL_N2_TRIGGER_N2_TANK_P 210
+#define FILL_N2_TARGET_N2_TANK_P  2000
+#define FILL_N2_TRIGGER_N2_TANK_P 2100
 
-#define PRE_PRESS_TARGET_N2O_TANK_P  5
-#define PRE_PRESS_TRIGGER_N2O_TANK_P 7
+#define PRE_PRESS_TARGET_N2O_TANK_P  50
+#define PRE_PRESS_TRIGGER_N2O_TANK_P 70
 
-#define FILL_N2O_TARGET_N2O_TANK_P  35
-#define FILL_N2O_TARGET_N2O_TANK_W  7
-#define FILL_N2O_TRIGGER_N2O_TANK_P 38
-#define FILL_N2O_TRIGGER_N2O_TANK_T 2
+#define FILL_N2O_TARGET_N2O_TANK_P  350
+#define FILL_N2O_TARGET_N2O_TANK_W  7000
+#define FILL_N2O_TRIGGER_N2O_TANK_P 380
+#define FILL_N2O_TRIGGER_N2O_TANK_T 20
 
-#define POST_PRESS_TARGET_N2O_TANK_P  50
-#define POST_PRESS_TRIGGER_N2O_TANK_P 52
+#define POST_PRESS_TARGET_N2O_TANK_P  500
+#define POST_PRESS_TRIGGER_N2O_TANK_P 520
 
 struct filling_sm_config
 {
@@ -60,35 +61,38 @@ struct filling_sm_config
     } post_press;
 };
 
-#define DEFAULT_FILL_SM_CONFIG(name)                                                          \
-    struct filling_sm_config name = {                                                         \
+// Initializer for struct filling_sm_config with the defaults above
+#define FILLING_SM_CONFIG_DEFAULT                                                             \
+    {                                                                                         \
         .safe_pause =                                                                         \
             {                                                                                 \
                 .target_n2o_tank_pressure = SAFE_PAUSE_TARGET_N2O_TANK_P,                     \
                 .trigger_n2o_tank_pressure = SAFE_PAUSE_TRIGGER_N2O_TANK_P,                   \
             },                                                                                \
-        .f_copv =                                                                             \
+        .fill_n2 =                                                                            \
             {                                                                                 \
                 .target_n2_tank_pressure = FILL_N2_TARGET_N2_TANK_P,                          \
                 .trigger_n2_tank_pressure = FILL_N2_TRIGGER_N2_TANK_P,                        \
             },                                                                                \
-        .pre_p =                                                                              \
+        .pre_press =                                                                          \
             {                                                                                 \
                 .target_n2o_tank_pressure = PRE_PRESS_TARGET_N2O_TANK_P,                      \
                 .trigger_n2o_tank_pressure = PRE_PRESS_TRIGGER_N2O_TANK_P,                    \
             },                                                                                \
-        .f_n2o =                                                                              \
+        .fill_n2o =                                                                           \
             {                                                                                 \
-                .target_n2o_tank_pressure = FILL_N2O_TARGET_N2O_TANK_P,                       \
                 .target_n2o_tank_weight = FILL_N2O_TARGET_N2O_TANK_W,                         \
+                .target_n2o_tank_pressure = FILL_N2O_TARGET_N2O_TANK_P,                       \
                 .trigger_n2o_tank_pressure = FILL_N2O_TRIGGER_N2O_TANK_P,                     \
                 .trigger_n2o_tank_temperature = FILL_N2O_TRIGGER_N2O_TANK_T,                  \
             },                                                                                \
-        .post_p =                                                                             \
+        .post_press =                                                                         \
             {                                                                                 \
                 .target_n2o_tank_pressure = POST_PRESS_TARGET_N2O_TANK_P,                     \
                 .trigger_n2o_tank_pressure = POST_PRESS_TRIGGER_N2O_TANK_P,                   \
             },                                                                                \
     }
 
+#define DEFAULT_FILL_SM_CONFIG(name) struct filling_sm_config name = FILLING_SM_CONFIG_DEFAULT
+
 #endif // _FILL_SM_CONFIG_H_
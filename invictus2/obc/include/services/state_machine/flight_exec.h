@@ -0,0 +1,42 @@
+#ifndef _FLIGHT_EXEC_H_
+#define _FLIGHT_EXEC_H_
+
+#include "data_models.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Flight mode executor.
+ *
+ * From ARMED onwards the state machine is no longer run by the ground operations work
+ * queue, but by a cooperative thread at a fixed rate that reads the navigator and Kalman
+ * channels directly. Commands and filling station samples are still received by the work
+ * queue, they are picked up on the next period.
+ */
+
+struct flight_exec_stats
+{
+    uint32_t runs;
+    uint32_t overruns; // Periods skipped because a run did not finish in time
+    uint32_t last_us;
+    uint32_t max_us; // Worst case execution time since boot
+};
+
+// Create the executor thread, idle until flight_exec_resume()
+void flight_exec_init(void);
+
+// Start running the state machine periodically, until it leaves flight mode
+void flight_exec_resume(void);
+
+void flight_exec_get_stats(struct flight_exec_stats *stats);
+
+/* Provided by the state machine service (sm_work.c) */
+
+// True while the state machine must be run by the executor
+bool sm_flight_mode(void);
+
+// Run the state machine once with fresh flight data, under the state machine lock
+void sm_flight_step(const navigator_sensors_t *navigator, const kalman_data_t *kalman);
+
+#endif // _FLIGHT_EXEC_H_
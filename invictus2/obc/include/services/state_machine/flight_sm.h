@@ -1,32 +1,33 @@
 #ifndef FLIGHT_SM_H
 #define FLIGHT_SM_H
 
+#include <stdbool.h>
+
+struct sm_object;
+
 void ignition_entry(void *o);
-void ignition_run(void *o);
 void ignition_exit(void *o);
 
 void boost_entry(void *o);
-void boost_run(void *o);
 void boost_exit(void *o);
 
 void coast_entry(void *o);
-void coast_run(void *o);
 void coast_exit(void *o);
 
 void apogee_entry(void *o);
-void apogee_run(void *o);
 void apogee_exit(void *o);
 
 void drogue_chute_entry(void *o);
-void drogue_chute_run(void *o);
 void drogue_chute_exit(void *o);
 
 void main_chute_entry(void *o);
-void main_chute_run(void *o);
 void main_chute_exit(void *o);
 
 void touchdown_entry(void *o);
-void touchdown_run(void *o);
 void touchdown_exit(void *o);
 
+// Transition checks that are not sensor thresholds, see sm_transitions.c
+bool boost_timer_done(const struct sm_object *s);
+bool drogue_ematch_fired(const struct sm_object *s);
+
 #endif // FLIGHT_SM_H
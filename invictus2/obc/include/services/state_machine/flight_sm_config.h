@@ -3,22 +3,24 @@
 
 #include <stdint.h>
 
-#define MIN_CHAMBER_LAUNCH_TEMP  650  // Minimum chamber temperature in Celsius for launch
+#define MIN_CHAMBER_LAUNCH_TEMP  6500 // Minimum chamber temperature in deci-ºC for launch
 #define MAIN_CHUTE_DEPLOY_ALTITUDE 450 // Altitude in meters for main chute deployment
 
 struct flight_sm_config {
-    uint16_t min_chamber_launch_temp; // Minimum chamber temperature in Celsius for launch
+    uint16_t min_chamber_launch_temp; // Minimum chamber temperature in deci-ºC for launch
     uint16_t main_chute_deploy_altitude; // Altitude in meters for main chute deployment
-    uint16_t touchdown_altitude;
-    uint16_t coast_vertical_speed;
-    uint16_t boost_vertical_speed;
+    uint16_t touchdown_altitude;         // Altitude in meters
+    uint16_t coast_vertical_speed;       // Vertical speed in dm/s
+    uint16_t boost_vertical_speed;       // Vertical speed in dm/s
 };
 
-#define DEFAULT_FLIGHT_SM_CONFIG(name)                                                              \
-    struct flight_sm_config name = {                                                         \
+// Initializer for struct flight_sm_config with the defaults above
+#define FLIGHT_SM_CONFIG_DEFAULT                                                              \
+    {                                                                                         \
         .min_chamber_launch_temp = MIN_CHAMBER_LAUNCH_TEMP,                                   \
         .main_chute_deploy_altitude = MAIN_CHUTE_DEPLOY_ALTITUDE,                             \
     }
 
+#define DEFAULT_FLIGHT_SM_CONFIG(name) struct flight_sm_config name = FLIGHT_SM_CONFIG_DEFAULT
 
-#endif // _FLIGHT_SM_CONFIG_H_
\ No newline at end of file
+#endif // _FLIGHT_SM_CONFIG_H_
@@ -7,10 +7,35 @@
 #include "data_models.h"
 
 #include <zephyr/smf.h>
+#include <zephyr/sys/util.h>
 
 bool state_machine_service_setup(void);
 void state_machine_service_start(void);
 
+// Command the safe state of the current main state (abort, or safe pause while filling),
+// for the supervisor when a service the valves depend on stalls
+void sm_force_safe(void);
+
+// Parts of system_data_t, a run carries a new sample of some of them
+enum sm_source
+{
+    SM_SRC_PRESSURES = BIT(0),
+    SM_SRC_THERMOCOUPLES = BIT(1),
+    SM_SRC_LOADCELLS = BIT(2),
+    SM_SRC_NAVIGATOR = BIT(3),
+    SM_SRC_KALMAN = BIT(4),
+};
+
+#define SM_TABLE_MAX_GUARD_ROWS 8 // Guard rows with a confirmation history, per active state
+
+/* Bookkeeping of the transition table for the active state, see sm_table.h */
+struct sm_table_ctx
+{
+    const struct smf_state *state; // Active state the fields below refer to
+    uint32_t entered_ms;
+    uint8_t history[SM_TABLE_MAX_GUARD_ROWS]; // Last guard results, newest in bit 0
+};
+
 /* User defined object */
 struct sm_object
 {
@@ -22,6 +47,10 @@ struct sm_object
     system_data_t data;
     state_data_t state_data;
     struct sm_config *config;
+
+    uint32_t now_ms; // Set by the caller before every run, for dwell times
+    uint8_t fresh;   // enum sm_source updated since the last run, cleared by the caller
+    struct sm_table_ctx table;
 };
 
 extern const struct smf_state states[];
@@ -35,6 +64,8 @@ void close_all_valves(struct sm_object *s);
 // closes all valves except the one specified
 void open_single_valve(struct sm_object *s, valve_t valve);
 
-void sm_init(struct sm_object *initial_s_obj);
+// Attach the configuration (kept by reference, must outlive the object) and enter the
+// initial state
+void sm_init(struct sm_object *initial_s_obj, struct sm_config *config);
 
 #endif // _MAIN_SM_H_
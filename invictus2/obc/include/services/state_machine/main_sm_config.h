@@ -10,4 +10,10 @@ struct sm_config {
     struct flight_sm_config flight_sm_config;
 };
 
+#define DEFAULT_SM_CONFIG(name)                                                               \
+    struct sm_config name = {                                                                 \
+        .filling_sm_config = FILLING_SM_CONFIG_DEFAULT,                                       \
+        .flight_sm_config = FLIGHT_SM_CONFIG_DEFAULT,                                         \
+    }
+
 #endif // _MAIN_SM_CONFIG_H_
@@ -0,0 +1,45 @@
+#ifndef _SM_INTAKE_H_
+#define _SM_INTAKE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "zephyr/kernel.h"
+#include "zephyr/sys/atomic.h"
+
+/*
+ * Intake of the state machine's channels.
+ *
+ * The state machine listener copies each message into a message queue, in the publisher's
+ * context where the channel message can be read without locking, and the work queue takes
+ * it from there. The work queue never waits on a channel lock, so a lower priority
+ * publisher holding the channel cannot stall it, and there is nothing to retry.
+ *
+ * Commands are queued in order and dropped once the queue is full. Sensor intakes only
+ * hold the latest sample, a newer one replaces a sample not taken yet.
+ *
+ * An intake has a single producer, the listener of its channel, which zbus serializes.
+ */
+
+struct sm_intake
+{
+    struct k_msgq *queue;
+    bool latest_only;
+    atomic_t dropped; // Messages dropped, or replaced by a newer one if latest_only
+};
+
+#define SM_INTAKE_DEFINE(_name, _type, _depth, _latest_only)                                  \
+    K_MSGQ_DEFINE(_name##_queue, sizeof(_type), _depth, 4);                                   \
+    static struct sm_intake _name = {.queue = &_name##_queue, .latest_only = _latest_only}
+
+// From the listener. False if the message was dropped, it was counted.
+bool sm_intake_put(struct sm_intake *intake, const void *msg);
+
+// From the work queue, never blocks. False if there is nothing to take.
+bool sm_intake_get(struct sm_intake *intake, void *msg);
+
+bool sm_intake_pending(struct sm_intake *intake);
+
+uint32_t sm_intake_dropped(struct sm_intake *intake);
+
+#endif // _SM_INTAKE_H_
@@ -0,0 +1,165 @@
+#ifndef _SM_TABLE_H_
+#define _SM_TABLE_H_
+
+#include "services/state_machine/main_sm.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <zephyr/sys/util.h>
+
+/*
+ * Declarative transition tables.
+ *
+ * Every state owns a (possibly empty) list of rows. A row fires when its command and fill
+ * command match the pending ones (0 matches anything) and all its guards hold. Guards
+ * compare a 16 bit field of system_data_t against a 16 bit field of struct sm_config,
+ * located by offsetof() at compile time, so the table is plain data that can be audited
+ * and evaluated on the host.
+ *
+ * sm_table_run() is the run action of every state. It evaluates the active state's rows
+ * in order and then its ancestors', stopping at the first row that fires: command rows
+ * first, then guard only rows. Unmatched commands stop at states marked as absorbing,
+ * mirroring smf_set_handled().
+ *
+ * Thresholds read from noisy sensors can be debounced three ways:
+ *  - hysteresis: SM_GUARD_HYST() moves the limit by a fixed band, away from the side the
+ *    guard accepts, so re-crossing a target needs more than noise;
+ *  - confirmation: SM_WHEN_CONFIRMED() rows fire once their guards held on N of the last
+ *    M samples (M <= 8) of the fields they read, runs without a new sample of any of them
+ *    (a command, another sensor) are not counted; the history is kept per row and cleared
+ *    on every state change;
+ *  - dwell: SM_WHEN_CONFIRMED_AFTER() rows do not fire until the active state has been
+ *    entered for that long, which bounds how often a valve can cycle. Only the rows that
+ *    reopen a valve are held, a vent row of the same state fires right away.
+ * Command rows are never delayed by any of them.
+ *
+ * A guard never holds on a thermocouple without a reading (THERMO_INVALID), but for
+ * SM_GUARD_IF_VALID() ones, which are left out of their row instead: the row then fires on
+ * its other guards, for a vent that must not wait on a missing reading.
+ *
+ * Actuators are still set by the entry actions: SMF enters parents and initial substates
+ * without going through a row, so a per-row mask would miss those.
+ */
+
+#define SM_MAX_GUARDS  2
+#define SM_STATE_COUNT FLIGHT_SST(_FLIGHT_SST_MAX) // Size of states[]
+
+enum sm_cmp
+{
+    SM_CMP_NONE = 0, // Unused guard slot
+    SM_LT,
+    SM_LE,
+    SM_GT,
+    SM_GE,
+};
+
+struct sm_guard
+{
+    uint16_t data_offset;   // Into system_data_t
+    uint16_t config_offset; // Into struct sm_config
+    uint16_t band;          // Hysteresis, in data units
+    uint8_t cmp;            // enum sm_cmp
+    uint8_t data_signed: 1;
+    uint8_t config_signed: 1;
+    uint8_t if_valid: 1; // Holds on an invalid reading
+};
+
+struct sm_transition
+{
+    uint8_t command;      // command_t, 0 for guard only rows
+    uint8_t fill_command; // fill_command_t, 0 for any
+    uint8_t target;       // Index into states[]
+    uint8_t confirm_n;    // Fire when the guards held on confirm_n of the last confirm_m
+    uint8_t confirm_m;    // samples, 0 to fire on the first one
+    uint16_t min_dwell_ms; // In the active state before the row can fire, guard only rows
+    struct sm_guard guards[SM_MAX_GUARDS];
+
+    // Conditions that are not a threshold (timers, e-match feedback), NULL if unused
+    bool (*check)(const struct sm_object *s);
+};
+
+struct sm_state_rows
+{
+    const struct sm_transition *rows;
+    uint8_t count;
+    bool absorb; // Unmatched commands do not reach the parent state
+};
+
+/* Compile time helpers: reject anything but 16 bit fields, record signedness */
+#define _SM_MEMBER(type, member)    (((type *)0)->member)
+#define _SM_IS_SIGNED(type, member) (((__typeof__(_SM_MEMBER(type, member)))-1) < 0)
+#define _SM_OFFSET16(type, member)                                                            \
+    (offsetof(type, member) +                                                                 \
+     ZERO_OR_COMPILE_ERROR(sizeof(_SM_MEMBER(type, member)) == sizeof(uint16_t)))
+
+/**
+ * Guard "data.field cmp config->cfg_field", e.g.
+ * SM_GUARD(pressures.n2o_tank_pressure, SM_GT, filling_sm_config.fill_n2.trigger_n2_tank_pressure)
+ */
+#define SM_GUARD(field, op, cfg_field)                                                        \
+    {                                                                                         \
+        .data_offset = _SM_OFFSET16(system_data_t, field),                                    \
+        .config_offset = _SM_OFFSET16(struct sm_config, cfg_field),                           \
+        .cmp = (op),                                                                          \
+        .data_signed = _SM_IS_SIGNED(system_data_t, field),                                   \
+        .config_signed = _SM_IS_SIGNED(struct sm_config, cfg_field),                          \
+    }
+
+/** SM_GUARD() that holds when the reading is invalid, see above */
+#define SM_GUARD_IF_VALID(field, op, cfg_field)                                               \
+    {                                                                                         \
+        .data_offset = _SM_OFFSET16(system_data_t, field),                                    \
+        .config_offset = _SM_OFFSET16(struct sm_config, cfg_field),                           \
+        .cmp = (op),                                                                          \
+        .data_signed = _SM_IS_SIGNED(system_data_t, field),                                   \
+        .config_signed = _SM_IS_SIGNED(struct sm_config, cfg_field),                          \
+        .if_valid = 1,                                                                        \
+    }
+
+/** SM_GUARD() with the limit moved by band against the accepted side (LT: limit - band) */
+#define SM_GUARD_HYST(field, op, cfg_field, band_)                                            \
+    {                                                                                         \
+        .data_offset = _SM_OFFSET16(system_data_t, field),                                    \
+        .config_offset = _SM_OFFSET16(struct sm_config, cfg_field),                           \
+        .band = (band_),                                                                      \
+        .cmp = (op),                                                                          \
+        .data_signed = _SM_IS_SIGNED(system_data_t, field),                                   \
+        .config_signed = _SM_IS_SIGNED(struct sm_config, cfg_field),                          \
+    }
+
+/* Rows. Guards are ANDed, alternatives (OR) are separate rows with the same target. */
+#define SM_ON_CMD(cmd, tgt, ...)                                                              \
+    {.command = (cmd), .target = (tgt), .guards = {__VA_ARGS__}}
+#define SM_ON_FILL_CMD(fill_cmd, tgt)                                                         \
+    {.command = CMD_FILL_EXEC, .fill_command = (fill_cmd), .target = (tgt)}
+#define SM_WHEN(tgt, ...)       {.target = (tgt), .guards = {__VA_ARGS__}}
+#define SM_WHEN_CHECK(tgt, fn)  {.target = (tgt), .check = (fn)}
+#define SM_WHEN_CONFIRMED_AFTER(tgt, dwell_ms, n, m, ...)                                     \
+    {                                                                                         \
+        .target = (tgt), .guards = {__VA_ARGS__},                                             \
+        .confirm_n = (n) + ZERO_OR_COMPILE_ERROR((n) <= (m) && (m) <= 8),                     \
+        .confirm_m = (m), .min_dwell_ms = (dwell_ms),                                         \
+    }
+#define SM_WHEN_CONFIRMED(tgt, n, m, ...) SM_WHEN_CONFIRMED_AFTER(tgt, 0, n, m, __VA_ARGS__)
+
+/* Row list of a state, to be used in a designated initializer indexed by state */
+#define _SM_STATE_ROWS(st, absorb_, ...)                                                      \
+    [st] = {                                                                                  \
+        .rows = (const struct sm_transition[]){__VA_ARGS__},                                  \
+        .count = ARRAY_SIZE(((const struct sm_transition[]){__VA_ARGS__})),                   \
+        .absorb = (absorb_),                                                                  \
+    }
+#define SM_STATE(st, ...)           _SM_STATE_ROWS(st, false, __VA_ARGS__)
+#define SM_STATE_ABSORBING(st, ...) _SM_STATE_ROWS(st, true, __VA_ARGS__)
+
+extern const struct sm_state_rows sm_transitions[SM_STATE_COUNT];
+
+/** Run action shared by every state, see above. */
+void sm_table_run(void *o);
+
+/** Evaluate a single row against the object, without transitioning or confirmation. */
+bool sm_table_row_matches(const struct sm_object *s, const struct sm_transition *row);
+
+#endif // _SM_TABLE_H_
@@ -0,0 +1,47 @@
+#ifndef OBC_SUPERVISOR_H_
+#define OBC_SUPERVISOR_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "data_models.h"
+
+#include "zephyr/kernel.h"
+
+// Supervision of the services and the hardware watchdog.
+//
+// Services register a heartbeat deadline for their work queue or thread. Work queues are
+// sent a heartbeat work item every CONFIG_SUPERVISOR_PERIOD_MSEC, which only runs once the
+// work items queued before it are done, plain threads call supervisor_heartbeat() from
+// their loop. A service without a heartbeat for longer than its deadline is stalled: it is
+// restarted if it can be and the state machine is put in a safe state if the valves depend
+// on it.
+//
+// The supervisor thread feeds the hardware watchdog (alias watchdog0) only while every
+// service is alive, but for the ones the flight does not depend on. A service that does not
+// recover within CONFIG_SUPERVISOR_WDT_TIMEOUT_MSEC resets the board. In flight mode, from
+// ARMED onwards, only a stall of a flight critical service does: a reset there loses the
+// flight executor, whatever the service that stalled.
+
+struct supervisor_watch
+{
+    uint32_t deadline_ms;  // Longest time allowed between two heartbeats
+    bool force_safe;       // A stall puts the state machine in a safe state
+    bool keep_fed;         // A stall does not withhold the watchdog, it never resets the board
+    bool flight_critical;  // A stall still withholds the watchdog in flight mode
+    void (*restart)(void); // Called on a stall to restart the service, optional
+};
+
+bool supervisor_service_setup(void);
+void supervisor_service_start(void);
+
+// Once the work queue or thread is started, watch is kept by reference. A NULL watch stops
+// watching the service, e.g. before its thread exits.
+void supervisor_watch_work_q(health_service_t service, struct k_work_q *work_q,
+                             const struct supervisor_watch *watch);
+void supervisor_watch_thread(health_service_t service, const struct supervisor_watch *watch);
+
+// For watched threads, at least once per deadline
+void supervisor_heartbeat(health_service_t service);
+
+#endif // OBC_SUPERVISOR_H_
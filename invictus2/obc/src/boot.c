@@ -0,0 +1,169 @@
+#include "boot.h"
+#include "chan_stats.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/zbus/zbus.h>
+
+LOG_MODULE_REGISTER(boot, LOG_LEVEL_INF);
+
+// Telemetry channels
+ZBUS_CHAN_DECLARE(chan_thermo_sensors, chan_pressure_sensors, chan_weight_sensors);
+ZBUS_CHAN_DECLARE(chan_navigator_sensors, chan_kalman_data, chan_rocket_state);
+
+static const struct
+{
+    const struct zbus_channel *chan;
+    const char *name;
+} telemetry_chans[] = {
+    {&chan_thermo_sensors, "thermo"},
+    {&chan_pressure_sensors, "pressure"},
+    {&chan_weight_sensors, "weight"},
+    {&chan_navigator_sensors, "navigator"},
+    {&chan_kalman_data, "kalman"},
+    {&chan_rocket_state, "rocket state"},
+};
+
+// After the services' own listeners
+#define TELEMETRY_LISTENER_PRIO 9
+
+static void telemetry_listener_cb(const struct zbus_channel *chan);
+
+CHAN_STATS_LISTENER_DEFINE(boot_telemetry_listener, telemetry_listener_cb);
+ZBUS_CHAN_ADD_OBS(chan_thermo_sensors, boot_telemetry_listener, TELEMETRY_LISTENER_PRIO);
+ZBUS_CHAN_ADD_OBS(chan_pressure_sensors, boot_telemetry_listener, TELEMETRY_LISTENER_PRIO);
+ZBUS_CHAN_ADD_OBS(chan_weight_sensors, boot_telemetry_listener, TELEMETRY_LISTENER_PRIO);
+ZBUS_CHAN_ADD_OBS(chan_navigator_sensors, boot_telemetry_listener, TELEMETRY_LISTENER_PRIO);
+ZBUS_CHAN_ADD_OBS(chan_kalman_data, boot_telemetry_listener, TELEMETRY_LISTENER_PRIO);
+ZBUS_CHAN_ADD_OBS(chan_rocket_state, boot_telemetry_listener, TELEMETRY_LISTENER_PRIO);
+
+K_THREAD_STACK_ARRAY_DEFINE(boot_stacks, CONFIG_BOOT_THREADS, CONFIG_BOOT_STACK_SIZE);
+static struct k_thread boot_threads[CONFIG_BOOT_THREADS];
+
+static struct boot_slot
+{
+    const struct boot_service *service;
+    bool ok;
+} slots[CONFIG_BOOT_THREADS];
+
+static uint32_t services_up_ms;
+static atomic_t first_telemetry_ms;
+static const char *first_telemetry;
+
+static void telemetry_listener_cb(const struct zbus_channel *chan)
+{
+    // Only the first message matters, one atomic read per publish afterwards
+    if (atomic_get(&first_telemetry_ms) != 0)
+    {
+        return;
+    }
+
+    const uint32_t now_ms = MAX(k_uptime_get_32(), 1);
+    if (!atomic_cas(&first_telemetry_ms, 0, now_ms))
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(telemetry_chans); i++)
+    {
+        if (telemetry_chans[i].chan == chan)
+        {
+            first_telemetry = telemetry_chans[i].name;
+        }
+    }
+
+    LOG_INF("First telemetry (%s) %u ms after reset", first_telemetry, now_ms);
+}
+
+static void boot_entry(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    struct boot_slot *const slot = p1;
+    const struct boot_service *const service = slot->service;
+    const uint32_t start_ms = k_uptime_get_32();
+
+    slot->ok = service->setup == NULL || service->setup();
+    if (!slot->ok)
+    {
+        LOG_ERR("  * %s setup failed", service->name);
+        return;
+    }
+
+    if (service->start != NULL)
+    {
+        service->start();
+    }
+
+    LOG_INF("  * %s up in %u ms", service->name, k_uptime_get_32() - start_ms);
+}
+
+// Bring up to CONFIG_BOOT_THREADS services of the stage up, from *next on
+static bool run_batch(const struct boot_service *services, size_t count, uint8_t stage,
+                      size_t *next)
+{
+    const int prio = k_thread_priority_get(k_current_get());
+    size_t spawned = 0;
+
+    for (; *next < count && spawned < CONFIG_BOOT_THREADS; (*next)++)
+    {
+        if (services[*next].stage != stage)
+        {
+            continue;
+        }
+
+        struct boot_slot *const slot = &slots[spawned];
+        *slot = (struct boot_slot){.service = &services[*next]};
+
+        k_thread_create(&boot_threads[spawned], boot_stacks[spawned],
+                        K_THREAD_STACK_SIZEOF(boot_stacks[spawned]), boot_entry, slot, NULL,
+                        NULL, prio, 0, K_NO_WAIT);
+        k_thread_name_set(&boot_threads[spawned], services[*next].name);
+        spawned++;
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < spawned; i++)
+    {
+        k_thread_join(&boot_threads[i], K_FOREVER);
+        ok = ok && slots[i].ok;
+    }
+
+    return ok;
+}
+
+bool boot_run(const struct boot_service *services, size_t count)
+{
+    uint8_t last_stage = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        last_stage = MAX(last_stage, services[i].stage);
+    }
+
+    for (uint8_t stage = 0; stage <= last_stage; stage++)
+    {
+        LOG_INF("Boot stage %u", stage);
+
+        size_t next = 0;
+        while (next < count)
+        {
+            if (!run_batch(services, count, stage, &next))
+            {
+                return false; // The later stages depend on it
+            }
+        }
+    }
+
+    services_up_ms = k_uptime_get_32();
+    LOG_INF("Services up %u ms after reset", services_up_ms);
+    return true;
+}
+
+void boot_get_stats(struct boot_stats *stats)
+{
+    stats->services_up_ms = services_up_ms;
+    stats->first_telemetry_ms = (uint32_t)atomic_get(&first_telemetry_ms);
+    stats->first_telemetry = stats->first_telemetry_ms != 0 ? first_telemetry : NULL;
+}
@@ -0,0 +1,220 @@
+#include "chan_stats.h"
+
+#include "invictus2/timesync.h"
+
+#include "zephyr/kernel.h"
+#include "zephyr/logging/log.h"
+#include "zephyr/spinlock.h"
+
+LOG_MODULE_REGISTER(chan_stats, LOG_LEVEL_INF);
+
+// Published channels
+ZBUS_CHAN_DECLARE(chan_bus_stats);
+
+struct chan_stats chan_stats[_BUS_CHAN_MAX];
+
+static const char *const chan_names[] = {
+    [BUS_CHAN_THERMO] = "thermo",
+    [BUS_CHAN_PRESSURE] = "pressure",
+    [BUS_CHAN_WEIGHT] = "weight",
+    [BUS_CHAN_NAVIGATOR] = "navigator",
+    [BUS_CHAN_KALMAN] = "kalman",
+    [BUS_CHAN_ACTUATORS] = "actuators",
+    [BUS_CHAN_MODBUS_HEALTH] = "modbus_health",
+    [BUS_CHAN_PACKETS] = "packets",
+    [BUS_CHAN_ROCKET_STATE] = "rocket_state",
+    [BUS_CHAN_HEALTH] = "health",
+    [BUS_CHAN_CMD_LATENCY] = "cmd_latency",
+    [BUS_CHAN_BUS_STATS] = "bus_stats",
+};
+
+BUILD_ASSERT(ARRAY_SIZE(chan_names) == _BUS_CHAN_MAX, "Every channel needs a name");
+
+static void sample_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(sample_work, sample_work_handler);
+
+// Counters at the previous sample, only touched by the sampling work
+static struct
+{
+    uint32_t pubs;
+    uint32_t pub_errors;
+    uint32_t read_busy;
+    uint32_t listener_runs;
+    uint32_t listener_cycles;
+} last[_BUS_CHAN_MAX];
+
+static struct k_spinlock lock;
+static bus_stats_t latest;
+static uint64_t last_sample_us;
+
+static void atomic_max(atomic_t *max, uint32_t value)
+{
+    atomic_val_t cur = atomic_get(max);
+    while ((uint32_t)cur < value && !atomic_cas(max, cur, value))
+    {
+        cur = atomic_get(max);
+    }
+}
+
+int chan_stats_pub(const struct zbus_channel *chan, const void *msg, k_timeout_t timeout)
+{
+    struct chan_stats *const stats = zbus_chan_user_data(chan);
+    const uint32_t start = k_cycle_get_32();
+
+    if (stats == NULL)
+    {
+        return zbus_chan_pub(chan, msg, timeout);
+    }
+
+    // Racy with a concurrent publish of the channel, which only skews its latencies
+    stats->pub_start = start;
+
+    const int ret = zbus_chan_pub(chan, msg, timeout);
+    atomic_inc(ret == 0 ? &stats->pubs : &stats->pub_errors);
+    atomic_max(&stats->max_pub_cycles, k_cycle_get_32() - start);
+
+    return ret;
+}
+
+int chan_stats_read(const struct zbus_channel *chan, void *msg, k_timeout_t timeout)
+{
+    struct chan_stats *const stats = zbus_chan_user_data(chan);
+    const uint32_t start = k_cycle_get_32();
+
+    const int ret = zbus_chan_read(chan, msg, timeout);
+    if (stats == NULL)
+    {
+        return ret;
+    }
+
+    if (ret == -EBUSY || ret == -EAGAIN)
+    {
+        atomic_inc(&stats->read_busy);
+    }
+    atomic_max(&stats->max_read_cycles, k_cycle_get_32() - start);
+
+    return ret;
+}
+
+uint32_t chan_stats_listener_begin(const struct zbus_channel *chan)
+{
+    struct chan_stats *const stats = zbus_chan_user_data(chan);
+    const uint32_t start = k_cycle_get_32();
+
+    if (stats != NULL)
+    {
+        atomic_max(&stats->max_latency_cycles, start - stats->pub_start);
+    }
+
+    return start;
+}
+
+void chan_stats_listener_end(const struct zbus_channel *chan, uint32_t start)
+{
+    struct chan_stats *const stats = zbus_chan_user_data(chan);
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    const uint32_t cycles = k_cycle_get_32() - start;
+    atomic_inc(&stats->listener_runs);
+    atomic_add(&stats->listener_cycles, (atomic_val_t)cycles);
+    atomic_max(&stats->max_listener_cycles, cycles);
+}
+
+static uint16_t sat16(uint32_t value)
+{
+    return (uint16_t)MIN(value, UINT16_MAX);
+}
+
+static uint16_t cyc_to_us16(uint32_t cycles)
+{
+    return sat16(k_cyc_to_us_floor32(cycles));
+}
+
+// Counters move on, take the difference with the previous sample
+static uint32_t delta(atomic_t *counter, uint32_t *prev)
+{
+    const uint32_t now = (uint32_t)atomic_get(counter);
+    const uint32_t diff = now - *prev;
+
+    *prev = now;
+    return diff;
+}
+
+static void sample_chan(bus_chan_t id, uint32_t period_ms, bus_chan_sample_t *out)
+{
+    struct chan_stats *const stats = &chan_stats[id];
+
+    const uint32_t pubs = delta(&stats->pubs, &last[id].pubs);
+    const uint32_t runs = delta(&stats->listener_runs, &last[id].listener_runs);
+    const uint32_t cycles = delta(&stats->listener_cycles, &last[id].listener_cycles);
+
+    out->pubs_per_sec = sat16(period_ms == 0 ? 0 : pubs * MSEC_PER_SEC / period_ms);
+    out->pub_errors = sat16(delta(&stats->pub_errors, &last[id].pub_errors));
+    out->read_busy = sat16(delta(&stats->read_busy, &last[id].read_busy));
+    out->avg_listener_us = runs == 0 ? 0 : cyc_to_us16(cycles / runs);
+
+    out->max_pub_us = cyc_to_us16((uint32_t)atomic_clear(&stats->max_pub_cycles));
+    out->max_listener_us = cyc_to_us16((uint32_t)atomic_clear(&stats->max_listener_cycles));
+    out->max_latency_us = cyc_to_us16((uint32_t)atomic_clear(&stats->max_latency_cycles));
+    out->max_read_us = cyc_to_us16((uint32_t)atomic_clear(&stats->max_read_cycles));
+}
+
+static void sample_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    const uint64_t now_us = timesync_uptime_us();
+    const uint32_t period_ms = (uint32_t)((now_us - last_sample_us) / USEC_PER_MSEC);
+
+    bus_stats_t sample = {
+        .timestamp_us = now_us,
+        .period_ms = sat16(period_ms),
+    };
+
+    last_sample_us = now_us;
+
+    for (int c = 0; c < _BUS_CHAN_MAX; c++)
+    {
+        sample_chan(c, period_ms, &sample.chans[c]);
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    latest = sample;
+    k_spin_unlock(&lock, key);
+
+    int ret = chan_stats_pub(&chan_bus_stats, &sample, K_MSEC(100));
+    if (ret != 0)
+    {
+        LOG_ERR("Failed to publish channel statistics: %d", ret);
+    }
+
+    k_work_schedule(&sample_work, K_MSEC(CONFIG_CHAN_STATS_INTERVAL_MSEC));
+}
+
+void chan_stats_start(void)
+{
+    // Counting runs from boot, the first period starts now
+    bus_chan_sample_t discard;
+    for (int c = 0; c < _BUS_CHAN_MAX; c++)
+    {
+        sample_chan(c, 0, &discard);
+    }
+
+    last_sample_us = timesync_uptime_us();
+    k_work_schedule(&sample_work, K_MSEC(CONFIG_CHAN_STATS_INTERVAL_MSEC));
+}
+
+const char *chan_stats_name(bus_chan_t chan)
+{
+    return chan < _BUS_CHAN_MAX ? chan_names[chan] : "?";
+}
+
+void chan_stats_get(bus_stats_t *stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    *stats = latest;
+    k_spin_unlock(&lock, key);
+}
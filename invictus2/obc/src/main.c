@@ -1,9 +1,6 @@
 #include <zephyr/kernel.h>
 #include <zephyr/zbus/zbus.h>
 
-#include <zephyr/sys/atomic.h>
-#include <zephyr/sys/atomic_types.h>
-
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/drivers/pwm.h>
 
@@ -15,14 +12,21 @@
 
 LOG_MODULE_REGISTER(obc, LOG_LEVEL_INF);
 
+#include "boot.h"
+#include "chan_stats.h"
 #include "data_models.h"
 #include "validators.h"
 #include "packets.h"
 #include "shell.h"
 
-#include "services/lora.h"
+#include "services/config_store.h"
+#include "services/health.h"
+#include "services/kalman.h"
 #include "services/modbus.h"
+#include "services/navigator.h"
+#include "services/sd_logger.h"
 #include "services/state_machine/main_sm.h"
+#include "services/supervisor.h"
 
 static const struct gpio_dt_spec led_green =
     GPIO_DT_SPEC_GET(DT_NODELABEL(led_green_0), gpios);
@@ -30,6 +34,7 @@ static const struct gpio_dt_spec led_red = GPIO_DT_SPEC_GET(DT_NODELABEL(led_red
 static const struct pwm_dt_spec buzzer = PWM_DT_SPEC_GET(DT_NODELABEL(buzzer));
 
 #define BUZZER_PULSE_MICROS 500
+#define BUZZER_CHIRP_MSEC   200
 
 /* static const struct device *fem = DEVICE_DT_GET(DT_NODELABEL(nrf_radio_fem)); */
 
@@ -46,7 +51,7 @@ static const struct pwm_dt_spec buzzer = PWM_DT_SPEC_GET(DT_NODELABEL(buzzer));
 // the filling state machine. -- Medium priority thread.
 // - Navigator thread: Reads data from the navigator board via uart. -- Medium
 // priority thread.
-// - Data Thread: Saves sensor data and debug logs to the SD card. -- Low
+// - SD logger thread: Saves every zbus message to the SD card. -- Low
 // priority thread.
 //
 
@@ -54,116 +59,162 @@ static const struct pwm_dt_spec buzzer = PWM_DT_SPEC_GET(DT_NODELABEL(buzzer));
 //
 //
 // --- Sensor Channels ---
-ZBUS_CHAN_DEFINE(chan_thermo_sensors,  /* Channel Name */
-                 thermocouples_t,      /* Message Type */
-                 NULL,                 /* Validator Func */
-                 NULL,                 /* User Data */
-                 ZBUS_OBSERVERS_EMPTY, /* Observers */
-                 ZBUS_MSG_INIT(0)      /* Initial Value */
+ZBUS_CHAN_DEFINE(chan_thermo_sensors,         /* Channel Name */
+                 thermo_sample_t,             /* Message Type */
+                 NULL,                        /* Validator Func */
+                 CHAN_STATS(BUS_CHAN_THERMO), /* User Data */
+                 ZBUS_OBSERVERS_EMPTY,        /* Observers */
+                 ZBUS_MSG_INIT(0)             /* Initial Value */
 );
 
-ZBUS_CHAN_DEFINE(chan_pressure_sensors, /* Channel Name */
-                 pressures_t,           /* Message Type */
-                 NULL,                  /* Validator Func */
-                 NULL,                  /* User Data */
-                 ZBUS_OBSERVERS_EMPTY,  /* Observers */
-                 ZBUS_MSG_INIT(0)       /* Initial Value */
+ZBUS_CHAN_DEFINE(chan_pressure_sensors,         /* Channel Name */
+                 pressure_sample_t,             /* Message Type */
+                 NULL,                          /* Validator Func */
+                 CHAN_STATS(BUS_CHAN_PRESSURE), /* User Data */
+                 ZBUS_OBSERVERS_EMPTY,          /* Observers */
+                 ZBUS_MSG_INIT(0)               /* Initial Value */
 );
 
-ZBUS_CHAN_DEFINE(chan_weight_sensors,  /* Channel Name */
-                 loadcell_weights_t,   /* Message Type */
-                 NULL,                 /* Validator Func */
-                 NULL,                 /* User Data */
-                 ZBUS_OBSERVERS_EMPTY, /* Observers */
-                 ZBUS_MSG_INIT(0)      /* Initial Value */
+ZBUS_CHAN_DEFINE(chan_weight_sensors,         /* Channel Name */
+                 weight_sample_t,             /* Message Type */
+                 NULL,                        /* Validator Func */
+                 CHAN_STATS(BUS_CHAN_WEIGHT), /* User Data */
+                 ZBUS_OBSERVERS_EMPTY,        /* Observers */
+                 ZBUS_MSG_INIT(0)             /* Initial Value */
 );
 
-ZBUS_CHAN_DEFINE(chan_navigator_sensors, /* Channel Name */
-                 navigator_sensors_t,    /* Message Type */
-                 NULL,                   /* Validator Func */
-                 NULL,                   /* User Data */
-                 ZBUS_OBSERVERS_EMPTY,   /* Observers */
-                 ZBUS_MSG_INIT(0)        /* Initial Value */
+ZBUS_CHAN_DEFINE(chan_navigator_sensors,         /* Channel Name */
+                 navigator_sample_t,             /* Message Type */
+                 NULL,                           /* Validator Func */
+                 CHAN_STATS(BUS_CHAN_NAVIGATOR), /* User Data */
+                 ZBUS_OBSERVERS_EMPTY,           /* Observers */
+                 ZBUS_MSG_INIT(0)                /* Initial Value */
 );
 
-ZBUS_CHAN_DEFINE(chan_kalman_data,     /* Channel Name */
-                 kalman_data_t,        /* Message Type */
-                 NULL,                 /* Validator Func */
-                 NULL,                 /* User Data */
-                 ZBUS_OBSERVERS_EMPTY, /* Observers */
-                 ZBUS_MSG_INIT(0)      /* Initial Value */
+ZBUS_CHAN_DEFINE(chan_kalman_data,            /* Channel Name */
+                 kalman_sample_t,             /* Message Type */
+                 NULL,                        /* Validator Func */
+                 CHAN_STATS(BUS_CHAN_KALMAN), /* User Data */
+                 ZBUS_OBSERVERS_EMPTY,        /* Observers */
+                 ZBUS_MSG_INIT(0)             /* Initial Value */
 );
 
 // --- Mobdus Actuator Write Channel ---
-ZBUS_CHAN_DEFINE(chan_actuators,       /* Channel Name */
-                 actuators_bitmap_t,   /* Message Type */
-                 NULL,                 /* Validator Func */
-                 NULL,                 /* User Data */
-                 ZBUS_OBSERVERS_EMPTY, /* Observers */
-                 ZBUS_MSG_INIT(0)      /* Initial Value */
+ZBUS_CHAN_DEFINE(chan_actuators,                 /* Channel Name */
+                 actuators_bitmap_t,             /* Message Type */
+                 NULL,                           /* Validator Func */
+                 CHAN_STATS(BUS_CHAN_ACTUATORS), /* User Data */
+                 ZBUS_OBSERVERS_EMPTY,           /* Observers */
+                 ZBUS_MSG_INIT(0)                /* Initial Value */
+);
+
+// --- Modbus Bus Health ---
+ZBUS_CHAN_DEFINE(chan_modbus_health,                 /* Channel Name */
+                 modbus_health_t,                    /* Message Type */
+                 NULL,                               /* Validator Func */
+                 CHAN_STATS(BUS_CHAN_MODBUS_HEALTH), /* User Data */
+                 ZBUS_OBSERVERS_EMPTY,               /* Observers */
+                 ZBUS_MSG_INIT(0)                    /* Initial Value */
 );
 
 // --- Packets from Ground Station ---
-ZBUS_CHAN_DEFINE(chan_packets,         /* Channel Name */
-                 generic_packet_t,     /* Message Type */
-                 packet_validator,     /* Validator Func */
-                 NULL,                 /* User Data */
-                 ZBUS_OBSERVERS_EMPTY, /* Observers */
-                 ZBUS_MSG_INIT(0)      /* Initial Value */
+ZBUS_CHAN_DEFINE(chan_packets,                 /* Channel Name */
+                 generic_packet_t,             /* Message Type */
+                 packet_validator,             /* Validator Func */
+                 CHAN_STATS(BUS_CHAN_PACKETS), /* User Data */
+                 ZBUS_OBSERVERS_EMPTY,         /* Observers */
+                 ZBUS_MSG_INIT(0)              /* Initial Value */
 );
 
 // --- Rocket State ---
-ZBUS_CHAN_DEFINE(chan_rocket_state,    /* Channel Name */
-                 state_data_t,         /* Message Type */
-                 NULL,                 /* Validator Func */
-                 NULL,                 /* User Data */
-                 ZBUS_OBSERVERS_EMPTY, /* Observers */
-                 ZBUS_MSG_INIT(0)      /* Initial Value */
+ZBUS_CHAN_DEFINE(chan_rocket_state,                 /* Channel Name */
+                 state_data_t,                      /* Message Type */
+                 NULL,                              /* Validator Func */
+                 CHAN_STATS(BUS_CHAN_ROCKET_STATE), /* User Data */
+                 ZBUS_OBSERVERS_EMPTY,              /* Observers */
+                 ZBUS_MSG_INIT(0)                   /* Initial Value */
 );
 
-static lora_context_t lora_context;
-
-// --- Thread Spawning ---
-
-bool setup_services(atomic_t *stop_signal)
-{
-    LOG_INF("Setting up threads...");
-    lora_context.stop_signal = stop_signal;
-
-    LOG_INF("  * state machine...");
-    if (!state_machine_service_setup())
-    {
-        LOG_ERR("State machine service setup failed");
-        return false;
-    }
+// --- Service Health ---
+ZBUS_CHAN_DEFINE(chan_health,                 /* Channel Name */
+                 health_sample_t,             /* Message Type */
+                 NULL,                        /* Validator Func */
+                 CHAN_STATS(BUS_CHAN_HEALTH), /* User Data */
+                 ZBUS_OBSERVERS_EMPTY,        /* Observers */
+                 ZBUS_MSG_INIT(0)             /* Initial Value */
+);
 
-    // Initialize the modbus thread
-    LOG_INF("  * modbus...");
-    if (!modbus_service_setup())
-    {
-        LOG_ERR("Modbus RTU master setup failed");
-        return false;
-    }
+// --- Command Latency ---
+ZBUS_CHAN_DEFINE(chan_cmd_latency,                 /* Channel Name */
+                 cmd_latency_t,                    /* Message Type */
+                 NULL,                             /* Validator Func */
+                 CHAN_STATS(BUS_CHAN_CMD_LATENCY), /* User Data */
+                 ZBUS_OBSERVERS_EMPTY,             /* Observers */
+                 ZBUS_MSG_INIT(0)                  /* Initial Value */
+);
 
-    /* LOG_INF("  * lora..."); */
-    /* if (!lora_service_setup(&lora_context)) */
-    /* { */
-    /*     LOG_ERR("LoRa thread setup failed"); */
-    /*     return false; */
-    /* } */
+// --- Channel Statistics ---
+ZBUS_CHAN_DEFINE(chan_bus_stats,                 /* Channel Name */
+                 bus_stats_t,                    /* Message Type */
+                 NULL,                           /* Validator Func */
+                 CHAN_STATS(BUS_CHAN_BUS_STATS), /* User Data */
+                 ZBUS_OBSERVERS_EMPTY,           /* Observers */
+                 ZBUS_MSG_INIT(0)                /* Initial Value */
+);
 
-    LOG_INF("done...");
-    return true;
+// --- Boot Sequence ---
+
+// Stages only wait on the earlier ones, the services of a stage are brought up concurrently
+static const struct boot_service boot_services[] = {
+    // The state machine loads its configuration from the store
+    {.name = "config store", .stage = 0, .setup = config_store_service_setup},
+    {.name = "health",
+     .stage = 0,
+     .setup = health_service_setup,
+     .start = health_service_start},
+    {.name = "channel stats", .stage = 0, .start = chan_stats_start},
+
+    {.name = "state machine",
+     .stage = 1,
+     .setup = state_machine_service_setup,
+     .start = state_machine_service_start},
+    {.name = "navigator",
+     .stage = 1,
+     .setup = navigator_service_setup,
+     .start = navigator_service_start},
+    {.name = "kalman",
+     .stage = 1,
+     .setup = kalman_service_setup,
+     .start = kalman_service_start},
+    {.name = "sd logger",
+     .stage = 1,
+     .setup = sd_logger_service_setup,
+     .start = sd_logger_service_start},
+    {.name = "modbus",
+     .stage = 1,
+     .setup = modbus_service_setup,
+     .start = modbus_service_start},
+
+    // Last, the watchdog runs from here on
+    {.name = "supervisor",
+     .stage = 2,
+     .setup = supervisor_service_setup,
+     .start = supervisor_service_start},
+};
+
+static void buzzer_off_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+    pwm_set_pulse_dt(&buzzer, 0);
 }
 
-void health_check(void)
-{
-    LOG_INF("Heartbeat");
+static K_WORK_DELAYABLE_DEFINE(buzzer_off_work, buzzer_off_work_handler);
 
-    k_sleep(K_MSEC(1000));
+// Turned off by the system work queue, the caller goes on meanwhile
+static void buzzer_chirp(void)
+{
     pwm_set_pulse_dt(&buzzer, BUZZER_PULSE_MICROS * 1000);
-    k_sleep(K_MSEC(1000));
-    pwm_set_pulse_dt(&buzzer, 0);
+    k_work_reschedule(&buzzer_off_work, K_MSEC(BUZZER_CHIRP_MSEC));
 }
 
 // --- Main ---
@@ -171,23 +222,18 @@ int main(void)
 {
     LOG_INF("Starting OBC main thread");
 
-    health_check();
+    buzzer_chirp();
     setup_shell_if_enabled();
-    health_check();
 
-    LOG_INF("Setting up services");
-    atomic_t stop_signal = ATOMIC_INIT(0);
-    if (!setup_services(&stop_signal))
+    LOG_INF("Bringing up services");
+    if (!boot_run(boot_services, ARRAY_SIZE(boot_services)))
     {
-        LOG_ERR("Failed to setup services");
+        LOG_ERR("Failed to bring up services");
         k_oops();
     }
 
-    /* lora_service_start(); */
-    state_machine_service_start();
-    // modbus_service_start();
-
     LOG_INF("Services started.");
+    buzzer_chirp();
 
     return 0;
 }
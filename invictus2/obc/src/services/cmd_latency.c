@@ -0,0 +1,223 @@
+#include "services/cmd_latency.h"
+#include "chan_stats.h"
+
+#include "invictus2/timesync.h"
+
+#include "zephyr/kernel.h"
+#include "zephyr/logging/log.h"
+#include "zephyr/spinlock.h"
+#include "zephyr/zbus/zbus.h"
+
+LOG_MODULE_REGISTER(cmd_latency, LOG_LEVEL_INF);
+
+#define TIMEOUT_US (CONFIG_CMD_LATENCY_TIMEOUT_MSEC * USEC_PER_MSEC)
+
+// Published channels
+ZBUS_CHAN_DECLARE(chan_cmd_latency);
+
+static void done_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(done_work, done_work_handler);
+
+// Done commands waiting to be published, stamps may come from ISRs
+K_MSGQ_DEFINE(done_q, sizeof(cmd_latency_t), CONFIG_CMD_LATENCY_TRACED, 8);
+
+static struct k_spinlock lock;
+static struct traced
+{
+    cmd_latency_t latency;
+    bool in_flight;
+} traced[CONFIG_CMD_LATENCY_TRACED];
+static uint32_t next_id = CMD_LATENCY_NONE + 1;
+static uint32_t last_id[_CMD_STAGE_MAX]; // Last command stamped at each stage
+static struct cmd_latency_stats stats;
+static uint64_t stage_sum_us[_CMD_STAGE_MAX];
+
+// Lock held, account a command and queue it for publishing
+static void finish(struct traced *const t)
+{
+    const cmd_latency_t *const current = &t->latency;
+
+    t->in_flight = false;
+    stats.commands++;
+
+    for (int s = 0; s < _CMD_STAGE_MAX; s++)
+    {
+        if (s != CMD_STAGE_RX && current->stage_us[s] == 0)
+        {
+            continue;
+        }
+
+        struct cmd_latency_stage_stats *const stage = &stats.stages[s];
+        stage->count++;
+        stage->last_us = current->stage_us[s];
+        stage->max_us = MAX(stage->max_us, current->stage_us[s]);
+        stage_sum_us[s] += current->stage_us[s];
+        stage->avg_us = (uint32_t)(stage_sum_us[s] / stage->count);
+    }
+
+    stats.last_total_us = current->stage_us[current->last_stage];
+    stats.max_total_us = MAX(stats.max_total_us, stats.last_total_us);
+
+    if (k_msgq_put(&done_q, current, K_NO_WAIT) != 0)
+    {
+        LOG_WRN("Latency of command %u not published, queue full", current->id);
+    }
+}
+
+// Lock held, NULL if the command is done or unknown
+static struct traced *find(const uint32_t id)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(traced); i++)
+    {
+        if (traced[i].in_flight && traced[i].latency.id == id)
+        {
+            return &traced[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void done_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    uint64_t next_us = UINT64_MAX;
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    const uint64_t now_us = timesync_uptime_us();
+    for (size_t i = 0; i < ARRAY_SIZE(traced); i++)
+    {
+        struct traced *const t = &traced[i];
+        if (!t->in_flight)
+        {
+            continue;
+        }
+
+        const uint64_t age_us = now_us - t->latency.rx_timestamp_us;
+        if (t->latency.last_stage == CMD_STAGE_MODBUS_WRITE || age_us >= TIMEOUT_US)
+        {
+            finish(t);
+        }
+        else
+        {
+            next_us = MIN(next_us, TIMEOUT_US - age_us);
+        }
+    }
+    k_spin_unlock(&lock, key);
+
+    if (next_us != UINT64_MAX)
+    {
+        k_work_schedule(&done_work, K_USEC(next_us));
+    }
+
+    cmd_latency_t done;
+    while (k_msgq_get(&done_q, &done, K_NO_WAIT) == 0)
+    {
+        LOG_INF("Command %u (%d): %u us to stage %d", done.id, done.command_id,
+                done.stage_us[done.last_stage], done.last_stage);
+
+        const int ret = chan_stats_pub(&chan_cmd_latency, &done, K_MSEC(100));
+        if (ret != 0)
+        {
+            LOG_WRN("Failed to publish command latency: %d", ret);
+        }
+    }
+}
+
+uint32_t cmd_latency_rx(uint8_t command_id)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    // A free slot, or the oldest command if all are traced
+    struct traced *slot = &traced[0];
+    for (size_t i = 0; i < ARRAY_SIZE(traced) && slot->in_flight; i++)
+    {
+        if (!traced[i].in_flight || traced[i].latency.id - slot->latency.id > INT32_MAX)
+        {
+            slot = &traced[i];
+        }
+    }
+
+    const bool evicted = slot->in_flight;
+    if (evicted)
+    {
+        finish(slot);
+    }
+
+    const uint32_t id = next_id;
+    next_id = next_id == UINT32_MAX ? CMD_LATENCY_NONE + 1 : next_id + 1;
+
+    slot->latency = (cmd_latency_t){
+        .id = id,
+        .command_id = command_id,
+        .last_stage = CMD_STAGE_RX,
+        .rx_timestamp_us = timesync_uptime_us(),
+    };
+    slot->in_flight = true;
+    last_id[CMD_STAGE_RX] = id;
+
+    k_spin_unlock(&lock, key);
+
+    // Publish an evicted one right away, the timeouts are rescheduled from there
+    if (evicted)
+    {
+        k_work_reschedule(&done_work, K_NO_WAIT);
+    }
+    else if (!k_work_delayable_is_pending(&done_work))
+    {
+        k_work_schedule(&done_work, K_USEC(TIMEOUT_US));
+    }
+
+    return id;
+}
+
+void cmd_latency_stamp(uint32_t id, cmd_stage_t stage)
+{
+    const uint64_t now_us = timesync_uptime_us();
+    bool done = false;
+
+    if (stage <= CMD_STAGE_RX || stage >= _CMD_STAGE_MAX)
+    {
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    last_id[stage] = id;
+
+    struct traced *const t = find(id);
+    if (t != NULL && t->latency.stage_us[stage] == 0)
+    {
+        // At least 1 us, 0 marks the stages the command did not go through
+        t->latency.stage_us[stage] = MAX((uint32_t)(now_us - t->latency.rx_timestamp_us), 1);
+        t->latency.last_stage = MAX(t->latency.last_stage, stage);
+        done = stage == CMD_STAGE_MODBUS_WRITE;
+    }
+    k_spin_unlock(&lock, key);
+
+    if (done)
+    {
+        k_work_reschedule(&done_work, K_NO_WAIT);
+    }
+}
+
+uint32_t cmd_latency_last(cmd_stage_t stage)
+{
+    if (stage >= _CMD_STAGE_MAX)
+    {
+        return CMD_LATENCY_NONE;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    const uint32_t id = last_id[stage];
+    k_spin_unlock(&lock, key);
+
+    return id;
+}
+
+void cmd_latency_get_stats(struct cmd_latency_stats *out)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    *out = stats;
+    k_spin_unlock(&lock, key);
+}
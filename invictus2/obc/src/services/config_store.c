@@ -0,0 +1,171 @@
+#include "services/config_store.h"
+#include "services/state_machine/flight_exec.h"
+
+#include <string.h>
+
+#include "zephyr/kernel.h"
+#include "zephyr/logging/log.h"
+#include "zephyr/spinlock.h"
+#include "zephyr/storage/flash_map.h"
+
+LOG_MODULE_REGISTER(config_store_service, LOG_LEVEL_INF);
+
+#if FIXED_PARTITION_EXISTS(storage_partition)
+
+#include "zephyr/drivers/flash.h"
+#include "zephyr/fs/nvs.h"
+
+// Bump on any change of struct sm_config, older entries are then ignored
+#define SM_CONFIG_VERSION 1
+#define SM_CONFIG_ID      1
+
+struct stored_config
+{
+    uint16_t version; // SM_CONFIG_VERSION
+    uint16_t size;    // sizeof(struct sm_config), catches a forgotten version bump
+    struct sm_config config;
+};
+
+static struct nvs_fs nvs = {
+    .flash_device = FIXED_PARTITION_DEVICE(storage_partition),
+    .offset = FIXED_PARTITION_OFFSET(storage_partition),
+};
+static bool mounted;
+
+// Latest configuration to save, written by config_store_save() and read by the save work
+static struct stored_config staged;
+static struct k_spinlock staged_lock;
+
+static void save_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(save_work, save_work_handler);
+
+static void save_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    // Programming and erasing the flash runs with XIP off and interrupts locked, that
+    // would stall the flight executor. Saved once back on the ground.
+    if (sm_flight_mode())
+    {
+        k_work_schedule(&save_work, K_MSEC(CONFIG_CONFIG_STORE_SAVE_DELAY_MSEC));
+        return;
+    }
+
+    struct stored_config entry;
+
+    k_spinlock_key_t key = k_spin_lock(&staged_lock);
+    entry = staged;
+    k_spin_unlock(&staged_lock, key);
+
+    // NVS skips the write when the entry is unchanged
+    const ssize_t ret = nvs_write(&nvs, SM_CONFIG_ID, &entry, sizeof(entry));
+    if (ret < 0)
+    {
+        LOG_ERR("Failed to save the configuration: %d", (int)ret);
+        return;
+    }
+
+    if (ret > 0)
+    {
+        LOG_INF("Configuration saved");
+    }
+}
+
+bool config_store_service_setup(void)
+{
+    if (!device_is_ready(nvs.flash_device))
+    {
+        LOG_ERR("Flash device not ready");
+        return false;
+    }
+
+    struct flash_pages_info page;
+    int ret = flash_get_page_info_by_offs(nvs.flash_device, nvs.offset, &page);
+    if (ret < 0)
+    {
+        LOG_ERR("Failed to get the flash page size: %d", ret);
+        return false;
+    }
+
+    nvs.sector_size = page.size;
+    nvs.sector_count = FIXED_PARTITION_SIZE(storage_partition) / page.size;
+
+    ret = nvs_mount(&nvs);
+    if (ret < 0)
+    {
+        // Not fatal, the state machine runs with the defaults
+        LOG_ERR("Failed to mount the config store: %d", ret);
+        return true;
+    }
+
+    mounted = true;
+    LOG_INF("Config store: %u sectors of %u bytes, %d bytes free", nvs.sector_count,
+            nvs.sector_size, (int)nvs_calc_free_space(&nvs));
+    return true;
+}
+
+bool config_store_load(struct sm_config *config)
+{
+    if (!mounted)
+    {
+        return false;
+    }
+
+    struct stored_config entry;
+    const ssize_t ret = nvs_read(&nvs, SM_CONFIG_ID, &entry, sizeof(entry));
+    if (ret == -ENOENT)
+    {
+        LOG_INF("No stored configuration, using the defaults");
+        return false;
+    }
+
+    if (ret != sizeof(entry) || entry.version != SM_CONFIG_VERSION ||
+        entry.size != sizeof(entry.config))
+    {
+        LOG_WRN("Stored configuration is from another firmware version, using the defaults");
+        return false;
+    }
+
+    *config = entry.config;
+    LOG_INF("Loaded the stored configuration");
+    return true;
+}
+
+void config_store_save(const struct sm_config *config)
+{
+    if (!mounted)
+    {
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&staged_lock);
+    staged.version = SM_CONFIG_VERSION;
+    staged.size = sizeof(staged.config);
+    staged.config = *config;
+    k_spin_unlock(&staged_lock, key);
+
+    // Flash writes are rare and slow, the system work queue keeps them off the services.
+    // Already scheduled saves pick the latest configuration up.
+    k_work_schedule(&save_work, K_MSEC(CONFIG_CONFIG_STORE_SAVE_DELAY_MSEC));
+}
+
+#else
+
+bool config_store_service_setup(void)
+{
+    LOG_WRN("No storage partition in the devicetree, configuration not persisted");
+    return true;
+}
+
+bool config_store_load(struct sm_config *config)
+{
+    ARG_UNUSED(config);
+    return false;
+}
+
+void config_store_save(const struct sm_config *config)
+{
+    ARG_UNUSED(config);
+}
+
+#endif // FIXED_PARTITION_EXISTS(storage_partition)
@@ -0,0 +1,197 @@
+#include "services/health.h"
+#include "chan_stats.h"
+
+#include "invictus2/timesync.h"
+
+#include "zephyr/kernel.h"
+#include "zephyr/logging/log.h"
+#include "zephyr/spinlock.h"
+#include "zephyr/sys/slist.h"
+#include "zephyr/zbus/zbus.h"
+
+LOG_MODULE_REGISTER(health_service, LOG_LEVEL_INF);
+
+// The work queue backlog is read under irq_lock(), as the kernel's own lock
+BUILD_ASSERT(!IS_ENABLED(CONFIG_SMP), "Work queue backlog sampling assumes a single CPU");
+
+// Published channels
+ZBUS_CHAN_DECLARE(chan_health);
+
+static void sample_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(sample_work, sample_work_handler);
+
+static struct
+{
+    k_tid_t thread;
+    struct k_work_q *work_q; // NULL for plain threads
+    uint64_t last_cycles;
+    uint8_t max_backlog;
+} monitored[_HEALTH_SERVICE_MAX];
+
+static const char *const service_names[] = {
+    [HEALTH_SYS_WORK_Q] = "sys_work_q",
+    [HEALTH_SM_WORK_Q] = "sm",
+    [HEALTH_FLIGHT_EXEC] = "flight_exec",
+    [HEALTH_KALMAN_WORK_Q] = "kalman",
+    [HEALTH_NAVIGATOR_WORK_Q] = "navigator",
+    [HEALTH_SD_LOGGER_WORK_Q] = "sd_logger",
+    [HEALTH_MODBUS_WORK_Q] = "modbus",
+    [HEALTH_LORA] = "lora",
+    [HEALTH_SUPERVISOR] = "supervisor",
+};
+
+BUILD_ASSERT(ARRAY_SIZE(service_names) == _HEALTH_SERVICE_MAX, "Every service needs a name");
+
+static struct k_spinlock lock;
+static health_sample_t latest;
+static uint64_t last_all_cycles;
+static uint64_t last_busy_cycles;
+static uint64_t last_sample_us;
+
+static uint16_t permille(uint64_t part, uint64_t total)
+{
+    return total == 0 ? 0 : (uint16_t)MIN(part * 1000 / total, 1000);
+}
+
+static uint8_t work_q_backlog(struct k_work_q *work_q)
+{
+    // k_work_q has no API for it, count the pending list like the kernel does, irqs locked
+    const unsigned int key = irq_lock();
+    const size_t pending = sys_slist_len(&work_q->pending);
+    irq_unlock(key);
+
+    return (uint8_t)MIN(pending, UINT8_MAX);
+}
+
+static void sample_service(health_service_t service, uint64_t period_cycles,
+                           health_service_sample_t *out)
+{
+    k_tid_t thread;
+    struct k_work_q *work_q;
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    thread = monitored[service].thread;
+    work_q = monitored[service].work_q;
+    k_spin_unlock(&lock, key);
+
+    if (thread == NULL)
+    {
+        return; // Not running
+    }
+
+    k_thread_runtime_stats_t runtime;
+    if (k_thread_runtime_stats_get(thread, &runtime) == 0)
+    {
+        out->cpu_permille =
+            permille(runtime.execution_cycles - monitored[service].last_cycles, period_cycles);
+        monitored[service].last_cycles = runtime.execution_cycles;
+    }
+
+    // Scans the stack for the painted pattern, it only runs once per period
+    size_t unused;
+    out->stack_size = (uint16_t)MIN(thread->stack_info.size, UINT16_MAX);
+    if (k_thread_stack_space_get(thread, &unused) == 0)
+    {
+        out->stack_used = (uint16_t)MIN(thread->stack_info.size - unused, UINT16_MAX);
+    }
+
+    if (work_q != NULL)
+    {
+        out->backlog = work_q_backlog(work_q);
+        monitored[service].max_backlog = MAX(monitored[service].max_backlog, out->backlog);
+        out->max_backlog = monitored[service].max_backlog;
+    }
+
+    if ((uint32_t)out->stack_used * 100 >=
+        (uint32_t)out->stack_size * CONFIG_HEALTH_STACK_WARN_PERCENT)
+    {
+        LOG_WRN("%s stack at %u of %u bytes", service_names[service], out->stack_used,
+                out->stack_size);
+    }
+}
+
+static void sample_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    k_thread_runtime_stats_t all;
+    k_thread_runtime_stats_all_get(&all);
+
+    // execution_cycles includes the idle thread, total_cycles does not
+    const uint64_t period_cycles = all.execution_cycles - last_all_cycles;
+    const uint64_t now_us = timesync_uptime_us();
+
+    health_sample_t sample = {
+        .timestamp_us = now_us,
+        .cpu_load_permille = permille(all.total_cycles - last_busy_cycles, period_cycles),
+        .period_ms = (uint16_t)MIN((now_us - last_sample_us) / USEC_PER_MSEC, UINT16_MAX),
+    };
+
+    last_all_cycles = all.execution_cycles;
+    last_busy_cycles = all.total_cycles;
+    last_sample_us = now_us;
+
+    for (int s = 0; s < _HEALTH_SERVICE_MAX; s++)
+    {
+        sample_service(s, period_cycles, &sample.services[s]);
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    latest = sample;
+    k_spin_unlock(&lock, key);
+
+    int ret = chan_stats_pub(&chan_health, &sample, K_MSEC(100));
+    if (ret != 0)
+    {
+        LOG_ERR("Failed to publish health sample: %d", ret);
+    }
+
+    k_work_schedule(&sample_work, K_MSEC(CONFIG_HEALTH_SAMPLE_INTERVAL_MSEC));
+}
+
+void health_register_thread(health_service_t service, k_tid_t thread)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    monitored[service].thread = thread;
+    monitored[service].work_q = NULL;
+    k_spin_unlock(&lock, key);
+}
+
+void health_register_work_q(health_service_t service, struct k_work_q *work_q)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    monitored[service].thread = k_work_queue_thread_get(work_q);
+    monitored[service].work_q = work_q;
+    k_spin_unlock(&lock, key);
+}
+
+const char *health_service_name(health_service_t service)
+{
+    return service < _HEALTH_SERVICE_MAX ? service_names[service] : "?";
+}
+
+void health_get_sample(health_sample_t *sample)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    *sample = latest;
+    k_spin_unlock(&lock, key);
+}
+
+bool health_service_setup(void)
+{
+    // Also runs the sampling
+    health_register_work_q(HEALTH_SYS_WORK_Q, &k_sys_work_q);
+    return true;
+}
+
+void health_service_start(void)
+{
+    // The first period starts now, not at boot
+    k_thread_runtime_stats_t all;
+    k_thread_runtime_stats_all_get(&all);
+    last_all_cycles = all.execution_cycles;
+    last_busy_cycles = all.total_cycles;
+    last_sample_us = timesync_uptime_us();
+
+    k_work_schedule(&sample_work, K_MSEC(CONFIG_HEALTH_SAMPLE_INTERVAL_MSEC));
+}
@@ -0,0 +1,138 @@
+#include "services/kalman.h"
+#include "services/kalman/filter.h"
+#include "services/health.h"
+
+#include "chan_stats.h"
+#include "data_models.h"
+#include "invictus2/trace.h"
+
+#include "zephyr/kernel.h"
+#include "zephyr/logging/log.h"
+#include "zephyr/zbus/zbus.h"
+
+LOG_MODULE_REGISTER(kalman_service, LOG_LEVEL_INF);
+
+static void filter_work_handler(struct k_work *work);
+static K_WORK_DEFINE(filter_work, filter_work_handler);
+
+K_THREAD_STACK_DEFINE(kalman_work_q_stack, CONFIG_KALMAN_WORK_Q_STACK);
+static struct k_work_q kalman_work_q;
+
+// Subscribed channels
+ZBUS_CHAN_DECLARE(chan_navigator_sensors);
+
+// Published channels
+ZBUS_CHAN_DECLARE(chan_kalman_data);
+
+static void kalman_listener_cb(const struct zbus_channel *chan);
+
+CHAN_STATS_LISTENER_DEFINE(kalman_listener, kalman_listener_cb);
+ZBUS_CHAN_ADD_OBS(chan_navigator_sensors, kalman_listener, CONFIG_KALMAN_ZBUS_LISTENER_PRIO);
+
+// The navigator publishes a frame worth of samples back to back, every one is queued
+K_MSGQ_DEFINE(sample_q, sizeof(navigator_sample_t), CONFIG_KALMAN_QUEUE_DEPTH, 8);
+
+static struct kf_state kf;
+static struct kalman_stats stats;
+static uint64_t total_us;
+static uint64_t last_timestamp_us; // Of the previous sample, 0 before the first one
+
+static void kalman_listener_cb(const struct zbus_channel *chan)
+{
+    // Runs in the publisher's context, the message can be read without locking
+    if (k_msgq_put(&sample_q, zbus_chan_const_msg(chan), K_NO_WAIT) != 0)
+    {
+        stats.dropped++;
+        return;
+    }
+
+    k_work_submit_to_queue(&kalman_work_q, &filter_work);
+}
+
+static void filter_sample(const navigator_sample_t *sample)
+{
+    // Over the real gap, a sample dropped on the link is still propagated over. The nominal
+    // period on the first sample, or if the navigator clock went back.
+    uint32_t dt_us = 0;
+    if (last_timestamp_us != 0 && sample->timestamp_us > last_timestamp_us)
+    {
+        dt_us = (uint32_t)MIN(sample->timestamp_us - last_timestamp_us, KF_MAX_DT_US);
+    }
+    last_timestamp_us = sample->timestamp_us;
+
+    TRACE_BEGIN(TRACE_KALMAN_STEP);
+    const uint32_t start = k_cycle_get_32();
+    kf_update(&kf, &sample->sensors, dt_us);
+    const uint32_t took_us = k_cyc_to_us_ceil32(k_cycle_get_32() - start);
+    TRACE_END(TRACE_KALMAN_STEP);
+
+    kalman_sample_t estimate = {.timestamp_us = sample->timestamp_us};
+    kf_output(&kf, &estimate.kalman);
+
+    TRACE_BEGIN(TRACE_ZBUS_PUB);
+    int ret = chan_stats_pub(&chan_kalman_data, &estimate, K_MSEC(1));
+    TRACE_END(TRACE_ZBUS_PUB);
+    if (ret != 0)
+    {
+        LOG_WRN("Failed to publish kalman data: %d", ret);
+    }
+
+    const unsigned int key = irq_lock();
+    stats.runs++;
+    stats.last_us = took_us;
+    stats.max_us = MAX(stats.max_us, took_us);
+    total_us += took_us;
+    stats.avg_us = (uint32_t)(total_us / stats.runs);
+    irq_unlock(key);
+}
+
+static void filter_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    navigator_sample_t sample;
+
+    while (k_msgq_get(&sample_q, &sample, K_NO_WAIT) == 0)
+    {
+        filter_sample(&sample);
+    }
+}
+
+void kalman_get_stats(struct kalman_stats *out)
+{
+    const unsigned int key = irq_lock();
+    *out = stats;
+    irq_unlock(key);
+}
+
+bool kalman_service_setup(void)
+{
+    const struct kf_params params = {
+        .imu_period_us = CONFIG_KALMAN_IMU_PERIOD_USEC,
+        .baro_decimation = CONFIG_KALMAN_BARO_DECIMATION,
+        .accel_noise_mms2 = CONFIG_KALMAN_ACCEL_NOISE_MMS2,
+        .baro_noise_mm = CONFIG_KALMAN_BARO_NOISE_MM,
+        .launch_accel_mg = CONFIG_KALMAN_LAUNCH_ACCEL_MG,
+        .align_samples = CONFIG_KALMAN_ALIGN_SAMPLES,
+    };
+
+    if (!kf_init(&kf, &params))
+    {
+        LOG_ERR("Invalid navigation filter parameters");
+        return false;
+    }
+
+    LOG_INF("Filter gains: altitude %d, speed %d (Q16)", kf.k_alt_q16, kf.k_speed_q16);
+
+    k_work_queue_init(&kalman_work_q);
+    return true;
+}
+
+void kalman_service_start(void)
+{
+    k_work_queue_start(&kalman_work_q, kalman_work_q_stack,
+                       K_THREAD_STACK_SIZEOF(kalman_work_q_stack), CONFIG_KALMAN_WORK_Q_PRIO,
+                       NULL);
+    k_thread_name_set(&kalman_work_q.thread, "kalman");
+    health_register_work_q(HEALTH_KALMAN_WORK_Q, &kalman_work_q);
+}
@@ -0,0 +1,321 @@
+#include "services/kalman/filter.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <zephyr/sys/util.h>
+
+#define G_MG         1000
+#define STILL_MG     50 // Accelerometer magnitude tolerance around 1 g while still
+#define STILL_DDPS   50 // Gyro rate tolerance while still, in 0.1 deg/s
+#define RICCATI_RUNS 500
+#define US_Q40       1099512 // 1 us in s, Q40
+
+/*
+ * ISA pressure altitude, h = 44330.8 m * (1 - (p / 1013.25 hPa)^0.190263), in mm, every
+ * 10 hPa from 200 hPa (11.8 km) to 1100 hPa. Linear interpolation between entries is
+ * within 0.1 m of the formula at sea level.
+ */
+#define BARO_TABLE_MIN_DHPA  2000
+#define BARO_TABLE_STEP_DHPA 100
+
+static const int32_t baro_altitude_mm[] = {
+    11774895, 11471272, 11179140, 10897570, 10625745, 10362941,
+    10108517, 9861896, 9622564, 9390057, 9163953, 8943872,
+    8729467, 8520420, 8316442, 8117264, 7922643, 7732352,
+    7546180, 7363934, 7185433, 7010511, 6839009, 6670782,
+    6505695, 6343618, 6184431, 6028023, 5874286, 5723122,
+    5574435, 5428137, 5284143, 5142375, 5002756, 4865216,
+    4729686, 4596101, 4464401, 4334527, 4206423, 4080037,
+    3955317, 3832216, 3710687, 3590686, 3472170, 3355100,
+    3239437, 3125142, 3012181, 2900519, 2790124, 2680963,
+    2573006, 2466225, 2360590, 2256074, 2152652, 2050298,
+    1948988, 1848698, 1749406, 1651090, 1553728, 1457300,
+    1361786, 1267168, 1173426, 1080542, 988500, 897283,
+    806873, 717256, 628416, 540337, 453006, 366409,
+    280532, 195361, 110884, 27089, -56038, -138507,
+    -220330, -301519, -382084, -462035, -541385, -620141,
+    -698314,
+};
+
+int32_t kf_baro_altitude_mm(uint16_t pressure_dhpa)
+{
+    const int32_t max_dhpa =
+        BARO_TABLE_MIN_DHPA + BARO_TABLE_STEP_DHPA * (ARRAY_SIZE(baro_altitude_mm) - 1);
+    const int32_t p = CLAMP((int32_t)pressure_dhpa, BARO_TABLE_MIN_DHPA, max_dhpa - 1);
+
+    const int32_t i = (p - BARO_TABLE_MIN_DHPA) / BARO_TABLE_STEP_DHPA;
+    const int32_t frac = (p - BARO_TABLE_MIN_DHPA) % BARO_TABLE_STEP_DHPA;
+
+    return baro_altitude_mm[i] +
+           (baro_altitude_mm[i + 1] - baro_altitude_mm[i]) * frac / BARO_TABLE_STEP_DHPA;
+}
+
+static inline int32_t mul_q30(int32_t a, int32_t b)
+{
+    return (int32_t)(((int64_t)a * b) >> 30);
+}
+
+/*
+ * Steady state gains of the vertical channel: iterate the Riccati equation over one baro
+ * period (baro_decimation predictions, then the correction) until it settles.
+ */
+static void solve_gains(struct kf_state *kf, const struct kf_params *params)
+{
+    const float dt = params->imu_period_us * 1e-6f;
+    const float qa = (params->accel_noise_mms2 * 1e-3f) * (params->accel_noise_mms2 * 1e-3f);
+    const float r = (params->baro_noise_mm * 1e-3f) * (params->baro_noise_mm * 1e-3f);
+
+    const float q00 = qa * dt * dt * dt * dt / 4.0f;
+    const float q01 = qa * dt * dt * dt / 2.0f;
+    const float q11 = qa * dt * dt;
+
+    float p00 = r, p01 = 0.0f, p11 = 1.0f;
+    float k0 = 0.0f, k1 = 0.0f;
+
+    for (int run = 0; run < RICCATI_RUNS; run++)
+    {
+        for (int i = 0; i < params->baro_decimation; i++)
+        {
+            // P = F P F' + Q, F = [1 dt; 0 1]
+            p00 += 2.0f * dt * p01 + dt * dt * p11 + q00;
+            p01 += dt * p11 + q01;
+            p11 += q11;
+        }
+
+        const float s = p00 + r;
+        k0 = p00 / s;
+        k1 = p01 / s;
+
+        // P = (I - K H) P, H = [1 0]
+        p11 -= k1 * p01;
+        p01 -= k1 * p00;
+        p00 -= k0 * p00;
+    }
+
+    kf->k_alt_q16 = (int32_t)(k0 * 65536.0f + 0.5f);
+    kf->k_speed_q16 = (int32_t)(k1 * 65536.0f + 0.5f);
+}
+
+bool kf_init(struct kf_state *kf, const struct kf_params *params)
+{
+    if (params->imu_period_us == 0 || params->baro_decimation == 0 ||
+        params->accel_noise_mms2 == 0 || params->baro_noise_mm == 0 ||
+        params->align_samples == 0)
+    {
+        return false;
+    }
+
+    memset(kf, 0, sizeof(*kf));
+    kf->q[0] = KF_Q30_ONE;
+
+    kf->period_us = params->imu_period_us;
+
+    // 0.1 deg/s = pi / 1800 rad/s, halved for the quaternion derivative
+    kf->gyro_half_q46 = (int32_t)(3.14159265f / 1800.0f * 1e-6f / 2.0f * (1LL << 46));
+
+    kf->baro_decimation = params->baro_decimation;
+    kf->launch_accel_mg = params->launch_accel_mg;
+    kf->align_samples = params->align_samples;
+
+    solve_gains(kf, params);
+    return true;
+}
+
+// Baro reading to use, 0 if neither sensor has one
+static uint16_t baro_reading(const navigator_sensors_t *sample)
+{
+    if (sample->baro1 != 0 && sample->baro2 != 0)
+    {
+        return (uint16_t)(((uint32_t)sample->baro1 + sample->baro2) / 2);
+    }
+
+    return sample->baro1 != 0 ? sample->baro1 : sample->baro2;
+}
+
+/*
+ * Shortest rotation taking the measured "up" (the specific force at rest) to world z.
+ * Only runs on the pad, once per alignment, so float is fine here.
+ */
+static void align(struct kf_state *kf)
+{
+    const float n = (float)kf->align_samples;
+    const float ax = kf->accel_sum[0] / n;
+    const float ay = kf->accel_sum[1] / n;
+    const float az = kf->accel_sum[2] / n;
+    const float norm = __builtin_sqrtf(ax * ax + ay * ay + az * az);
+
+    float w = 1.0f + az / norm;
+    float x = ay / norm;
+    float y = -ax / norm;
+
+    if (w < 1e-6f)
+    {
+        // Upside down, any horizontal axis will do
+        w = 0.0f;
+        x = 1.0f;
+        y = 0.0f;
+    }
+
+    const float qn = __builtin_sqrtf(w * w + x * x + y * y);
+    kf->q[0] = (int32_t)(w / qn * KF_Q30_ONE);
+    kf->q[1] = (int32_t)(x / qn * KF_Q30_ONE);
+    kf->q[2] = (int32_t)(y / qn * KF_Q30_ONE);
+    kf->q[3] = 0;
+
+    const uint16_t baro = (uint16_t)(kf->baro_sum / kf->align_samples);
+    if (baro != 0)
+    {
+        kf->ground_altitude_mm = kf_baro_altitude_mm(baro);
+        kf->aligned = true;
+    }
+
+    kf->altitude_um = 0;
+    kf->speed_ums = 0;
+    kf->max_altitude_m = 0;
+}
+
+static void pad_alignment(struct kf_state *kf, const navigator_sensors_t *sample)
+{
+    const int64_t a2 = (int64_t)sample->accel_x * sample->accel_x +
+                       (int64_t)sample->accel_y * sample->accel_y +
+                       (int64_t)sample->accel_z * sample->accel_z;
+
+    if (kf->launch_accel_mg != 0 && a2 > (int64_t)kf->launch_accel_mg * kf->launch_accel_mg)
+    {
+        kf->launched = true;
+        return;
+    }
+
+    const bool still = a2 > (G_MG - STILL_MG) * (G_MG - STILL_MG) &&
+                       a2 < (G_MG + STILL_MG) * (G_MG + STILL_MG) &&
+                       abs(sample->gyro_x) < STILL_DDPS && abs(sample->gyro_y) < STILL_DDPS &&
+                       abs(sample->gyro_z) < STILL_DDPS;
+
+    if (!still)
+    {
+        kf->still_samples = 0;
+        return;
+    }
+
+    if (kf->still_samples == 0)
+    {
+        memset(kf->accel_sum, 0, sizeof(kf->accel_sum));
+        kf->baro_sum = 0;
+    }
+
+    kf->accel_sum[0] += sample->accel_x;
+    kf->accel_sum[1] += sample->accel_y;
+    kf->accel_sum[2] += sample->accel_z;
+    kf->baro_sum += baro_reading(sample);
+
+    if (++kf->still_samples == kf->align_samples)
+    {
+        align(kf);
+        kf->still_samples = 0;
+    }
+}
+
+static void integrate_gyro(struct kf_state *kf, const navigator_sensors_t *sample,
+                           const uint32_t dt_us)
+{
+    const int64_t half_q46 = (int64_t)kf->gyro_half_q46 * dt_us;
+    const int32_t hx = (int32_t)((sample->gyro_x * half_q46) >> 16);
+    const int32_t hy = (int32_t)((sample->gyro_y * half_q46) >> 16);
+    const int32_t hz = (int32_t)((sample->gyro_z * half_q46) >> 16);
+    int32_t *q = kf->q;
+
+    // q += q * (0, h), first order is plenty for the rotation per IMU sample
+    const int32_t dw = -mul_q30(q[1], hx) - mul_q30(q[2], hy) - mul_q30(q[3], hz);
+    const int32_t dx = mul_q30(q[0], hx) + mul_q30(q[2], hz) - mul_q30(q[3], hy);
+    const int32_t dy = mul_q30(q[0], hy) - mul_q30(q[1], hz) + mul_q30(q[3], hx);
+    const int32_t dz = mul_q30(q[0], hz) + mul_q30(q[1], hy) - mul_q30(q[2], hx);
+
+    q[0] += dw;
+    q[1] += dx;
+    q[2] += dy;
+    q[3] += dz;
+
+    // Renormalize with one Newton step of 1/sqrt around 1: q *= (3 - |q|^2) / 2
+    const int32_t n2 = mul_q30(q[0], q[0]) + mul_q30(q[1], q[1]) + mul_q30(q[2], q[2]) +
+                       mul_q30(q[3], q[3]);
+    const int32_t f = (int32_t)(((int64_t)3 * KF_Q30_ONE - n2) / 2);
+
+    for (int i = 0; i < 4; i++)
+    {
+        q[i] = mul_q30(q[i], f);
+    }
+}
+
+// Specific force along world z minus gravity, in mm/s^2
+static int32_t vertical_accel_mms2(const struct kf_state *kf, const navigator_sensors_t *sample)
+{
+    const int32_t *q = kf->q;
+
+    // Third row of the rotation matrix of q
+    const int32_t r0 = 2 * (mul_q30(q[1], q[3]) - mul_q30(q[0], q[2]));
+    const int32_t r1 = 2 * (mul_q30(q[2], q[3]) + mul_q30(q[0], q[1]));
+    const int32_t r2 = KF_Q30_ONE - 2 * (mul_q30(q[1], q[1]) + mul_q30(q[2], q[2]));
+
+    const int64_t up_mg = ((int64_t)r0 * sample->accel_x + (int64_t)r1 * sample->accel_y +
+                           (int64_t)r2 * sample->accel_z) >>
+                          30;
+
+    return (int32_t)((up_mg - G_MG) * 980665 / 100000);
+}
+
+void kf_update(struct kf_state *kf, const navigator_sensors_t *sample, uint32_t dt_us)
+{
+    if (dt_us == 0)
+    {
+        dt_us = kf->period_us;
+    }
+    dt_us = MIN(dt_us, KF_MAX_DT_US);
+
+    if (!kf->launched)
+    {
+        pad_alignment(kf, sample);
+    }
+
+    integrate_gyro(kf, sample, dt_us);
+    kf->accel_mms2 = vertical_accel_mms2(kf, sample);
+
+    // Predict: h += v dt + a dt^2 / 2, v += a dt
+    const int64_t dt_q32 = ((int64_t)dt_us * US_Q40) >> 8;
+    const int64_t half_dt2_q32 = (dt_q32 * dt_q32) >> 33;
+    const int64_t accel_ums2 = (int64_t)kf->accel_mms2 * 1000;
+    kf->altitude_um += (kf->speed_ums * dt_q32 + accel_ums2 * half_dt2_q32) >> 32;
+    kf->speed_ums += (accel_ums2 * dt_q32) >> 32;
+
+    // Correct with the barometric altitude
+    const uint16_t baro = baro_reading(sample);
+    if (++kf->since_baro >= kf->baro_decimation)
+    {
+        kf->since_baro = 0;
+    }
+
+    if (kf->since_baro == 0 && kf->aligned && baro != 0)
+    {
+        const int64_t measured_um =
+            (int64_t)(kf_baro_altitude_mm(baro) - kf->ground_altitude_mm) * 1000;
+        const int64_t residual_um = measured_um - kf->altitude_um;
+
+        kf->altitude_um += (residual_um * kf->k_alt_q16) >> 16;
+        kf->speed_ums += (residual_um * kf->k_speed_q16) >> 16;
+    }
+
+    kf->max_altitude_m = MAX(kf->max_altitude_m, (int32_t)(kf->altitude_um / 1000000));
+}
+
+void kf_output(const struct kf_state *kf, kalman_data_t *out)
+{
+    out->altitude = (int16_t)CLAMP(kf->altitude_um / 1000000, INT16_MIN, INT16_MAX);
+    out->max_altitude = (int16_t)CLAMP(kf->max_altitude_m, INT16_MIN, INT16_MAX);
+    out->vertical_speed = (int16_t)CLAMP(kf->speed_ums / 100000, INT16_MIN, INT16_MAX);
+    out->vertical_acceleration = (int16_t)CLAMP(kf->accel_mms2 / 100, INT16_MIN, INT16_MAX);
+
+    for (int i = 0; i < 4; i++)
+    {
+        out->quaternions[i] = (int16_t)(kf->q[i] >> 16);
+    }
+}
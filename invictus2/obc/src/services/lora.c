@@ -1,5 +1,9 @@
 #include "invictus2/drivers/sx128x.h"
 #include "packets.h"
+#include "chan_stats.h"
+#include "services/cmd_latency.h"
+#include "services/health.h"
+#include "services/supervisor.h"
 #include "services/lora.h"
 #include "invictus2/drivers/sx128x_context.h"
 
@@ -89,10 +93,23 @@ void lora_handle_incoming_packet()
     ring_buf_get_claim(&ctx->rx_rb, &raw_msg, sizeof(struct generic_packet_s));
 
     struct generic_packet_s *msg = (struct generic_packet_s *)raw_msg;
-    zbus_chan_pub(&chan_packets, (const void *)msg, K_NO_WAIT);
+    const uint32_t latency_id = cmd_latency_rx(msg->header.command_id);
+    chan_stats_pub(&chan_packets, (const void *)msg, K_NO_WAIT);
+    cmd_latency_stamp(latency_id, CMD_STAGE_PUBLISHED);
     ring_buf_get_finish(&ctx->rx_rb, sizeof(struct generic_packet_s));
 }
 
+static void lora_service_restart(void);
+
+// Set by a restart, the thread leaves its loop like on stop_signal
+static atomic_t restarting = ATOMIC_INIT(0);
+
+// The radio is only driven from the LoRa thread, it can be recreated from scratch
+static const struct supervisor_watch lora_watch = {
+    .deadline_ms = CONFIG_SUPERVISOR_LORA_DEADLINE_MSEC,
+    .restart = lora_service_restart,
+};
+
 void lora_thread_entry(void *p1, void *p2, void *p3)
 {
     ARG_UNUSED(p1);
@@ -112,9 +129,13 @@ void lora_thread_entry(void *p1, void *p2, void *p3)
     }
 
     LOG_INF("LoRa thread starting");
+    supervisor_watch_thread(HEALTH_LORA, &lora_watch);
+
     const uint32_t c_sleep_time_ms = 1000;
-    while (*ctx->stop_signal != 1)
+    while (*ctx->stop_signal != 1 && !atomic_get(&restarting))
     {
+        supervisor_heartbeat(HEALTH_LORA);
+
         // LOG_INF("LoRa thread");
 
         // handle lora reception
@@ -146,13 +167,40 @@ void lora_thread_entry(void *p1, void *p2, void *p3)
 
     // unregister callback
     sx128x_register_recv_callback(NULL);
+    supervisor_watch_thread(HEALTH_LORA, NULL);
     LOG_INF("LoRa thread exiting.");
 }
 
-#define LORA_THREAD_PRIO 5               // TODO: make KConfig
+#define LORA_THREAD_PRIO       5   // TODO: make KConfig
+#define LORA_RESTART_POLL_MSEC 100
 K_THREAD_STACK_DEFINE(lora_stack, 1024); // TODO: make KConfig
 static struct k_thread lora_thread;
 
+static void restart_work_handler(struct k_work *work)
+{
+    // Recreated only once the old thread is out of the driver
+    if (k_thread_join(&lora_thread, K_NO_WAIT) != 0)
+    {
+        LOG_WRN_ONCE("LoRa thread busy, restart pending until it stops");
+        k_work_reschedule(k_work_delayable_from_work(work), K_MSEC(LORA_RESTART_POLL_MSEC));
+        return;
+    }
+
+    atomic_set(&restarting, 0);
+    lora_service_start();
+}
+
+static K_WORK_DELAYABLE_DEFINE(restart_work, restart_work_handler);
+
+// From the supervisor. Aborting the thread could leave the radio and the SPI bus in the
+// middle of a transfer, it is asked to stop instead and recreated once it did.
+static void lora_service_restart(void)
+{
+    atomic_set(&restarting, 1);
+    k_wakeup(&lora_thread); // Out of its sleep between two transmissions
+    k_work_reschedule(&restart_work, K_NO_WAIT);
+}
+
 void lora_service_start(void)
 {
     const k_tid_t tid =
@@ -160,4 +208,5 @@ void lora_service_start(void)
                         lora_thread_entry, NULL, NULL, NULL, LORA_THREAD_PRIO, 0, K_NO_WAIT);
 
     k_thread_name_set(tid, "lora");
+    health_register_thread(HEALTH_LORA, tid);
 }
\ No newline at end of file
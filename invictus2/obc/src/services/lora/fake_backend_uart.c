@@ -1,5 +1,7 @@
 #include "services/fake_lora.h"
 #include "packets.h"
+#include "chan_stats.h"
+#include "services/cmd_latency.h"
 
 ZBUS_CHAN_DECLARE(chan_packets);
 LOG_MODULE_REGISTER(lora_backend_testing, LOG_LEVEL_DBG);
@@ -147,12 +149,14 @@ void fake_lora_backend()
             continue;
         }
 
-        int rc = zbus_chan_pub(&chan_packets, (const void *)&packet, K_NO_WAIT);
+        const uint32_t latency_id = cmd_latency_rx(packet.header.command_id);
+        int rc = chan_stats_pub(&chan_packets, (const void *)&packet, K_NO_WAIT);
         if (rc != 0)
         {
             LOG_ERR("Failed to publish packet to channel: %d", rc);
             continue;
         }
+        cmd_latency_stamp(latency_id, CMD_STAGE_PUBLISHED);
 
         LOG_INF("Published packet with cmd ID %d to packet channel", packet.header.command_id);
     }
@@ -2,47 +2,75 @@
 #include "services/modbus/hydra.h"
 #include "services/modbus/lift.h"
 
+#include "chan_stats.h"
 #include "data_models.h"
+#include "packets.h"
+#include "services/cmd_latency.h"
+#include "services/health.h"
+#include "services/supervisor.h"
+
+#include "invictus2/timesync.h"
+#include "invictus2/trace.h"
+
+#include <string.h>
 
 #include "zephyr/kernel.h"
 #include "zephyr/logging/log.h"
 #include "zephyr/modbus/modbus.h"
+#include "zephyr/spinlock.h"
 #include "zephyr/zbus/zbus.h"
 
 #define MODBUS_NODE DT_ALIAS(modbus_rtu)
 
 #if DT_NODE_HAS_COMPAT(DT_PARENT(MODBUS_NODE), zephyr_cdc_acm_uart)
+#include "zephyr/drivers/uart.h"
 #include "zephyr/usb/usb_device.h"
+
+#define MODBUS_OVER_CDC_ACM 1
 #endif
 
 LOG_MODULE_REGISTER(modbus_service, LOG_LEVEL_DBG);
 
 static void lift_read_ir_work_handler(struct k_work *work);
 static void hydra_read_ir_work_handler(struct k_work *work);
+static void time_sync_work_handler(struct k_work *work);
+static void master_wait_work_handler(struct k_work *work);
 
 static void actuator_work_handler(struct k_work *work);
 static void command_work_handler(struct k_work *work);
 static void rocket_state_work_handler(struct k_work *work);
 
+static bool write_fill_control(bool enable, uint16_t setpoint);
+
 static K_WORK_DEFINE(actuator_work, actuator_work_handler);
 static K_WORK_DEFINE(command_work, command_work_handler);
 static K_WORK_DEFINE(rocket_state_work, rocket_state_work_handler);
 
 static K_WORK_DELAYABLE_DEFINE(lift_sample_work, lift_read_ir_work_handler);
 static K_WORK_DELAYABLE_DEFINE(hydra_sample_work, hydra_read_ir_work_handler);
+static K_WORK_DELAYABLE_DEFINE(time_sync_work, time_sync_work_handler);
+static K_WORK_DELAYABLE_DEFINE(master_wait_work, master_wait_work_handler);
 
 K_THREAD_STACK_DEFINE(modbus_work_q_stack, CONFIG_MODBUS_WORK_Q_STACK);
 static struct k_work_q modbus_work_q;
 
+// A wedged transaction leaves the valves out of control. In flight mode the board is not
+// reset for it, the sequence goes on without the filling station and HYDRA samples.
+static const struct supervisor_watch modbus_watch = {
+    .deadline_ms = CONFIG_SUPERVISOR_MODBUS_DEADLINE_MSEC,
+    .force_safe = true,
+};
+
 // Published channels
 ZBUS_CHAN_DECLARE(chan_thermo_sensors, chan_pressure_sensors, chan_weight_sensors);
+ZBUS_CHAN_DECLARE(chan_modbus_health);
 
 // Subscribed channels
 ZBUS_CHAN_DECLARE(chan_actuators, chan_packets, chan_rocket_state);
 
 static void modbus_listener_cb(const struct zbus_channel *chan);
 
-ZBUS_LISTENER_DEFINE(modbus_listener, modbus_listener_cb);
+CHAN_STATS_LISTENER_DEFINE(modbus_listener, modbus_listener_cb);
 ZBUS_CHAN_ADD_OBS(chan_actuators, modbus_listener, CONFIG_MODBUS_ZBUS_LISTENER_PRIO);
 ZBUS_CHAN_ADD_OBS(chan_packets, modbus_listener, CONFIG_MODBUS_ZBUS_LISTENER_PRIO);
 ZBUS_CHAN_ADD_OBS(chan_rocket_state, modbus_listener, CONFIG_MODBUS_ZBUS_LISTENER_PRIO);
@@ -54,18 +82,75 @@ static struct lift_boards lifts = {0};
 static int client_iface;
 static atomic_t fs_disabled = ATOMIC_INIT(false);
 
+// Last fill loop written to the filling station hydra, only touched by the work queue
+static struct
+{
+    bool enable;
+    uint16_t setpoint;
+} fill_control;
+static main_state_t main_state = _MAIN_STATE_START;
+
+// Latest actuator state published by the state machine, with the latency ID of the command
+// that led to it. Only the latest state matters, the work writes it to the boards.
+static struct
+{
+    actuators_bitmap_t actuators;
+    uint32_t latency_id;
+} actuator_request;
+static struct k_spinlock actuator_lock;
+static bool actuators_failed; // A board missed the last write, only touched by the work queue
+
+// A manual bus command as received, with its latency ID (see cmd_latency.h). Copied by the
+// listener, so back to back commands are each executed and the work queue never waits on
+// chan_packets.
+struct modbus_command
+{
+    struct manual_exec_s exec;
+    uint32_t latency_id;
+};
+
+K_MSGQ_DEFINE(command_q, sizeof(struct modbus_command), CONFIG_MODBUS_COMMAND_QUEUE_DEPTH, 4);
+
 // Function Implementations
 
 static void modbus_listener_cb(const struct zbus_channel *chan)
 {
     if (chan == &chan_actuators)
     {
+        // Runs in the publisher's context, the message can be read without locking
+        const actuators_bitmap_t *const actuators = zbus_chan_const_msg(chan);
+
+        k_spinlock_key_t key = k_spin_lock(&actuator_lock);
+        actuator_request.actuators = *actuators;
+        actuator_request.latency_id = cmd_latency_last(CMD_STAGE_SM_RUN);
+        k_spin_unlock(&actuator_lock, key);
+
         k_work_submit_to_queue(&modbus_work_q, &actuator_work);
         return;
     }
 
     if (chan == &chan_packets)
     {
+        // Runs in the publisher's context, the message can be read without locking
+        const struct cmd_manual_exec_s *const packet = zbus_chan_const_msg(chan);
+
+        // Everything else is handled by the state machine
+        if ((command_t)packet->hdr.command_id != CMD_MANUAL_EXEC)
+        {
+            return;
+        }
+
+        const struct modbus_command command = {
+            .exec = packet->payload,
+            .latency_id = cmd_latency_last(CMD_STAGE_RX),
+        };
+
+        if (k_msgq_put(&command_q, &command, K_NO_WAIT) != 0)
+        {
+            LOG_ERR("Command queue full, manual command %u dropped",
+                    command.exec.manual_cmd_id);
+            return;
+        }
         k_work_submit_to_queue(&modbus_work_q, &command_work);
         return;
     }
@@ -93,25 +178,13 @@ const static struct modbus_iface_param client_param = {
 
 bool modbus_service_setup(void)
 {
-#if DT_NODE_HAS_COMPAT(DT_PARENT(MODBUS_NODE), zephyr_cdc_acm_uart)
-    LOG_INF("Waiting for Modbus RTU Master connection on %s...",
-            DEVICE_DT_NAME(DT_PARENT(MODBUS_NODE)));
-
+#ifdef MODBUS_OVER_CDC_ACM
+    // The master connection is waited for by the work queue, see master_wait_work_handler
     const struct device *const dev = DEVICE_DT_GET(DT_PARENT(MODBUS_NODE));
-    uint32_t dtr = 0;
-
     if (!device_is_ready(dev) || usb_enable(NULL))
     {
         return false;
     }
-
-    while (!dtr)
-    {
-        uart_line_ctrl_get(dev, UART_LINE_CTRL_DTR, &dtr);
-        k_sleep(K_MSEC(100));
-    }
-
-    LOG_INF("Master connected on %s", dev->name);
 #endif
 
     const char iface_name[] = {DEVICE_DT_NAME(MODBUS_NODE)};
@@ -126,19 +199,62 @@ bool modbus_service_setup(void)
     return modbus_init_client(client_iface, client_param) == 0;
 }
 
+static void slave_health_to_zbus_rep(const struct modbus_slave_metadata *const meta,
+                                     modbus_slave_health_t *const rep)
+{
+    rep->slave_id = meta->slave_id;
+    rep->is_connected = meta->is_connected;
+    rep->consecutive_errors = meta->health.consecutive_errors;
+    rep->total_reads = meta->health.total_reads;
+    rep->total_errors = meta->health.total_errors;
+    rep->avg_latency_us = meta->health.avg_latency_us;
+    rep->max_latency_us = meta->health.max_latency_us;
+    rep->backoff_ms = meta->health.backoff_ms;
+}
+
+static void publish_bus_health(void)
+{
+    modbus_health_t health = {0};
+
+    // clang-format off
+    slave_health_to_zbus_rep(&hydras.uf.meta,    &health.slaves[MODBUS_SLAVE_UF_HYDRA]);
+    slave_health_to_zbus_rep(&hydras.lf.meta,    &health.slaves[MODBUS_SLAVE_LF_HYDRA]);
+    slave_health_to_zbus_rep(&hydras.fs.meta,    &health.slaves[MODBUS_SLAVE_FS_HYDRA]);
+    slave_health_to_zbus_rep(&lifts.rocket.meta, &health.slaves[MODBUS_SLAVE_ROCKET_LIFT]);
+    slave_health_to_zbus_rep(&lifts.fs.meta,     &health.slaves[MODBUS_SLAVE_FS_LIFT]);
+    // clang-format on
+
+    chan_stats_pub(&chan_modbus_health, (const void *)&health, K_MSEC(100));
+}
+
 static void hydra_read_ir_work_handler(struct k_work *work)
 {
     k_work_schedule_for_queue(&modbus_work_q, &hydra_sample_work,
                               K_MSEC(CONFIG_MODBUS_HYDRA_SAMPLE_INTERVAL_MSEC));
 
-    thermocouples_t temperatures = {0};
-    pressures_t pressures = {0};
+    TRACE_BEGIN(TRACE_MODBUS_WORK);
+    thermo_sample_t temperatures = {0};
+    pressure_sample_t pressures = {0};
     hydra_boards_read_irs(client_iface, &hydras, (bool)atomic_get(&fs_disabled));
     hydra_boards_irs_to_zbus_rep(&hydras, &temperatures, &pressures,
                                  (bool)atomic_get(&fs_disabled));
 
-    zbus_chan_pub(&chan_thermo_sensors, (const void *)&temperatures, K_MSEC(100));
-    zbus_chan_pub(&chan_pressure_sensors, (const void *)&pressures, K_MSEC(100));
+    chan_stats_pub(&chan_thermo_sensors, (const void *)&temperatures, K_MSEC(100));
+    chan_stats_pub(&chan_pressure_sensors, (const void *)&pressures, K_MSEC(100));
+    publish_bus_health();
+
+    // The filling station hydra closes the fill valve unless its lease is renewed
+    if (fill_control.enable && !(bool)atomic_get(&fs_disabled))
+    {
+        write_fill_control(true, fill_control.setpoint);
+    }
+
+    // Valves a board missed are written again at the sample rate, until it answers
+    if (actuators_failed)
+    {
+        k_work_submit_to_queue(&modbus_work_q, &actuator_work);
+    }
+    TRACE_END(TRACE_MODBUS_WORK);
 }
 
 static void lift_read_ir_work_handler(struct k_work *work)
@@ -146,26 +262,203 @@ static void lift_read_ir_work_handler(struct k_work *work)
     k_work_schedule_for_queue(&modbus_work_q, &lift_sample_work,
                               K_MSEC(CONFIG_MODBUS_LIFT_SAMPLE_INTERVAL_MSEC));
 
-    loadcell_weights_t weights = {0};
+    // NOTE: The LIFT boards do not serve their sample time, stamp the readings with the
+    // time they were requested at instead.
+    TRACE_BEGIN(TRACE_MODBUS_WORK);
+    weight_sample_t weights = {.timestamp_us = timesync_uptime_us()};
     lift_boards_read_irs(client_iface, &lifts, (bool)atomic_get(&fs_disabled));
-    lift_boards_irs_to_zbus_rep(&lifts, &weights, (bool)atomic_get(&fs_disabled));
+    lift_boards_irs_to_zbus_rep(&lifts, &weights.weights, (bool)atomic_get(&fs_disabled));
 
-    zbus_chan_pub(&chan_weight_sensors, (const void *)&weights, K_MSEC(100));
+    chan_stats_pub(&chan_weight_sensors, (const void *)&weights, K_MSEC(100));
+    publish_bus_health();
+    TRACE_END(TRACE_MODBUS_WORK);
+}
+
+static void time_sync_work_handler(struct k_work *work)
+{
+    k_work_schedule_for_queue(&modbus_work_q, &time_sync_work,
+                              K_MSEC(CONFIG_TIMESYNC_BROADCAST_INTERVAL_MSEC));
+
+    int ret = modbus_broadcast_time(client_iface);
+    if (ret < 0)
+    {
+        LOG_WRN("Time sync broadcast failed: %d", ret);
+    }
 }
 
 static void actuator_work_handler(struct k_work *work)
 {
-    k_oops(); // FIXME: implement function
+    ARG_UNUSED(work);
+
+    // A state published while the last one was written is taken by the next run, only
+    // its command is stamped
+    k_spinlock_key_t key = k_spin_lock(&actuator_lock);
+    const actuators_bitmap_t actuators = actuator_request.actuators;
+    const uint32_t latency_id = actuator_request.latency_id;
+    actuator_request.latency_id = CMD_LATENCY_NONE;
+    k_spin_unlock(&actuator_lock, key);
+
+    TRACE_BEGIN(TRACE_MODBUS_WORK);
+    const int ret = hydra_boards_write_valves(client_iface, &hydras, actuators,
+                                              (bool)atomic_get(&fs_disabled));
+    TRACE_END(TRACE_MODBUS_WORK);
+
+    actuators_failed = ret < 0;
+    if (ret == 0)
+    {
+        cmd_latency_stamp(latency_id, CMD_STAGE_MODBUS_WRITE);
+    }
+}
+
+static void handle_valve_ms_command(const struct manual_exec_s *const exec,
+                                    const uint32_t latency_id)
+{
+    // NOTE: params is not aligned for the uint32_t in manual_valve_ms_s, copy it out
+    struct manual_valve_ms_s params;
+    memcpy(&params, exec->params, sizeof(params));
+
+    const valve_t valve = (valve_t)params.valve_id;
+    const bool fs_valve = valve >= VALVE_N2O_FILL && valve <= VALVE_N2_QUICK_DC;
+
+    if (fs_valve && (bool)atomic_get(&fs_disabled))
+    {
+        LOG_WRN("Filling Station is disconnected, ignoring pulse on valve %d", valve);
+        return;
+    }
+
+    if (params.duration_ms > UINT16_MAX)
+    {
+        LOG_WRN("Pulse of %u ms on valve %d clamped to %u ms", params.duration_ms, valve,
+                UINT16_MAX);
+    }
+
+    LOG_INF("Pulsing valve %d for %u ms", valve, params.duration_ms);
+    const int ret = hydra_boards_valve_pulse(client_iface, &hydras, valve,
+                                             (uint16_t)MIN(params.duration_ms, UINT16_MAX));
+    if (ret == 0)
+    {
+        cmd_latency_stamp(latency_id, CMD_STAGE_MODBUS_WRITE);
+    }
+}
+
+// Kept as it was on failure, a stop is retried on the next rocket state
+static bool write_fill_control(const bool enable, const uint16_t setpoint)
+{
+    if (hydra_boards_fill_control(client_iface, &hydras, enable, setpoint) < 0)
+    {
+        return false;
+    }
+
+    fill_control.enable = enable;
+    fill_control.setpoint = setpoint;
+    return true;
+}
+
+static void handle_fill_control_command(const struct manual_exec_s *const exec,
+                                        const uint32_t latency_id)
+{
+    // NOTE: params is not aligned for the uint16_t in manual_fill_control_s, copy it out
+    struct manual_fill_control_s params;
+    memcpy(&params, exec->params, sizeof(params));
+
+    if ((bool)atomic_get(&fs_disabled))
+    {
+        LOG_WRN("Filling Station is disconnected, ignoring fill control");
+        return;
+    }
+
+    // Outside of FILL the loop is kept closed, see rocket_state_work_handler
+    if (params.enable && main_state != FILL)
+    {
+        LOG_WRN("Fill control only runs while filling, in state %d", main_state);
+        return;
+    }
+
+    LOG_INF("Fill control %s, setpoint %u dbar", params.enable ? "on" : "off",
+            params.setpoint);
+    if (write_fill_control(params.enable, params.setpoint))
+    {
+        cmd_latency_stamp(latency_id, CMD_STAGE_MODBUS_WRITE);
+    }
 }
 
 static void command_work_handler(struct k_work *work)
 {
-    k_oops(); // FIXME: implement function
+    ARG_UNUSED(work);
+
+    // Submitted once per command, but a single run takes all the queued ones
+    struct modbus_command command;
+    while (k_msgq_get(&command_q, &command, K_NO_WAIT) == 0)
+    {
+        switch ((enum manual_cmd_e)command.exec.manual_cmd_id)
+        {
+        case MANUAL_CMD_VALVE_MS:
+            handle_valve_ms_command(&command.exec, command.latency_id);
+            break;
+
+        case MANUAL_CMD_FILL_CONTROL:
+            handle_fill_control_command(&command.exec, command.latency_id);
+            break;
+
+        default:
+            break; // Not a bus command
+        }
+    }
 }
 
 static void rocket_state_work_handler(struct k_work *work)
 {
-    k_oops(); // FIXME: implement function
+    state_data_t state;
+    int ret = chan_stats_read(&chan_rocket_state, &state, K_MSEC(100));
+    if (ret < 0)
+    {
+        LOG_ERR("Failed to read rocket state channel: %d", ret);
+        return;
+    }
+
+    main_state = state.main_state;
+
+    // Leaving FILL, by the end of a program or an abort, closes the fill valve
+    if (main_state != FILL && fill_control.enable)
+    {
+        LOG_INF("Left FILL, stopping fill control");
+        write_fill_control(false, fill_control.setpoint);
+    }
+}
+
+static void start_sampling(void)
+{
+    // Without blocking the boot on the master, it may connect at any time
+#ifdef MODBUS_OVER_CDC_ACM
+    LOG_INF("Waiting for Modbus RTU Master connection on %s...",
+            DEVICE_DT_NAME(DT_PARENT(MODBUS_NODE)));
+#endif
+    k_work_schedule_for_queue(&modbus_work_q, &master_wait_work, K_NO_WAIT);
+}
+
+static void master_wait_work_handler(struct k_work *work)
+{
+#ifdef MODBUS_OVER_CDC_ACM
+    const struct device *const dev = DEVICE_DT_GET(DT_PARENT(MODBUS_NODE));
+    uint32_t dtr = 0;
+
+    uart_line_ctrl_get(dev, UART_LINE_CTRL_DTR, &dtr);
+    if (!dtr)
+    {
+        k_work_schedule_for_queue(&modbus_work_q, k_work_delayable_from_work(work),
+                                  K_MSEC(100));
+        return;
+    }
+
+    LOG_INF("Master connected on %s", dev->name);
+#else
+    ARG_UNUSED(work);
+#endif
+
+    // Sync the slaves before their first samples are read
+    k_work_schedule_for_queue(&modbus_work_q, &time_sync_work, K_NO_WAIT);
+    k_work_schedule_for_queue(&modbus_work_q, &hydra_sample_work, K_MSEC(100));
+    k_work_schedule_for_queue(&modbus_work_q, &lift_sample_work, K_MSEC(100));
 }
 
 void modbus_service_start(void)
@@ -176,7 +469,9 @@ void modbus_service_start(void)
     k_work_queue_start(&modbus_work_q, modbus_work_q_stack,
                        K_THREAD_STACK_SIZEOF(modbus_work_q_stack), CONFIG_MODBUS_WORK_Q_PRIO,
                        NULL);
+    k_thread_name_set(&modbus_work_q.thread, "modbus");
+    health_register_work_q(HEALTH_MODBUS_WORK_Q, &modbus_work_q);
+    supervisor_watch_work_q(HEALTH_MODBUS_WORK_Q, &modbus_work_q, &modbus_watch);
 
-    k_work_schedule_for_queue(&modbus_work_q, &hydra_sample_work, K_MSEC(100));
-    k_work_schedule_for_queue(&modbus_work_q, &lift_sample_work, K_MSEC(100));
+    start_sampling();
 }
@@ -1,27 +1,156 @@
 #include "services/modbus/common.h"
 
+#include "invictus2/timesync.h"
+#include "invictus2/trace.h"
+
+#include "zephyr/kernel.h"
 #include "zephyr/logging/log.h"
+#include "zephyr/modbus/modbus.h"
+#include "zephyr/sys/util.h"
 
 LOG_MODULE_REGISTER(obc_modbus_common, LOG_LEVEL_DBG);
 
-inline void modbus_slave_check_connection(const int read_result,
-                                          struct modbus_slave_metadata *const meta,
-                                          const char *const label)
+#define MODBUS_BROADCAST_ID 0
+
+static void modbus_slave_update_latency(struct modbus_slave_health *const health,
+                                        const uint32_t latency_us)
+{
+    health->last_latency_us = latency_us;
+    health->max_latency_us = MAX(health->max_latency_us, latency_us);
+
+    if (health->avg_latency_us == 0) {
+        health->avg_latency_us = latency_us;
+    } else {
+        // EMA with alpha = 1/8, cheap enough to run on every transaction
+        health->avg_latency_us =
+            health->avg_latency_us - (health->avg_latency_us >> 3) + (latency_us >> 3);
+    }
+}
+
+static void modbus_slave_schedule_probe(struct modbus_slave_health *const health)
+{
+    if (health->backoff_ms == 0) {
+        health->backoff_ms = CONFIG_MODBUS_HEALTH_BACKOFF_MIN_MSEC;
+    } else {
+        health->backoff_ms = MIN(health->backoff_ms * 2, CONFIG_MODBUS_HEALTH_BACKOFF_MAX_MSEC);
+    }
+
+    health->next_poll_ms = k_uptime_get() + health->backoff_ms;
+    health->skipped_polls = 0;
+}
+
+void modbus_slave_check_connection(const int read_result, const uint32_t latency_us,
+                                   struct modbus_slave_metadata *const meta,
+                                   const char *const label)
 {
     if (!meta || !label) {
         LOG_ERR("Invalid parameters for connection check.");
         return;
     }
 
-    if (read_result < 0 && !meta->is_connected) {
-        return; // Already disconnected, no need to log again
+    struct modbus_slave_health *const health = &meta->health;
+
+    health->total_reads++;
+    modbus_slave_update_latency(health, latency_us);
+
+    if (read_result >= 0) {
+        if (!meta->was_connected) {
+            LOG_INF("Connected to [%s].", label);
+            meta->was_connected = true;
+            meta->is_connected = true;
+        } else if (!meta->is_connected) {
+            LOG_INF("Reconnected to [%s] after %u failed reads.", label,
+                    health->consecutive_errors);
+            meta->is_connected = true;
+        }
+
+        health->consecutive_errors = 0;
+        health->backoff_ms = 0;
+        health->next_poll_ms = 0;
+        return;
     }
 
-    if (read_result < 0 && meta->is_connected) {
+    health->total_errors++;
+    health->consecutive_errors++;
+
+    if (!meta->is_connected) {
+        // Failed probe, no need to log again
+        modbus_slave_schedule_probe(health);
+        return;
+    }
+
+    if (health->consecutive_errors >= CONFIG_MODBUS_HEALTH_FAIL_THRESHOLD) {
         LOG_ERR("Failed to read [%s]: %d. Flagging disconnect.", label, read_result);
         meta->is_connected = false;
-    } else if (read_result >= 0 && !meta->is_connected) {
-        LOG_INF("Reconnected to [%s].", label);
-        meta->is_connected = true;
+        modbus_slave_schedule_probe(health);
+    } else {
+        LOG_WRN("Failed to read [%s]: %d (%u/%u).", label, read_result,
+                health->consecutive_errors, CONFIG_MODBUS_HEALTH_FAIL_THRESHOLD);
+    }
+}
+
+// Read the input registers, accounting the transaction in the slave health
+static int read_irs_timed(const int client_iface, struct modbus_slave_metadata *const meta,
+                          uint16_t *const regs, const uint16_t count, const char *const label)
+{
+    TRACE_BEGIN(TRACE_MODBUS_XFER);
+    const uint32_t start = k_cycle_get_32();
+    const int rc = modbus_read_input_regs(client_iface, meta->slave_id, meta->ir_start, regs,
+                                          count);
+    const uint32_t latency_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+    TRACE_END(TRACE_MODBUS_XFER);
+
+    modbus_slave_check_connection(rc, latency_us, meta, label);
+    return rc;
+}
+
+int modbus_slave_read_irs(const int client_iface, struct modbus_slave_metadata *const meta,
+                          uint16_t *const regs, const uint16_t count, const char *const label)
+{
+    if (!meta || !regs || count == 0) {
+        return -EINVAL;
+    }
+
+    struct modbus_slave_health *const health = &meta->health;
+    const bool probing = !meta->is_connected;
+
+    if (probing && k_uptime_get() < health->next_poll_ms) {
+        health->skipped_polls++;
+        return -EAGAIN;
+    }
+
+    if (!probing) {
+        return read_irs_timed(client_iface, meta, regs, count, label);
     }
+
+    // A disconnected slave costs a full rx_timeout per read, so only ask for one register
+    // until it answers again. Into a scratch register, regs keeps the last full block.
+    uint16_t probe;
+    int rc = read_irs_timed(client_iface, meta, &probe, 1, label);
+
+    if (rc < 0) {
+        return rc;
+    }
+
+    if (count == 1) {
+        regs[0] = probe;
+        return rc;
+    }
+
+    // Probe succeeded, fetch the whole block so callers never see partially stale data
+    return read_irs_timed(client_iface, meta, regs, count, label);
+}
+
+int modbus_broadcast_time(const int client_iface)
+{
+    uint16_t regs[TIMESYNC_MODBUS_HR_COUNT];
+
+    // Stamped as late as possible, the slaves account for the frame time from here on
+    timesync_to_regs(timesync_uptime_us(), regs);
+
+    TRACE_BEGIN(TRACE_MODBUS_XFER);
+    const int rc = modbus_write_holding_regs(client_iface, MODBUS_BROADCAST_ID,
+                                             TIMESYNC_MODBUS_HR_ADDR, regs, ARRAY_SIZE(regs));
+    TRACE_END(TRACE_MODBUS_XFER);
+    return rc == -ETIMEDOUT ? 0 : rc;
 }
@@ -1,6 +1,10 @@
 #include "services/modbus/hydra.h"
 #include "services/modbus/common.h"
 
+#include "invictus2/hydra_modbus.h"
+#include "invictus2/timesync.h"
+#include "invictus2/trace.h"
+
 #include "zephyr/kernel.h"
 #include "zephyr/modbus/modbus.h"
 #include "zephyr/logging/log.h"
@@ -22,6 +26,11 @@ inline void hydra_boards_init(struct hydra_boards *const hb)
                      (CONFIG_MODBUS_HYDRA_LF_SLAVE_ID != CONFIG_MODBUS_HYDRA_FS_SLAVE_ID),
                  "all hydra boards must have different, non-zero, slave IDs.");
 
+    // The board unions mirror the register map served by the HYDRA firmware
+    BUILD_ASSERT(ARRAY_SIZE(hb->uf.sensors.raw) == HYDRA_UF_IR_COUNT + HYDRA_IR_TIME_COUNT);
+    BUILD_ASSERT(ARRAY_SIZE(hb->lf.sensors.raw) == HYDRA_LF_IR_COUNT + HYDRA_IR_TIME_COUNT);
+    BUILD_ASSERT(ARRAY_SIZE(hb->fs.sensors.raw) == HYDRA_FS_IR_COUNT + HYDRA_IR_TIME_COUNT);
+
     if (!hb) {
         LOG_ERR("Hydras boards structure pointer is NULL.");
         return;
@@ -48,39 +57,172 @@ void hydra_boards_read_irs(const int client_iface, struct hydra_boards *const hb
     }
 
     // Read upper feed hydra sensors
-    int uf_rc = modbus_read_input_regs(
-        client_iface, hb->uf.meta.slave_id, hb->uf.meta.ir_start,
-        (uint16_t *const)&hb->uf.sensors.raw, ARRAY_SIZE(hb->uf.sensors.raw));
+    modbus_slave_read_irs(client_iface, &hb->uf.meta, (uint16_t *const)&hb->uf.sensors.raw,
+                          ARRAY_SIZE(hb->uf.sensors.raw), "UF hydra sensors");
 
-    int lf_rc = modbus_read_input_regs(
-        client_iface, hb->lf.meta.slave_id, hb->lf.meta.ir_start,
-        (uint16_t *const)&hb->lf.sensors.raw, ARRAY_SIZE(hb->lf.sensors.raw));
-
-    modbus_slave_check_connection(uf_rc, &hb->uf.meta, "UF hydra sensors");
-    modbus_slave_check_connection(lf_rc, &hb->lf.meta, "LF hydra sensors");
+    modbus_slave_read_irs(client_iface, &hb->lf.meta, (uint16_t *const)&hb->lf.sensors.raw,
+                          ARRAY_SIZE(hb->lf.sensors.raw), "LF hydra sensors");
 
     if (fs_disabled) {
         LOG_WRN_ONCE("Filling Station is disconnected, skipping read.");
         return;
     }
 
-    int fs_rc = modbus_read_input_regs(
-        client_iface, hb->fs.meta.slave_id, hb->fs.meta.ir_start,
-        (uint16_t *const)&hb->fs.sensors.raw, ARRAY_SIZE(hb->fs.sensors.raw));
+    modbus_slave_read_irs(client_iface, &hb->fs.meta, (uint16_t *const)&hb->fs.sensors.raw,
+                          ARRAY_SIZE(hb->fs.sensors.raw), "FS hydra sensors");
+}
+
+int hydra_boards_valve_pulse(const int client_iface, const struct hydra_boards *const hb,
+                             const valve_t valve, const uint16_t duration_ms)
+{
+    if (!hb || client_iface < 0) {
+        LOG_ERR("Invalid parameters for hydra valve pulse.");
+        return -EINVAL;
+    }
+
+    const struct modbus_slave_metadata *meta;
+    uint16_t coil;
+
+    switch (valve) {
+    // clang-format off
+    case VALVE_PRESSURIZING: meta = &hb->uf.meta; coil = HYDRA_UF_COIL_PRESSURIZING_VALVE; break;
+    case VALVE_VENT:         meta = &hb->uf.meta; coil = HYDRA_UF_COIL_VENTING_VALVE;      break;
+    case VALVE_ABORT:        meta = &hb->lf.meta; coil = HYDRA_LF_COIL_ABORT_VALVE;        break;
+    case VALVE_MAIN:         meta = &hb->lf.meta; coil = HYDRA_LF_COIL_MAIN_VALVE;         break;
+    case VALVE_N2O_FILL:     meta = &hb->fs.meta; coil = HYDRA_FS_COIL_N2O_FILL_VALVE;     break;
+    case VALVE_N2O_PURGE:    meta = &hb->fs.meta; coil = HYDRA_FS_COIL_N2O_PURGE_VALVE;    break;
+    case VALVE_N2_FILL:      meta = &hb->fs.meta; coil = HYDRA_FS_COIL_N2_FILL_VALVE;      break;
+    case VALVE_N2_PURGE:     meta = &hb->fs.meta; coil = HYDRA_FS_COIL_N2_PURGE_VALVE;     break;
+    case VALVE_N2O_QUICK_DC: meta = &hb->fs.meta; coil = HYDRA_FS_COIL_N2O_QUICK_DC;       break;
+    case VALVE_N2_QUICK_DC:  meta = &hb->fs.meta; coil = HYDRA_FS_COIL_N2_QUICK_DC;        break;
+    // clang-format on
+    default:
+        LOG_ERR("Valve %d is not driven by a hydra.", valve);
+        return -EINVAL;
+    }
+
+    TRACE_BEGIN(TRACE_MODBUS_XFER);
+    int rc = modbus_write_holding_reg(client_iface, meta->slave_id,
+                                      HYDRA_HR_PULSE_ADDR_START + coil, duration_ms);
+    TRACE_END(TRACE_MODBUS_XFER);
+    if (rc < 0) {
+        LOG_ERR("Failed to pulse valve %d on slave %u: %d", valve, meta->slave_id, rc);
+    }
+
+    return rc;
+}
+
+// The solenoid unions hold the coils of a board in address order, LSB first, as sent
+static int write_solenoids(const int client_iface, const struct modbus_slave_metadata *meta,
+                           uint8_t *const solenoids, bool *const written, uint8_t target,
+                           const uint16_t coil_count)
+{
+    if (*written && *solenoids == target) {
+        return 0;
+    }
+
+    TRACE_BEGIN(TRACE_MODBUS_XFER);
+    int rc = modbus_write_coils(client_iface, meta->slave_id, HYDRA_COIL_ADDR_START, &target,
+                                coil_count);
+    TRACE_END(TRACE_MODBUS_XFER);
+
+    *solenoids = target;
+    *written = rc == 0;
+    if (rc < 0) {
+        LOG_ERR("Failed to write the valves of slave %u: %d", meta->slave_id, rc);
+    }
+
+    return rc;
+}
+
+int hydra_boards_write_valves(const int client_iface, struct hydra_boards *const hb,
+                              const actuators_bitmap_t actuators, const bool fs_disabled)
+{
+    if (!hb || client_iface < 0) {
+        LOG_ERR("Invalid parameters for hydra valve write.");
+        return -EINVAL;
+    }
+
+    const union uf_solenoids uf = {
+        .pressurizing_valve = actuators.v_pressurizing,
+        .venting_valve = actuators.v_vent,
+    };
+    const union lf_solenoids lf = {
+        .abort_valve = actuators.v_abort,
+        .main_valve = actuators.v_main,
+    };
+
+    // Every board is attempted, one that does not answer does not hold the others back
+    int rc = write_solenoids(client_iface, &hb->uf.meta, &hb->uf.solenoids.raw,
+                             &hb->uf.solenoids_written, uf.raw, HYDRA_UF_COIL_COUNT);
+
+    int ret = write_solenoids(client_iface, &hb->lf.meta, &hb->lf.solenoids.raw,
+                              &hb->lf.solenoids_written, lf.raw, HYDRA_LF_COIL_COUNT);
+    rc = rc < 0 ? rc : ret;
+
+    if (fs_disabled) {
+        return rc;
+    }
+
+    const union fs_solenoids fs = {
+        .n2o_fill_valve = actuators.v_n2o_fill,
+        .n2_fill_valve = actuators.v_n2_fill,
+        .n2o_purge_valve = actuators.v_n2o_purge,
+        .n2_purge_valve = actuators.v_n2_purge,
+        .n2o_quick_dc = actuators.v_n2o_quick_dc,
+        .n2_quick_dc = actuators.v_n2_quick_dc,
+    };
 
-    modbus_slave_check_connection(fs_rc, &hb->fs.meta, "FS hydra sensors");
+    ret = write_solenoids(client_iface, &hb->fs.meta, &hb->fs.solenoids.raw,
+                          &hb->fs.solenoids_written, fs.raw, HYDRA_FS_COIL_COUNT);
+    return rc < 0 ? rc : ret;
+}
+
+int hydra_boards_fill_control(const int client_iface, const struct hydra_boards *const hb,
+                              const bool enable, const uint16_t setpoint)
+{
+    if (!hb || client_iface < 0) {
+        LOG_ERR("Invalid parameters for hydra fill control.");
+        return -EINVAL;
+    }
+
+    // The server stores the registers in address order, the setpoint lands before the flag
+    BUILD_ASSERT(HYDRA_CONTROL_HR_SETPOINT == 0 && HYDRA_CONTROL_HR_ENABLE == 1);
+    uint16_t regs[] = {
+        [HYDRA_CONTROL_HR_SETPOINT] = setpoint,
+        [HYDRA_CONTROL_HR_ENABLE] = enable,
+    };
+
+    int rc = modbus_write_holding_regs(client_iface, hb->fs.meta.slave_id,
+                                       HYDRA_HR_CONTROL_ADDR_START + HYDRA_CONTROL_HR_SETPOINT,
+                                       regs, ARRAY_SIZE(regs));
+    if (rc < 0) {
+        LOG_ERR("Failed to set fill control on slave %u: %d", hb->fs.meta.slave_id, rc);
+    }
+
+    return rc;
+}
+
+// Oldest sample time of the connected boards, UINT64_MAX if none of them is connected
+static uint64_t oldest_sample(uint64_t oldest, const struct modbus_slave_metadata *const meta,
+                              const uint16_t *const sample_time)
+{
+    return meta->is_connected ? MIN(oldest, timesync_from_regs(sample_time)) : oldest;
 }
 
 inline void hydra_boards_irs_to_zbus_rep(const struct hydra_boards *const hb,
-                                         thermocouples_t *const thermocouples,
-                                         pressures_t *const pressures,
+                                         thermo_sample_t *const thermo_sample,
+                                         pressure_sample_t *const pressure_sample,
                                          const bool fs_disabled)
 {
-    if (!hb || !thermocouples || !pressures) {
+    if (!hb || !thermo_sample || !pressure_sample) {
         LOG_ERR("Invalid parameters for HYDRA IRs to ZBUS conversion.");
         k_oops(); // Should never reach here
     }
 
+    thermocouples_t *const thermocouples = &thermo_sample->thermocouples;
+    pressures_t *const pressures = &pressure_sample->pressures;
+
     // clang-format off
     #define ZERO_IF_FS_DISABLED(x) ((fs_disabled) ? 0 : (x))
 
@@ -106,4 +248,18 @@ inline void hydra_boards_irs_to_zbus_rep(const struct hydra_boards *const hb,
     pressures->n2o_line_pressure = ZERO_IF_FS_DISABLED(hb->fs.sensors.n2o_pressure);
     pressures->quick_dc_pressure = ZERO_IF_FS_DISABLED(hb->fs.sensors.quick_dc_pressure);
     // clang-format on
+
+    uint64_t thermo_time = UINT64_MAX;
+    thermo_time = oldest_sample(thermo_time, &hb->uf.meta, hb->uf.sensors.sample_time);
+    thermo_time = oldest_sample(thermo_time, &hb->lf.meta, hb->lf.sensors.sample_time);
+
+    uint64_t pressure_time = oldest_sample(UINT64_MAX, &hb->lf.meta, hb->lf.sensors.sample_time);
+
+    if (!fs_disabled) {
+        thermo_time = oldest_sample(thermo_time, &hb->fs.meta, hb->fs.sensors.sample_time);
+        pressure_time = oldest_sample(pressure_time, &hb->fs.meta, hb->fs.sensors.sample_time);
+    }
+
+    thermo_sample->timestamp_us = thermo_time == UINT64_MAX ? 0 : thermo_time;
+    pressure_sample->timestamp_us = pressure_time == UINT64_MAX ? 0 : pressure_time;
 }
@@ -37,23 +37,18 @@ void lift_boards_read_irs(const int client_iface, struct lift_boards *const lb,
         return;
     }
 
-    // Read upper feed lift sensors
-    int rocket_rc = modbus_read_input_regs(
-        client_iface, lb->rocket.meta.slave_id, lb->rocket.meta.ir_start,
-        (uint16_t *const)&lb->rocket.loadcells.raw, ARRAY_SIZE(lb->rocket.loadcells.raw));
-
-    modbus_slave_check_connection(rocket_rc, &lb->rocket.meta, "Rocket LIFT");
+    // Read rocket lift sensors
+    modbus_slave_read_irs(client_iface, &lb->rocket.meta,
+                          (uint16_t *const)&lb->rocket.loadcells.raw,
+                          ARRAY_SIZE(lb->rocket.loadcells.raw), "Rocket LIFT");
 
     if (fs_disabled) {
         LOG_WRN_ONCE("Filling Station is disconnected, skipping read.");
         return;
     }
 
-    int fs_rc =
-        modbus_read_input_regs(client_iface, lb->fs.meta.slave_id, lb->fs.meta.ir_start,
-                               (uint16_t *const)&lb->fs.n2o_loadcell, 1);
-
-    modbus_slave_check_connection(fs_rc, &lb->fs.meta, "Filling Station LIFT");
+    modbus_slave_read_irs(client_iface, &lb->fs.meta, (uint16_t *const)&lb->fs.n2o_loadcell, 1,
+                          "Filling Station LIFT");
 }
 
 inline void lift_boards_irs_to_zbus_rep(const struct lift_boards *const lb,
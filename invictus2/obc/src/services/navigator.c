@@ -1,10 +1,268 @@
 #include "services/navigator.h"
+#include "services/health.h"
+
+#include "chan_stats.h"
+#include "data_models.h"
+#include "invictus2/nav_link.h"
+#include "invictus2/timesync.h"
+#include "invictus2/trace.h"
+
+#include <string.h>
+
+#include "zephyr/device.h"
+#include "zephyr/drivers/uart.h"
+#include "zephyr/kernel.h"
+#include "zephyr/logging/log.h"
+#include "zephyr/sys/ring_buffer.h"
+#include "zephyr/zbus/zbus.h"
+
+LOG_MODULE_REGISTER(navigator_service, LOG_LEVEL_INF);
+
+#define NAVIGATOR_UART_NODE DT_ALIAS(navigator_uart)
+
+// Published channels
+ZBUS_CHAN_DECLARE(chan_navigator_sensors, chan_kalman_data);
+
+static struct navigator_stats stats;
+
+#if DT_NODE_EXISTS(NAVIGATOR_UART_NODE)
+
+/*
+ * The UART receives with the async API into two buffers: while the driver (and its DMA)
+ * fills one, the other is handed back on UART_RX_BUF_REQUEST. Received bytes are copied to
+ * a ring from the callback, the work queue decodes frames out of it and publishes them.
+ *
+ * The other direction only carries the time sync frames the navigator stamps its samples
+ * with, see invictus2/timesync.h.
+ */
+static const struct device *const uart_dev = DEVICE_DT_GET(NAVIGATOR_UART_NODE);
+
+static uint8_t rx_bufs[2][CONFIG_NAVIGATOR_RX_BUF_SIZE];
+static uint8_t next_rx_buf;
+RING_BUF_DECLARE(rx_ring, CONFIG_NAVIGATOR_RX_RING_SIZE);
+
+static struct nav_link_decoder decoder;
+
+static uint8_t sync_tx_buf[NAV_LINK_MAX_FRAME];
+static atomic_t sync_tx_busy = ATOMIC_INIT(false);
+static uint16_t sync_seq;
+static bool link_disabled; // The UART is unusable, as without the alias
+
+static void decode_work_handler(struct k_work *work);
+static void sync_work_handler(struct k_work *work);
+static K_WORK_DEFINE(decode_work, decode_work_handler);
+static K_WORK_DELAYABLE_DEFINE(sync_work, sync_work_handler);
+
+K_THREAD_STACK_DEFINE(navigator_work_q_stack, CONFIG_NAVIGATOR_WORK_Q_STACK);
+static struct k_work_q navigator_work_q;
+
+static int rx_enable(void)
+{
+    int ret = uart_rx_enable(uart_dev, rx_bufs[next_rx_buf], sizeof(rx_bufs[0]),
+                             CONFIG_NAVIGATOR_RX_TIMEOUT_USEC);
+    next_rx_buf = !next_rx_buf;
+    return ret;
+}
+
+static void uart_cb(const struct device *dev, struct uart_event *evt, void *user_data)
+{
+    ARG_UNUSED(user_data);
+
+    switch (evt->type)
+    {
+    case UART_RX_RDY:
+    {
+        const uint8_t *data = &evt->data.rx.buf[evt->data.rx.offset];
+        const uint32_t put = ring_buf_put(&rx_ring, data, evt->data.rx.len);
+
+        stats.rx_dropped += evt->data.rx.len - put;
+        k_work_submit_to_queue(&navigator_work_q, &decode_work);
+        break;
+    }
+
+    case UART_RX_BUF_REQUEST:
+        uart_rx_buf_rsp(dev, rx_bufs[next_rx_buf], sizeof(rx_bufs[0]));
+        next_rx_buf = !next_rx_buf;
+        break;
+
+    case UART_RX_STOPPED:
+        stats.uart_errors++;
+        break;
+
+    case UART_RX_DISABLED:
+        // After an error, or if a buffer could not be provided in time
+        rx_enable();
+        break;
+
+    case UART_TX_DONE:
+        atomic_set(&sync_tx_busy, false);
+        break;
+
+    case UART_TX_ABORTED:
+        stats.uart_errors++;
+        atomic_set(&sync_tx_busy, false);
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void publish_frame(const struct nav_link_frame *frame, void *user_data)
+{
+    ARG_UNUSED(user_data);
+
+    const struct zbus_channel *chan;
+    const uint8_t *sample = frame->samples;
+    size_t size;
+
+    switch (frame->header.type)
+    {
+    case NAV_LINK_SENSORS:
+        chan = &chan_navigator_sensors;
+        size = sizeof(navigator_sample_t);
+        break;
+
+    case NAV_LINK_KALMAN:
+        chan = &chan_kalman_data;
+        size = sizeof(kalman_sample_t);
+        break;
+
+    default:
+        return; // Not sent by the navigator
+    }
+
+    for (uint8_t i = 0; i < frame->header.count; i++, sample += size)
+    {
+        // The samples are only word aligned in the decoder buffer
+        union
+        {
+            navigator_sample_t sensors;
+            kalman_sample_t kalman;
+        } copy;
+
+        memcpy(&copy, sample, size);
+        TRACE_BEGIN(TRACE_ZBUS_PUB);
+        const int ret = chan_stats_pub(chan, &copy, K_MSEC(1));
+        TRACE_END(TRACE_ZBUS_PUB);
+        if (ret != 0)
+        {
+            stats.publish_errors++;
+        }
+    }
+}
+
+static void decode_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    uint8_t *data;
+    uint32_t len;
+
+    while ((len = ring_buf_get_claim(&rx_ring, &data, UINT32_MAX)) > 0)
+    {
+        TRACE_BEGIN(TRACE_NAV_FRAME);
+        nav_link_decode(&decoder, data, len, publish_frame, NULL);
+        TRACE_END(TRACE_NAV_FRAME);
+        ring_buf_get_finish(&rx_ring, len);
+    }
+}
+
+static void sync_work_handler(struct k_work *work)
+{
+    k_work_schedule_for_queue(&navigator_work_q, &sync_work,
+                              K_MSEC(CONFIG_TIMESYNC_BROADCAST_INTERVAL_MSEC));
+
+    // Skipped rather than queued, a late sync frame is worse than none
+    if (!atomic_cas(&sync_tx_busy, false, true))
+    {
+        stats.sync_skipped++;
+        return;
+    }
+
+    const struct nav_link_sync sync = {.master_us = timesync_uptime_us()};
+    const size_t len = nav_link_encode(NAV_LINK_SYNC, sync_seq++, &sync, 1, sync_tx_buf,
+                                       sizeof(sync_tx_buf));
+
+    const int ret = uart_tx(uart_dev, sync_tx_buf, len, SYS_FOREVER_US);
+    if (ret != 0)
+    {
+        stats.uart_errors++;
+        atomic_set(&sync_tx_busy, false);
+        return;
+    }
+
+    stats.syncs_sent++;
+}
+
+void navigator_get_stats(struct navigator_stats *out)
+{
+    const unsigned int key = irq_lock();
+    *out = stats;
+    out->link = decoder.stats;
+    irq_unlock(key);
+}
 
 bool navigator_service_setup(void)
 {
-    return false;
+    // The OBC boots without the navigator, the flight executor runs on its own
+    if (!device_is_ready(uart_dev))
+    {
+        LOG_ERR("Navigator UART not ready, navigator link disabled");
+        link_disabled = true;
+        return true;
+    }
+
+    int ret = uart_callback_set(uart_dev, uart_cb, NULL);
+    if (ret != 0)
+    {
+        LOG_ERR("Navigator UART has no async API (%d), navigator link disabled", ret);
+        link_disabled = true;
+        return true;
+    }
+
+    nav_link_decoder_init(&decoder);
+    k_work_queue_init(&navigator_work_q);
+    return true;
 }
 
 void navigator_service_start(void)
 {
+    if (link_disabled)
+    {
+        return;
+    }
+
+    k_work_queue_start(&navigator_work_q, navigator_work_q_stack,
+                       K_THREAD_STACK_SIZEOF(navigator_work_q_stack),
+                       CONFIG_NAVIGATOR_WORK_Q_PRIO, NULL);
+    k_thread_name_set(&navigator_work_q.thread, "navigator");
+    health_register_work_q(HEALTH_NAVIGATOR_WORK_Q, &navigator_work_q);
+
+    int ret = rx_enable();
+    if (ret != 0)
+    {
+        LOG_ERR("Failed to start navigator reception: %d", ret);
+    }
+
+    k_work_schedule_for_queue(&navigator_work_q, &sync_work, K_NO_WAIT);
+}
+
+#else
+
+bool navigator_service_setup(void)
+{
+    LOG_WRN("No navigator-uart alias, navigator link disabled");
+    return true;
 }
+
+void navigator_service_start(void)
+{
+}
+
+void navigator_get_stats(struct navigator_stats *out)
+{
+    *out = stats;
+}
+
+#endif // DT_NODE_EXISTS(NAVIGATOR_UART_NODE)
@@ -0,0 +1,701 @@
+#include "services/sd_logger.h"
+#include "services/health.h"
+#include "services/sd_logger/log_buffer.h"
+#include "services/supervisor.h"
+
+#include "chan_stats.h"
+#include "data_models.h"
+#include "packets.h"
+#include "invictus2/sd_log.h"
+#include "invictus2/timesync.h"
+#include "invictus2/trace.h"
+
+#include <stdio.h>
+
+#include "zephyr/kernel.h"
+#include "zephyr/logging/log.h"
+#include "zephyr/spinlock.h"
+#include "zephyr/zbus/zbus.h"
+
+LOG_MODULE_REGISTER(sd_logger_service, LOG_LEVEL_INF);
+
+#define BUF_BLOCKS   (CONFIG_SD_LOGGER_BUF_SIZE / SD_LOG_BLOCK_SIZE)
+#define RING_BLOCKS  MAX(CONFIG_SD_LOGGER_PRETRIGGER_BLOCKS, 1)
+#define WRITE_BLOCKS MAX(BUF_BLOCKS, RING_BLOCKS) // Longest write, a ring drain or a buffer
+
+BUILD_ASSERT(CONFIG_SD_LOGGER_BUF_SIZE % SD_LOG_BLOCK_SIZE == 0,
+             "SD logger buffers must be whole blocks");
+
+// Subscribed channels
+ZBUS_CHAN_DECLARE(chan_thermo_sensors, chan_pressure_sensors, chan_weight_sensors);
+ZBUS_CHAN_DECLARE(chan_navigator_sensors, chan_kalman_data);
+ZBUS_CHAN_DECLARE(chan_rocket_state, chan_modbus_health, chan_packets, chan_cmd_latency);
+ZBUS_CHAN_DECLARE(chan_health, chan_bus_stats);
+
+static struct sd_logger_stats stats;
+
+#if DT_HAS_COMPAT_STATUS_OKAY(zephyr_sdmmc_disk)
+
+#include "ff.h"
+#include "zephyr/fs/fs.h"
+
+#define MOUNT_POINT "/SD:"
+
+static FATFS fat_fs;
+static struct fs_mount_t sd_mount = {
+    .type = FS_FATFS,
+    .fs_data = &fat_fs,
+    .mnt_point = MOUNT_POINT,
+};
+
+static struct fs_file_t log_file;
+
+static const struct
+{
+    const struct zbus_channel *chan;
+    enum sd_log_record_type type;
+} logged_chans[] = {
+    {&chan_thermo_sensors, SD_LOG_REC_THERMO},
+    {&chan_pressure_sensors, SD_LOG_REC_PRESSURE},
+    {&chan_weight_sensors, SD_LOG_REC_WEIGHT},
+    {&chan_navigator_sensors, SD_LOG_REC_NAVIGATOR},
+    {&chan_kalman_data, SD_LOG_REC_KALMAN},
+    {&chan_modbus_health, SD_LOG_REC_MODBUS_HEALTH},
+    {&chan_packets, SD_LOG_REC_PACKET},
+    {&chan_cmd_latency, SD_LOG_REC_CMD_LATENCY},
+    {&chan_health, SD_LOG_REC_HEALTH},
+    {&chan_bus_stats, SD_LOG_REC_BUS_STATS},
+};
+
+BUILD_ASSERT(sizeof(navigator_sample_t) <= UINT8_MAX && sizeof(kalman_sample_t) <= UINT8_MAX &&
+                 sizeof(modbus_health_t) <= UINT8_MAX && sizeof(generic_packet_t) <= UINT8_MAX &&
+                 sizeof(cmd_latency_t) <= UINT8_MAX && sizeof(health_sample_t) <= UINT8_MAX &&
+                 sizeof(bus_stats_t) <= UINT8_MAX,
+             "Logged messages must fit the record length");
+
+static void start_work_handler(struct k_work *work);
+static void stop_work_handler(struct k_work *work);
+static void write_work_handler(struct k_work *work);
+static void ring_work_handler(struct k_work *work);
+static void status_work_handler(struct k_work *work);
+static void sync_work_handler(struct k_work *work);
+
+static K_WORK_DEFINE(start_work, start_work_handler);
+static K_WORK_DEFINE(stop_work, stop_work_handler);
+static K_WORK_DEFINE(write_work, write_work_handler);
+static K_WORK_DEFINE(ring_work, ring_work_handler);
+static K_WORK_DEFINE(status_work, status_work_handler);
+static K_WORK_DELAYABLE_DEFINE(sync_work, sync_work_handler);
+
+K_THREAD_STACK_DEFINE(sd_logger_work_q_stack, CONFIG_SD_LOGGER_WORK_Q_STACK);
+static struct k_work_q sd_logger_work_q;
+
+// Mounting, recovering and preallocating a log can take longer than any deadline, and the
+// flight does not depend on the card: a stall is only reported
+static const struct supervisor_watch sd_logger_watch = {
+    .deadline_ms = CONFIG_SUPERVISOR_SD_LOGGER_DEADLINE_MSEC,
+    .keep_fed = true,
+};
+
+static void sd_logger_listener_cb(const struct zbus_channel *chan);
+
+CHAN_STATS_LISTENER_DEFINE(sd_logger_listener, sd_logger_listener_cb);
+ZBUS_CHAN_ADD_OBS(chan_thermo_sensors, sd_logger_listener, CONFIG_SD_LOGGER_ZBUS_LISTENER_PRIO);
+ZBUS_CHAN_ADD_OBS(chan_pressure_sensors, sd_logger_listener,
+                  CONFIG_SD_LOGGER_ZBUS_LISTENER_PRIO);
+ZBUS_CHAN_ADD_OBS(chan_weight_sensors, sd_logger_listener, CONFIG_SD_LOGGER_ZBUS_LISTENER_PRIO);
+ZBUS_CHAN_ADD_OBS(chan_navigator_sensors, sd_logger_listener,
+                  CONFIG_SD_LOGGER_ZBUS_LISTENER_PRIO);
+ZBUS_CHAN_ADD_OBS(chan_kalman_data, sd_logger_listener, CONFIG_SD_LOGGER_ZBUS_LISTENER_PRIO);
+ZBUS_CHAN_ADD_OBS(chan_rocket_state, sd_logger_listener, CONFIG_SD_LOGGER_ZBUS_LISTENER_PRIO);
+ZBUS_CHAN_ADD_OBS(chan_modbus_health, sd_logger_listener, CONFIG_SD_LOGGER_ZBUS_LISTENER_PRIO);
+ZBUS_CHAN_ADD_OBS(chan_packets, sd_logger_listener, CONFIG_SD_LOGGER_ZBUS_LISTENER_PRIO);
+ZBUS_CHAN_ADD_OBS(chan_cmd_latency, sd_logger_listener, CONFIG_SD_LOGGER_ZBUS_LISTENER_PRIO);
+ZBUS_CHAN_ADD_OBS(chan_health, sd_logger_listener, CONFIG_SD_LOGGER_ZBUS_LISTENER_PRIO);
+ZBUS_CHAN_ADD_OBS(chan_bus_stats, sd_logger_listener, CONFIG_SD_LOGGER_ZBUS_LISTENER_PRIO);
+
+// The blocks and their numbering, see services/sd_logger/log_buffer.h. Everything below is
+// protected by buf_lock, except the blocks handed to the writer, which only it touches.
+static struct sd_log_block bufs[2][BUF_BLOCKS];
+static struct sd_log_block ring[RING_BLOCKS];
+static struct log_buffer blocks = {
+    .bufs = {bufs[0], bufs[1]},
+    .buf_blocks = BUF_BLOCKS,
+    .ring = ring,
+    .ring_blocks = CONFIG_SD_LOGGER_PRETRIGGER_BLOCKS,
+};
+static bool logging;
+static main_state_t main_state;
+
+static struct k_spinlock buf_lock;
+
+static bool mounted;
+static bool recovered;     // The last log on the card was checked
+static uint32_t file_size; // Bytes written to the current file
+
+// Lock held, hand the work the buffering asks for to the writer
+static void submit(uint32_t events)
+{
+    if (events & LOG_BUFFER_WRITE)
+    {
+        k_work_submit_to_queue(&sd_logger_work_q, &write_work);
+    }
+
+    if (events & LOG_BUFFER_DRAIN)
+    {
+        k_work_submit_to_queue(&sd_logger_work_q, &ring_work);
+    }
+}
+
+// Lock held
+static void append_record(enum sd_log_record_type type, const void *msg, size_t len)
+{
+    submit(log_buffer_append(&blocks, type, msg, len, (uint32_t)timesync_uptime_us()));
+}
+
+static void log_record(enum sd_log_record_type type, const void *msg, size_t len)
+{
+    k_spinlock_key_t key = k_spin_lock(&buf_lock);
+
+    if (logging)
+    {
+        append_record(type, msg, len);
+    }
+
+    k_spin_unlock(&buf_lock, key);
+}
+
+// Lock held, the rocket state drives the pre-trigger recorder
+static void set_main_state(main_state_t state)
+{
+    const main_state_t prev = main_state;
+    main_state = state;
+
+    if (prev == ARMED && state != ARMED)
+    {
+        submit(log_buffer_trigger(&blocks));
+    }
+    else if (prev != ARMED && state == ARMED)
+    {
+        submit(log_buffer_arm(&blocks));
+    }
+}
+
+static void log_rocket_state(const state_data_t *state)
+{
+    k_spinlock_key_t key = k_spin_lock(&buf_lock);
+
+    if (logging)
+    {
+        // The ARMED state is logged before the ring takes over, FLIGHT or ABORT after the
+        // ring is frozen
+        if (state->main_state == ARMED)
+        {
+            append_record(SD_LOG_REC_ROCKET_STATE, state, sizeof(*state));
+            set_main_state(state->main_state);
+        }
+        else
+        {
+            set_main_state(state->main_state);
+            append_record(SD_LOG_REC_ROCKET_STATE, state, sizeof(*state));
+        }
+    }
+    else
+    {
+        main_state = state->main_state;
+    }
+
+    k_spin_unlock(&buf_lock, key);
+}
+
+static void handle_command(const generic_packet_t *packet)
+{
+    if ((command_t)packet->header.command_id != CMD_MANUAL_EXEC)
+    {
+        return;
+    }
+
+    const struct cmd_manual_exec_s *const cmd = (const struct cmd_manual_exec_s *)packet;
+
+    switch ((enum manual_cmd_e)cmd->payload.manual_cmd_id)
+    {
+    case MANUAL_CMD_SD_LOG_START:
+        k_work_submit_to_queue(&sd_logger_work_q, &start_work);
+        break;
+
+    case MANUAL_CMD_SD_LOG_STOP:
+        k_work_submit_to_queue(&sd_logger_work_q, &stop_work);
+        break;
+
+    case MANUAL_CMD_SD_STATUS:
+        k_work_submit_to_queue(&sd_logger_work_q, &status_work);
+        break;
+
+    default:
+        break; // Not an SD command
+    }
+}
+
+static void sd_logger_listener_cb(const struct zbus_channel *chan)
+{
+    // Runs in the publisher's context, the message can be read without locking
+    if (chan == &chan_rocket_state)
+    {
+        log_rocket_state(zbus_chan_const_msg(chan));
+        return;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(logged_chans); i++)
+    {
+        if (logged_chans[i].chan == chan)
+        {
+            log_record(logged_chans[i].type, zbus_chan_const_msg(chan),
+                       zbus_chan_msg_size(chan));
+            break;
+        }
+    }
+
+    if (chan == &chan_packets)
+    {
+        handle_command(zbus_chan_const_msg(chan));
+    }
+}
+
+// Seal and write count blocks. The file position always advances by their size, so
+// block seq stays at offset seq * SD_LOG_BLOCK_SIZE even after a failed write.
+static int write_blocks(struct sd_log_block *blocks, size_t count)
+{
+    const size_t len = count * SD_LOG_BLOCK_SIZE;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        sd_log_block_seal(&blocks[i]);
+    }
+
+    TRACE_BEGIN(TRACE_SD_WRITE);
+    const uint32_t start = k_cycle_get_32();
+    const ssize_t ret = fs_write(&log_file, blocks, len);
+    const uint32_t took_us = k_cyc_to_us_ceil32(k_cycle_get_32() - start);
+    TRACE_END(TRACE_SD_WRITE);
+
+    k_spinlock_key_t key = k_spin_lock(&buf_lock);
+    stats.last_write_us = took_us;
+    stats.max_write_us = MAX(stats.max_write_us, took_us);
+    if (ret == (ssize_t)len)
+    {
+        stats.bytes_written += len;
+    }
+    else
+    {
+        stats.write_errors++;
+    }
+    k_spin_unlock(&buf_lock, key);
+
+    file_size += len;
+
+    if (ret != (ssize_t)len)
+    {
+        LOG_ERR("Log write failed: %d", (int)ret);
+        (void)fs_seek(&log_file, file_size, FS_SEEK_SET);
+        return ret < 0 ? (int)ret : -ENOSPC;
+    }
+
+    return 0;
+}
+
+static void write_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    struct sd_log_block *pending;
+    k_spinlock_key_t key = k_spin_lock(&buf_lock);
+    const uint16_t count = log_buffer_pending(&blocks, &pending);
+    k_spin_unlock(&buf_lock, key);
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    // A failed write loses this buffer only, the next ones are still attempted
+    (void)write_blocks(pending, count);
+
+    key = k_spin_lock(&buf_lock);
+    submit(log_buffer_written(&blocks));
+    k_spin_unlock(&buf_lock, key);
+}
+
+// Write the frozen ring, oldest block first, runs as returned by log_buffer_frozen()
+static void drain_ring(const struct log_buffer_run *runs, size_t count)
+{
+    uint32_t written = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        (void)write_blocks(runs[i].blocks, runs[i].count);
+        written += runs[i].count;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&buf_lock);
+    stats.pretrigger_blocks += written;
+    submit(log_buffer_drained(&blocks));
+    k_spin_unlock(&buf_lock, key);
+
+    LOG_INF("Pre-trigger window written: %u blocks", written);
+}
+
+static void ring_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    // Frozen, producers do not touch the ring until it is drained
+    struct log_buffer_run runs[2];
+    k_spinlock_key_t key = k_spin_lock(&buf_lock);
+    const size_t count = log_buffer_frozen(&blocks, runs);
+    k_spin_unlock(&buf_lock, key);
+
+    if (count > 0)
+    {
+        drain_ring(runs, count);
+    }
+}
+
+static void sync_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    k_spinlock_key_t key = k_spin_lock(&buf_lock);
+    const bool is_logging = logging;
+    k_spin_unlock(&buf_lock, key);
+
+    if (!is_logging)
+    {
+        return;
+    }
+
+    // Flushes the FAT and directory entry, data written so far survives a power loss
+    const int ret = fs_sync(&log_file);
+    if (ret < 0)
+    {
+        LOG_WRN("Log sync failed: %d", ret);
+    }
+
+    k_work_schedule_for_queue(&sd_logger_work_q, &sync_work,
+                              K_MSEC(CONFIG_SD_LOGGER_SYNC_INTERVAL_MSEC));
+}
+
+static void log_path(char *path, size_t size, uint32_t index)
+{
+    snprintf(path, size, MOUNT_POINT "/LOG%05u.BIN", (unsigned int)index);
+}
+
+static int read_block(void *ctx, uint32_t index, struct sd_log_block *blk)
+{
+    struct fs_file_t *const file = ctx;
+
+    int ret = fs_seek(file, (off_t)index * SD_LOG_BLOCK_SIZE, FS_SEEK_SET);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    ret = fs_read(file, blk, sizeof(*blk));
+    return ret == sizeof(*blk) ? 0 : -EIO;
+}
+
+// Trim a log cut by a reset or a power loss, pre-allocated and possibly torn, to its
+// last valid block
+static void recover_log(uint32_t index)
+{
+    static struct sd_log_block scan_blk;
+    char path[sizeof(MOUNT_POINT "/LOG00000.BIN")];
+    struct fs_dirent entry;
+    struct fs_file_t file;
+
+    log_path(path, sizeof(path), index);
+    if (fs_stat(path, &entry) < 0 || entry.size == 0)
+    {
+        return;
+    }
+
+    fs_file_t_init(&file);
+    int ret = fs_open(&file, path, FS_O_RDWR);
+    if (ret < 0)
+    {
+        LOG_WRN("Failed to open LOG%05u.BIN for recovery: %d", index, ret);
+        return;
+    }
+
+    struct sd_log_scan scan;
+    sd_log_scan(read_block, &file, entry.size / SD_LOG_BLOCK_SIZE, WRITE_BLOCKS, &scan_blk,
+                &scan);
+
+    const size_t end = scan.blocks * SD_LOG_BLOCK_SIZE;
+    if (end != entry.size)
+    {
+        ret = fs_truncate(&file, end);
+        LOG_INF("Recovered LOG%05u.BIN: %u blocks, %u torn, %u blocks read, trim: %d", index,
+                scan.blocks, scan.lost, scan.reads, ret);
+    }
+
+    (void)fs_close(&file);
+}
+
+static int open_next_file(uint32_t *index)
+{
+    char path[sizeof(MOUNT_POINT "/LOG00000.BIN")];
+    struct fs_dirent entry;
+
+    for (uint32_t i = stats.file_index; i < 100000; i++)
+    {
+        log_path(path, sizeof(path), i);
+        if (fs_stat(path, &entry) != -ENOENT)
+        {
+            continue;
+        }
+
+        // Only a reset leaves a log open, so the last one is checked once per boot
+        if (!recovered && i > 0)
+        {
+            recover_log(i - 1);
+        }
+        recovered = true;
+
+        fs_file_t_init(&log_file);
+        *index = i;
+        return fs_open(&log_file, path, FS_O_CREATE | FS_O_WRITE);
+    }
+
+    return -ENOSPC;
+}
+
+static void start_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    if (logging)
+    {
+        LOG_WRN("Already logging to LOG%05u.BIN", stats.file_index);
+        return;
+    }
+
+    int ret;
+    if (!mounted)
+    {
+        ret = fs_mount(&sd_mount);
+        if (ret < 0)
+        {
+            LOG_ERR("Failed to mount the SD card: %d", ret);
+            return;
+        }
+        mounted = true;
+    }
+
+    uint32_t index;
+    ret = open_next_file(&index);
+    if (ret < 0)
+    {
+        LOG_ERR("Failed to create a log file: %d", ret);
+        return;
+    }
+
+    // Allocating the clusters up front keeps the FAT updates out of the logging writes.
+    // FATFS fills the file with zeros, so this takes a while on large files.
+    if (CONFIG_SD_LOGGER_PREALLOC_KB > 0)
+    {
+        ret = fs_truncate(&log_file, CONFIG_SD_LOGGER_PREALLOC_KB * 1024);
+        if (ret == 0)
+        {
+            ret = fs_seek(&log_file, 0, FS_SEEK_SET);
+        }
+
+        if (ret < 0)
+        {
+            LOG_WRN("Failed to pre-allocate the log file: %d", ret);
+        }
+    }
+
+    // Commit the file size, so the blocks written into it survive a power loss
+    (void)fs_sync(&log_file);
+
+    file_size = 0;
+
+    const uint64_t start_us = timesync_uptime_us();
+
+    k_spinlock_key_t key = k_spin_lock(&buf_lock);
+    log_buffer_start(&blocks, (uint32_t)start_us);
+    logging = true;
+    stats.logging = true;
+    stats.file_index = index;
+    stats.bytes_written = 0;
+    stats.write_errors = 0;
+    stats.max_write_us = 0;
+    stats.pretrigger_blocks = 0;
+    k_spin_unlock(&buf_lock, key);
+
+    const struct sd_log_file_hdr file_hdr = {
+        .magic = SD_LOG_MAGIC,
+        .version = SD_LOG_VERSION,
+        .buf_sectors = WRITE_BLOCKS,
+        .start_us = start_us,
+    };
+    log_record(SD_LOG_REC_FILE_HDR, &file_hdr, sizeof(file_hdr));
+
+    // Logging may start with the rocket already ARMED, the listener tracks the state anyway
+    key = k_spin_lock(&buf_lock);
+    if (main_state == ARMED)
+    {
+        submit(log_buffer_arm(&blocks));
+    }
+    k_spin_unlock(&buf_lock, key);
+
+    k_work_schedule_for_queue(&sd_logger_work_q, &sync_work,
+                              K_MSEC(CONFIG_SD_LOGGER_SYNC_INTERVAL_MSEC));
+
+    LOG_INF("Logging to LOG%05u.BIN", index);
+}
+
+static void stop_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    k_spinlock_key_t key = k_spin_lock(&buf_lock);
+    const bool was_logging = logging;
+    logging = false;
+    stats.logging = false;
+    k_spin_unlock(&buf_lock, key);
+
+    if (!was_logging)
+    {
+        return;
+    }
+
+    (void)k_work_cancel_delayable(&sync_work);
+
+    // No producer touches the buffers anymore, write out in numbering order the pending
+    // buffer and the pre-trigger window, whichever goes first when the ring work did not
+    // run yet, then the partial buffer
+    log_buffer_stop(&blocks);
+
+    struct sd_log_block *run;
+    struct log_buffer_run runs[2];
+    uint16_t count;
+    size_t run_count;
+    do
+    {
+        count = log_buffer_pending(&blocks, &run);
+        if (count > 0)
+        {
+            (void)write_blocks(run, count);
+            (void)log_buffer_written(&blocks);
+        }
+
+        run_count = log_buffer_frozen(&blocks, runs);
+        if (run_count > 0)
+        {
+            drain_ring(runs, run_count);
+        }
+    } while (count > 0 || run_count > 0);
+
+    count = log_buffer_partial(&blocks, &run);
+    if (count > 0)
+    {
+        (void)write_blocks(run, count);
+    }
+
+    // Drop whatever was pre-allocated and not used
+    int ret = fs_truncate(&log_file, file_size);
+    if (ret < 0)
+    {
+        LOG_WRN("Failed to trim the log file: %d", ret);
+    }
+
+    ret = fs_close(&log_file);
+    if (ret < 0)
+    {
+        LOG_ERR("Failed to close the log file: %d", ret);
+    }
+
+    LOG_INF("Closed LOG%05u.BIN: %u records, %u bytes, %u dropped", stats.file_index,
+            blocks.records, stats.bytes_written, blocks.dropped);
+}
+
+static void status_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    struct sd_logger_stats s;
+    sd_logger_get_stats(&s);
+
+    LOG_INF("SD log %s, LOG%05u.BIN: %u records, %u dropped, %u bytes, %u write errors, "
+            "write %u us (max %u us)",
+            s.logging ? "running" : "stopped", s.file_index, s.records, s.dropped,
+            s.bytes_written, s.write_errors, s.last_write_us, s.max_write_us);
+}
+
+void sd_logger_start(void)
+{
+    k_work_submit_to_queue(&sd_logger_work_q, &start_work);
+}
+
+void sd_logger_stop(void)
+{
+    k_work_submit_to_queue(&sd_logger_work_q, &stop_work);
+}
+
+void sd_logger_get_stats(struct sd_logger_stats *out)
+{
+    k_spinlock_key_t key = k_spin_lock(&buf_lock);
+    *out = stats;
+    out->records = blocks.records;
+    out->dropped = blocks.dropped;
+    k_spin_unlock(&buf_lock, key);
+}
+
+bool sd_logger_service_setup(void)
+{
+    k_work_queue_init(&sd_logger_work_q);
+    return true;
+}
+
+void sd_logger_service_start(void)
+{
+    k_work_queue_start(&sd_logger_work_q, sd_logger_work_q_stack,
+                       K_THREAD_STACK_SIZEOF(sd_logger_work_q_stack),
+                       CONFIG_SD_LOGGER_WORK_Q_PRIO, NULL);
+    k_thread_name_set(&sd_logger_work_q.thread, "sd_logger");
+    health_register_work_q(HEALTH_SD_LOGGER_WORK_Q, &sd_logger_work_q);
+    supervisor_watch_work_q(HEALTH_SD_LOGGER_WORK_Q, &sd_logger_work_q, &sd_logger_watch);
+
+    if (IS_ENABLED(CONFIG_SD_LOGGER_AUTOSTART))
+    {
+        sd_logger_start();
+    }
+}
+
+#else
+
+bool sd_logger_service_setup(void)
+{
+    LOG_WRN("No SD card in the devicetree, SD logging disabled");
+    return true;
+}
+
+void sd_logger_service_start(void)
+{
+}
+
+void sd_logger_start(void)
+{
+}
+
+void sd_logger_stop(void)
+{
+}
+
+void sd_logger_get_stats(struct sd_logger_stats *out)
+{
+    *out = stats;
+}
+
+#endif // DT_HAS_COMPAT_STATUS_OKAY(zephyr_sdmmc_disk)
@@ -0,0 +1,235 @@
+#include "services/sd_logger/log_buffer.h"
+
+// Hand count blocks of bufs[active] to the writer and switch buffers
+static uint32_t hand_over(struct log_buffer *lb, uint16_t count)
+{
+    lb->buf_pending = true;
+    lb->pending_blocks = count;
+    lb->active = !lb->active;
+    lb->cur_block = 0;
+    return LOG_BUFFER_WRITE;
+}
+
+// The block records go to once the current one is full, NULL if there is none
+static struct sd_log_block *next_block(struct log_buffer *lb, uint32_t *events)
+{
+    if (lb->recorder == LOG_BUFFER_REC_PRETRIGGER)
+    {
+        lb->ring_head = (lb->ring_head + 1) % lb->ring_blocks;
+        if (lb->ring_count < lb->ring_blocks)
+        {
+            lb->ring_count++;
+        }
+        else
+        {
+            // The oldest block is overwritten, its records never make it to the file
+            lb->records -= lb->ring[lb->ring_head].hdr.records;
+        }
+        sd_log_block_init(&lb->ring[lb->ring_head], lb->session, 0);
+        return &lb->ring[lb->ring_head];
+    }
+
+    if (lb->cur_block + 1 < lb->buf_blocks)
+    {
+        lb->cur_block++;
+    }
+    else if (!lb->buf_pending)
+    {
+        *events |= hand_over(lb, lb->buf_blocks);
+    }
+    else
+    {
+        return NULL;
+    }
+
+    struct sd_log_block *const blk = &lb->bufs[lb->active][lb->cur_block];
+    sd_log_block_init(blk, lb->session, lb->next_seq++);
+    return blk;
+}
+
+// Start recording to the ring once the blocks logged so far can be written
+static uint32_t recorder_arm(struct log_buffer *lb)
+{
+    uint32_t events = 0;
+
+    if (lb->recorder != LOG_BUFFER_REC_ARMING || lb->buf_pending)
+    {
+        return 0;
+    }
+
+    if (lb->bufs[lb->active][lb->cur_block].hdr.records > 0)
+    {
+        events |= hand_over(lb, lb->cur_block + 1);
+    }
+    else if (lb->cur_block > 0)
+    {
+        events |= hand_over(lb, lb->cur_block);
+        lb->next_seq--; // The empty block is not written, its number goes after the ring
+    }
+    else
+    {
+        lb->next_seq--;
+    }
+
+    lb->ring_head = 0;
+    lb->ring_count = 1;
+    sd_log_block_init(&lb->ring[0], lb->session, 0);
+    lb->recorder = LOG_BUFFER_REC_PRETRIGGER;
+    return events;
+}
+
+void log_buffer_start(struct log_buffer *lb, uint32_t session)
+{
+    lb->active = 0;
+    lb->cur_block = 0;
+    lb->next_seq = 1;
+    lb->session = session;
+    sd_log_block_init(&lb->bufs[0][0], session, 0);
+    lb->buf_pending = false;
+    lb->ring_draining = false;
+    lb->recorder = LOG_BUFFER_REC_OFF;
+    lb->dropped_since_last = 0;
+    lb->records = 0;
+    lb->dropped = 0;
+}
+
+uint32_t log_buffer_append(struct log_buffer *lb, enum sd_log_record_type type,
+                           const void *msg, size_t len, uint32_t time_us)
+{
+    const struct sd_log_record_hdr hdr = {
+        .type = type,
+        .len = (uint8_t)len,
+        .dropped = lb->dropped_since_last,
+        .time_us = time_us,
+    };
+
+    uint32_t events = recorder_arm(lb);
+
+    struct sd_log_block *blk = lb->recorder == LOG_BUFFER_REC_PRETRIGGER
+                                   ? &lb->ring[lb->ring_head]
+                                   : &lb->bufs[lb->active][lb->cur_block];
+
+    if (!sd_log_block_append(blk, &hdr, msg))
+    {
+        blk = next_block(lb, &events);
+        if (blk == NULL)
+        {
+            lb->dropped++;
+            lb->dropped_since_last = MIN(lb->dropped_since_last + 1, UINT16_MAX);
+            return events;
+        }
+
+        (void)sd_log_block_append(blk, &hdr, msg);
+    }
+
+    lb->dropped_since_last = 0;
+    lb->records++;
+    return events;
+}
+
+uint32_t log_buffer_arm(struct log_buffer *lb)
+{
+    if (lb->ring_blocks == 0 || lb->ring_draining || lb->recorder != LOG_BUFFER_REC_OFF)
+    {
+        return 0;
+    }
+
+    lb->recorder = LOG_BUFFER_REC_ARMING;
+    return recorder_arm(lb);
+}
+
+uint32_t log_buffer_trigger(struct log_buffer *lb)
+{
+    const enum log_buffer_recorder prev = lb->recorder;
+    lb->recorder = LOG_BUFFER_REC_OFF;
+
+    if (prev != LOG_BUFFER_REC_PRETRIGGER)
+    {
+        return 0;
+    }
+
+    // The oldest block is the one after the head once the ring wrapped
+    const bool wrapped = lb->ring_count == lb->ring_blocks;
+    lb->ring_first = wrapped ? (lb->ring_head + 1) % lb->ring_blocks : 0;
+    if (lb->ring[lb->ring_head].hdr.records == 0)
+    {
+        lb->ring_count--;
+    }
+
+    for (uint16_t i = 0; i < lb->ring_count; i++)
+    {
+        lb->ring[(lb->ring_first + i) % lb->ring_blocks].hdr.seq = lb->next_seq++;
+    }
+
+    sd_log_block_init(&lb->bufs[lb->active][lb->cur_block], lb->session, lb->next_seq++);
+
+    if (lb->ring_count == 0)
+    {
+        return 0;
+    }
+
+    lb->ring_draining = true;
+    return LOG_BUFFER_DRAIN;
+}
+
+void log_buffer_stop(struct log_buffer *lb)
+{
+    (void)log_buffer_trigger(lb);
+}
+
+uint16_t log_buffer_pending(const struct log_buffer *lb, struct sd_log_block **blocks)
+{
+    *blocks = lb->bufs[!lb->active];
+
+    if (!lb->buf_pending)
+    {
+        return 0;
+    }
+
+    // Handed over after the trigger, before the frozen ring was written
+    if (lb->ring_draining && (*blocks)[0].hdr.seq > lb->ring[lb->ring_first].hdr.seq)
+    {
+        return 0;
+    }
+
+    return lb->pending_blocks;
+}
+
+uint32_t log_buffer_written(struct log_buffer *lb)
+{
+    lb->buf_pending = false;
+    return recorder_arm(lb);
+}
+
+size_t log_buffer_frozen(const struct log_buffer *lb, struct log_buffer_run runs[2])
+{
+    if (!lb->ring_draining)
+    {
+        return 0;
+    }
+
+    const uint16_t tail = MIN(lb->ring_count, lb->ring_blocks - lb->ring_first);
+
+    runs[0].blocks = &lb->ring[lb->ring_first];
+    runs[0].count = tail;
+    if (lb->ring_count == tail)
+    {
+        return 1;
+    }
+
+    runs[1].blocks = &lb->ring[0];
+    runs[1].count = lb->ring_count - tail;
+    return 2;
+}
+
+uint32_t log_buffer_drained(struct log_buffer *lb)
+{
+    lb->ring_draining = false;
+    return lb->buf_pending ? LOG_BUFFER_WRITE : 0;
+}
+
+uint16_t log_buffer_partial(const struct log_buffer *lb, struct sd_log_block **blocks)
+{
+    *blocks = lb->bufs[lb->active];
+    return lb->cur_block + (lb->bufs[lb->active][lb->cur_block].hdr.records > 0 ? 1 : 0);
+}
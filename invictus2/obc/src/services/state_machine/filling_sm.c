@@ -7,8 +7,6 @@
 
 LOG_MODULE_DECLARE(state_machine_service);
 
-#define SET_FILL_STATE(s, st) SET_STATE(s, FILL_SST(st))
-
 /* ======================================================================== */
 /* root/fill/safe_pause: Filling is paused, waiting for resume command.     */
 /* ======================================================================== */
@@ -20,27 +18,6 @@ void safe_pause_entry(void *o)
     close_all_valves(s);
 }
 
-void safe_pause_run(void *o)
-{
-    // Wait for CMD_RESUME to transition to idle.
-    struct sm_object *s = (struct sm_object *)o;
-    command_t cmd = s->command;
-    if (!cmd)
-    {
-        return;
-    }
-
-    switch (cmd)
-    {
-    case CMD_RESUME:
-        SET_STATE(s, IDLE);
-        break;
-    default:
-        LOG_WRN("Unexpected command in SAFE_PAUSE: 0x%08x", cmd);
-        SET_HANDLED(s);
-    }
-}
-
 void safe_pause_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -56,18 +33,6 @@ void safe_pause_idle_entry(void *o)
     close_all_valves(s);
 }
 
-void safe_pause_idle_run(void *o)
-{
-    // Transition to vent if N2O tank pressure exceeds trigger.
-    struct sm_object *s = (struct sm_object *)o;
-
-    if (s->data.pressures.n2o_tank_pressure >
-        s->config->filling_sm_config.safe_pause.trigger_n2o_tank_pressure)
-    {
-        SET_FILL_STATE(s, SAFE_PAUSE_VENT);
-    }
-}
-
 void safe_pause_idle_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -83,17 +48,6 @@ void safe_pause_vent_entry(void *o)
     open_single_valve(s, VALVE_VENT);
 }
 
-void safe_pause_vent_run(void *o)
-{
-    // Transition back to idle when pressure is safe.
-    struct sm_object *s = (struct sm_object *)o;
-
-    if (s->data.pressures.n2o_tank_pressure <=
-        s->config->filling_sm_config.safe_pause.target_n2o_tank_pressure)
-    {
-        SET_FILL_STATE(s, SAFE_PAUSE_IDLE);
-    }
-}
 void safe_pause_vent_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -109,11 +63,6 @@ void fill_n2_entry(void *o)
     close_all_valves(s);
 }
 
-void fill_n2_run(void *o)
-{
-    ARG_UNUSED(o);
-}
-
 void fill_n2_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -129,23 +78,6 @@ void fill_n2_idle_entry(void *o)
     close_all_valves(s);
 }
 
-void fill_n2_idle_run(void *o)
-{
-    // Transition to fill when pressure is below target.
-    struct sm_object *s = (struct sm_object *)o;
-
-    if (s->data.pressures.n2_line_pressure <=
-        s->config->filling_sm_config.fill_n2.target_n2_tank_pressure)
-    {
-        SET_FILL_STATE(s, FILL_N2_FILL);
-    }
-    else if (s->data.pressures.n2_line_pressure >
-             s->config->filling_sm_config.fill_n2.trigger_n2_tank_pressure)
-    {
-        SET_FILL_STATE(s, FILL_N2_VENT);
-    }
-}
-
 void fill_n2_idle_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -161,18 +93,6 @@ void fill_n2_fill_entry(void *o)
     open_single_valve(s, VALVE_N2_FILL);
 }
 
-void fill_n2_fill_run(void *o)
-{
-    // Transition to idle when pressure reaches target.
-    struct sm_object *s = (struct sm_object *)o;
-
-    if (s->data.pressures.n2_line_pressure >=
-        s->config->filling_sm_config.fill_n2.target_n2_tank_pressure)
-    {
-        SET_FILL_STATE(s, FILL_N2_IDLE);
-    }
-}
-
 void fill_n2_fill_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -191,17 +111,6 @@ void fill_n2_vent_entry(void *o)
     set_valve(s, VALVE_VENT, true);
 }
 
-void fill_n2_vent_run(void *o)
-{
-    // Transition to idle when pressure reaches target.
-    struct sm_object *s = (struct sm_object *)o;
-    if (s->data.pressures.n2_line_pressure <=
-        s->config->filling_sm_config.fill_n2.target_n2_tank_pressure)
-    {
-        SET_FILL_STATE(s, FILL_N2_IDLE);
-    }
-}
-
 void fill_n2_vent_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -217,11 +126,6 @@ void pre_press_entry(void *o)
     close_all_valves(s);
 }
 
-void pre_press_run(void *o)
-{
-    ARG_UNUSED(o);
-}
-
 void pre_press_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -237,23 +141,6 @@ void pre_press_idle_entry(void *o)
     close_all_valves(s);
 }
 
-void pre_press_idle_run(void *o)
-{
-    // Transition to vent or fill based on pressure.
-    struct sm_object *s = (struct sm_object *)o;
-    if (s->data.pressures.n2o_tank_pressure >
-        s->config->filling_sm_config.pre_press.trigger_n2o_tank_pressure)
-    {
-        SET_FILL_STATE(s, PRE_PRESS_VENT);
-        return;
-    }
-    if (s->data.pressures.n2o_tank_pressure <
-        s->config->filling_sm_config.pre_press.target_n2o_tank_pressure)
-    {
-        SET_FILL_STATE(s, PRE_PRESS_FILL_N2);
-    }
-}
-
 void pre_press_idle_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -269,17 +156,6 @@ void pre_press_vent_entry(void *o)
     open_single_valve(s, VALVE_VENT);
 }
 
-void pre_press_vent_run(void *o)
-{
-    // Transition to idle when pressure is safe.
-    struct sm_object *s = (struct sm_object *)o;
-    if (s->data.pressures.n2o_tank_pressure <=
-        s->config->filling_sm_config.pre_press.target_n2o_tank_pressure)
-    {
-        SET_FILL_STATE(s, PRE_PRESS_IDLE);
-    }
-}
-
 void pre_press_vent_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -295,18 +171,6 @@ void pre_press_fill_entry(void *o)
     open_single_valve(s, VALVE_PRESSURIZING);
 }
 
-void pre_press_fill_run(void *o)
-{
-    // Transition to idle when pressure reaches target.
-    struct sm_object *s = (struct sm_object *)o;
-
-    if (s->data.pressures.n2o_tank_pressure >=
-        s->config->filling_sm_config.pre_press.target_n2o_tank_pressure)
-    {
-        SET_FILL_STATE(s, PRE_PRESS_IDLE);
-    }
-}
-
 void pre_press_fill_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -322,11 +186,6 @@ void fill_n2o_entry(void *o)
     close_all_valves(s);
 }
 
-void fill_n2o_run(void *o)
-{
-    ARG_UNUSED(o);
-}
-
 void fill_n2o_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -342,18 +201,6 @@ void fill_n2o_idle_entry(void *o)
     close_all_valves(s);
 }
 
-void fill_n2o_idle_run(void *o)
-{
-    // Transition to fill when tank weight is below target.
-    struct sm_object *s = (struct sm_object *)o;
-
-    if (s->data.loadcells.n2o_loadcell <
-        s->config->filling_sm_config.fill_n2o.target_n2o_tank_weight)
-    {
-        SET_FILL_STATE(s, FILL_N2O_FILL);
-    }
-}
-
 void fill_n2o_idle_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -369,27 +216,6 @@ void fill_n2o_fill_entry(void *o)
     open_single_valve(s, VALVE_N2O_FILL);
 }
 
-void fill_n2o_fill_run(void *o)
-{
-    // FIXME: should be minimum temp thermocouple not specific one
-    // Transition to vent if pressure and temperature exceed trigger,
-    // or to idle if weight reaches target.
-    struct sm_object *s = (struct sm_object *)o;
-
-    if (s->data.pressures.n2o_tank_pressure >=
-            s->config->filling_sm_config.fill_n2o.trigger_n2o_tank_pressure &&
-        s->data.thermocouples.n2o_tank_uf_t1 >
-            s->config->filling_sm_config.fill_n2o.trigger_n2o_tank_temperature)
-    {
-        SET_FILL_STATE(s, FILL_N2O_VENT);
-    }
-    else if (s->data.loadcells.n2o_loadcell >=
-             s->config->filling_sm_config.fill_n2o.target_n2o_tank_weight)
-    {
-        SET_FILL_STATE(s, FILL_N2O_IDLE);
-    }
-}
-
 void fill_n2o_fill_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -407,21 +233,6 @@ void fill_n2o_vent_entry(void *o)
     set_valve(s, VALVE_VENT, true);
 }
 
-void fill_n2o_vent_run(void *o)
-{
-    // Transition to fill when pressure or temperature drop below trigger.
-    // FIXME: Instead of specific thermocouple should be lowest temp one.
-    struct sm_object *s = (struct sm_object *)o;
-
-    if (s->data.pressures.n2o_tank_pressure <=
-            s->config->filling_sm_config.fill_n2o.target_n2o_tank_pressure ||
-        s->data.thermocouples.n2o_tank_uf_t1 <=
-            s->config->filling_sm_config.fill_n2o.trigger_n2o_tank_temperature)
-    {
-        SET_FILL_STATE(s, FILL_N2O_FILL);
-    }
-}
-
 void fill_n2o_vent_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -436,11 +247,6 @@ void post_press_entry(void *o)
     close_all_valves(s);
 }
 
-void post_press_run(void *o)
-{
-    ARG_UNUSED(o);
-}
-
 void post_press_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -456,23 +262,6 @@ void post_press_idle_entry(void *o)
     close_all_valves(s);
 }
 
-void post_press_idle_run(void *o)
-{
-    // Transition to vent or fill based on pressure.
-    struct sm_object *s = (struct sm_object *)o;
-
-    if (s->data.pressures.n2o_tank_pressure >
-        s->config->filling_sm_config.post_press.trigger_n2o_tank_pressure)
-    {
-        SET_FILL_STATE(s, POST_PRESS_VENT);
-    }
-    else if (s->data.pressures.n2o_tank_pressure <
-             s->config->filling_sm_config.post_press.target_n2o_tank_pressure)
-    {
-        SET_FILL_STATE(s, POST_PRESS_FILL_N2);
-    }
-}
-
 void post_press_idle_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -488,18 +277,6 @@ void post_press_fill_entry(void *o)
     open_single_valve(s, VALVE_N2_FILL);
 }
 
-void post_press_fill_run(void *o)
-{
-    // Transition to idle when pressure reaches target.
-    struct sm_object *s = (struct sm_object *)o;
-
-    if (s->data.pressures.n2o_tank_pressure >=
-        s->config->filling_sm_config.post_press.target_n2o_tank_pressure)
-    {
-        SET_FILL_STATE(s, POST_PRESS_IDLE);
-    }
-}
-
 void post_press_fill_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -515,18 +292,6 @@ void post_press_vent_entry(void *o)
     open_single_valve(s, VALVE_VENT);
 }
 
-void post_press_vent_run(void *o)
-{
-    // Transition to idle when pressure is safe.
-    struct sm_object *s = (struct sm_object *)o;
-
-    if (s->data.pressures.n2o_tank_pressure <=
-        s->config->filling_sm_config.post_press.target_n2o_tank_pressure)
-    {
-        SET_FILL_STATE(s, POST_PRESS_IDLE);
-    }
-}
-
 void post_press_vent_exit(void *o)
 {
     ARG_UNUSED(o);
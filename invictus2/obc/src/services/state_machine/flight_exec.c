@@ -0,0 +1,108 @@
+#include "services/state_machine/flight_exec.h"
+#include "services/health.h"
+#include "services/supervisor.h"
+#include "chan_stats.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/zbus/zbus.h>
+
+LOG_MODULE_DECLARE(state_machine_service);
+
+ZBUS_CHAN_DECLARE(chan_navigator_sensors, chan_kalman_data);
+
+K_THREAD_STACK_DEFINE(flight_exec_stack, CONFIG_SM_FLIGHT_EXEC_STACK_SIZE);
+static struct k_thread flight_exec_thread;
+
+K_SEM_DEFINE(flight_exec_sem, 0, 1);
+K_TIMER_DEFINE(flight_exec_timer, NULL, NULL);
+
+static struct flight_exec_stats stats;
+
+// Only watched in flight mode, a stall in ARMED aborts and in FLIGHT resets the board
+static const struct supervisor_watch flight_exec_watch = {
+    .deadline_ms = CONFIG_SUPERVISOR_FLIGHT_EXEC_DEADLINE_MSEC,
+    .force_safe = true,
+    .flight_critical = true,
+};
+
+static void flight_exec_tick(void)
+{
+    navigator_sample_t navigator;
+    kalman_sample_t kalman;
+
+    const uint32_t start = k_cycle_get_32();
+
+    // Never wait on a publisher, the previous sample is good enough for one period
+    if (chan_stats_read(&chan_navigator_sensors, &navigator, K_NO_WAIT) != 0 ||
+        chan_stats_read(&chan_kalman_data, &kalman, K_NO_WAIT) != 0)
+    {
+        LOG_WRN_ONCE("Flight data channels busy, running on previous samples");
+        sm_flight_step(NULL, NULL);
+    }
+    else
+    {
+        sm_flight_step(&navigator.sensors, &kalman.kalman);
+    }
+
+    const uint32_t elapsed_us = k_cyc_to_us_ceil32(k_cycle_get_32() - start);
+    stats.runs++;
+    stats.last_us = elapsed_us;
+    stats.max_us = MAX(stats.max_us, elapsed_us);
+}
+
+static void flight_exec_entry(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    while (true)
+    {
+        k_sem_take(&flight_exec_sem, K_FOREVER);
+        LOG_INF("Flight executor running every %d ms", CONFIG_SM_FLIGHT_EXEC_PERIOD_MSEC);
+
+        supervisor_watch_thread(HEALTH_FLIGHT_EXEC, &flight_exec_watch);
+        k_timer_start(&flight_exec_timer, K_NO_WAIT, K_MSEC(CONFIG_SM_FLIGHT_EXEC_PERIOD_MSEC));
+
+        while (sm_flight_mode())
+        {
+            const uint32_t periods = k_timer_status_sync(&flight_exec_timer);
+            if (periods > 1)
+            {
+                stats.overruns += periods - 1;
+            }
+
+            flight_exec_tick();
+            supervisor_heartbeat(HEALTH_FLIGHT_EXEC);
+        }
+
+        k_timer_stop(&flight_exec_timer);
+        supervisor_watch_thread(HEALTH_FLIGHT_EXEC, NULL);
+        LOG_INF("Flight executor stopped: %u runs, WCET %u us, %u overruns", stats.runs,
+                stats.max_us, stats.overruns);
+    }
+}
+
+void flight_exec_init(void)
+{
+    k_tid_t tid = k_thread_create(&flight_exec_thread, flight_exec_stack,
+                                  K_THREAD_STACK_SIZEOF(flight_exec_stack), flight_exec_entry,
+                                  NULL, NULL, NULL,
+                                  K_PRIO_COOP(CONFIG_SM_FLIGHT_EXEC_PRIO), 0, K_NO_WAIT);
+    k_thread_name_set(tid, "flight_exec");
+    health_register_thread(HEALTH_FLIGHT_EXEC, tid);
+}
+
+void flight_exec_resume(void)
+{
+    k_sem_give(&flight_exec_sem);
+}
+
+void flight_exec_get_stats(struct flight_exec_stats *out)
+{
+    // The executor preempts any caller, keep it out while copying
+    unsigned int key = irq_lock();
+    *out = stats;
+    irq_unlock(key);
+}
@@ -8,8 +8,6 @@
 
 LOG_MODULE_DECLARE(state_machine_service);
 
-#define SET_FLIGHT_STATE(s, st) SET_STATE(s, FLIGHT_SST(st))
-
 // Helper functions
 
 #define BOOST_TIME_MS 4000 // FIXME: Make KConfig
@@ -53,16 +51,6 @@ void ignition_entry(void *o)
     s->state_data.flight_state = IGNITION;
 }
 
-void ignition_run(void *o)
-{
-    struct sm_object *s = (struct sm_object *)o;
-    if (s->data.thermocouples.chamber_thermo >
-        s->config->flight_sm_config.min_chamber_launch_temp)
-    {
-        SET_FLIGHT_STATE(s, BOOST);
-    }
-}
-
 void ignition_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -78,28 +66,27 @@ void boost_entry(void *o)
     boost_timer_start();
 }
 
-void boost_run(void *o)
+bool boost_timer_done(const struct sm_object *s)
 {
-    struct sm_object *s = (struct sm_object *)o;
-
-    if (boost_timer_expired || boost_timer_cancelled)
+    if (!boost_timer_expired && !boost_timer_cancelled)
     {
+        return false;
+    }
 
-        int16_t kalman_vs = s->data.kalman.vertical_speed;
-        int16_t config_vs = s->config->flight_sm_config.boost_vertical_speed;
-        if (kalman_vs >= config_vs)
-        {
-            LOG_WRN("Boost timer expired. Vertical speed is higher than expected: %d >= %d ",
-                    kalman_vs, config_vs);
-        }
-
-        if (boost_timer_cancelled)
-        {
-            LOG_WRN("Boost timer cancelled, transitioning to COAST");
-        }
+    int16_t kalman_vs = s->data.kalman.vertical_speed;
+    int16_t config_vs = s->config ? s->config->flight_sm_config.boost_vertical_speed : 0;
+    if (s->config && kalman_vs >= config_vs)
+    {
+        LOG_WRN("Boost timer expired. Vertical speed is higher than expected: %d >= %d ",
+                kalman_vs, config_vs);
+    }
 
-        SET_FLIGHT_STATE(s, COAST);
+    if (boost_timer_cancelled)
+    {
+        LOG_WRN("Boost timer cancelled, transitioning to COAST");
     }
+
+    return true;
 }
 
 void boost_exit(void *o)
@@ -116,16 +103,6 @@ void coast_entry(void *o)
     s->state_data.flight_state = COAST;
 }
 
-void coast_run(void *o)
-{
-    struct sm_object *s = (struct sm_object *)o;
-    // Transition to APOGEE when vertical speed drops below threshold.
-    if (s->data.kalman.vertical_speed < s->config->flight_sm_config.coast_vertical_speed)
-    {
-        SET_FLIGHT_STATE(s, APOGEE);
-    }
-}
-
 void coast_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -140,14 +117,9 @@ void apogee_entry(void *o)
     s->state_data.flight_state = APOGEE;
 }
 
-void apogee_run(void *o)
+bool drogue_ematch_fired(const struct sm_object *s)
 {
-    struct sm_object *s = (struct sm_object *)o;
-    // Transition to DROGUE_CHUTE when ematch is fired.
-    if (s->data.actuators.ematch_drogue == 1)
-    {
-        SET_FLIGHT_STATE(s, DROGUE_CHUTE);
-    }
+    return s->data.actuators.ematch_drogue == 1;
 }
 
 void apogee_exit(void *o)
@@ -164,16 +136,6 @@ void drogue_chute_entry(void *o)
     s->state_data.flight_state = DROGUE_CHUTE;
 }
 
-void drogue_chute_run(void *o)
-{
-    struct sm_object *s = (struct sm_object *)o;
-    // Transition to MAIN_CHUTE when altitude drops below threshold.
-    if (s->data.kalman.altitude < s->config->flight_sm_config.main_chute_deploy_altitude)
-    {
-        SET_FLIGHT_STATE(s, MAIN_CHUTE);
-    }
-}
-
 void drogue_chute_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -188,16 +150,6 @@ void main_chute_entry(void *o)
     s->state_data.flight_state = MAIN_CHUTE;
 }
 
-void main_chute_run(void *o)
-{
-    struct sm_object *s = (struct sm_object *)o;
-    // Transition to TOUCHDOWN when altitude drops below threshold.
-    if (s->data.kalman.altitude < s->config->flight_sm_config.touchdown_altitude)
-    {
-        SET_FLIGHT_STATE(s, TOUCHDOWN);
-    }
-}
-
 void main_chute_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -212,11 +164,6 @@ void touchdown_entry(void *o)
     s->state_data.flight_state = TOUCHDOWN;
 }
 
-void touchdown_run(void *o)
-{
-    ARG_UNUSED(o);
-}
-
 void touchdown_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -1,6 +1,7 @@
 #include "services/state_machine/main_sm.h"
 #include "services/state_machine/filling_sm.h"
 #include "services/state_machine/flight_sm.h"
+#include "services/state_machine/sm_table.h"
 
 #include "data_models.h"
 
@@ -80,33 +81,6 @@ static void root_entry(void *o)
     s->state_data.flight_state = _FLIGHT_SST_START;
 }
 
-static void root_run(void *o)
-{
-    struct sm_object *s = (struct sm_object *)o;
-
-    command_t cmd = s->command;
-    if (!cmd)
-    {
-        return;
-    }
-
-    switch (cmd)
-    {
-    case CMD_STOP:
-        smf_set_state(SMF_CTX(s), &states[IDLE]);
-        break;
-
-    case CMD_ABORT:
-        smf_set_state(SMF_CTX(s), &states[ABORT]);
-        break;
-    default:
-        // Unknown global command
-        ;
-    }
-
-    cmd = 0;
-}
-
 static void root_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -123,29 +97,6 @@ static void idle_entry(void *o)
     s->state_data.main_state = IDLE;
 }
 
-static void idle_run(void *o)
-{
-    struct sm_object *s = (struct sm_object *)o;
-
-    command_t cmd = s->command;
-    if (!cmd)
-    {
-        return;
-    }
-
-    switch (cmd)
-    {
-    case CMD_FILL_EXEC:
-        smf_set_state(SMF_CTX(s), &states[FILL]);
-        break;
-    case CMD_READY:
-        smf_set_state(SMF_CTX(s), &states[READY]);
-        break;
-    default:
-        smf_set_handled(SMF_CTX(s));
-    }
-}
-
 static void idle_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -162,35 +113,6 @@ static void fill_entry(void *o)
     s->state_data.main_state = FILL;
 }
 
-static void fill_run(void *o)
-{
-    struct sm_object *s = (struct sm_object *)o;
-
-    fill_command_t cmd = s->fill_command;
-    if (!cmd)
-    {
-        return;
-    }
-
-    switch (cmd)
-    {
-    case CMD_FILL_N2:
-        smf_set_state(SMF_CTX(s), &states[FILL_SST(FILL_N2)]);
-        break;
-    case CMD_FILL_PRE_PRESS:
-        smf_set_state(SMF_CTX(s), &states[FILL_SST(PRE_PRESS)]);
-        break;
-    case CMD_FILL_N2O:
-        smf_set_state(SMF_CTX(s), &states[FILL_SST(FILL_N2O)]);
-        break;
-    case CMD_FILL_POST_PRESS:
-        smf_set_state(SMF_CTX(s), &states[FILL_SST(POST_PRESS)]);
-        break;
-    default:
-        smf_set_handled(SMF_CTX(s));
-    }
-}
-
 static void fill_exit(void *o)
 {
     struct sm_object *s = (struct sm_object *)o;
@@ -207,29 +129,6 @@ static void ready_entry(void *o)
     s->state_data.main_state = READY;
 }
 
-static void ready_run(void *o)
-{
-    struct sm_object *s = (struct sm_object *)o;
-
-    command_t cmd = s->command;
-    if (!cmd)
-    {
-        return;
-    }
-
-    switch (cmd)
-    {
-    case CMD_ARM:
-        smf_set_state(SMF_CTX(s), &states[ARMED]);
-        break;
-    case CMD_ABORT:
-        smf_set_state(SMF_CTX(s), &states[ABORT]);
-        break;
-    default:
-        smf_set_handled(SMF_CTX(s));
-    }
-}
-
 static void ready_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -245,36 +144,6 @@ static void armed_entry(void *o)
     s->state_data.main_state = ARMED;
 }
 
-static void armed_run(void *o)
-{
-    struct sm_object *s = (struct sm_object *)o;
-
-    command_t cmd = s->command;
-    if (!cmd)
-    {
-        return;
-    }
-
-    switch (cmd)
-    {
-    case CMD_FIRE:
-        if (s->data.thermocouples.chamber_thermo >
-            s->config->flight_sm_config.min_chamber_launch_temp)
-        {
-            // Chamber temperature is above minimum
-        }
-        else
-        {
-            smf_set_handled(SMF_CTX(s));
-            break;
-        }
-        smf_set_state(SMF_CTX(s), &states[FLIGHT]);
-        break;
-    default:
-        smf_set_handled(SMF_CTX(s));
-    }
-}
-
 static void armed_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -290,27 +159,6 @@ static void flight_entry(void *o)
     s->state_data.main_state = FLIGHT;
 }
 
-static void flight_run(void *o)
-{
-    struct sm_object *s = (struct sm_object *)o;
-    command_t cmd = s->command;
-    if (!cmd)
-    {
-        return;
-    }
-    switch (cmd)
-    {
-    case CMD_LAUNCH_OVERRIDE:
-        // Handle launch override if necessary
-        break;
-    case CMD_ABORT:
-        smf_set_state(SMF_CTX(s), &states[ABORT]);
-        break;
-    default:
-        smf_set_handled(SMF_CTX(s));
-    }
-}
-
 static void flight_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -331,29 +179,6 @@ static void abort_entry(void *o)
     s->state_data.main_state = ABORT;
 }
 
-static void abort_run(void *o)
-{
-    struct sm_object *s = (struct sm_object *)o;
-
-    command_t cmd = s->command;
-    if (!cmd)
-    {
-        return;
-    }
-
-    switch (cmd)
-    {
-    case CMD_READY:
-        smf_set_state(SMF_CTX(s), &states[IDLE]);
-        break;
-    case CMD_STOP:
-        smf_set_state(SMF_CTX(s), &states[IDLE]);
-        break;
-    default:
-        smf_set_handled(SMF_CTX(s));
-    }
-}
-
 static void abort_exit(void *o)
 {
     ARG_UNUSED(o);
@@ -365,50 +190,53 @@ static void abort_exit(void *o)
 
 const struct smf_state states[] = {
     // clang-format off
-    [ROOT]   = SMF_CREATE_STATE(root_entry, root_run, root_exit, NULL, &states[IDLE]),
-
-    [IDLE]   = SMF_CREATE_STATE(idle_entry, idle_run, idle_exit, &states[ROOT], NULL),
-    [ABORT]  = SMF_CREATE_STATE(abort_entry, abort_run, abort_exit,&states[ROOT], NULL),
-    [FILL]   = SMF_CREATE_STATE(fill_entry, fill_run, fill_exit, &states[ROOT], &states[FILL_SST(SAFE_PAUSE)]),
-    [READY]  = SMF_CREATE_STATE(ready_entry, ready_run, ready_exit, &states[ROOT], NULL),
-    [ARMED]  = SMF_CREATE_STATE(armed_entry, armed_run, armed_exit, &states[ROOT], NULL),
-    [FLIGHT] = SMF_CREATE_STATE(flight_entry, flight_run, flight_exit, &states[ROOT], NULL),
-
-    [FILL_SST(SAFE_PAUSE)]      = SMF_CREATE_STATE(safe_pause_entry, safe_pause_run, safe_pause_exit, &states[FILL], &states[FILL_SST(SAFE_PAUSE_IDLE)]),
-    [FILL_SST(SAFE_PAUSE_IDLE)] = SMF_CREATE_STATE(safe_pause_idle_entry, safe_pause_idle_run, safe_pause_idle_exit, &states[FILL_SST(SAFE_PAUSE)], NULL),
-    [FILL_SST(SAFE_PAUSE_VENT)] = SMF_CREATE_STATE(safe_pause_vent_entry, safe_pause_vent_run, safe_pause_vent_exit, &states[FILL_SST(SAFE_PAUSE)], NULL),
-
-    [FILL_SST(FILL_N2)]      = SMF_CREATE_STATE(fill_n2_entry, fill_n2_run, fill_n2_exit, &states[FILL], &states[FILL_SST(FILL_N2_IDLE)]),
-    [FILL_SST(FILL_N2_IDLE)] = SMF_CREATE_STATE(fill_n2_idle_entry, fill_n2_idle_run, fill_n2_idle_exit, &states[FILL_SST(FILL)], NULL),
-    [FILL_SST(FILL_N2_FILL)] = SMF_CREATE_STATE(fill_n2_fill_entry, fill_n2_fill_run, fill_n2_fill_exit, &states[FILL_SST(FILL)], NULL),
-    [FILL_SST(FILL_N2_VENT)] = SMF_CREATE_STATE(fill_n2_vent_entry, fill_n2_vent_run, fill_n2_vent_exit, &states[FILL_SST(FILL)], NULL),
-
-    [FILL_SST(PRE_PRESS)]         = SMF_CREATE_STATE(pre_press_entry, pre_press_run, pre_press_exit, &states[FILL], &states[FILL_SST(PRE_PRESS_IDLE)]),
-    [FILL_SST(PRE_PRESS_IDLE)]    = SMF_CREATE_STATE(pre_press_idle_entry, pre_press_idle_run, pre_press_idle_exit, &states[FILL_SST(PRE_PRESS)], NULL),
-    [FILL_SST(PRE_PRESS_FILL_N2)] = SMF_CREATE_STATE(pre_press_fill_entry, pre_press_fill_run, pre_press_fill_exit, &states[FILL_SST(PRE_PRESS)], NULL),
-    [FILL_SST(PRE_PRESS_VENT)]    = SMF_CREATE_STATE(pre_press_vent_entry, pre_press_vent_run, pre_press_vent_exit, &states[FILL_SST(PRE_PRESS)], NULL),
-
-    [FILL_SST(FILL_N2O)]      = SMF_CREATE_STATE(fill_n2o_entry, fill_n2o_run, fill_n2o_exit, &states[FILL], &states[FILL_SST(FILL_N2O_IDLE)]),
-    [FILL_SST(FILL_N2O_IDLE)] = SMF_CREATE_STATE(fill_n2o_idle_entry, fill_n2o_idle_run, fill_n2o_idle_exit, &states[FILL_SST(FILL_N2O)], NULL),
-    [FILL_SST(FILL_N2O_FILL)] = SMF_CREATE_STATE(fill_n2o_fill_entry, fill_n2o_fill_run, fill_n2o_fill_exit, &states[FILL_SST(FILL_N2O)], NULL),
-    [FILL_SST(FILL_N2O_VENT)] = SMF_CREATE_STATE(fill_n2o_vent_entry, fill_n2o_vent_run, fill_n2o_vent_exit, &states[FILL_SST(FILL_N2O)], NULL),
-
-    [FILL_SST(POST_PRESS)]         = SMF_CREATE_STATE(post_press_entry, post_press_run, post_press_exit, &states[FILL], &states[FILL_SST(POST_PRESS_IDLE)]),
-    [FILL_SST(POST_PRESS_IDLE)]    = SMF_CREATE_STATE(post_press_idle_entry, post_press_idle_run, post_press_idle_exit, &states[FILL_SST(POST_PRESS)], NULL),
-    [FILL_SST(POST_PRESS_FILL_N2)] = SMF_CREATE_STATE(post_press_fill_entry, post_press_fill_run, post_press_fill_exit, &states[FILL_SST(POST_PRESS)], NULL),
-    [FILL_SST(POST_PRESS_VENT)]    = SMF_CREATE_STATE(post_press_vent_entry, post_press_vent_run, post_press_vent_exit, &states[FILL_SST(POST_PRESS)], NULL),
-
-    [FLIGHT_SST(IGNITION)]     = SMF_CREATE_STATE(ignition_entry, ignition_run, ignition_exit, &states[FLIGHT], NULL),
-    [FLIGHT_SST(BOOST)]        = SMF_CREATE_STATE(boost_entry, boost_run, boost_exit, &states[FLIGHT], NULL),
-    [FLIGHT_SST(COAST)]        = SMF_CREATE_STATE(coast_entry, coast_run, coast_exit, &states[FLIGHT], NULL),
-    [FLIGHT_SST(APOGEE)]       = SMF_CREATE_STATE(apogee_entry, apogee_run, apogee_exit, &states[FLIGHT], NULL),
-    [FLIGHT_SST(DROGUE_CHUTE)] = SMF_CREATE_STATE(drogue_chute_entry, drogue_chute_run, drogue_chute_exit, &states[FLIGHT], NULL),
-    [FLIGHT_SST(MAIN_CHUTE)]   = SMF_CREATE_STATE(main_chute_entry, main_chute_run, main_chute_exit, &states[FLIGHT], NULL),
-    [FLIGHT_SST(TOUCHDOWN)]    = SMF_CREATE_STATE(touchdown_entry, touchdown_run, touchdown_exit, &states[FLIGHT], NULL),
+    [ROOT]   = SMF_CREATE_STATE(root_entry, sm_table_run, root_exit, NULL, &states[IDLE]),
+
+    [IDLE]   = SMF_CREATE_STATE(idle_entry, sm_table_run, idle_exit, &states[ROOT], NULL),
+    [ABORT]  = SMF_CREATE_STATE(abort_entry, sm_table_run, abort_exit, &states[ROOT], NULL),
+    [FILL]   = SMF_CREATE_STATE(fill_entry, sm_table_run, fill_exit, &states[ROOT], &states[FILL_SST(SAFE_PAUSE)]),
+    [READY]  = SMF_CREATE_STATE(ready_entry, sm_table_run, ready_exit, &states[ROOT], NULL),
+    [ARMED]  = SMF_CREATE_STATE(armed_entry, sm_table_run, armed_exit, &states[ROOT], NULL),
+    [FLIGHT] = SMF_CREATE_STATE(flight_entry, sm_table_run, flight_exit, &states[ROOT], &states[FLIGHT_SST(IGNITION)]),
+
+    [FILL_SST(SAFE_PAUSE)]      = SMF_CREATE_STATE(safe_pause_entry, sm_table_run, safe_pause_exit, &states[FILL], &states[FILL_SST(SAFE_PAUSE_IDLE)]),
+    [FILL_SST(SAFE_PAUSE_IDLE)] = SMF_CREATE_STATE(safe_pause_idle_entry, sm_table_run, safe_pause_idle_exit, &states[FILL_SST(SAFE_PAUSE)], NULL),
+    [FILL_SST(SAFE_PAUSE_VENT)] = SMF_CREATE_STATE(safe_pause_vent_entry, sm_table_run, safe_pause_vent_exit, &states[FILL_SST(SAFE_PAUSE)], NULL),
+
+    [FILL_SST(FILL_N2)]      = SMF_CREATE_STATE(fill_n2_entry, sm_table_run, fill_n2_exit, &states[FILL], &states[FILL_SST(FILL_N2_IDLE)]),
+    [FILL_SST(FILL_N2_IDLE)] = SMF_CREATE_STATE(fill_n2_idle_entry, sm_table_run, fill_n2_idle_exit, &states[FILL_SST(FILL_N2)], NULL),
+    [FILL_SST(FILL_N2_FILL)] = SMF_CREATE_STATE(fill_n2_fill_entry, sm_table_run, fill_n2_fill_exit, &states[FILL_SST(FILL_N2)], NULL),
+    [FILL_SST(FILL_N2_VENT)] = SMF_CREATE_STATE(fill_n2_vent_entry, sm_table_run, fill_n2_vent_exit, &states[FILL_SST(FILL_N2)], NULL),
+
+    [FILL_SST(PRE_PRESS)]         = SMF_CREATE_STATE(pre_press_entry, sm_table_run, pre_press_exit, &states[FILL], &states[FILL_SST(PRE_PRESS_IDLE)]),
+    [FILL_SST(PRE_PRESS_IDLE)]    = SMF_CREATE_STATE(pre_press_idle_entry, sm_table_run, pre_press_idle_exit, &states[FILL_SST(PRE_PRESS)], NULL),
+    [FILL_SST(PRE_PRESS_FILL_N2)] = SMF_CREATE_STATE(pre_press_fill_entry, sm_table_run, pre_press_fill_exit, &states[FILL_SST(PRE_PRESS)], NULL),
+    [FILL_SST(PRE_PRESS_VENT)]    = SMF_CREATE_STATE(pre_press_vent_entry, sm_table_run, pre_press_vent_exit, &states[FILL_SST(PRE_PRESS)], NULL),
+
+    [FILL_SST(FILL_N2O)]      = SMF_CREATE_STATE(fill_n2o_entry, sm_table_run, fill_n2o_exit, &states[FILL], &states[FILL_SST(FILL_N2O_IDLE)]),
+    [FILL_SST(FILL_N2O_IDLE)] = SMF_CREATE_STATE(fill_n2o_idle_entry, sm_table_run, fill_n2o_idle_exit, &states[FILL_SST(FILL_N2O)], NULL),
+    [FILL_SST(FILL_N2O_FILL)] = SMF_CREATE_STATE(fill_n2o_fill_entry, sm_table_run, fill_n2o_fill_exit, &states[FILL_SST(FILL_N2O)], NULL),
+    [FILL_SST(FILL_N2O_VENT)] = SMF_CREATE_STATE(fill_n2o_vent_entry, sm_table_run, fill_n2o_vent_exit, &states[FILL_SST(FILL_N2O)], NULL),
+
+    [FILL_SST(POST_PRESS)]         = SMF_CREATE_STATE(post_press_entry, sm_table_run, post_press_exit, &states[FILL], &states[FILL_SST(POST_PRESS_IDLE)]),
+    [FILL_SST(POST_PRESS_IDLE)]    = SMF_CREATE_STATE(post_press_idle_entry, sm_table_run, post_press_idle_exit, &states[FILL_SST(POST_PRESS)], NULL),
+    [FILL_SST(POST_PRESS_FILL_N2)] = SMF_CREATE_STATE(post_press_fill_entry, sm_table_run, post_press_fill_exit, &states[FILL_SST(POST_PRESS)], NULL),
+    [FILL_SST(POST_PRESS_VENT)]    = SMF_CREATE_STATE(post_press_vent_entry, sm_table_run, post_press_vent_exit, &states[FILL_SST(POST_PRESS)], NULL),
+
+    [FLIGHT_SST(IGNITION)]     = SMF_CREATE_STATE(ignition_entry, sm_table_run, ignition_exit, &states[FLIGHT], NULL),
+    [FLIGHT_SST(BOOST)]        = SMF_CREATE_STATE(boost_entry, sm_table_run, boost_exit, &states[FLIGHT], NULL),
+    [FLIGHT_SST(COAST)]        = SMF_CREATE_STATE(coast_entry, sm_table_run, coast_exit, &states[FLIGHT], NULL),
+    [FLIGHT_SST(APOGEE)]       = SMF_CREATE_STATE(apogee_entry, sm_table_run, apogee_exit, &states[FLIGHT], NULL),
+    [FLIGHT_SST(DROGUE_CHUTE)] = SMF_CREATE_STATE(drogue_chute_entry, sm_table_run, drogue_chute_exit, &states[FLIGHT], NULL),
+    [FLIGHT_SST(MAIN_CHUTE)]   = SMF_CREATE_STATE(main_chute_entry, sm_table_run, main_chute_exit, &states[FLIGHT], NULL),
+    [FLIGHT_SST(TOUCHDOWN)]    = SMF_CREATE_STATE(touchdown_entry, sm_table_run, touchdown_exit, &states[FLIGHT], NULL),
     // clang-format on
 };
 
-void sm_init(struct sm_object *initial_s_obj)
+BUILD_ASSERT(ARRAY_SIZE(states) == SM_STATE_COUNT, "sm_transitions[] must cover every state");
+
+void sm_init(struct sm_object *initial_s_obj, struct sm_config *config)
 {
+    initial_s_obj->config = config;
     smf_set_initial(SMF_CTX(initial_s_obj), &states[ROOT]);
 }
@@ -0,0 +1,35 @@
+#include "services/state_machine/sm_intake.h"
+
+bool sm_intake_put(struct sm_intake *intake, const void *msg)
+{
+    if (k_msgq_put(intake->queue, msg, K_NO_WAIT) == 0)
+    {
+        return true;
+    }
+
+    atomic_inc(&intake->dropped);
+
+    if (!intake->latest_only)
+    {
+        return false;
+    }
+
+    // Single producer, once purged there is room
+    k_msgq_purge(intake->queue);
+    return k_msgq_put(intake->queue, msg, K_NO_WAIT) == 0;
+}
+
+bool sm_intake_get(struct sm_intake *intake, void *msg)
+{
+    return k_msgq_get(intake->queue, msg, K_NO_WAIT) == 0;
+}
+
+bool sm_intake_pending(struct sm_intake *intake)
+{
+    return k_msgq_num_used_get(intake->queue) > 0;
+}
+
+uint32_t sm_intake_dropped(struct sm_intake *intake)
+{
+    return (uint32_t)atomic_get(&intake->dropped);
+}
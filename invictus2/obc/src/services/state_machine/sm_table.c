@@ -0,0 +1,206 @@
+#include "services/state_machine/sm_table.h"
+#include "services/state_machine/main_sm.h"
+
+#include <zephyr/logging/log.h>
+#include <zephyr/smf.h>
+#include <zephyr/sys/util.h>
+
+#include <stddef.h>
+#include <string.h>
+
+LOG_MODULE_DECLARE(state_machine_service);
+
+static int32_t load_field(const void *base, const uint16_t offset, const bool is_signed)
+{
+    const uint8_t *field = (const uint8_t *)base + offset;
+    return is_signed ? *(const int16_t *)field : *(const uint16_t *)field;
+}
+
+// Part of system_data_t a guard reads, 0 if none of them
+static uint8_t guard_source(const struct sm_guard *guard)
+{
+#define SOURCE(member, src)                                                                   \
+    {offsetof(system_data_t, member), sizeof(((system_data_t *)0)->member), (src)}
+    static const struct
+    {
+        uint16_t offset;
+        uint16_t size;
+        uint8_t source;
+    } sources[] = {
+        SOURCE(pressures, SM_SRC_PRESSURES),
+        SOURCE(thermocouples, SM_SRC_THERMOCOUPLES),
+        SOURCE(loadcells, SM_SRC_LOADCELLS),
+        SOURCE(navigator, SM_SRC_NAVIGATOR),
+        SOURCE(kalman, SM_SRC_KALMAN),
+    };
+#undef SOURCE
+
+    for (size_t i = 0; i < ARRAY_SIZE(sources); i++)
+    {
+        if ((uint16_t)(guard->data_offset - sources[i].offset) < sources[i].size)
+        {
+            return sources[i].source;
+        }
+    }
+
+    return 0;
+}
+
+static bool guard_holds(const struct sm_object *s, const struct sm_guard *guard)
+{
+    const int32_t value = load_field(&s->data, guard->data_offset, guard->data_signed);
+    const int32_t limit = load_field(s->config, guard->config_offset, guard->config_signed);
+
+    if (value == THERMO_INVALID && guard_source(guard) == SM_SRC_THERMOCOUPLES)
+    {
+        return guard->if_valid;
+    }
+
+    switch ((enum sm_cmp)guard->cmp)
+    {
+    case SM_LT:
+        return value < limit - guard->band;
+    case SM_LE:
+        return value <= limit - guard->band;
+    case SM_GT:
+        return value > limit + guard->band;
+    case SM_GE:
+        return value >= limit + guard->band;
+    default:
+        return false;
+    }
+}
+
+bool sm_table_row_matches(const struct sm_object *s, const struct sm_transition *row)
+{
+    if (row->command != 0 && row->command != s->command)
+    {
+        return false;
+    }
+
+    if (row->fill_command != 0 && row->fill_command != s->fill_command)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < SM_MAX_GUARDS && row->guards[i].cmp != SM_CMP_NONE; i++)
+    {
+        // Thresholds are meaningless without a configuration, never fire on them
+        if (s->config == NULL || !guard_holds(s, &row->guards[i]))
+        {
+            return false;
+        }
+    }
+
+    return row->check == NULL || row->check(s);
+}
+
+// Restart dwell time and confirmation histories whenever the active state changed
+static void track_active_state(struct sm_object *s)
+{
+    struct sm_table_ctx *table = &s->table;
+
+    if (table->state != SMF_CTX(s)->current)
+    {
+        table->state = SMF_CTX(s)->current;
+        table->entered_ms = s->now_ms;
+        memset(table->history, 0, sizeof(table->history));
+    }
+}
+
+// Record this run's result of a guard only row if the run carries a new sample of a field
+// it reads, returns whether the row is confirmed
+static bool confirm_row(struct sm_object *s, const struct sm_transition *row, int *slot,
+                        bool holds)
+{
+    if (row->confirm_m == 0)
+    {
+        return holds;
+    }
+
+    if (*slot >= SM_TABLE_MAX_GUARD_ROWS)
+    {
+        LOG_WRN_ONCE("Too many confirmed rows, increase SM_TABLE_MAX_GUARD_ROWS");
+        return holds;
+    }
+
+    uint8_t sources = 0;
+    for (int i = 0; i < SM_MAX_GUARDS && row->guards[i].cmp != SM_CMP_NONE; i++)
+    {
+        sources |= guard_source(&row->guards[i]);
+    }
+
+    // Another run on the same samples would only count the same reading again
+    uint8_t *history = &s->table.history[(*slot)++];
+    if (sources == 0 || (sources & s->fresh) != 0)
+    {
+        *history = (uint8_t)((*history << 1) | holds);
+    }
+
+    return __builtin_popcount(*history & BIT_MASK(row->confirm_m)) >= row->confirm_n;
+}
+
+// Walk the active state and its ancestors, firing the first matching row of one kind
+static bool run_rows(struct sm_object *s, const bool commands)
+{
+    const uint32_t dwell_ms = s->now_ms - s->table.entered_ms;
+    int slot = 0;
+
+    for (const struct smf_state *state = SMF_CTX(s)->current; state != NULL;
+         state = state->parent)
+    {
+        const int index = state - states;
+        const struct sm_state_rows *entry = &sm_transitions[index];
+
+        for (int i = 0; i < entry->count; i++)
+        {
+            const struct sm_transition *row = &entry->rows[i];
+            if ((row->command != 0) != commands)
+            {
+                continue;
+            }
+
+            bool fire = sm_table_row_matches(s, row);
+            if (!commands)
+            {
+                // Every sample counts towards confirmation, dwell only holds the transition
+                fire = confirm_row(s, row, &slot, fire) && dwell_ms >= row->min_dwell_ms;
+            }
+
+            if (!fire)
+            {
+                continue;
+            }
+
+            LOG_DBG("State %d: row %d -> state %d", index, i, row->target);
+            smf_set_state(SMF_CTX(s), &states[row->target]);
+            return true;
+        }
+
+        if (commands && entry->absorb)
+        {
+            LOG_WRN("Unexpected command in state %d: %d", index, s->command);
+            return false;
+        }
+    }
+
+    return false;
+}
+
+void sm_table_run(void *o)
+{
+    struct sm_object *s = (struct sm_object *)o;
+
+    track_active_state(s);
+
+    // Commands first, so a threshold crossing on the same step can never swallow an abort
+    if (s->command == 0 || !run_rows(s, true))
+    {
+        run_rows(s, false);
+    }
+
+    track_active_state(s);
+
+    // SMF would call this again for every ancestor, they were already evaluated above
+    smf_set_handled(SMF_CTX(s));
+}
@@ -0,0 +1,173 @@
+#include "services/state_machine/sm_table.h"
+#include "services/state_machine/flight_sm.h"
+
+#include "data_models.h"
+#include "packets.h"
+
+/* ===================================================================== */
+/* Transition tables, one entry per state with outgoing transitions.     */
+/* Rows are evaluated in order, the first one that fires wins.           */
+/* ===================================================================== */
+
+#define FILL_CFG(field)   filling_sm_config.field
+#define FLIGHT_CFG(field) flight_sm_config.field
+
+#define N2O_TANK_P   pressures.n2o_tank_pressure
+#define N2_LINE_P    pressures.n2_line_pressure
+#define N2O_TANK_W   loadcells.n2o_loadcell
+#define N2O_TANK_T   thermocouples.n2o_tank_uf_t1 // FIXME: should be the minimum temperature
+#define CHAMBER_T    thermocouples.chamber_thermo
+
+// Filling thresholds come from noisy transducers, see the debouncing notes in sm_table.h
+#define FILL_WHEN(tgt, ...)                                                                   \
+    SM_WHEN_CONFIRMED(tgt, CONFIG_SM_FILL_CONFIRM_SAMPLES, CONFIG_SM_FILL_CONFIRM_WINDOW,     \
+                      __VA_ARGS__)
+// Rows reopening a fill valve, held until the idle state settled. Vent rows are not held.
+#define FILL_AFTER_DWELL(tgt, ...)                                                            \
+    SM_WHEN_CONFIRMED_AFTER(tgt, CONFIG_SM_FILL_MIN_DWELL_MSEC,                               \
+                            CONFIG_SM_FILL_CONFIRM_SAMPLES, CONFIG_SM_FILL_CONFIRM_WINDOW,    \
+                            __VA_ARGS__)
+#define P_BAND        CONFIG_SM_FILL_PRESSURE_HYSTERESIS
+#define W_BAND        CONFIG_SM_FILL_WEIGHT_HYSTERESIS
+
+const struct sm_state_rows sm_transitions[SM_STATE_COUNT] = {
+    // clang-format off
+
+    /* ---- root and main states ---- */
+    SM_STATE(ROOT,
+        SM_ON_CMD(CMD_STOP, IDLE),
+        SM_ON_CMD(CMD_ABORT, ABORT)),
+
+    SM_STATE_ABSORBING(IDLE,
+        SM_ON_CMD(CMD_FILL_EXEC, FILL),
+        SM_ON_CMD(CMD_READY, READY)),
+
+    SM_STATE(FILL,
+        SM_ON_CMD(CMD_SAFE_PAUSE, FILL_SST(SAFE_PAUSE)),
+        SM_ON_FILL_CMD(CMD_FILL_N2, FILL_SST(FILL_N2)),
+        SM_ON_FILL_CMD(CMD_FILL_PRE_PRESS, FILL_SST(PRE_PRESS)),
+        SM_ON_FILL_CMD(CMD_FILL_N2O, FILL_SST(FILL_N2O)),
+        SM_ON_FILL_CMD(CMD_FILL_POST_PRESS, FILL_SST(POST_PRESS))),
+
+    SM_STATE_ABSORBING(READY,
+        SM_ON_CMD(CMD_ARM, ARMED),
+        SM_ON_CMD(CMD_ABORT, ABORT)),
+
+    SM_STATE_ABSORBING(ARMED,
+        SM_ON_CMD(CMD_FIRE, FLIGHT,
+            SM_GUARD(CHAMBER_T, SM_GT, FLIGHT_CFG(min_chamber_launch_temp))),
+        SM_ON_CMD(CMD_ABORT, ABORT)),
+
+    SM_STATE_ABSORBING(FLIGHT,
+        SM_ON_CMD(CMD_ABORT, ABORT)),
+
+    SM_STATE_ABSORBING(ABORT,
+        SM_ON_CMD(CMD_READY, IDLE),
+        SM_ON_CMD(CMD_STOP, IDLE)),
+
+    /* ---- root/fill/safe_pause ---- */
+    SM_STATE(FILL_SST(SAFE_PAUSE),
+        SM_ON_CMD(CMD_RESUME, IDLE)),
+
+    SM_STATE(FILL_SST(SAFE_PAUSE_IDLE),
+        FILL_WHEN(FILL_SST(SAFE_PAUSE_VENT),
+            SM_GUARD(N2O_TANK_P, SM_GT, FILL_CFG(safe_pause.trigger_n2o_tank_pressure)))),
+
+    SM_STATE(FILL_SST(SAFE_PAUSE_VENT),
+        FILL_WHEN(FILL_SST(SAFE_PAUSE_IDLE),
+            SM_GUARD(N2O_TANK_P, SM_LE, FILL_CFG(safe_pause.target_n2o_tank_pressure)))),
+
+    /* ---- root/fill/fill_n2 ---- */
+    SM_STATE(FILL_SST(FILL_N2_IDLE),
+        FILL_AFTER_DWELL(FILL_SST(FILL_N2_FILL),
+            SM_GUARD_HYST(N2_LINE_P, SM_LE,
+                FILL_CFG(fill_n2.target_n2_tank_pressure), P_BAND)),
+        FILL_WHEN(FILL_SST(FILL_N2_VENT),
+            SM_GUARD(N2_LINE_P, SM_GT, FILL_CFG(fill_n2.trigger_n2_tank_pressure)))),
+
+    SM_STATE(FILL_SST(FILL_N2_FILL),
+        FILL_WHEN(FILL_SST(FILL_N2_IDLE),
+            SM_GUARD(N2_LINE_P, SM_GE, FILL_CFG(fill_n2.target_n2_tank_pressure)))),
+
+    SM_STATE(FILL_SST(FILL_N2_VENT),
+        FILL_WHEN(FILL_SST(FILL_N2_IDLE),
+            SM_GUARD(N2_LINE_P, SM_LE, FILL_CFG(fill_n2.target_n2_tank_pressure)))),
+
+    /* ---- root/fill/pre_press ---- */
+    SM_STATE(FILL_SST(PRE_PRESS_IDLE),
+        FILL_WHEN(FILL_SST(PRE_PRESS_VENT),
+            SM_GUARD(N2O_TANK_P, SM_GT, FILL_CFG(pre_press.trigger_n2o_tank_pressure))),
+        FILL_AFTER_DWELL(FILL_SST(PRE_PRESS_FILL_N2),
+            SM_GUARD_HYST(N2O_TANK_P, SM_LT,
+                FILL_CFG(pre_press.target_n2o_tank_pressure), P_BAND))),
+
+    SM_STATE(FILL_SST(PRE_PRESS_VENT),
+        FILL_WHEN(FILL_SST(PRE_PRESS_IDLE),
+            SM_GUARD(N2O_TANK_P, SM_LE, FILL_CFG(pre_press.target_n2o_tank_pressure)))),
+
+    SM_STATE(FILL_SST(PRE_PRESS_FILL_N2),
+        FILL_WHEN(FILL_SST(PRE_PRESS_IDLE),
+            SM_GUARD(N2O_TANK_P, SM_GE, FILL_CFG(pre_press.target_n2o_tank_pressure)))),
+
+    /* ---- root/fill/fill_n2o ---- */
+    SM_STATE(FILL_SST(FILL_N2O_IDLE),
+        FILL_AFTER_DWELL(FILL_SST(FILL_N2O_FILL),
+            SM_GUARD_HYST(N2O_TANK_W, SM_LT,
+                FILL_CFG(fill_n2o.target_n2o_tank_weight), W_BAND))),
+
+    SM_STATE(FILL_SST(FILL_N2O_FILL),
+        FILL_WHEN(FILL_SST(FILL_N2O_VENT),
+            SM_GUARD(N2O_TANK_P, SM_GE, FILL_CFG(fill_n2o.trigger_n2o_tank_pressure)),
+            // Without a temperature, overpressure alone vents
+            SM_GUARD_IF_VALID(N2O_TANK_T, SM_GT,
+                FILL_CFG(fill_n2o.trigger_n2o_tank_temperature))),
+        FILL_WHEN(FILL_SST(FILL_N2O_IDLE),
+            SM_GUARD(N2O_TANK_W, SM_GE, FILL_CFG(fill_n2o.target_n2o_tank_weight)))),
+
+    SM_STATE(FILL_SST(FILL_N2O_VENT),
+        FILL_WHEN(FILL_SST(FILL_N2O_FILL),
+            SM_GUARD(N2O_TANK_P, SM_LE, FILL_CFG(fill_n2o.target_n2o_tank_pressure))),
+        FILL_WHEN(FILL_SST(FILL_N2O_FILL),
+            SM_GUARD(N2O_TANK_T, SM_LE, FILL_CFG(fill_n2o.trigger_n2o_tank_temperature)))),
+
+    /* ---- root/fill/post_press ---- */
+    SM_STATE(FILL_SST(POST_PRESS_IDLE),
+        FILL_WHEN(FILL_SST(POST_PRESS_VENT),
+            SM_GUARD(N2O_TANK_P, SM_GT, FILL_CFG(post_press.trigger_n2o_tank_pressure))),
+        FILL_AFTER_DWELL(FILL_SST(POST_PRESS_FILL_N2),
+            SM_GUARD_HYST(N2O_TANK_P, SM_LT,
+                FILL_CFG(post_press.target_n2o_tank_pressure), P_BAND))),
+
+    SM_STATE(FILL_SST(POST_PRESS_FILL_N2),
+        FILL_WHEN(FILL_SST(POST_PRESS_IDLE),
+            SM_GUARD(N2O_TANK_P, SM_GE, FILL_CFG(post_press.target_n2o_tank_pressure)))),
+
+    SM_STATE(FILL_SST(POST_PRESS_VENT),
+        FILL_WHEN(FILL_SST(POST_PRESS_IDLE),
+            SM_GUARD(N2O_TANK_P, SM_LE, FILL_CFG(post_press.target_n2o_tank_pressure)))),
+
+    /* ---- root/flight ---- */
+    SM_STATE(FLIGHT_SST(IGNITION),
+        SM_WHEN(FLIGHT_SST(BOOST),
+            SM_GUARD(CHAMBER_T, SM_GT, FLIGHT_CFG(min_chamber_launch_temp)))),
+
+    SM_STATE(FLIGHT_SST(BOOST),
+        SM_WHEN_CHECK(FLIGHT_SST(COAST), boost_timer_done)),
+
+    SM_STATE(FLIGHT_SST(COAST),
+        SM_WHEN(FLIGHT_SST(APOGEE),
+            SM_GUARD(kalman.vertical_speed, SM_LT, FLIGHT_CFG(coast_vertical_speed)))),
+
+    SM_STATE(FLIGHT_SST(APOGEE),
+        SM_WHEN_CHECK(FLIGHT_SST(DROGUE_CHUTE), drogue_ematch_fired)),
+
+    SM_STATE(FLIGHT_SST(DROGUE_CHUTE),
+        SM_WHEN(FLIGHT_SST(MAIN_CHUTE),
+            SM_GUARD(kalman.altitude, SM_LT, FLIGHT_CFG(main_chute_deploy_altitude)))),
+
+    SM_STATE(FLIGHT_SST(MAIN_CHUTE),
+        SM_WHEN(FLIGHT_SST(TOUCHDOWN),
+            SM_GUARD(kalman.altitude, SM_LT, FLIGHT_CFG(touchdown_altitude)))),
+
+    // clang-format on
+};
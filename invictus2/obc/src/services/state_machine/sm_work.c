@@ -1,14 +1,29 @@
 #include "data_models.h"
 #include "packets.h"
+#include "chan_stats.h"
+#include "invictus2/trace.h"
+#include "services/cmd_latency.h"
+#include "services/config_store.h"
+#include "services/health.h"
+#include "services/supervisor.h"
 #include "services/state_machine/filling_sm_config.h"
 #include "services/state_machine/main_sm.h"
+#include "services/state_machine/flight_exec.h"
+#include "services/state_machine/sm_intake.h"
 
 #include "zephyr/kernel.h"
 #include "zephyr/zbus/zbus.h"
 #include "zephyr/logging/log.h"
 
+#include <string.h>
+
 static struct sm_object sm_obj;
+static DEFAULT_SM_CONFIG(sm_config);
 bool smf_run_scheduled = false;
+static uint32_t command_latency_id; // Of sm_obj.command, see cmd_latency.h
+
+// Serializes sm_obj between the work queue and the flight executor
+K_MUTEX_DEFINE(sm_lock);
 
 LOG_MODULE_DECLARE(state_machine_service, LOG_LEVEL_DBG);
 
@@ -16,6 +31,12 @@ LOG_MODULE_DECLARE(state_machine_service, LOG_LEVEL_DBG);
 K_THREAD_STACK_DEFINE(sm_work_q_stack, 1024); // TODO: Make KConfig
 static struct k_work_q sm_work_q;
 
+// Nothing else can drive the valves on the ground, a stall there ends in a watchdog reset.
+// In flight mode the executor runs the machine and is watched on its own.
+static const struct supervisor_watch sm_watch = {
+    .deadline_ms = CONFIG_SUPERVISOR_SM_DEADLINE_MSEC,
+};
+
 static void command_work_handler(struct k_work *work);
 static void weight_work_handler(struct k_work *work);
 static void thermo_work_handler(struct k_work *work);
@@ -37,32 +58,23 @@ ZBUS_CHAN_DECLARE(chan_rocket_state, chan_actuators);
 
 static void rocket_state_listener_cb(const struct zbus_channel *chan);
 
-ZBUS_LISTENER_DEFINE(rocket_state_listener, rocket_state_listener_cb);
+CHAN_STATS_LISTENER_DEFINE(rocket_state_listener, rocket_state_listener_cb);
 ZBUS_CHAN_ADD_OBS(chan_packets, rocket_state_listener, 6);          // FIXME: Make KConfig
 ZBUS_CHAN_ADD_OBS(chan_weight_sensors, rocket_state_listener, 6);   // FIXME: Make KConfig
 ZBUS_CHAN_ADD_OBS(chan_thermo_sensors, rocket_state_listener, 6);   // FIXME: Make KConfig
 ZBUS_CHAN_ADD_OBS(chan_pressure_sensors, rocket_state_listener, 6); // FIXME: Make KConfig
 
-#define ZBUS_RET_CHECK(ret, work)                                                             \
-    switch (ret)                                                                              \
-    {                                                                                         \
-    case -EFAULT:                                                                             \
-        LOG_ERR("Error reading packet channel");                                              \
-        return;                                                                               \
-    case -EAGAIN:                                                                             \
-        LOG_WRN("No new packet to read");                                                     \
-        return;                                                                               \
-    case -EBUSY:                                                                              \
-        /* try again*/                                                                        \
-        LOG_WRN("Packet channel busy, retrying");                                             \
-        k_work_submit_to_queue(&sm_work_q, work);                                             \
-        return;                                                                               \
-    case 0:                                                                                   \
-        break;                                                                                \
-    default:                                                                                  \
-        LOG_ERR("Unexpected error reading packet channel: %d", ret);                          \
-        return;                                                                               \
-    }
+// A ground command as queued for the state machine, with its latency ID
+struct sm_command
+{
+    generic_packet_t packet;
+    uint32_t latency_id;
+};
+
+SM_INTAKE_DEFINE(command_intake, struct sm_command, CONFIG_SM_COMMAND_QUEUE_DEPTH, false);
+SM_INTAKE_DEFINE(weight_intake, weight_sample_t, 1, true);
+SM_INTAKE_DEFINE(thermo_intake, thermo_sample_t, 1, true);
+SM_INTAKE_DEFINE(pressure_intake, pressure_sample_t, 1, true);
 
 #define CHECK_PARAMS(params, cmd_name)                                                        \
     if (!params)                                                                              \
@@ -86,26 +98,44 @@ ZBUS_CHAN_ADD_OBS(chan_pressure_sensors, rocket_state_listener, 6); // FIXME: Ma
 
 static void rocket_state_listener_cb(const struct zbus_channel *chan)
 {
+    // Runs in the publisher's context, the message can be read without locking
+    const void *msg = zbus_chan_const_msg(chan);
+
     if (chan == &chan_packets)
     {
+        // Stamped at reception by the publisher, right before publishing
+        const struct sm_command command = {
+            .packet = *(const generic_packet_t *)msg,
+            .latency_id = cmd_latency_last(CMD_STAGE_RX),
+        };
+
+        if (!sm_intake_put(&command_intake, &command))
+        {
+            LOG_ERR("Command queue full, command %u dropped",
+                    command.packet.header.command_id);
+            return;
+        }
         k_work_submit_to_queue(&sm_work_q, &command_work);
         return;
     }
 
     if (chan == &chan_weight_sensors)
     {
+        sm_intake_put(&weight_intake, msg);
         k_work_submit_to_queue(&sm_work_q, &weight_work);
         return;
     }
 
     if (chan == &chan_thermo_sensors)
     {
+        sm_intake_put(&thermo_intake, msg);
         k_work_submit_to_queue(&sm_work_q, &thermo_work);
         return;
     }
 
     if (chan == &chan_pressure_sensors)
     {
+        sm_intake_put(&pressure_intake, msg);
         k_work_submit_to_queue(&sm_work_q, &pressure_work);
         return;
     }
@@ -113,7 +143,16 @@ static void rocket_state_listener_cb(const struct zbus_channel *chan)
 
 static void handle_fill_exec_command(struct cmd_fill_exec_s *fill_exec)
 {
+    // Saving the thresholds writes the flash, which stalls the CPU: never once armed
+    const main_state_t main_state = sm_obj.state_data.main_state;
+    if (main_state != IDLE && main_state != FILL)
+    {
+        LOG_WRN("Fill command ignored in main state %d", main_state);
+        return;
+    }
+
     struct filling_sm_config *fill_cfg = &sm_obj.config->filling_sm_config;
+    const struct filling_sm_config prev_cfg = *fill_cfg;
     fill_command_t fill_cmd = (fill_command_t)fill_exec->payload.program_id;
 
     switch (fill_cmd)
@@ -185,15 +224,30 @@ static void handle_fill_exec_command(struct cmd_fill_exec_s *fill_exec)
 
     sm_obj.command = CMD_FILL_EXEC;
     sm_obj.fill_command = fill_cmd;
+
+    if (memcmp(&prev_cfg, fill_cfg, sizeof(prev_cfg)) != 0)
+    {
+        config_store_save(sm_obj.config);
+    }
 }
 
 static void command_work_handler(struct k_work *work)
 {
-    generic_packet_t generic_packet;
-    int ret = zbus_chan_read(&chan_packets, &generic_packet, K_MSEC(100));
-    ZBUS_RET_CHECK(ret, &command_work);
+    TRACE_BEGIN(TRACE_SM_WORK);
+    k_mutex_lock(&sm_lock, K_FOREVER);
+
+    // One command per run of the state machine, the next one is taken once it has run
+    // (sm_step() resubmits this work). In flight mode that is the executor's next period.
+    struct sm_command command;
+    if (sm_obj.command != 0 || !sm_intake_get(&command_intake, &command))
+    {
+        k_mutex_unlock(&sm_lock);
+        TRACE_END(TRACE_SM_WORK);
+        return;
+    }
+
+    command_t cmd = (command_t)command.packet.header.command_id;
 
-    command_t cmd = (command_t)generic_packet.header.command_id;
     switch (cmd)
     {
     case CMD_ABORT:
@@ -209,87 +263,242 @@ static void command_work_handler(struct k_work *work)
         break;
 
     case CMD_FILL_EXEC:
-        handle_fill_exec_command((struct cmd_fill_exec_s *)&generic_packet);
+        handle_fill_exec_command((struct cmd_fill_exec_s *)&command.packet);
         break;
 
     case CMD_MANUAL_EXEC:
+        break; // Executed by the services that own the hardware (e.g. modbus)
+
     case CMD_STATUS_REQ:
         LOG_WRN("Received unimplemented command: %d", cmd);
-        return;
+        break;
 
     case CMD_STATUS_REP:
     case CMD_ACK:
         LOG_WRN("Received command not meant for state machine: %d", cmd);
-        return; // Ignore these commands
+        break; // Ignore these commands
 
     case _CMD_NONE:
     case _CMD_MAX:
         LOG_ERR("Received unknown command: %d", cmd);
-        return;
+        break;
+    }
+    const command_t pending = sm_obj.command;
+    if (pending != 0)
+    {
+        command_latency_id = command.latency_id;
     }
+    k_mutex_unlock(&sm_lock);
+    TRACE_END(TRACE_SM_WORK);
+    cmd_latency_stamp(command.latency_id, CMD_STAGE_SM_COMMAND);
 
-    LOG_INF("Received command: %d", sm_obj.command);
-    SCHEDULE_SM_RUN();
+    if (pending != 0)
+    {
+        LOG_INF("Received command: %d", pending);
+        SCHEDULE_SM_RUN();
+    }
+    else if (sm_intake_pending(&command_intake))
+    {
+        // Nothing for the state machine to run, e.g. a manual command
+        k_work_submit_to_queue(&sm_work_q, work);
+    }
 }
 
 static void weight_work_handler(struct k_work *work)
 {
-    loadcell_weights_t weights;
-    int ret = zbus_chan_read(&chan_weight_sensors, &weights, K_MSEC(100));
-    ZBUS_RET_CHECK(ret, &weight_work);
+    weight_sample_t sample;
+    if (!sm_intake_get(&weight_intake, &sample))
+    {
+        return; // Taken by an earlier run
+    }
 
-    sm_obj.data.loadcells = weights;
+    k_mutex_lock(&sm_lock, K_FOREVER);
+    sm_obj.data.loadcells = sample.weights;
+    sm_obj.fresh |= SM_SRC_LOADCELLS;
+    k_mutex_unlock(&sm_lock);
     SCHEDULE_SM_RUN();
 }
 
 static void thermo_work_handler(struct k_work *work)
 {
-    thermocouples_t thermos;
-    int ret = zbus_chan_read(&chan_thermo_sensors, &thermos, K_MSEC(100));
-    ZBUS_RET_CHECK(ret, &thermo_work);
+    thermo_sample_t sample;
+    if (!sm_intake_get(&thermo_intake, &sample))
+    {
+        return; // Taken by an earlier run
+    }
 
-    sm_obj.data.thermocouples = thermos;
+    k_mutex_lock(&sm_lock, K_FOREVER);
+    sm_obj.data.thermocouples = sample.thermocouples;
+    sm_obj.fresh |= SM_SRC_THERMOCOUPLES;
+    k_mutex_unlock(&sm_lock);
     SCHEDULE_SM_RUN();
 }
 
 static void pressure_work_handler(struct k_work *work)
 {
-    pressures_t pressures;
-    int ret = zbus_chan_read(&chan_pressure_sensors, &pressures, K_MSEC(100));
-    ZBUS_RET_CHECK(ret, &pressure_work);
+    pressure_sample_t sample;
+    if (!sm_intake_get(&pressure_intake, &sample))
+    {
+        return; // Taken by an earlier run
+    }
 
-    sm_obj.data.pressures = pressures;
+    k_mutex_lock(&sm_lock, K_FOREVER);
+    sm_obj.data.pressures = sample.pressures;
+    sm_obj.fresh |= SM_SRC_PRESSURES;
+    k_mutex_unlock(&sm_lock);
     SCHEDULE_SM_RUN();
 }
 
-static void state_machine_work_handler(struct k_work *work)
+// Run the state machine once and publish the result, with sm_lock held
+static void sm_step(const bool only_changes)
 {
-    ARG_UNUSED(work);
+    const state_data_t prev_state = sm_obj.state_data;
+    const actuators_bitmap_t prev_actuators = sm_obj.data.actuators;
+    const bool had_command = sm_obj.command != 0 || sm_obj.fill_command != 0;
+    const uint32_t latency_id = had_command ? command_latency_id : CMD_LATENCY_NONE;
 
-    smf_run_scheduled = false;
+    sm_obj.now_ms = k_uptime_get_32();
+    TRACE_BEGIN(TRACE_SM_RUN);
     smf_run_state(SMF_CTX(&sm_obj));
+    TRACE_END(TRACE_SM_RUN);
+    // Also without a command, the actuators published below are attributed to this run
+    cmd_latency_stamp(latency_id, CMD_STAGE_SM_RUN);
 
-    // Clear commands after processing
+    // Clear commands and samples after processing
     sm_obj.command = 0;
     sm_obj.fill_command = 0;
+    sm_obj.fresh = 0;
 
-    int ret = zbus_chan_pub(&chan_rocket_state, &sm_obj.state_data, K_MSEC(100));
-    if (ret != 0)
+    // The next queued command waits for this run, see command_work_handler()
+    if (sm_intake_pending(&command_intake))
     {
-        LOG_ERR("Failed to publish rocket state: %d", ret);
+        k_work_submit_to_queue(&sm_work_q, &command_work);
+    }
+
+    if (!only_changes || memcmp(&prev_state, &sm_obj.state_data, sizeof(prev_state)) != 0)
+    {
+        TRACE_BEGIN(TRACE_ZBUS_PUB);
+        int ret = chan_stats_pub(&chan_rocket_state, &sm_obj.state_data, K_MSEC(100));
+        TRACE_END(TRACE_ZBUS_PUB);
+        if (ret != 0)
+        {
+            LOG_ERR("Failed to publish rocket state: %d", ret);
+        }
+
+        LOG_INF("Rocket state"
+                " - Main state: %d"
+                " - Filling state: %d"
+                " - Flight state: %d",
+                sm_obj.state_data.main_state, sm_obj.state_data.filling_state,
+                sm_obj.state_data.flight_state);
+    }
+
+    if (!only_changes || prev_actuators.raw != sm_obj.data.actuators.raw)
+    {
+        TRACE_BEGIN(TRACE_ZBUS_PUB);
+        int ret = chan_stats_pub(&chan_actuators, &sm_obj.data.actuators, K_MSEC(100));
+        TRACE_END(TRACE_ZBUS_PUB);
+        if (ret != 0)
+        {
+            LOG_ERR("Failed to publish actuators state: %d", ret);
+        }
+        else
+        {
+            cmd_latency_stamp(latency_id, CMD_STAGE_ACTUATORS);
+        }
+    }
+}
+
+bool sm_flight_mode(void)
+{
+    const main_state_t state = sm_obj.state_data.main_state;
+    return state == ARMED || state == FLIGHT;
+}
+
+void sm_flight_step(const navigator_sensors_t *navigator, const kalman_data_t *kalman)
+{
+    k_mutex_lock(&sm_lock, K_FOREVER);
+
+    if (navigator != NULL && kalman != NULL)
+    {
+        sm_obj.data.navigator = *navigator;
+        sm_obj.data.kalman = *kalman;
+        sm_obj.fresh |= SM_SRC_NAVIGATOR | SM_SRC_KALMAN;
+    }
+
+    sm_step(true);
+    k_mutex_unlock(&sm_lock);
+}
+
+void sm_force_safe(void)
+{
+    // The lock may be held by the stalled service itself
+    if (k_mutex_lock(&sm_lock, K_MSEC(100)) != 0)
+    {
+        LOG_ERR("State machine locked, cannot force a safe state");
+        return;
+    }
+
+    const state_data_t state = sm_obj.state_data;
+    command_t cmd = 0;
+
+    switch (state.main_state)
+    {
+    case FILL:
+        // Vents on overpressure without the ground station, unless already there
+        if (state.filling_state < SAFE_PAUSE || state.filling_state > SAFE_PAUSE_VENT)
+        {
+            cmd = CMD_SAFE_PAUSE;
+        }
+        break;
+
+    case READY:
+    case ARMED:
+        cmd = CMD_ABORT;
+        break;
+
+    default:
+        break; // Already safe, or in flight where the sequence must go on
+    }
+
+    // A command taken but not run yet is replaced, unless it is an abort
+    if (cmd != 0 && sm_obj.command == CMD_ABORT)
+    {
+        LOG_WRN("Abort already pending, not forcing command %d", cmd);
+    }
+    else if (cmd != 0)
+    {
+        LOG_WRN("Forcing command %d in main state %d", cmd, state.main_state);
+        sm_obj.command = cmd;
+        command_latency_id = CMD_LATENCY_NONE;
+        SCHEDULE_SM_RUN();
+    }
+
+    k_mutex_unlock(&sm_lock);
+}
+
+static void state_machine_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    smf_run_scheduled = false;
+
+    // In flight mode the executor runs the machine, pending commands wait for its next period
+    if (sm_flight_mode())
+    {
+        return;
     }
 
-    LOG_INF("Rocket state"
-            " - Main state: %d"
-            " - Filling state: %d"
-            " - Flight state: %d",
-            sm_obj.state_data.main_state, sm_obj.state_data.filling_state,
-            sm_obj.state_data.flight_state);
+    TRACE_BEGIN(TRACE_SM_WORK);
+    k_mutex_lock(&sm_lock, K_FOREVER);
+    sm_step(false);
+    const bool handover = sm_flight_mode();
+    k_mutex_unlock(&sm_lock);
+    TRACE_END(TRACE_SM_WORK);
 
-    ret = zbus_chan_pub(&chan_actuators, &sm_obj.data.actuators, K_MSEC(100));
-    if (ret != 0)
+    if (handover)
     {
-        LOG_ERR("Failed to publish actuators state: %d", ret);
+        flight_exec_resume();
     }
 }
 
@@ -299,8 +508,11 @@ bool state_machine_service_setup(void)
     // For example, initialize hardware, data models, or configuration.
     // Return true if setup is successful, false otherwise.
 
-    sm_init(&sm_obj);
+    // Thresholds set by fill commands before a reset are restored
+    (void)config_store_load(&sm_config);
+    sm_init(&sm_obj, &sm_config);
     k_work_queue_init(&sm_work_q);
+    flight_exec_init();
     return true;
 }
 
@@ -312,4 +524,7 @@ void state_machine_service_start(void)
     // return;
     k_work_queue_start(&sm_work_q, sm_work_q_stack, K_THREAD_STACK_SIZEOF(sm_work_q_stack),
                        SM_WORK_Q_PRIO, NULL);
+    k_thread_name_set(&sm_work_q.thread, "sm");
+    health_register_work_q(HEALTH_SM_WORK_Q, &sm_work_q);
+    supervisor_watch_work_q(HEALTH_SM_WORK_Q, &sm_work_q, &sm_watch);
 }
@@ -0,0 +1,221 @@
+#include "services/supervisor.h"
+#include "services/health.h"
+#include "services/state_machine/flight_exec.h"
+#include "services/state_machine/main_sm.h"
+
+#include "zephyr/device.h"
+#include "zephyr/kernel.h"
+#include "zephyr/logging/log.h"
+#include "zephyr/spinlock.h"
+#include "zephyr/sys/atomic.h"
+
+LOG_MODULE_REGISTER(supervisor_service, LOG_LEVEL_INF);
+
+#define WDT_NODE DT_ALIAS(watchdog0)
+
+#if DT_NODE_HAS_STATUS(WDT_NODE, okay)
+#include "zephyr/drivers/watchdog.h"
+
+static const struct device *const wdt = DEVICE_DT_GET(WDT_NODE);
+static int wdt_channel = -1;
+#endif
+
+BUILD_ASSERT(CONFIG_SUPERVISOR_WDT_TIMEOUT_MSEC > 2 * CONFIG_SUPERVISOR_PERIOD_MSEC,
+             "The watchdog must survive a late supervisor period");
+
+static struct watched
+{
+    const struct supervisor_watch *watch; // NULL if the service is not watched
+    struct k_work_q *work_q;              // NULL for threads that beat themselves
+    struct k_work beat_work;
+    atomic_t last_beat_ms;
+    bool stalled;
+} watched[_HEALTH_SERVICE_MAX];
+
+static struct k_spinlock lock;
+
+K_THREAD_STACK_DEFINE(supervisor_stack, CONFIG_SUPERVISOR_STACK_SIZE);
+static struct k_thread supervisor_thread;
+
+static void beat_work_handler(struct k_work *work)
+{
+    struct watched *const w = CONTAINER_OF(work, struct watched, beat_work);
+    atomic_set(&w->last_beat_ms, k_uptime_get_32());
+}
+
+static void add_watch(health_service_t service, struct k_work_q *work_q,
+                      const struct supervisor_watch *watch)
+{
+    struct watched *const w = &watched[service];
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    atomic_set(&w->last_beat_ms, k_uptime_get_32());
+    w->work_q = work_q;
+    w->stalled = false;
+    w->watch = watch;
+    k_spin_unlock(&lock, key);
+}
+
+void supervisor_watch_work_q(health_service_t service, struct k_work_q *work_q,
+                             const struct supervisor_watch *w)
+{
+    add_watch(service, work_q, w);
+}
+
+void supervisor_watch_thread(health_service_t service, const struct supervisor_watch *w)
+{
+    add_watch(service, NULL, w);
+}
+
+void supervisor_heartbeat(health_service_t service)
+{
+    atomic_set(&watched[service].last_beat_ms, k_uptime_get_32());
+}
+
+static void on_stall(health_service_t service, const struct supervisor_watch *watch,
+                     uint32_t silent_ms)
+{
+    LOG_ERR("%s stalled, no heartbeat for %u ms", health_service_name(service), silent_ms);
+
+    if (watch->force_safe)
+    {
+        sm_force_safe();
+    }
+
+    if (watch->restart != NULL)
+    {
+        LOG_WRN("Restarting %s", health_service_name(service));
+        watch->restart();
+    }
+}
+
+// True if every watched service is alive, or stalled but keeping the watchdog fed
+static bool check_services(void)
+{
+    bool alive = true;
+    const bool flight = sm_flight_mode();
+
+    for (int s = 0; s < _HEALTH_SERVICE_MAX; s++)
+    {
+        struct watched *const w = &watched[s];
+
+        k_spinlock_key_t key = k_spin_lock(&lock);
+        const struct supervisor_watch *const watch = w->watch;
+        struct k_work_q *const work_q = w->work_q;
+        k_spin_unlock(&lock, key);
+
+        if (watch == NULL)
+        {
+            continue;
+        }
+
+        if (work_q != NULL)
+        {
+            // Still pending if the queue has not caught up since the last period
+            k_work_submit_to_queue(work_q, &w->beat_work);
+        }
+
+        const uint32_t silent_ms = k_uptime_get_32() - (uint32_t)atomic_get(&w->last_beat_ms);
+        if (silent_ms <= watch->deadline_ms)
+        {
+            if (w->stalled)
+            {
+                LOG_INF("%s recovered", health_service_name(s));
+                w->stalled = false;
+            }
+            continue;
+        }
+
+        alive = alive && (watch->keep_fed || (flight && !watch->flight_critical));
+        if (!w->stalled)
+        {
+            w->stalled = true;
+            on_stall(s, watch, silent_ms);
+        }
+    }
+
+    return alive;
+}
+
+static void supervisor_entry(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    bool was_alive = true;
+
+    while (true)
+    {
+        const bool alive = check_services();
+
+        if (was_alive && !alive)
+        {
+            LOG_ERR("Watchdog no longer fed, reset in %u ms unless the services recover",
+                    CONFIG_SUPERVISOR_WDT_TIMEOUT_MSEC);
+        }
+        was_alive = alive;
+
+#if DT_NODE_HAS_STATUS(WDT_NODE, okay)
+        if (alive && wdt_channel >= 0)
+        {
+            wdt_feed(wdt, wdt_channel);
+        }
+#endif
+
+        k_sleep(K_MSEC(CONFIG_SUPERVISOR_PERIOD_MSEC));
+    }
+}
+
+bool supervisor_service_setup(void)
+{
+    for (int s = 0; s < _HEALTH_SERVICE_MAX; s++)
+    {
+        k_work_init(&watched[s].beat_work, beat_work_handler);
+    }
+
+#if DT_NODE_HAS_STATUS(WDT_NODE, okay)
+    if (!device_is_ready(wdt))
+    {
+        LOG_ERR("Watchdog %s not ready", wdt->name);
+        return false;
+    }
+
+    const struct wdt_timeout_cfg cfg = {
+        .window = {.min = 0, .max = CONFIG_SUPERVISOR_WDT_TIMEOUT_MSEC},
+        .callback = NULL,
+        .flags = WDT_FLAG_RESET_SOC,
+    };
+
+    wdt_channel = wdt_install_timeout(wdt, &cfg);
+    if (wdt_channel < 0)
+    {
+        LOG_ERR("Failed to install the watchdog timeout: %d", wdt_channel);
+        return false;
+    }
+#else
+    LOG_WRN("No watchdog0, stalled services will not reset the board");
+#endif
+
+    return true;
+}
+
+void supervisor_service_start(void)
+{
+#if DT_NODE_HAS_STATUS(WDT_NODE, okay)
+    // From here on the board resets if the supervisor stops feeding it
+    int ret = wdt_setup(wdt, WDT_OPT_PAUSE_HALTED_BY_DBG);
+    if (ret != 0)
+    {
+        LOG_ERR("Failed to start the watchdog: %d", ret);
+        wdt_channel = -1;
+    }
+#endif
+
+    const k_tid_t tid = k_thread_create(
+        &supervisor_thread, supervisor_stack, K_THREAD_STACK_SIZEOF(supervisor_stack),
+        supervisor_entry, NULL, NULL, NULL, K_PRIO_PREEMPT(CONFIG_SUPERVISOR_PRIO), 0,
+        K_NO_WAIT);
+    k_thread_name_set(tid, "supervisor");
+    health_register_thread(HEALTH_SUPERVISOR, tid);
+}
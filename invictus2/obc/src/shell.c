@@ -1,5 +1,9 @@
 #include "shell.h"
+#include "boot.h"
+#include "chan_stats.h"
 #include "packets.h"
+#include "services/cmd_latency.h"
+#include "services/health.h"
 
 #include <zephyr/kernel.h>
 #include <zephyr/device.h>
@@ -30,6 +34,11 @@ static int packet_fill_post_press_handler(const struct shell *sh, size_t argc, c
 
 static int packet_manual_exec_handler(const struct shell *sh, size_t argc, char **argv);
 
+static int latency_handler(const struct shell *sh, size_t argc, char **argv);
+static int health_handler(const struct shell *sh, size_t argc, char **argv);
+static int boot_handler(const struct shell *sh, size_t argc, char **argv);
+static int bus_handler(const struct shell *sh, size_t argc, char **argv);
+
 SHELL_STATIC_SUBCMD_SET_CREATE(
     fill_exec_subcmd_set,
 
@@ -74,13 +83,29 @@ SHELL_STATIC_SUBCMD_SET_CREATE(
 
     SHELL_SUBCMD_SET_END);
 SHELL_CMD_REGISTER(packet, &packet_subcmd_set, "Packet commands", NULL);
+SHELL_CMD_REGISTER(latency, NULL, "Command latency per stage", latency_handler);
+SHELL_CMD_REGISTER(health, NULL, "CPU and stack usage per service", health_handler);
+SHELL_CMD_REGISTER(boot, NULL, "Boot timings", boot_handler);
+SHELL_CMD_REGISTER(bus, NULL, "zbus statistics per channel", bus_handler);
+
+// Shell commands go through the same stages as the radio ones, for bench measurements
+static int publish_packet(const generic_packet_t *pack)
+{
+    const uint32_t latency_id = cmd_latency_rx(pack->header.command_id);
+    int ret = chan_stats_pub(&chan_packets, (const void *)pack, K_MSEC(100));
+    if (ret == 0)
+    {
+        cmd_latency_stamp(latency_id, CMD_STAGE_PUBLISHED);
+    }
+    return ret;
+}
 
 static int pub_cmd(const struct shell *sh, command_t cmd)
 {
     generic_packet_t pack = create_cmd_packet(cmd);
     LOG_HEXDUMP_DBG(&pack, sizeof(pack), "Packet data");
 
-    int ret = zbus_chan_pub(&chan_packets, (const void *)&pack, K_MSEC(100));
+    int ret = publish_packet(&pack);
     if (ret == 0)
     {
         shell_print(sh, "Published command %d", cmd);
@@ -191,7 +216,7 @@ static int packet_fill_n2_handler(const struct shell *sh, size_t argc, char **ar
     fill_exec->payload.program_id = CMD_FILL_N2;
     memcpy(fill_exec->payload.params, &payload, sizeof(payload));
 
-    return zbus_chan_pub(&chan_packets, (const void *)&generic_pack, K_MSEC(100));
+    return publish_packet(&generic_pack);
 }
 
 static int packet_fill_pre_press_handler(const struct shell *sh, size_t argc, char **argv)
@@ -220,7 +245,7 @@ static int packet_fill_pre_press_handler(const struct shell *sh, size_t argc, ch
     fill_exec->payload.program_id = CMD_FILL_PRE_PRESS;
     memcpy(fill_exec->payload.params, &payload, sizeof(payload));
 
-    return zbus_chan_pub(&chan_packets, (const void *)&generic_pack, K_MSEC(100));
+    return publish_packet(&generic_pack);
 }
 
 static int packet_fill_n2o_handler(const struct shell *sh, size_t argc, char **argv)
@@ -250,7 +275,7 @@ static int packet_fill_n2o_handler(const struct shell *sh, size_t argc, char **a
     fill_exec->payload.program_id = CMD_FILL_N2O;
     memcpy(fill_exec->payload.params, &payload, sizeof(payload));
 
-    return zbus_chan_pub(&chan_packets, (const void *)&generic_pack, K_MSEC(100));
+    return publish_packet(&generic_pack);
 }
 
 static int packet_fill_post_press_handler(const struct shell *sh, size_t argc, char **argv)
@@ -279,7 +304,7 @@ static int packet_fill_post_press_handler(const struct shell *sh, size_t argc, c
     fill_exec->payload.program_id = CMD_FILL_POST_PRESS;
     memcpy(fill_exec->payload.params, &payload, sizeof(payload));
 
-    return zbus_chan_pub(&chan_packets, (const void *)&generic_pack, K_MSEC(100));
+    return publish_packet(&generic_pack);
 }
 
 static int packet_manual_exec_handler(const struct shell *sh, size_t argc, char **argv)
@@ -288,6 +313,112 @@ static int packet_manual_exec_handler(const struct shell *sh, size_t argc, char
     return 0;
 }
 
+static int latency_handler(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    static const char *const stage_names[_CMD_STAGE_MAX] = {
+        [CMD_STAGE_RX] = "rx",
+        [CMD_STAGE_PUBLISHED] = "published",
+        [CMD_STAGE_SM_COMMAND] = "sm_command",
+        [CMD_STAGE_SM_RUN] = "sm_run",
+        [CMD_STAGE_ACTUATORS] = "actuators",
+        [CMD_STAGE_MODBUS_WRITE] = "modbus_write",
+    };
+
+    struct cmd_latency_stats stats;
+    cmd_latency_get_stats(&stats);
+
+    shell_print(sh, "%u commands, last %u us, max %u us", stats.commands, stats.last_total_us,
+                stats.max_total_us);
+    shell_print(sh, "%-12s %8s %10s %10s %10s", "stage", "count", "last us", "avg us", "max us");
+
+    for (int s = 0; s < _CMD_STAGE_MAX; s++)
+    {
+        const struct cmd_latency_stage_stats *const stage = &stats.stages[s];
+        shell_print(sh, "%-12s %8u %10u %10u %10u", stage_names[s], stage->count,
+                    stage->last_us, stage->avg_us, stage->max_us);
+    }
+
+    return 0;
+}
+
+static int health_handler(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    health_sample_t sample;
+    health_get_sample(&sample);
+
+    shell_print(sh, "CPU load %u.%u%% over %u ms", sample.cpu_load_permille / 10,
+                sample.cpu_load_permille % 10, sample.period_ms);
+    shell_print(sh, "%-12s %6s %12s %8s", "service", "cpu %", "stack", "backlog");
+
+    for (int s = 0; s < _HEALTH_SERVICE_MAX; s++)
+    {
+        const health_service_sample_t *const service = &sample.services[s];
+        if (service->stack_size == 0)
+        {
+            shell_print(sh, "%-12s not running", health_service_name(s));
+            continue;
+        }
+
+        shell_print(sh, "%-12s %4u.%u %5u/%-6u %4u/%-3u", health_service_name(s),
+                    service->cpu_permille / 10, service->cpu_permille % 10, service->stack_used,
+                    service->stack_size, service->backlog, service->max_backlog);
+    }
+
+    return 0;
+}
+
+static int boot_handler(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    struct boot_stats stats;
+    boot_get_stats(&stats);
+
+    shell_print(sh, "Services up %u ms after reset", stats.services_up_ms);
+    if (stats.first_telemetry != NULL)
+    {
+        shell_print(sh, "First telemetry (%s) %u ms after reset", stats.first_telemetry,
+                    stats.first_telemetry_ms);
+    }
+    else
+    {
+        shell_print(sh, "No telemetry yet");
+    }
+
+    return 0;
+}
+
+static int bus_handler(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    bus_stats_t stats;
+    chan_stats_get(&stats);
+
+    shell_print(sh, "Over %u ms, times in us", stats.period_ms);
+    shell_print(sh, "%-14s %6s %5s %7s %9s %9s %8s %5s %8s", "channel", "pub/s", "errs",
+                "max pub", "avg lstnr", "max lstnr", "max lat", "busy", "max read");
+
+    for (int c = 0; c < _BUS_CHAN_MAX; c++)
+    {
+        const bus_chan_sample_t *const chan = &stats.chans[c];
+        shell_print(sh, "%-14s %6u %5u %7u %9u %9u %8u %5u %8u", chan_stats_name(c),
+                    chan->pubs_per_sec, chan->pub_errors, chan->max_pub_us,
+                    chan->avg_listener_us, chan->max_listener_us, chan->max_latency_us,
+                    chan->read_busy, chan->max_read_us);
+    }
+
+    return 0;
+}
+
 void setup_shell_if_enabled(void)
 {
 #if DT_NODE_HAS_COMPAT(DT_CHOSEN(zephyr_shell_uart), zephyr_cdc_acm_uart)
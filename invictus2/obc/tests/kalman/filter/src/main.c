@@ -0,0 +1,265 @@
+/*
+ * Navigation filter tests, against a synthetic flight: pad, boost, coast with drag, drogue
+ * descent. The IMU is mounted tilted on the rail and all sensors are noisy, the baro only
+ * refreshes every few IMU samples, like on the navigator. The same flight is also flown with
+ * samples lost on the way, which the filter must propagate over.
+ */
+#include "services/kalman/filter.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#define IMU_PERIOD_US   2000
+#define BARO_DECIMATION 10
+#define PAD_ALTITUDE_M  100.0f
+#define TILT_RAD        (5.0f * 3.14159265f / 180.0f)
+#define G               9.80665f
+
+#define PAD_S     3.0f
+#define BOOST_S   3.0f
+#define THRUST    60.0f    // Net upwards acceleration during boost, m/s^2
+#define DRAG      0.0004f  // Drag deceleration per (m/s)^2
+#define DROGUE_MS (-20.0f) // Descent rate under drogue
+
+static const struct kf_params params = {
+    .imu_period_us = IMU_PERIOD_US,
+    .baro_decimation = BARO_DECIMATION,
+    .accel_noise_mms2 = 500,
+    .baro_noise_mm = 1500,
+    .launch_accel_mg = 2500,
+    .align_samples = 250,
+};
+
+static struct kf_state kf;
+static uint32_t seed;
+
+static int32_t noise(int32_t peak)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return (int32_t)(seed % (2 * peak + 1)) - peak;
+}
+
+static uint16_t isa_pressure_dhpa(float altitude_m)
+{
+    return (uint16_t)(10132.5f * powf(1.0f - altitude_m / 44330.8f, 1.0f / 0.190263f) + 0.5f);
+}
+
+struct truth
+{
+    float t;
+    float altitude;
+    float speed;
+    float accel; // World vertical, without gravity
+};
+
+// Advance the synthetic flight by one IMU period
+static void fly(struct truth *tr, bool *drogue)
+{
+    const float dt = IMU_PERIOD_US * 1e-6f;
+
+    if (tr->t < PAD_S)
+    {
+        tr->accel = 0.0f;
+    }
+    else if (tr->t < PAD_S + BOOST_S)
+    {
+        tr->accel = THRUST - DRAG * tr->speed * fabsf(tr->speed);
+    }
+    else if (!*drogue)
+    {
+        tr->accel = -G - DRAG * tr->speed * fabsf(tr->speed);
+        *drogue = tr->speed < 0.0f;
+    }
+    else
+    {
+        // Drogue out: relax to the descent rate
+        tr->accel = (DROGUE_MS - tr->speed) * 2.0f;
+    }
+
+    tr->speed += tr->accel * dt;
+    tr->altitude += tr->speed * dt;
+    tr->t += dt;
+}
+
+// What the navigator would report for the current truth, IMU tilted about x
+static void sense(const struct truth *tr, navigator_sensors_t *out, uint32_t sample)
+{
+    static uint16_t baro;
+
+    const float specific_force_mg = (tr->accel + G) / G * 1000.0f;
+
+    out->accel_x = noise(20);
+    out->accel_y = (int16_t)(specific_force_mg * sinf(TILT_RAD)) + noise(20);
+    out->accel_z = (int16_t)(specific_force_mg * cosf(TILT_RAD)) + noise(20);
+    out->gyro_x = noise(3);
+    out->gyro_y = noise(3);
+    out->gyro_z = noise(3);
+
+    if (sample % BARO_DECIMATION == 0)
+    {
+        baro = isa_pressure_dhpa(PAD_ALTITUDE_M + tr->altitude) + noise(1);
+    }
+
+    out->baro1 = baro;
+    out->baro2 = baro;
+}
+
+static void before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+    seed = 0x2545f491;
+    zassert_true(kf_init(&kf, &params));
+}
+
+ZTEST_SUITE(kalman_filter, NULL, NULL, before, NULL, NULL);
+
+ZTEST(kalman_filter, test_invalid_params)
+{
+    struct kf_params bad = params;
+    bad.baro_decimation = 0;
+    zassert_false(kf_init(&kf, &bad));
+}
+
+ZTEST(kalman_filter, test_baro_altitude_table)
+{
+    // Against the ISA formula, within 0.2 m
+    const uint16_t pressures_dhpa[] = {2500, 6000, 7950, 8988, 10132, 10500};
+
+    for (size_t i = 0; i < ARRAY_SIZE(pressures_dhpa); i++)
+    {
+        const float expected_mm =
+            44330.8e3f * (1.0f - powf(pressures_dhpa[i] / 10132.5f, 0.190263f));
+        zassert_within(kf_baro_altitude_mm(pressures_dhpa[i]), (int32_t)expected_mm, 200,
+                       "%u dhPa", pressures_dhpa[i]);
+    }
+}
+
+ZTEST(kalman_filter, test_pad_alignment)
+{
+    struct truth tr = {0};
+    bool drogue = false;
+    navigator_sensors_t sample;
+
+    for (uint32_t i = 0; tr.t < PAD_S - 0.1f; i++)
+    {
+        sense(&tr, &sample, i);
+        kf_update(&kf, &sample, IMU_PERIOD_US);
+        fly(&tr, &drogue);
+    }
+
+    kalman_data_t out;
+    kf_output(&kf, &out);
+
+    zassert_false(kf.launched);
+    zassert_true(kf.aligned);
+    zassert_within(out.altitude, 0, 1);
+    zassert_within(out.vertical_speed, 0, 5, "%d dm/s", out.vertical_speed);
+
+    // Tilt about x: q = (cos(t/2), -sin(t/2), 0, 0) in Q14, sign of x by convention
+    zassert_within(out.quaternions[0], (int)(cosf(TILT_RAD / 2) * 16384), 40);
+    zassert_within(abs(out.quaternions[1]), (int)(sinf(TILT_RAD / 2) * 16384), 40);
+}
+
+struct flight_result
+{
+    int32_t max_altitude; // Estimated, m
+    float true_apogee;
+    int32_t detect_delay_ms; // Vertical speed <= 0 after the true apogee
+    float max_error;         // Altitude, m
+    int16_t final_speed;     // dm/s
+};
+
+// Fly the whole synthetic flight, feeding the filter all but one sample in every lose_every
+// (never if 0)
+static void fly_flight(struct flight_result *res, uint32_t lose_every)
+{
+    struct truth tr = {0};
+    bool drogue = false;
+    navigator_sensors_t sample;
+    kalman_data_t out;
+
+    float true_apogee_t = 0.0f, true_apogee = 0.0f;
+    float detected_t = 0.0f;
+    float max_error = 0.0f;
+    uint64_t cycles = 0;
+    uint32_t samples = 0;
+    uint32_t dt_us = 0;
+
+    for (uint32_t i = 0; tr.t < 40.0f; i++)
+    {
+        sense(&tr, &sample, i);
+        dt_us += IMU_PERIOD_US;
+
+        if (lose_every == 0 || i % lose_every != 0)
+        {
+            const uint32_t start = k_cycle_get_32();
+            kf_update(&kf, &sample, dt_us);
+            cycles += k_cycle_get_32() - start;
+            samples++;
+            dt_us = 0;
+        }
+
+        kf_output(&kf, &out);
+        fly(&tr, &drogue);
+
+        if (tr.altitude > true_apogee)
+        {
+            true_apogee = tr.altitude;
+            true_apogee_t = tr.t;
+        }
+
+        if (detected_t == 0.0f && tr.t > PAD_S + BOOST_S && out.vertical_speed <= 0)
+        {
+            detected_t = tr.t;
+        }
+
+        if (tr.t > PAD_S)
+        {
+            max_error = MAX(max_error, fabsf(out.altitude - tr.altitude));
+        }
+    }
+
+    printk("apogee %d m (true %d m), detected %d ms after the true one\n",
+           out.max_altitude, (int)true_apogee, (int)((detected_t - true_apogee_t) * 1000));
+    printk("max altitude error %d dm, %u cycles per update on this host\n",
+           (int)(max_error * 10), (uint32_t)(cycles / samples));
+
+    *res = (struct flight_result){
+        .max_altitude = out.max_altitude,
+        .true_apogee = true_apogee,
+        .detect_delay_ms = (int32_t)((detected_t - true_apogee_t) * 1000),
+        .max_error = max_error,
+        .final_speed = out.vertical_speed,
+    };
+}
+
+static void check_flight(const struct flight_result *res)
+{
+    zassert_true(kf.launched);
+    zassert_within(res->max_altitude, (int)res->true_apogee, 15);
+    zassert_true(res->max_error < 10.0f, "altitude off by %d m", (int)res->max_error);
+    zassert_within(res->detect_delay_ms, 0, 500);
+
+    // Under drogue at the end
+    zassert_within(res->final_speed, (int)(DROGUE_MS * 10), 15, "%d dm/s", res->final_speed);
+}
+
+ZTEST(kalman_filter, test_flight)
+{
+    struct flight_result res;
+    fly_flight(&res, 0);
+    check_flight(&res);
+}
+
+ZTEST(kalman_filter, test_flight_with_lost_samples)
+{
+    // One in four lost: each integrated over one period, the apogee is detected seconds late
+    struct flight_result res;
+    fly_flight(&res, 4);
+    check_flight(&res);
+}
@@ -0,0 +1,387 @@
+/*
+ * Modbus RTU bus timing benchmark.
+ *
+ * The OBC client and one Zephyr modbus server per board run in the same native_sim image,
+ * each on its own emulated UART. The UARTs are bridged in software so the servers behave
+ * like slaves on a shared multi-drop line, standing in for the pymodbus simulator in
+ * scripts/obc_monitor/modbus.py without needing a host process.
+ *
+ * Emulated UARTs move bytes instantly, so the measured latency is the protocol cost: the
+ * RTU inter-frame silence (t3.5) on both ends, scheduling and request handling. The time
+ * the frames spend on the wire is modelled from the baud rate and added on top to get the
+ * transaction time expected on the real bus.
+ */
+#include "services/modbus/common.h"
+#include "services/modbus/hydra.h"
+#include "services/modbus/lift.h"
+
+#include <stdlib.h>
+
+#include "zephyr/drivers/serial/uart_emul.h"
+#include "zephyr/kernel.h"
+#include "zephyr/modbus/modbus.h"
+#include "zephyr/sys/util.h"
+#include <zephyr/ztest.h>
+
+#define MODBUS_MAX_READ_REGS 125
+
+// RTU frame overhead: unit id, function code and CRC on both frames, plus the register
+// address and quantity on the request and the byte count on the response.
+#define RTU_REQUEST_CHARS      8
+#define RTU_RESPONSE_OVERHEAD  5
+#define RTU_BITS_PER_CHAR      10 // start + 8 data + 1 stop, no parity
+#define RTU_BRIDGE_CHUNK       64
+#define BENCHMARK_DEFAULT_BAUD 115200
+
+struct bench_slave {
+    const char *const label;
+    const struct device *const uart;
+    const char *const iface_name;
+    const uint8_t unit_id;
+    const uint16_t reg_count;
+    bool online;
+};
+
+struct latency_stats {
+    uint32_t p50;
+    uint32_t p90;
+    uint32_t p99;
+    uint32_t max;
+};
+
+#define BENCH_SLAVE(_label, _node, _id, _regs)                                               \
+    {                                                                                        \
+        .label = _label, .uart = DEVICE_DT_GET(DT_PARENT(DT_NODELABEL(_node))),              \
+        .iface_name = DEVICE_DT_NAME(DT_NODELABEL(_node)), .unit_id = _id,                   \
+        .reg_count = _regs,                                                                  \
+    }
+
+// Ordered as polled by the OBC, register counts follow the OBC board definitions
+static struct bench_slave slaves[] = {
+    BENCH_SLAVE("UF hydra", modbus_uf_hydra, CONFIG_MODBUS_HYDRA_UF_SLAVE_ID,
+                sizeof(union uf_sensors) / sizeof(uint16_t)),
+    BENCH_SLAVE("LF hydra", modbus_lf_hydra, CONFIG_MODBUS_HYDRA_LF_SLAVE_ID,
+                sizeof(union lf_sensors) / sizeof(uint16_t)),
+    BENCH_SLAVE("FS hydra", modbus_fs_hydra, CONFIG_MODBUS_HYDRA_FS_SLAVE_ID,
+                sizeof(union fs_sensors) / sizeof(uint16_t)),
+    BENCH_SLAVE("Rocket lift", modbus_rocket_lift, CONFIG_MODBUS_ROCKET_LIFT_SLAVE_ID,
+                sizeof(union r_loadcells) / sizeof(uint16_t)),
+    BENCH_SLAVE("FS lift", modbus_fs_lift, CONFIG_MODBUS_FS_LIFT_SLAVE_ID, 1),
+};
+
+static const struct device *const client_uart = DEVICE_DT_GET(DT_NODELABEL(euart_client));
+static int client_iface;
+static bool bus_running;
+
+static uint32_t samples[CONFIG_BENCHMARK_SAMPLES];
+static uint16_t regs[MODBUS_MAX_READ_REGS];
+
+// --- Emulated bus ---
+
+static void client_tx_ready(const struct device *dev, size_t size, void *user_data)
+{
+    ARG_UNUSED(size);
+    ARG_UNUSED(user_data);
+
+    uint8_t chunk[RTU_BRIDGE_CHUNK];
+    uint32_t len;
+
+    // Every slave sees every request, as on the real line
+    while ((len = uart_emul_get_tx_data(dev, chunk, sizeof(chunk))) > 0) {
+        for (size_t i = 0; i < ARRAY_SIZE(slaves); i++) {
+            if (slaves[i].online) {
+                uart_emul_put_rx_data(slaves[i].uart, chunk, len);
+            }
+        }
+    }
+}
+
+static void slave_tx_ready(const struct device *dev, size_t size, void *user_data)
+{
+    ARG_UNUSED(size);
+    ARG_UNUSED(user_data);
+
+    uint8_t chunk[RTU_BRIDGE_CHUNK];
+    uint32_t len;
+
+    while ((len = uart_emul_get_tx_data(dev, chunk, sizeof(chunk))) > 0) {
+        uart_emul_put_rx_data(client_uart, chunk, len);
+    }
+}
+
+static int slave_input_reg_rd(uint16_t addr, uint16_t *reg)
+{
+    *reg = addr;
+    return 0;
+}
+
+static struct modbus_user_callbacks slave_callbacks = {
+    .input_reg_rd = slave_input_reg_rd,
+};
+
+static int slave_start(struct bench_slave *const slave, const uint32_t baud)
+{
+    const struct modbus_iface_param param = {
+        .mode = MODBUS_MODE_RTU,
+        .server =
+            {
+                .user_cb = &slave_callbacks,
+                .unit_id = slave->unit_id,
+            },
+        .serial =
+            {
+                .baud = baud,
+                .parity = UART_CFG_PARITY_NONE,
+            },
+    };
+
+    const int iface = modbus_iface_get_by_name(slave->iface_name);
+    if (iface < 0) {
+        return iface;
+    }
+
+    int rc = modbus_init_server(iface, param);
+    slave->online = rc == 0;
+    return rc;
+}
+
+static void slave_stop(struct bench_slave *const slave)
+{
+    slave->online = false;
+    modbus_disable(modbus_iface_get_by_name(slave->iface_name));
+}
+
+static void bus_start(const uint32_t baud)
+{
+    const struct modbus_iface_param param = {
+        .mode = MODBUS_MODE_RTU,
+        .rx_timeout = CONFIG_BENCHMARK_RX_TIMEOUT_USEC,
+        .serial =
+            {
+                .baud = baud,
+                .parity = UART_CFG_PARITY_NONE,
+                .stop_bits_client = UART_CFG_STOP_BITS_1,
+            },
+    };
+
+    client_iface = modbus_iface_get_by_name(DEVICE_DT_NAME(DT_NODELABEL(modbus_client)));
+    zassert_true(client_iface >= 0, "Modbus client interface not found");
+    zassert_ok(modbus_init_client(client_iface, param), "Failed to start the client");
+
+    for (size_t i = 0; i < ARRAY_SIZE(slaves); i++) {
+        zassert_ok(slave_start(&slaves[i], baud), "Failed to start [%s]", slaves[i].label);
+    }
+
+    bus_running = true;
+}
+
+static void bus_stop(void)
+{
+    if (!bus_running) {
+        return;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(slaves); i++) {
+        slave_stop(&slaves[i]);
+    }
+
+    modbus_disable(client_iface);
+    bus_running = false;
+}
+
+static void *benchmark_setup(void)
+{
+    zassert_true(device_is_ready(client_uart), "Client UART not ready");
+    uart_emul_callback_tx_data_ready_set(client_uart, client_tx_ready, NULL);
+
+    for (size_t i = 0; i < ARRAY_SIZE(slaves); i++) {
+        zassert_true(device_is_ready(slaves[i].uart), "[%s] UART not ready", slaves[i].label);
+        uart_emul_callback_tx_data_ready_set(slaves[i].uart, slave_tx_ready, NULL);
+    }
+
+    return NULL;
+}
+
+static void benchmark_after(void *f)
+{
+    ARG_UNUSED(f);
+    bus_stop();
+}
+
+ZTEST_SUITE(modbus_benchmark, NULL, benchmark_setup, NULL, benchmark_after, NULL);
+
+// --- Measurement helpers ---
+
+static uint32_t wire_time_us(const uint32_t baud, const uint16_t reg_count)
+{
+    const uint64_t chars = RTU_REQUEST_CHARS + RTU_RESPONSE_OVERHEAD + 2 * reg_count;
+    return (uint32_t)DIV_ROUND_UP(chars * RTU_BITS_PER_CHAR * USEC_PER_SEC, baud);
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    const uint32_t x = *(const uint32_t *)a;
+    const uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static struct latency_stats compute_stats(uint32_t *const values, const size_t count)
+{
+    qsort(values, count, sizeof(values[0]), compare_u32);
+
+    return (struct latency_stats){
+        .p50 = values[(count * 50) / 100],
+        .p90 = values[(count * 90) / 100],
+        .p99 = values[(count * 99) / 100],
+        .max = values[count - 1],
+    };
+}
+
+static uint32_t timed_read(const uint8_t unit_id, const uint16_t reg_count)
+{
+    const uint32_t start = k_cycle_get_32();
+    int rc = modbus_read_input_regs(client_iface, unit_id, 0, regs, reg_count);
+    const uint32_t elapsed = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+    zassert_ok(rc, "Read of %u registers from slave %u failed: %d", reg_count, unit_id, rc);
+    zassert_equal(regs[reg_count - 1], reg_count - 1, "Slave returned unexpected data");
+    return elapsed;
+}
+
+static void measure_single_slave(const uint32_t baud, const uint16_t reg_count)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(samples); i++) {
+        samples[i] = timed_read(slaves[0].unit_id, reg_count);
+    }
+
+    const struct latency_stats s = compute_stats(samples, ARRAY_SIZE(samples));
+    const uint32_t wire = wire_time_us(baud, reg_count);
+
+    TC_PRINT("%7u %4u | %6u %6u %6u %6u | %6u | %6u %6u\n", baud, reg_count, s.p50, s.p90,
+             s.p99, s.max, wire, s.p99 + wire, USEC_PER_SEC / (s.p99 + wire));
+}
+
+static void print_single_slave_header(void)
+{
+    TC_PRINT("%d transactions per point, latencies in us\n", CONFIG_BENCHMARK_SAMPLES);
+    TC_PRINT("   baud regs |    p50    p90    p99    max |   wire |  total max_hz\n");
+}
+
+// --- Benchmarks ---
+
+ZTEST(modbus_benchmark, test_baud_sweep)
+{
+    static const uint32_t bauds[] = {9600, 19200, 38400, 57600, 115200, 230400, 460800};
+    // Largest block polled by the OBC
+    const uint16_t reg_count = slaves[2].reg_count;
+
+    print_single_slave_header();
+
+    for (size_t i = 0; i < ARRAY_SIZE(bauds); i++) {
+        bus_start(bauds[i]);
+        measure_single_slave(bauds[i], reg_count);
+        bus_stop();
+    }
+}
+
+ZTEST(modbus_benchmark, test_register_count_sweep)
+{
+    static const uint16_t reg_counts[] = {1, 3, 4, 6, 16, 32, 64, MODBUS_MAX_READ_REGS};
+
+    print_single_slave_header();
+    bus_start(BENCHMARK_DEFAULT_BAUD);
+
+    for (size_t i = 0; i < ARRAY_SIZE(reg_counts); i++) {
+        measure_single_slave(BENCHMARK_DEFAULT_BAUD, reg_counts[i]);
+    }
+}
+
+ZTEST(modbus_benchmark, test_slave_count_sweep)
+{
+    static const uint32_t bauds[] = {57600, 115200, 460800};
+
+    TC_PRINT("%d polling cycles per point, latencies in us\n", CONFIG_BENCHMARK_SAMPLES);
+    TC_PRINT("   baud slaves |    p50    p90    p99    max |   wire |  total max_hz\n");
+
+    for (size_t b = 0; b < ARRAY_SIZE(bauds); b++) {
+        bus_start(bauds[b]);
+
+        uint32_t wire = 0;
+        for (size_t n = 1; n <= ARRAY_SIZE(slaves); n++) {
+            wire += wire_time_us(bauds[b], slaves[n - 1].reg_count);
+
+            for (size_t i = 0; i < ARRAY_SIZE(samples); i++) {
+                samples[i] = 0;
+                for (size_t s = 0; s < n; s++) {
+                    samples[i] += timed_read(slaves[s].unit_id, slaves[s].reg_count);
+                }
+            }
+
+            const struct latency_stats s = compute_stats(samples, ARRAY_SIZE(samples));
+            TC_PRINT("%7u %6u | %6u %6u %6u %6u | %6u | %6u %6u\n", bauds[b], n, s.p50, s.p90,
+                     s.p99, s.max, wire, s.p99 + wire, USEC_PER_SEC / (s.p99 + wire));
+        }
+
+        bus_stop();
+    }
+}
+
+ZTEST(modbus_benchmark, test_offline_slave_cycle_cost)
+{
+    static uint32_t raw_cycle[CONFIG_BENCHMARK_SAMPLES];
+    struct modbus_slave_metadata meta[ARRAY_SIZE(slaves)];
+
+    bus_start(BENCHMARK_DEFAULT_BAUD);
+
+    // The FS lift drops off the bus
+    struct bench_slave *const offline = &slaves[ARRAY_SIZE(slaves) - 1];
+    slave_stop(offline);
+
+    // Plain reads pay the full response timeout every cycle
+    for (size_t i = 0; i < ARRAY_SIZE(raw_cycle); i++) {
+        const uint32_t start = k_cycle_get_32();
+        for (size_t s = 0; s < ARRAY_SIZE(slaves); s++) {
+            modbus_read_input_regs(client_iface, slaves[s].unit_id, 0, regs,
+                                   slaves[s].reg_count);
+        }
+        raw_cycle[i] = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+    }
+
+    // Reads through the health tracker back off the dead slave
+    for (size_t s = 0; s < ARRAY_SIZE(slaves); s++) {
+        meta[s] = (struct modbus_slave_metadata){
+            .slave_id = slaves[s].unit_id,
+            .is_connected = true,
+            .ir_start = 0,
+        };
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(samples); i++) {
+        const uint32_t start = k_cycle_get_32();
+        for (size_t s = 0; s < ARRAY_SIZE(slaves); s++) {
+            modbus_slave_read_irs(client_iface, &meta[s], regs, slaves[s].reg_count,
+                                  slaves[s].label);
+        }
+        samples[i] = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+    }
+
+    const struct latency_stats raw = compute_stats(raw_cycle, ARRAY_SIZE(raw_cycle));
+    const struct latency_stats tracked = compute_stats(samples, ARRAY_SIZE(samples));
+    const struct modbus_slave_health *const h = &meta[ARRAY_SIZE(slaves) - 1].health;
+
+    TC_PRINT("Polling cycle with [%s] offline, latencies in us\n", offline->label);
+    TC_PRINT("         |    p50    p90    p99    max\n");
+    TC_PRINT("plain    | %6u %6u %6u %6u\n", raw.p50, raw.p90, raw.p99, raw.max);
+    TC_PRINT("tracked  | %6u %6u %6u %6u\n", tracked.p50, tracked.p90, tracked.p99,
+             tracked.max);
+    TC_PRINT("[%s]: %u reads, %u errors, backoff %u ms\n", offline->label, h->total_reads,
+             h->total_errors, h->backoff_ms);
+
+    zassert_false(meta[ARRAY_SIZE(slaves) - 1].is_connected, "Offline slave not flagged");
+    zassert_true(tracked.p50 < raw.p50, "Health tracking did not shorten the polling cycle");
+
+    for (size_t s = 0; s < ARRAY_SIZE(slaves) - 1; s++) {
+        zassert_true(meta[s].is_connected, "[%s] flagged as disconnected", slaves[s].label);
+        zassert_equal(meta[s].health.total_errors, 0, "[%s] had errors", slaves[s].label);
+    }
+}
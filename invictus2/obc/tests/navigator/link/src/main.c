@@ -0,0 +1,188 @@
+/*
+ * Navigator link framing tests: round trips, resynchronization and error accounting.
+ */
+#include <invictus2/nav_link.h>
+
+#include <string.h>
+
+#include <zephyr/ztest.h>
+
+static struct nav_link_decoder dec;
+static navigator_sample_t received[4 * NAV_LINK_MAX_BATCH];
+static int received_count;
+static int frames_seen;
+
+static void on_frame(const struct nav_link_frame *frame, void *user_data)
+{
+    ARG_UNUSED(user_data);
+
+    zassert_equal(frame->header.type, NAV_LINK_SENSORS);
+    zassert_true(received_count + frame->header.count <= ARRAY_SIZE(received));
+
+    memcpy(&received[received_count], frame->samples,
+           frame->header.count * sizeof(navigator_sample_t));
+    received_count += frame->header.count;
+    frames_seen++;
+}
+
+static void make_samples(navigator_sample_t *samples, int n, uint8_t fill)
+{
+    for (int i = 0; i < n; i++)
+    {
+        memset(&samples[i], fill, sizeof(samples[i]));
+        samples[i].timestamp_us = 1250 * i + 0x100000000ULL;
+        samples[i].sensors.accel_z = 1000 + i;
+        samples[i].sensors.baro1 = 10132;
+    }
+}
+
+static void before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+    nav_link_decoder_init(&dec);
+    received_count = 0;
+    frames_seen = 0;
+}
+
+ZTEST_SUITE(navigator_link, NULL, NULL, before, NULL, NULL);
+
+ZTEST(navigator_link, test_round_trip)
+{
+    navigator_sample_t samples[NAV_LINK_MAX_BATCH];
+    uint8_t frame[NAV_LINK_MAX_FRAME];
+
+    // Zero filled samples: every other byte becomes a COBS code
+    make_samples(samples, NAV_LINK_MAX_BATCH, 0x00);
+    size_t n = nav_link_encode(NAV_LINK_SENSORS, 0, samples, NAV_LINK_MAX_BATCH, frame,
+                               sizeof(frame));
+    zassert_true(n > 0);
+    zassert_equal(frame[n - 1], 0);
+    zassert_is_null(memchr(frame, 0, n - 1), "delimiter inside the frame");
+
+    nav_link_decode(&dec, frame, n, on_frame, NULL);
+    zassert_equal(frames_seen, 1);
+    zassert_mem_equal(received, samples, sizeof(samples));
+
+    // No zeros at all: runs longer than a COBS block
+    make_samples(samples, NAV_LINK_MAX_BATCH, 0x5A);
+    n = nav_link_encode(NAV_LINK_SENSORS, 1, samples, NAV_LINK_MAX_BATCH, frame,
+                        sizeof(frame));
+    zassert_true(n > 0);
+
+    nav_link_decode(&dec, frame, n, on_frame, NULL);
+    zassert_equal(frames_seen, 2);
+    zassert_mem_equal(&received[NAV_LINK_MAX_BATCH], samples, sizeof(samples));
+    zassert_equal(dec.stats.lost_frames, 0);
+}
+
+ZTEST(navigator_link, test_encode_limits)
+{
+    navigator_sample_t samples[NAV_LINK_MAX_BATCH + 1];
+    uint8_t frame[NAV_LINK_MAX_FRAME];
+
+    make_samples(samples, ARRAY_SIZE(samples), 0x00);
+
+    zassert_equal(nav_link_encode(NAV_LINK_SENSORS, 0, samples, 0, frame, sizeof(frame)), 0);
+    zassert_equal(nav_link_encode(NAV_LINK_SENSORS, 0, samples, NAV_LINK_MAX_BATCH + 1, frame,
+                                  sizeof(frame)),
+                  0);
+    zassert_equal(nav_link_encode(0x7F, 0, samples, 1, frame, sizeof(frame)), 0);
+    zassert_equal(nav_link_encode(NAV_LINK_SENSORS, 0, samples, 2, frame, 32), 0);
+}
+
+ZTEST(navigator_link, test_resync_byte_by_byte)
+{
+    navigator_sample_t samples[3];
+    uint8_t stream[3 * NAV_LINK_MAX_FRAME];
+    size_t len = 0;
+
+    // Tail of a frame we joined in the middle of, then idle delimiters
+    const uint8_t garbage[] = {0x13, 0x37, 0x42, 0x00, 0x00, 0x00};
+    memcpy(stream, garbage, sizeof(garbage));
+    len += sizeof(garbage);
+
+    make_samples(samples, ARRAY_SIZE(samples), 0x00);
+    for (int i = 0; i < 2; i++)
+    {
+        len += nav_link_encode(NAV_LINK_SENSORS, 100 + i, samples, ARRAY_SIZE(samples),
+                               &stream[len], sizeof(stream) - len);
+    }
+
+    for (size_t i = 0; i < len; i++)
+    {
+        nav_link_decode(&dec, &stream[i], 1, on_frame, NULL);
+    }
+
+    zassert_equal(frames_seen, 2);
+    zassert_equal(received_count, 6);
+    zassert_equal(dec.stats.framing_errors + dec.stats.crc_errors, 1);
+    zassert_mem_equal(&received[3], samples, sizeof(samples));
+}
+
+ZTEST(navigator_link, test_corruption_and_loss)
+{
+    navigator_sample_t samples[2];
+    uint8_t frame[NAV_LINK_MAX_FRAME];
+
+    make_samples(samples, ARRAY_SIZE(samples), 0x00);
+
+    size_t n = nav_link_encode(NAV_LINK_SENSORS, 7, samples, 2, frame, sizeof(frame));
+    nav_link_decode(&dec, frame, n, on_frame, NULL);
+
+    // Flipped bit: dropped, and counted
+    n = nav_link_encode(NAV_LINK_SENSORS, 8, samples, 2, frame, sizeof(frame));
+    frame[n / 2] ^= 0x10;
+    nav_link_decode(&dec, frame, n, on_frame, NULL);
+    zassert_equal(frames_seen, 1);
+    zassert_equal(dec.stats.crc_errors + dec.stats.framing_errors, 1);
+
+    // Seq 8 never made it and 9, 10 were lost on the wire
+    n = nav_link_encode(NAV_LINK_SENSORS, 11, samples, 2, frame, sizeof(frame));
+    nav_link_decode(&dec, frame, n, on_frame, NULL);
+    zassert_equal(frames_seen, 2);
+    zassert_equal(dec.stats.lost_frames, 3);
+}
+
+ZTEST(navigator_link, test_oversized_frame)
+{
+    navigator_sample_t samples[1];
+    uint8_t frame[NAV_LINK_MAX_FRAME];
+    uint8_t noise[NAV_LINK_MAX_FRAME + 16];
+
+    memset(noise, 0xA5, sizeof(noise));
+    nav_link_decode(&dec, noise, sizeof(noise), on_frame, NULL);
+
+    make_samples(samples, 1, 0x00);
+    size_t n = nav_link_encode(NAV_LINK_SENSORS, 0, samples, 1, frame, sizeof(frame));
+
+    // The frame delimiter closes the noise, the frame after it comes through
+    nav_link_decode(&dec, frame, n, on_frame, NULL);
+    nav_link_decode(&dec, frame, n, on_frame, NULL);
+
+    zassert_equal(dec.stats.framing_errors, 1);
+    zassert_equal(frames_seen, 1);
+}
+
+static void on_sync(const struct nav_link_frame *frame, void *user_data)
+{
+    struct nav_link_sync *sync = user_data;
+
+    zassert_equal(frame->header.type, NAV_LINK_SYNC);
+    zassert_equal(frame->header.count, 1);
+    memcpy(sync, frame->samples, sizeof(*sync));
+    frames_seen++;
+}
+
+ZTEST(navigator_link, test_sync_frame)
+{
+    const struct nav_link_sync sent = {.master_us = 0x0000012345678900ULL};
+    struct nav_link_sync received_sync = {0};
+    uint8_t frame[NAV_LINK_MAX_FRAME];
+
+    const size_t n = nav_link_encode(NAV_LINK_SYNC, 0, &sent, 1, frame, sizeof(frame));
+    zassert_true(n > 0);
+
+    nav_link_decode(&dec, frame, n, on_sync, &received_sync);
+    zassert_equal(frames_seen, 1);
+    zassert_equal(received_sync.master_us, sent.master_us);
+}
@@ -0,0 +1,397 @@
+/*
+ * SD logger block buffering tests: the double buffer and the pre-trigger ring, written to an
+ * in-memory card by a writer that runs its work items in submission order, like the logger
+ * work queue. Whatever the interleaving of arming, wrapping, triggering, writes and stopping,
+ * every block must land at the offset of its sequence number, so that sd_log_scan() finds
+ * the whole log, and the records must come out in the order they were logged.
+ */
+#include "services/sd_logger/log_buffer.h"
+
+#include <string.h>
+
+#include <zephyr/ztest.h>
+
+#define BUF_BLOCKS  4
+#define RING_BLOCKS 8
+#define CARD_BLOCKS 512
+#define SESSION     0x5EED0042
+
+// Records of a uint32_t per block
+#define RECORD_SIZE (sizeof(struct sd_log_record_hdr) + sizeof(uint32_t))
+#define PER_BLOCK   (SD_LOG_BLOCK_PAYLOAD / RECORD_SIZE)
+
+static struct sd_log_block bufs[2][BUF_BLOCKS];
+static struct sd_log_block ring[RING_BLOCKS];
+static struct log_buffer lb = {
+    .bufs = {bufs[0], bufs[1]},
+    .buf_blocks = BUF_BLOCKS,
+    .ring = ring,
+    .ring_blocks = RING_BLOCKS,
+};
+
+static struct sd_log_block card[CARD_BLOCKS];
+static struct sd_log_block scratch;
+static uint32_t file_blocks;
+static uint32_t pretrigger_blocks;
+static uint32_t counter; // Payload of the next record, its logging order
+
+enum work
+{
+    WORK_WRITE,
+    WORK_DRAIN,
+};
+
+// Work queue, an item already queued is not queued again
+static enum work queue[2];
+static size_t queued;
+
+static void submit_one(enum work item)
+{
+    for (size_t i = 0; i < queued; i++)
+    {
+        if (queue[i] == item)
+        {
+            return;
+        }
+    }
+
+    queue[queued++] = item;
+}
+
+static void submit(uint32_t events)
+{
+    if (events & LOG_BUFFER_WRITE)
+    {
+        submit_one(WORK_WRITE);
+    }
+
+    if (events & LOG_BUFFER_DRAIN)
+    {
+        submit_one(WORK_DRAIN);
+    }
+}
+
+static void write_blocks(struct sd_log_block *blocks, size_t count)
+{
+    zassert_true(file_blocks + count <= CARD_BLOCKS, "card full");
+
+    for (size_t i = 0; i < count; i++)
+    {
+        sd_log_block_seal(&blocks[i]);
+        card[file_blocks++] = blocks[i];
+    }
+}
+
+static void drain_ring(void)
+{
+    struct log_buffer_run runs[2];
+    const size_t count = log_buffer_frozen(&lb, runs);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        write_blocks(runs[i].blocks, runs[i].count);
+        pretrigger_blocks += runs[i].count;
+    }
+
+    if (count > 0)
+    {
+        submit(log_buffer_drained(&lb));
+    }
+}
+
+// Run the queued work, as the writer thread
+static void run_work(void)
+{
+    while (queued > 0)
+    {
+        const enum work item = queue[0];
+        memmove(&queue[0], &queue[1], --queued * sizeof(queue[0]));
+
+        if (item == WORK_WRITE)
+        {
+            struct sd_log_block *blocks;
+            const uint16_t count = log_buffer_pending(&lb, &blocks);
+            if (count > 0)
+            {
+                write_blocks(blocks, count);
+                submit(log_buffer_written(&lb));
+            }
+        }
+        else
+        {
+            drain_ring();
+        }
+    }
+}
+
+// Close the log, as the stop work does, whatever is still queued
+static void stop(void)
+{
+    struct sd_log_block *blocks;
+    uint16_t count;
+    size_t before;
+
+    log_buffer_stop(&lb);
+
+    do
+    {
+        before = file_blocks;
+
+        count = log_buffer_pending(&lb, &blocks);
+        if (count > 0)
+        {
+            write_blocks(blocks, count);
+            (void)log_buffer_written(&lb);
+        }
+
+        drain_ring();
+    } while (file_blocks != before);
+
+    count = log_buffer_partial(&lb, &blocks);
+    write_blocks(blocks, count);
+    queued = 0;
+}
+
+static void log_records(uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        submit(log_buffer_append(&lb, SD_LOG_REC_NAVIGATOR, &counter, sizeof(counter),
+                                 counter));
+        counter++;
+    }
+}
+
+static int read_card(void *ctx, uint32_t index, struct sd_log_block *blk)
+{
+    ARG_UNUSED(ctx);
+
+    if (index >= CARD_BLOCKS)
+    {
+        return -EIO;
+    }
+
+    *blk = card[index];
+    return 0;
+}
+
+// The log on the card is whole, in order, and holds every record kept
+static void check_log(void)
+{
+    struct sd_log_scan scan;
+    sd_log_scan(read_card, NULL, CARD_BLOCKS, MAX(BUF_BLOCKS, RING_BLOCKS), &scratch, &scan);
+
+    zassert_equal(scan.session, SESSION);
+    zassert_equal(scan.blocks, file_blocks, "log ends at %u of %u blocks", scan.blocks,
+                  file_blocks);
+    zassert_equal(scan.lost, 0);
+
+    uint32_t records = 0;
+    int64_t last = -1;
+
+    for (uint32_t seq = 0; seq < file_blocks; seq++)
+    {
+        const struct sd_log_block *const blk = &card[seq];
+        zassert_true(sd_log_block_is_valid(blk, SESSION, seq), "block %u out of place", seq);
+
+        size_t off = 0;
+        for (uint16_t i = 0; i < blk->hdr.records; i++)
+        {
+            struct sd_log_record_hdr hdr;
+            uint32_t value;
+
+            memcpy(&hdr, &blk->data[off], sizeof(hdr));
+            memcpy(&value, &blk->data[off + sizeof(hdr)], sizeof(value));
+            off += sizeof(hdr) + hdr.len;
+
+            zassert_equal(hdr.type, SD_LOG_REC_NAVIGATOR);
+            zassert_true((int64_t)value > last, "record %u after %d in block %u", value,
+                         (int)last, seq);
+            last = value;
+            records++;
+        }
+    }
+
+    zassert_equal(records, lb.records, "%u records in the log, %u kept", records,
+                  lb.records);
+}
+
+static void before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+
+    memset(card, 0, sizeof(card));
+    file_blocks = 0;
+    pretrigger_blocks = 0;
+    counter = 0;
+    queued = 0;
+    log_buffer_start(&lb, SESSION);
+}
+
+ZTEST_SUITE(sd_log_recorder, NULL, NULL, before, NULL, NULL);
+
+ZTEST(sd_log_recorder, test_double_buffer)
+{
+    for (int i = 0; i < 10; i++)
+    {
+        log_records(PER_BLOCK + 7);
+        run_work();
+    }
+    stop();
+
+    zassert_equal(lb.dropped, 0);
+    zassert_equal(lb.records, counter);
+    check_log();
+}
+
+ZTEST(sd_log_recorder, test_arm_wrap_trigger)
+{
+    log_records(PER_BLOCK + PER_BLOCK / 2);
+    run_work();
+
+    submit(log_buffer_arm(&lb));
+    zassert_equal(lb.recorder, LOG_BUFFER_REC_PRETRIGGER);
+    run_work();
+    const uint32_t armed_at = counter;
+
+    // The pad, the ring wraps three times and nothing is written meanwhile
+    log_records(3 * RING_BLOCKS * PER_BLOCK + 5);
+    run_work();
+    zassert_equal(file_blocks, 2, "only the blocks logged before arming are written");
+
+    submit(log_buffer_trigger(&lb));
+    log_records(2 * BUF_BLOCKS * PER_BLOCK);
+    run_work();
+    stop();
+
+    zassert_equal(pretrigger_blocks, RING_BLOCKS);
+    zassert_true(lb.records < counter - 2 * RING_BLOCKS * PER_BLOCK, "oldest blocks kept");
+    zassert_true(card[2].hdr.records > 0);
+    check_log();
+
+    // The ring kept the last window only
+    uint32_t first;
+    memcpy(&first, &card[2].data[sizeof(struct sd_log_record_hdr)], sizeof(first));
+    zassert_true(first > armed_at + 2 * RING_BLOCKS * PER_BLOCK);
+}
+
+ZTEST(sd_log_recorder, test_arm_without_records)
+{
+    submit(log_buffer_arm(&lb));
+    zassert_equal(lb.recorder, LOG_BUFFER_REC_PRETRIGGER);
+    log_records(RING_BLOCKS / 2 * PER_BLOCK + 1);
+
+    submit(log_buffer_trigger(&lb));
+    log_records(PER_BLOCK);
+    run_work();
+    stop();
+
+    zassert_equal(pretrigger_blocks, RING_BLOCKS / 2 + 1);
+    check_log();
+}
+
+ZTEST(sd_log_recorder, test_trigger_empty_ring)
+{
+    log_records(PER_BLOCK / 2);
+    submit(log_buffer_arm(&lb));
+    run_work();
+
+    // Nothing was logged to the ring, its only block is dropped
+    zassert_equal(log_buffer_trigger(&lb), 0);
+    log_records(PER_BLOCK);
+    run_work();
+    stop();
+
+    zassert_equal(pretrigger_blocks, 0);
+    check_log();
+}
+
+ZTEST(sd_log_recorder, test_arm_while_writing)
+{
+    // A full buffer waits for the writer, arming waits for it too
+    log_records(BUF_BLOCKS * PER_BLOCK + 3);
+    zassert_equal(queued, 1);
+
+    zassert_equal(log_buffer_arm(&lb), 0);
+    zassert_equal(lb.recorder, LOG_BUFFER_REC_ARMING);
+    log_records(PER_BLOCK);
+
+    run_work();
+    zassert_equal(lb.recorder, LOG_BUFFER_REC_PRETRIGGER);
+
+    log_records(RING_BLOCKS * PER_BLOCK);
+    submit(log_buffer_trigger(&lb));
+    run_work();
+    stop();
+
+    check_log();
+}
+
+ZTEST(sd_log_recorder, test_rearm_after_drain)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        log_records(PER_BLOCK);
+        submit(log_buffer_arm(&lb));
+        log_records(2 * RING_BLOCKS * PER_BLOCK);
+
+        submit(log_buffer_trigger(&lb));
+        zassert_equal(log_buffer_arm(&lb), 0, "armed before the ring was written");
+        run_work();
+    }
+    stop();
+
+    zassert_equal(pretrigger_blocks, 3 * RING_BLOCKS);
+    check_log();
+}
+
+ZTEST(sd_log_recorder, test_stop_while_draining)
+{
+    log_records(PER_BLOCK);
+    submit(log_buffer_arm(&lb));
+    run_work();
+    log_records(2 * RING_BLOCKS * PER_BLOCK);
+
+    // The ring work is queued, a buffer numbered after the ring is handed over before it
+    // runs, then the stop work goes first
+    submit(log_buffer_trigger(&lb));
+    log_records(BUF_BLOCKS * PER_BLOCK + 1);
+    zassert_equal(queued, 2);
+
+    struct sd_log_block *blocks;
+    zassert_equal(log_buffer_pending(&lb, &blocks), 0, "written before the ring");
+
+    stop();
+
+    zassert_equal(pretrigger_blocks, RING_BLOCKS);
+    check_log();
+}
+
+ZTEST(sd_log_recorder, test_stop_before_any_write)
+{
+    // Arming hands the first blocks over, the ring is frozen and the live buffer fills up
+    // before the writer ran once
+    log_records(PER_BLOCK + 1);
+    submit(log_buffer_arm(&lb));
+    log_records(RING_BLOCKS * PER_BLOCK);
+    submit(log_buffer_trigger(&lb));
+    log_records(3 * BUF_BLOCKS * PER_BLOCK);
+    zassert_true(lb.dropped > 0);
+
+    stop();
+    check_log();
+}
+
+ZTEST(sd_log_recorder, test_stop_while_armed)
+{
+    log_records(3);
+    submit(log_buffer_arm(&lb));
+    run_work();
+    log_records(RING_BLOCKS * PER_BLOCK + PER_BLOCK / 3);
+
+    stop();
+
+    zassert_equal(lb.recorder, LOG_BUFFER_REC_OFF);
+    zassert_equal(pretrigger_blocks, RING_BLOCKS);
+    check_log();
+}
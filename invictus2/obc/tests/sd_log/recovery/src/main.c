@@ -0,0 +1,209 @@
+/*
+ * SD log format tests: block building and checking, and recovery of the end of a log
+ * written to an in-memory card, as left by a clean stop, a power loss and a torn write.
+ */
+#include <invictus2/sd_log.h>
+
+#include <string.h>
+
+#include <zephyr/ztest.h>
+
+#define CARD_BLOCKS  2048
+#define WRITE_BLOCKS 32 // Blocks per logger write
+#define SESSION      0xC0FFEE42
+
+static struct sd_log_block card[CARD_BLOCKS];
+static struct sd_log_block scratch;
+
+static int read_card(void *ctx, uint32_t index, struct sd_log_block *blk)
+{
+    ARG_UNUSED(ctx);
+
+    if (index >= CARD_BLOCKS) {
+        return -EIO;
+    }
+
+    *blk = card[index];
+    return 0;
+}
+
+static void fill_block(struct sd_log_block *blk, uint32_t session, uint32_t seq)
+{
+    const uint32_t value = seq;
+    const struct sd_log_record_hdr hdr = {
+        .type = SD_LOG_REC_NAVIGATOR,
+        .len = sizeof(value),
+        .time_us = seq * 1250,
+    };
+
+    sd_log_block_init(blk, session, seq);
+    while (sd_log_block_append(blk, &hdr, &value)) {
+    }
+    sd_log_block_seal(blk);
+}
+
+// Write blocks [0, count) of a log of the session
+static void write_log(uint32_t session, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        fill_block(&card[i], session, i);
+    }
+}
+
+static uint32_t log2_ceil(uint32_t n)
+{
+    uint32_t bits = 0;
+    while ((1U << bits) < n) {
+        bits++;
+    }
+    return bits;
+}
+
+static void before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+    // A pre-allocated file, zero filled
+    memset(card, 0, sizeof(card));
+}
+
+ZTEST_SUITE(sd_log_recovery, NULL, NULL, before, NULL, NULL);
+
+ZTEST(sd_log_recovery, test_block_check)
+{
+    struct sd_log_block blk;
+    fill_block(&blk, SESSION, 7);
+
+    zassert_true(blk.hdr.records > 0);
+    zassert_true(blk.hdr.used <= SD_LOG_BLOCK_PAYLOAD);
+    zassert_true(sd_log_block_is_valid(&blk, SESSION, 7));
+    zassert_false(sd_log_block_is_valid(&blk, SESSION, 8), "wrong position");
+    zassert_false(sd_log_block_is_valid(&blk, SESSION + 1, 7), "stale session");
+
+    blk.data[SD_LOG_BLOCK_PAYLOAD - 1] ^= 0x01;
+    zassert_false(sd_log_block_is_valid(&blk, SESSION, 7), "corrupted padding");
+}
+
+ZTEST(sd_log_recovery, test_records_fit_the_block)
+{
+    static const uint8_t payload[UINT8_MAX];
+    const struct sd_log_record_hdr hdr = {.type = SD_LOG_REC_PACKET, .len = UINT8_MAX};
+    const size_t size = sizeof(hdr) + hdr.len;
+    struct sd_log_block blk;
+
+    sd_log_block_init(&blk, SESSION, 0);
+
+    zassert_true(sd_log_block_append(&blk, &hdr, payload));
+    zassert_equal(blk.hdr.used, size);
+    zassert_false(sd_log_block_append(&blk, &hdr, payload), "records never cross blocks");
+    zassert_equal(blk.hdr.records, 1);
+
+    struct sd_log_record_hdr read;
+    memcpy(&read, blk.data, sizeof(read));
+    zassert_equal(read.type, SD_LOG_REC_PACKET);
+    zassert_equal(read.len, UINT8_MAX);
+}
+
+ZTEST(sd_log_recovery, test_scan_finds_end_of_preallocated_log)
+{
+    struct sd_log_scan scan;
+
+    for (uint32_t count = 1; count < CARD_BLOCKS; count = count * 3 + 1) {
+        memset(card, 0, sizeof(card));
+        write_log(SESSION, count);
+
+        sd_log_scan(read_card, NULL, CARD_BLOCKS, WRITE_BLOCKS, &scratch, &scan);
+
+        zassert_equal(scan.session, SESSION);
+        zassert_equal(scan.blocks, count, "log of %u blocks", count);
+        zassert_equal(scan.lost, 0);
+        // An invalid block costs a second read, a write past it
+        zassert_true(scan.reads <= 1 + 2 * log2_ceil(CARD_BLOCKS) + 2 * WRITE_BLOCKS,
+                     "%u blocks read", scan.reads);
+    }
+}
+
+ZTEST(sd_log_recovery, test_scan_full_log)
+{
+    struct sd_log_scan scan;
+
+    write_log(SESSION, CARD_BLOCKS);
+    sd_log_scan(read_card, NULL, CARD_BLOCKS, WRITE_BLOCKS, &scratch, &scan);
+
+    zassert_equal(scan.blocks, CARD_BLOCKS);
+}
+
+ZTEST(sd_log_recovery, test_scan_skips_torn_block_of_last_write)
+{
+    struct sd_log_scan scan;
+
+    // The card programmed the last write out of order and lost power halfway
+    const uint32_t count = 10 * WRITE_BLOCKS;
+    write_log(SESSION, count);
+    card[count - WRITE_BLOCKS / 2].data[3] ^= 0xFF;
+    memset(&card[count - 3], 0, sizeof(card[0]));
+
+    sd_log_scan(read_card, NULL, CARD_BLOCKS, WRITE_BLOCKS, &scratch, &scan);
+
+    zassert_equal(scan.blocks, count, "valid blocks after the torn ones are kept");
+    zassert_equal(scan.lost, 2);
+}
+
+ZTEST(sd_log_recovery, test_scan_skips_hole_of_failed_write)
+{
+    struct sd_log_scan scan;
+
+    // A write failed mid-log, the following ones went to their place after the hole
+    const uint32_t count = 1500;
+    for (uint32_t start = WRITE_BLOCKS; start + WRITE_BLOCKS < count; start += 97) {
+        memset(card, 0, sizeof(card));
+        write_log(SESSION, count);
+        memset(&card[start], 0, WRITE_BLOCKS * sizeof(card[0]));
+
+        sd_log_scan(read_card, NULL, CARD_BLOCKS, WRITE_BLOCKS, &scratch, &scan);
+
+        zassert_equal(scan.blocks, count, "hole at %u, end at %u", start, scan.blocks);
+    }
+}
+
+ZTEST(sd_log_recovery, test_scan_keeps_write_after_hole_next_to_the_end)
+{
+    struct sd_log_scan scan;
+
+    // The last write went through, one just before failed
+    const uint32_t count = 40 * WRITE_BLOCKS;
+    for (uint32_t start = count - 3 * WRITE_BLOCKS; start < count - WRITE_BLOCKS; start++) {
+        memset(card, 0, sizeof(card));
+        write_log(SESSION, count);
+        memset(&card[start], 0, WRITE_BLOCKS * sizeof(card[0]));
+
+        sd_log_scan(read_card, NULL, CARD_BLOCKS, WRITE_BLOCKS, &scratch, &scan);
+
+        zassert_equal(scan.blocks, count, "hole at %u, end at %u", start, scan.blocks);
+    }
+}
+
+ZTEST(sd_log_recovery, test_scan_ignores_stale_blocks)
+{
+    struct sd_log_scan scan;
+
+    // An older, longer log left on the clusters the new one grew into
+    write_log(SESSION - 1, CARD_BLOCKS);
+    write_log(SESSION, 100);
+
+    sd_log_scan(read_card, NULL, CARD_BLOCKS, WRITE_BLOCKS, &scratch, &scan);
+
+    zassert_equal(scan.blocks, 100);
+    zassert_equal(scan.lost, 0);
+}
+
+ZTEST(sd_log_recovery, test_scan_empty_log)
+{
+    struct sd_log_scan scan;
+
+    sd_log_scan(read_card, NULL, CARD_BLOCKS, WRITE_BLOCKS, &scratch, &scan);
+    zassert_equal(scan.blocks, 0);
+
+    sd_log_scan(read_card, NULL, 0, WRITE_BLOCKS, &scratch, &scan);
+    zassert_equal(scan.blocks, 0);
+    zassert_equal(scan.reads, 0);
+}
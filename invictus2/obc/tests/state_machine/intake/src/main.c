@@ -0,0 +1,449 @@
+/*
+ * State machine intake tests.
+ *
+ * The real sm_work.c is linked, its listener, work queue and command handling, with the
+ * state machine and the services around it replaced by stubs. The stub smf_run_state()
+ * records what the state machine is run with. Work items are held back behind a gate item
+ * to control what they find. Suites:
+ *  - contention: a lower priority thread holds the channel, the work queue must take the
+ *    queued sample regardless, once, without retrying
+ *  - intake: only the latest sensor sample is kept, commands are kept in order up to the
+ *    queue depth, one per run and stamped with their own latency ID, fill commands save the
+ *    configuration, a forced safe state does not replace a pending abort
+ *  - flight: in flight mode the executor runs the state machine, commands received within
+ *    one of its periods are each run in turn, fill commands are ignored
+ */
+#include "chan_stats.h"
+#include "data_models.h"
+#include "packets.h"
+#include "services/cmd_latency.h"
+#include "services/config_store.h"
+#include "services/health.h"
+#include "services/supervisor.h"
+#include "services/state_machine/flight_exec.h"
+#include "services/state_machine/main_sm.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/zbus/zbus.h>
+#include <zephyr/ztest.h>
+
+#include <string.h>
+
+// Declared by sm_work.c, registered by main_sm.c in the application
+LOG_MODULE_REGISTER(state_machine_service, LOG_LEVEL_INF);
+
+#define HOLDER_PRIO K_PRIO_PREEMPT(10) // Below the state machine work queue
+#define MAX_RUNS    16
+
+ZBUS_CHAN_DEFINE(chan_packets, generic_packet_t, NULL, NULL, ZBUS_OBSERVERS_EMPTY,
+                 ZBUS_MSG_INIT(0));
+ZBUS_CHAN_DEFINE(chan_weight_sensors, weight_sample_t, NULL, NULL, ZBUS_OBSERVERS_EMPTY,
+                 ZBUS_MSG_INIT(0));
+ZBUS_CHAN_DEFINE(chan_thermo_sensors, thermo_sample_t, NULL, NULL, ZBUS_OBSERVERS_EMPTY,
+                 ZBUS_MSG_INIT(0));
+ZBUS_CHAN_DEFINE(chan_pressure_sensors, pressure_sample_t, NULL, NULL, ZBUS_OBSERVERS_EMPTY,
+                 ZBUS_MSG_INIT(0));
+ZBUS_CHAN_DEFINE(chan_rocket_state, state_data_t, NULL, NULL, ZBUS_OBSERVERS_EMPTY,
+                 ZBUS_MSG_INIT(0));
+ZBUS_CHAN_DEFINE(chan_actuators, actuators_bitmap_t, NULL, NULL, ZBUS_OBSERVERS_EMPTY,
+                 ZBUS_MSG_INIT(0));
+
+// What the state machine was run with
+struct sm_run
+{
+    command_t command;
+    uint8_t fresh;
+    pressures_t pressures;
+};
+
+static struct sm_object *sm;
+static struct k_work_q *sm_work_q;
+
+static struct sm_run runs[MAX_RUNS];
+static atomic_t run_count;
+static atomic_t config_saves;
+
+// Latency ID of each command as received, and of each run as stamped
+static uint32_t rx_latency_id;
+static uint32_t run_latency_ids[MAX_RUNS];
+static atomic_t run_stamps;
+
+K_THREAD_STACK_DEFINE(holder_stack, 1024);
+static struct k_thread holder_thread;
+
+static K_SEM_DEFINE(gate_sem, 0, 1);
+static K_SEM_DEFINE(claimed_sem, 0, 1);
+static K_SEM_DEFINE(release_sem, 0, 1);
+
+/* ===================================================================== */
+/* Stubs                                                                 */
+/* ===================================================================== */
+
+void sm_init(struct sm_object *initial_s_obj, struct sm_config *config)
+{
+    sm = initial_s_obj;
+    sm->config = config;
+    sm->state_data.main_state = IDLE;
+}
+
+int32_t smf_run_state(struct smf_ctx *const ctx)
+{
+    const struct sm_object *const s = CONTAINER_OF(ctx, struct sm_object, ctx);
+    const atomic_val_t n = atomic_inc(&run_count);
+
+    if (n < MAX_RUNS)
+    {
+        runs[n] = (struct sm_run){
+            .command = s->command,
+            .fresh = s->fresh,
+            .pressures = s->data.pressures,
+        };
+    }
+
+    return 0;
+}
+
+bool config_store_load(struct sm_config *config)
+{
+    ARG_UNUSED(config);
+    return false;
+}
+
+void config_store_save(const struct sm_config *config)
+{
+    ARG_UNUSED(config);
+    atomic_inc(&config_saves);
+}
+
+void cmd_latency_stamp(uint32_t id, cmd_stage_t stage)
+{
+    if (stage != CMD_STAGE_SM_RUN)
+    {
+        return;
+    }
+
+    const atomic_val_t n = atomic_inc(&run_stamps);
+    if (n < MAX_RUNS)
+    {
+        run_latency_ids[n] = id;
+    }
+}
+
+uint32_t cmd_latency_last(cmd_stage_t stage)
+{
+    return stage == CMD_STAGE_RX ? rx_latency_id : CMD_LATENCY_NONE;
+}
+
+void health_register_work_q(health_service_t service, struct k_work_q *work_q)
+{
+    if (service == HEALTH_SM_WORK_Q)
+    {
+        sm_work_q = work_q;
+    }
+}
+
+void supervisor_watch_work_q(health_service_t service, struct k_work_q *work_q,
+                             const struct supervisor_watch *watch)
+{
+    ARG_UNUSED(service);
+    ARG_UNUSED(work_q);
+    ARG_UNUSED(watch);
+}
+
+// The executor is driven by the tests, through sm_flight_step()
+void flight_exec_init(void)
+{
+}
+
+void flight_exec_resume(void)
+{
+}
+
+int chan_stats_pub(const struct zbus_channel *chan, const void *msg, k_timeout_t timeout)
+{
+    return zbus_chan_pub(chan, msg, timeout);
+}
+
+uint32_t chan_stats_listener_begin(const struct zbus_channel *chan)
+{
+    ARG_UNUSED(chan);
+    return 0;
+}
+
+void chan_stats_listener_end(const struct zbus_channel *chan, uint32_t start)
+{
+    ARG_UNUSED(chan);
+    ARG_UNUSED(start);
+}
+
+/* ===================================================================== */
+/* Helpers                                                               */
+/* ===================================================================== */
+
+static void gate_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+    k_sem_take(&gate_sem, K_FOREVER);
+}
+
+static K_WORK_DEFINE(gate_work, gate_work_handler);
+
+// Holds the state machine work queue until open_gate()
+static void close_gate(void)
+{
+    k_work_submit_to_queue(sm_work_q, &gate_work);
+}
+
+static void open_gate(void)
+{
+    k_sem_give(&gate_sem);
+    k_msleep(10); // Lets the work queue catch up
+}
+
+static void publish_pressure(uint16_t n2o_tank_pressure)
+{
+    const pressure_sample_t sample = {.pressures.n2o_tank_pressure = n2o_tank_pressure};
+    zassert_ok(zbus_chan_pub(&chan_pressure_sensors, &sample, K_MSEC(10)));
+}
+
+static void publish_command(command_t command)
+{
+    const generic_packet_t packet = {.header.command_id = command};
+    rx_latency_id++;
+    zassert_ok(zbus_chan_pub(&chan_packets, &packet, K_MSEC(10)));
+}
+
+// A new N2 fill target, each call a different one so the configuration changes
+static void publish_fill_n2(void)
+{
+    static uint16_t target = 100;
+    struct cmd_fill_exec_s packet = {
+        .hdr.command_id = CMD_FILL_EXEC,
+        .payload.program_id = CMD_FILL_N2,
+    };
+    const struct fill_N2_params_s params = {.target_N2_deci_bar = ++target};
+    memcpy(packet.payload.params, &params, sizeof(params));
+
+    zassert_ok(zbus_chan_pub(&chan_packets, &packet, K_MSEC(10)));
+}
+
+// A lower priority publisher, preempted while holding the channel
+static void holder_entry(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    if (zbus_chan_claim(&chan_pressure_sensors, K_FOREVER) != 0)
+    {
+        return;
+    }
+
+    k_sem_give(&claimed_sem);
+    k_sem_take(&release_sem, K_FOREVER);
+    zbus_chan_finish(&chan_pressure_sensors);
+}
+
+static void *sm_work_setup(void)
+{
+    static bool started;
+
+    // Shared by the suites
+    if (!started)
+    {
+        zassert_true(state_machine_service_setup());
+        state_machine_service_start();
+        zassert_not_null(sm_work_q, "State machine work queue not registered");
+        started = true;
+    }
+
+    return NULL;
+}
+
+static void sm_work_before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+
+    // The work queue is idle between tests, sm_obj can be set from here
+    sm->state_data.main_state = IDLE;
+    atomic_clear(&run_count);
+    atomic_clear(&config_saves);
+    atomic_clear(&run_stamps);
+    memset(runs, 0, sizeof(runs));
+    memset(run_latency_ids, 0, sizeof(run_latency_ids));
+}
+
+/* ===================================================================== */
+/* Contention                                                            */
+/* ===================================================================== */
+
+ZTEST_SUITE(contention, NULL, sm_work_setup, sm_work_before, NULL, NULL);
+
+ZTEST(contention, test_sample_taken_while_channel_held)
+{
+    close_gate();
+    publish_pressure(100);
+
+    k_thread_create(&holder_thread, holder_stack, K_THREAD_STACK_SIZEOF(holder_stack),
+                    holder_entry, NULL, NULL, NULL, HOLDER_PRIO, 0, K_NO_WAIT);
+    zassert_ok(k_sem_take(&claimed_sem, K_MSEC(100)), "Holder did not claim the channel");
+
+    pressure_sample_t unused;
+    zassert_equal(zbus_chan_read(&chan_pressure_sensors, &unused, K_NO_WAIT), -EBUSY,
+                  "Channel not contended");
+
+    // Still held, the state machine must run with the sample all the same
+    open_gate();
+    zassert_equal(atomic_get(&run_count), 1, "State machine ran %ld times",
+                  atomic_get(&run_count));
+    zassert_equal(runs[0].pressures.n2o_tank_pressure, 100);
+    zassert_equal(runs[0].fresh, SM_SRC_PRESSURES);
+
+    k_sem_give(&release_sem);
+    zassert_ok(k_thread_join(&holder_thread, K_MSEC(100)));
+
+    k_msleep(10);
+    zassert_equal(atomic_get(&run_count), 1, "Ran again once the channel was freed");
+}
+
+/* ===================================================================== */
+/* Intake                                                                */
+/* ===================================================================== */
+
+ZTEST_SUITE(intake, NULL, sm_work_setup, sm_work_before, NULL, NULL);
+
+ZTEST(intake, test_latest_sample_replaces_unread)
+{
+    close_gate();
+    publish_pressure(1);
+    publish_pressure(2);
+    publish_pressure(3);
+    open_gate();
+
+    zassert_equal(atomic_get(&run_count), 1);
+    zassert_equal(runs[0].pressures.n2o_tank_pressure, 3, "Ran with sample %u",
+                  runs[0].pressures.n2o_tank_pressure);
+}
+
+ZTEST(intake, test_commands_in_order_up_to_depth)
+{
+    static const command_t sent[] = {CMD_READY, CMD_ARM, CMD_ABORT, CMD_STOP, CMD_FIRE};
+    BUILD_ASSERT(ARRAY_SIZE(sent) > CONFIG_SM_COMMAND_QUEUE_DEPTH);
+
+    close_gate();
+    for (size_t i = 0; i < ARRAY_SIZE(sent); i++)
+    {
+        publish_command(sent[i]);
+    }
+    open_gate();
+
+    // One run per command, the ones past the queue depth dropped
+    zassert_equal(atomic_get(&run_count), CONFIG_SM_COMMAND_QUEUE_DEPTH, "%ld runs",
+                  atomic_get(&run_count));
+    for (size_t i = 0; i < CONFIG_SM_COMMAND_QUEUE_DEPTH; i++)
+    {
+        zassert_equal(runs[i].command, sent[i], "Run %zu with command %u", i, runs[i].command);
+    }
+}
+
+ZTEST(intake, test_commands_stamped_with_their_own_latency_id)
+{
+    close_gate();
+    publish_command(CMD_READY);
+    const uint32_t first = rx_latency_id;
+    publish_command(CMD_ARM);
+    open_gate();
+
+    // Queued behind each other, not both stamped as the latest one received
+    zassert_equal(atomic_get(&run_stamps), 2, "%ld runs stamped", atomic_get(&run_stamps));
+    zassert_equal(run_latency_ids[0], first, "First run stamped for %u", run_latency_ids[0]);
+    zassert_equal(run_latency_ids[1], first + 1, "Second run stamped for %u",
+                  run_latency_ids[1]);
+}
+
+ZTEST(intake, test_fill_command_saved_on_the_ground)
+{
+    publish_fill_n2();
+    k_msleep(10);
+
+    zassert_equal(atomic_get(&run_count), 1);
+    zassert_equal(runs[0].command, CMD_FILL_EXEC);
+    zassert_equal(atomic_get(&config_saves), 1);
+}
+
+ZTEST(intake, test_forced_safe_state_keeps_pending_abort)
+{
+    // Taken in ARMED, where only the executor runs the state machine
+    sm->state_data.main_state = ARMED;
+    publish_command(CMD_ABORT);
+    k_msleep(10);
+    zassert_equal(atomic_get(&run_count), 0);
+
+    // The supervisor finds a stall in FILL before the abort ran
+    sm->state_data.main_state = FILL;
+    sm->state_data.filling_state = FILL_N2O_FILL;
+    sm_force_safe();
+    k_msleep(10);
+
+    zassert_equal(atomic_get(&run_count), 1);
+    zassert_equal(runs[0].command, CMD_ABORT, "Run with command %u", runs[0].command);
+}
+
+/* ===================================================================== */
+/* Flight                                                                */
+/* ===================================================================== */
+
+ZTEST_SUITE(flight, NULL, sm_work_setup, sm_work_before, NULL, NULL);
+
+ZTEST(flight, test_back_to_back_commands_each_run)
+{
+    sm->state_data.main_state = ARMED;
+    zassert_true(sm_flight_mode());
+
+    // Both within one executor period
+    publish_command(CMD_ABORT);
+    publish_command(CMD_STOP);
+    k_msleep(10);
+    zassert_equal(atomic_get(&run_count), 0, "Work queue ran the state machine in flight");
+
+    for (int period = 0; period < 3; period++)
+    {
+        sm_flight_step(NULL, NULL);
+        k_msleep(10); // The work queue takes the next command
+    }
+
+    zassert_equal(atomic_get(&run_count), 3);
+    zassert_equal(runs[0].command, CMD_ABORT, "First run with command %u", runs[0].command);
+    zassert_equal(runs[1].command, CMD_STOP, "Second run with command %u", runs[1].command);
+    zassert_equal(runs[2].command, 0, "Third run with command %u", runs[2].command);
+}
+
+ZTEST(flight, test_manual_command_does_not_hold_the_next)
+{
+    sm->state_data.main_state = ARMED;
+
+    // Not for the state machine, the command after it must still be taken
+    publish_command(CMD_MANUAL_EXEC);
+    publish_command(CMD_ABORT);
+    k_msleep(10);
+
+    sm_flight_step(NULL, NULL);
+
+    zassert_equal(atomic_get(&run_count), 1);
+    zassert_equal(runs[0].command, CMD_ABORT, "Run with command %u", runs[0].command);
+}
+
+ZTEST(flight, test_fill_command_ignored)
+{
+    sm->state_data.main_state = ARMED;
+
+    // Saving the configuration would write the flash in flight
+    publish_fill_n2();
+    k_msleep(10);
+    sm_flight_step(NULL, NULL);
+
+    zassert_equal(atomic_get(&run_count), 1);
+    zassert_equal(runs[0].command, 0, "Run with command %u", runs[0].command);
+    zassert_equal(atomic_get(&config_saves), 0, "Configuration saved in flight");
+}
@@ -0,0 +1,428 @@
+/*
+ * State machine simulator tests.
+ *
+ * The state machine runs on the host, one step per sensor sample, with no zbus or threads
+ * in between, so thousands of simulated minutes run in a few milliseconds. Suites:
+ *  - transitions: single commands, ported from the old filling state machine tests
+ *  - replay: a full fill in closed loop against the plant model, with timeline and
+ *    actuation counts
+ *  - random: random command/sensor traces checked against safety invariants
+ */
+#include "sim.h"
+
+#include <inttypes.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/smf.h>
+#include <zephyr/ztest.h>
+
+#ifdef CONFIG_ARCH_POSIX
+#include "native_rtc.h"
+#endif
+
+static struct sim sim;
+
+static uint64_t host_time_us(void)
+{
+#ifdef CONFIG_ARCH_POSIX
+    // Simulated kernel time does not advance while the test runs, measure real time
+    return native_rtc_gettime_us(RTC_CLOCK_REALTIME);
+#else
+    return k_cyc_to_us_floor64(k_cycle_get_64());
+#endif
+}
+
+static void step_cmd(command_t command, fill_command_t fill_command)
+{
+    const struct sim_sample sample = {
+        .command = command,
+        .fill_command = fill_command,
+        .n2o_tank_temp = 150,
+    };
+    sim_step(&sim, &sample);
+}
+
+static void sim_before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+    sim_reset(&sim, false);
+}
+
+/* ===================================================================== */
+/* Transitions                                                           */
+/* ===================================================================== */
+
+ZTEST_SUITE(transitions, NULL, NULL, sim_before, NULL, NULL);
+
+ZTEST(transitions, test_initial_state)
+{
+    zassert_equal(sim.state, IDLE, "Initial state is %s", sim_state_name(sim.state));
+    zassert_equal(sim.obj.state_data.main_state, IDLE);
+}
+
+ZTEST(transitions, test_idle_to_fill_and_stop)
+{
+    step_cmd(CMD_FILL_EXEC, CMD_FILL_NONE);
+    zassert_equal(sim.state, FILL_SST(SAFE_PAUSE_IDLE), "Got %s", sim_state_name(sim.state));
+
+    step_cmd(CMD_FILL_EXEC, CMD_FILL_N2);
+    zassert_equal(sim.state, FILL_SST(FILL_N2_IDLE), "Got %s", sim_state_name(sim.state));
+
+    step_cmd(CMD_STOP, CMD_FILL_NONE);
+    zassert_equal(sim.state, IDLE, "Got %s", sim_state_name(sim.state));
+    zassert_equal(sim.obj.data.actuators.raw, 0, "Valves left open in IDLE");
+}
+
+// Steps until the state changes, 0 if it did not within max_steps
+static uint32_t steps_to_leave(const struct sim_sample *sample, uint32_t max_steps)
+{
+    const int state = sim.state;
+
+    for (uint32_t i = 1; i <= max_steps; i++)
+    {
+        sim_step(&sim, sample);
+        if (sim.state != state)
+        {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
+ZTEST(transitions, test_dwell_holds_fill_rows_only)
+{
+    const struct fill_n2 *cfg = &sim.config.filling_sm_config.fill_n2;
+    const uint32_t dwell_steps = CONFIG_SM_FILL_MIN_DWELL_MSEC / CONFIG_SIM_STEP_MSEC;
+
+    // An overpressure right after entering the idle state vents without waiting
+    step_cmd(CMD_FILL_EXEC, CMD_FILL_NONE);
+    step_cmd(CMD_FILL_EXEC, CMD_FILL_N2);
+    const struct sim_sample over = {.n2_line_pressure = cfg->trigger_n2_tank_pressure + 1};
+    const uint32_t vent_steps = steps_to_leave(&over, dwell_steps);
+    zassert_equal(sim.state, FILL_SST(FILL_N2_VENT), "Got %s", sim_state_name(sim.state));
+    zassert_true(vent_steps <= CONFIG_SM_FILL_CONFIRM_WINDOW, "Vented after %u steps",
+                 vent_steps);
+
+    // Reopening the fill valve waits for the idle state to settle
+    const struct sim_sample target = {.n2_line_pressure = cfg->target_n2_tank_pressure};
+    zassert_true(steps_to_leave(&target, dwell_steps) > 0);
+    zassert_equal(sim.state, FILL_SST(FILL_N2_IDLE), "Got %s", sim_state_name(sim.state));
+
+    const struct sim_sample empty = {0};
+    const uint32_t fill_steps = steps_to_leave(&empty, 2 * dwell_steps);
+    zassert_equal(sim.state, FILL_SST(FILL_N2_FILL), "Got %s", sim_state_name(sim.state));
+    zassert_true(fill_steps >= dwell_steps, "Refilled after %u steps", fill_steps);
+}
+
+ZTEST(transitions, test_confirmation_counts_samples)
+{
+    const struct fill_n2 *cfg = &sim.config.filling_sm_config.fill_n2;
+
+    step_cmd(CMD_FILL_EXEC, CMD_FILL_NONE);
+    step_cmd(CMD_FILL_EXEC, CMD_FILL_N2);
+
+    // One pressure sample over the trigger, then only temperatures: a single reading
+    const struct sim_sample over = {.n2_line_pressure = cfg->trigger_n2_tank_pressure + 1};
+    const struct sim_sample thermo = {.n2o_tank_temp = 150, .stale = SM_SRC_PRESSURES};
+    sim_step(&sim, &over);
+    for (int i = 0; i < CONFIG_SM_FILL_CONFIRM_WINDOW; i++)
+    {
+        sim_step(&sim, &thermo);
+    }
+    zassert_equal(sim.state, FILL_SST(FILL_N2_IDLE), "Got %s", sim_state_name(sim.state));
+
+    for (int i = 1; i < CONFIG_SM_FILL_CONFIRM_SAMPLES; i++)
+    {
+        sim_step(&sim, &over);
+    }
+    zassert_equal(sim.state, FILL_SST(FILL_N2_VENT), "Got %s", sim_state_name(sim.state));
+}
+
+ZTEST(transitions, test_n2o_vent_without_temperature)
+{
+    const struct fill_n2o *cfg = &sim.config.filling_sm_config.fill_n2o;
+    const uint32_t dwell_steps = CONFIG_SM_FILL_MIN_DWELL_MSEC / CONFIG_SIM_STEP_MSEC;
+
+    step_cmd(CMD_FILL_EXEC, CMD_FILL_NONE);
+    step_cmd(CMD_FILL_EXEC, CMD_FILL_N2O);
+    const struct sim_sample empty = {.n2o_tank_temp = THERMO_INVALID};
+    zassert_true(steps_to_leave(&empty, 2 * dwell_steps) > 0);
+    zassert_equal(sim.state, FILL_SST(FILL_N2O_FILL), "Got %s", sim_state_name(sim.state));
+
+    // No temperature reading, the overpressure alone vents
+    const struct sim_sample over = {
+        .n2o_tank_pressure = cfg->trigger_n2o_tank_pressure,
+        .n2o_tank_temp = THERMO_INVALID,
+    };
+    const uint32_t vent_steps = steps_to_leave(&over, CONFIG_SM_FILL_CONFIRM_WINDOW);
+    zassert_equal(sim.state, FILL_SST(FILL_N2O_VENT), "Got %s", sim_state_name(sim.state));
+    zassert_true(vent_steps > 0);
+
+    // And the missing reading does not stop the vent either
+    zassert_equal(steps_to_leave(&over, 2 * CONFIG_SM_FILL_CONFIRM_WINDOW), 0, "Left for %s",
+                  sim_state_name(sim.state));
+}
+
+ZTEST(transitions, test_launch_sequence_needs_chamber_temp)
+{
+    step_cmd(CMD_READY, CMD_FILL_NONE);
+    step_cmd(CMD_ARM, CMD_FILL_NONE);
+    zassert_equal(sim.state, ARMED, "Got %s", sim_state_name(sim.state));
+
+    // Igniter not lit yet, FIRE must not be accepted
+    step_cmd(CMD_FIRE, CMD_FILL_NONE);
+    zassert_equal(sim.state, ARMED, "Got %s", sim_state_name(sim.state));
+
+    step_cmd(CMD_ABORT, CMD_FILL_NONE);
+    zassert_equal(sim.state, ABORT, "Got %s", sim_state_name(sim.state));
+}
+
+/* ===================================================================== */
+/* Closed loop replay of a full fill                                     */
+/* ===================================================================== */
+
+ZTEST_SUITE(replay, NULL, NULL, sim_before, NULL, NULL);
+
+struct fill_phase
+{
+    fill_command_t command;
+    uint32_t steps;
+};
+
+static const struct fill_phase fill_program[] = {
+    {CMD_FILL_N2, 2000},
+    {CMD_FILL_PRE_PRESS, 2000},
+    {CMD_FILL_N2O, 2000},
+    {CMD_FILL_POST_PRESS, 2000},
+};
+
+// Valve openings during each program of the last run_fill_program()
+static uint32_t program_opens[ARRAY_SIZE(fill_program)][SIM_ACTUATOR_BITS];
+
+// sim_actuations() over a single program
+static uint32_t program_actuations(size_t program, actuators_bitmap_t which)
+{
+    uint32_t count = 0;
+
+    for (int bit = 0; bit < SIM_ACTUATOR_BITS; bit++)
+    {
+        if (which.raw & BIT(bit))
+        {
+            count += program_opens[program][bit];
+        }
+    }
+
+    return count;
+}
+
+static void run_fill_program(struct sim_plant *plant)
+{
+    const struct filling_sm_config *cfg = &sim.config.filling_sm_config;
+    struct sim_sample sample;
+
+    step_cmd(CMD_FILL_EXEC, CMD_FILL_NONE);
+
+    for (size_t p = 0; p < ARRAY_SIZE(fill_program); p++)
+    {
+        const struct sim_stats before = sim.stats;
+
+        for (uint32_t i = 0; i < fill_program[p].steps; i++)
+        {
+            sim_plant_sample(plant, &sim, &sample);
+            if (i == 0)
+            {
+                sample.command = CMD_FILL_EXEC;
+                sample.fill_command = fill_program[p].command;
+            }
+            sim_step(&sim, &sample);
+        }
+
+        for (int bit = 0; bit < SIM_ACTUATOR_BITS; bit++)
+        {
+            program_opens[p][bit] = sim.stats.actuations[bit] - before.actuations[bit];
+        }
+
+        switch (fill_program[p].command)
+        {
+        case CMD_FILL_N2:
+            zassert_within(plant->n2_line_pressure, cfg->fill_n2.target_n2_tank_pressure,
+                           cfg->fill_n2.trigger_n2_tank_pressure -
+                               cfg->fill_n2.target_n2_tank_pressure);
+            break;
+        case CMD_FILL_PRE_PRESS:
+            zassert_true(plant->n2o_tank_pressure >=
+                         cfg->pre_press.target_n2o_tank_pressure - plant->noise);
+            break;
+        case CMD_FILL_N2O:
+            zassert_true(plant->n2o_weight >= cfg->fill_n2o.target_n2o_tank_weight);
+            zassert_true(plant->n2o_tank_pressure <=
+                         cfg->fill_n2o.trigger_n2o_tank_pressure + plant->noise);
+            break;
+        case CMD_FILL_POST_PRESS:
+            zassert_true(plant->n2o_tank_pressure >=
+                         cfg->post_press.target_n2o_tank_pressure - plant->noise);
+            break;
+        default:
+            break;
+        }
+    }
+
+    step_cmd(CMD_STOP, CMD_FILL_NONE);
+    zassert_equal(sim.state, IDLE, "Got %s", sim_state_name(sim.state));
+}
+
+ZTEST(replay, test_full_fill)
+{
+    struct sim_plant plant = {
+        .n2o_tank_temp = 150,
+        .noise = 2,
+    };
+
+    sim.print_timeline = true;
+    const uint64_t start_us = host_time_us();
+
+    run_fill_program(&plant);
+
+    const uint64_t elapsed_us = host_time_us() - start_us;
+    sim_print_stats(&sim);
+    printk("Replayed in %" PRIu64 " us on the host\n", elapsed_us);
+}
+
+/*
+ * Transducer noise well above the hysteresis bands: each fill valve must still open at most
+ * once per program, the only expected cycling is the N2O fill venting as the tank pressure
+ * builds, which keeps the N2O fill valve open.
+ */
+ZTEST(replay, test_noisy_fill_does_not_chatter)
+{
+    struct sim_plant plant = {
+        .n2o_tank_temp = 150,
+        .noise = 10, // +-1 bar, +-10 g
+    };
+
+    run_fill_program(&plant);
+    sim_print_stats(&sim);
+
+    static const struct
+    {
+        actuators_bitmap_t valve;
+        const char *name;
+    } fill_valves[] = {
+        {{.v_n2_fill = 1}, "N2 fill"},
+        {{.v_n2o_fill = 1}, "N2O fill"},
+        {{.v_pressurizing = 1}, "Pressurizing"},
+    };
+
+    for (size_t p = 0; p < ARRAY_SIZE(fill_program); p++)
+    {
+        for (size_t v = 0; v < ARRAY_SIZE(fill_valves); v++)
+        {
+            const uint32_t opens = program_actuations(p, fill_valves[v].valve);
+            zassert_true(opens <= 1, "%s valve opened %u times in program %d",
+                         fill_valves[v].name, opens, fill_program[p].command);
+        }
+    }
+}
+
+/* ===================================================================== */
+/* Random traces                                                         */
+/* ===================================================================== */
+
+ZTEST_SUITE(random, NULL, NULL, sim_before, NULL, NULL);
+
+static const command_t random_commands[] = {
+    CMD_ABORT, CMD_READY, CMD_ARM,    CMD_FIRE,      CMD_STOP,
+    CMD_SAFE_PAUSE, CMD_RESUME, CMD_FILL_EXEC, CMD_FILL_EXEC,
+};
+
+static void random_sample(uint32_t *seed, struct sim_sample *out)
+{
+    // Mostly sensor updates, a command every ~8 steps
+    const uint32_t r = sim_rand(seed);
+
+    *out = (struct sim_sample){
+        .n2o_tank_pressure = sim_rand(seed) % 1000,
+        .n2_line_pressure = sim_rand(seed) % 2500,
+        .n2o_weight = sim_rand(seed) % 9000,
+        .n2o_tank_temp = (int16_t)(sim_rand(seed) % 400) - 100,
+        .chamber_temp = sim_rand(seed) % 8000,
+    };
+
+    if ((r & 0x7) == 0)
+    {
+        out->command = random_commands[(r >> 3) % ARRAY_SIZE(random_commands)];
+        out->fill_command = (r >> 8) % (CMD_FILL_POST_PRESS + 1);
+    }
+}
+
+static bool is_leaf(int state)
+{
+    for (int s = 0; s < SM_STATE_COUNT; s++)
+    {
+        if (states[s].parent == &states[state])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int top_state(int state)
+{
+    const struct smf_state *s = &states[state];
+    while (s->parent != &states[ROOT])
+    {
+        s = s->parent;
+    }
+    return s - states;
+}
+
+ZTEST(random, test_invariants)
+{
+    uint32_t seed = CONFIG_SIM_SEED;
+    struct sim_sample sample;
+    uint32_t aborts = 0;
+
+    printk("Random traces: %d x %d steps, seed 0x%x\n", CONFIG_SIM_RANDOM_TRACES,
+           CONFIG_SIM_RANDOM_TRACE_STEPS, seed);
+    const uint64_t start_us = host_time_us();
+
+    for (int trace = 0; trace < CONFIG_SIM_RANDOM_TRACES; trace++)
+    {
+        sim_reset(&sim, false);
+        const uint32_t trace_seed = seed;
+
+        for (int i = 0; i < CONFIG_SIM_RANDOM_TRACE_STEPS; i++)
+        {
+            const int before = sim.state;
+            random_sample(&seed, &sample);
+            sim_step(&sim, &sample);
+
+            zassert_true(is_leaf(sim.state), "trace seed 0x%x step %d: %s is not a leaf",
+                         trace_seed, i, sim_state_name(sim.state));
+            zassert_equal((int)sim.obj.state_data.main_state, top_state(sim.state),
+                          "trace seed 0x%x step %d: main state %d in %s", trace_seed, i,
+                          sim.obj.state_data.main_state, sim_state_name(sim.state));
+
+            if (sample.command == CMD_ABORT && before != IDLE && before != ABORT)
+            {
+                aborts++;
+                zassert_equal(sim.state, ABORT, "trace seed 0x%x step %d: ABORT in %s -> %s",
+                              trace_seed, i, sim_state_name(before),
+                              sim_state_name(sim.state));
+            }
+
+            if (sim.state == IDLE)
+            {
+                zassert_equal(sim.obj.data.actuators.raw, 0,
+                              "trace seed 0x%x step %d: valves 0x%x open in IDLE", trace_seed,
+                              i, sim.obj.data.actuators.raw);
+            }
+        }
+    }
+
+    printk("%d steps, %u aborts checked in %" PRIu64 " us\n",
+           CONFIG_SIM_RANDOM_TRACES * CONFIG_SIM_RANDOM_TRACE_STEPS, aborts,
+           host_time_us() - start_us);
+}
@@ -0,0 +1,255 @@
+#include "sim.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/smf.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+
+// clang-format off
+static const char *const state_names[SM_STATE_COUNT] = {
+    [ROOT]   = "ROOT",
+    [IDLE]   = "IDLE",
+    [FILL]   = "FILL",
+    [READY]  = "READY",
+    [ARMED]  = "ARMED",
+    [FLIGHT] = "FLIGHT",
+    [ABORT]  = "ABORT",
+
+    [FILL_SST(SAFE_PAUSE)]         = "SAFE_PAUSE",
+    [FILL_SST(SAFE_PAUSE_IDLE)]    = "SAFE_PAUSE_IDLE",
+    [FILL_SST(SAFE_PAUSE_VENT)]    = "SAFE_PAUSE_VENT",
+    [FILL_SST(FILL_N2)]            = "FILL_N2",
+    [FILL_SST(FILL_N2_IDLE)]       = "FILL_N2_IDLE",
+    [FILL_SST(FILL_N2_FILL)]       = "FILL_N2_FILL",
+    [FILL_SST(FILL_N2_VENT)]       = "FILL_N2_VENT",
+    [FILL_SST(PRE_PRESS)]          = "PRE_PRESS",
+    [FILL_SST(PRE_PRESS_IDLE)]     = "PRE_PRESS_IDLE",
+    [FILL_SST(PRE_PRESS_VENT)]     = "PRE_PRESS_VENT",
+    [FILL_SST(PRE_PRESS_FILL_N2)]  = "PRE_PRESS_FILL_N2",
+    [FILL_SST(FILL_N2O)]           = "FILL_N2O",
+    [FILL_SST(FILL_N2O_IDLE)]      = "FILL_N2O_IDLE",
+    [FILL_SST(FILL_N2O_FILL)]      = "FILL_N2O_FILL",
+    [FILL_SST(FILL_N2O_VENT)]      = "FILL_N2O_VENT",
+    [FILL_SST(POST_PRESS)]         = "POST_PRESS",
+    [FILL_SST(POST_PRESS_IDLE)]    = "POST_PRESS_IDLE",
+    [FILL_SST(POST_PRESS_VENT)]    = "POST_PRESS_VENT",
+    [FILL_SST(POST_PRESS_FILL_N2)] = "POST_PRESS_FILL_N2",
+
+    [FLIGHT_SST(IGNITION)]     = "IGNITION",
+    [FLIGHT_SST(BOOST)]        = "BOOST",
+    [FLIGHT_SST(COAST)]        = "COAST",
+    [FLIGHT_SST(APOGEE)]       = "APOGEE",
+    [FLIGHT_SST(DROGUE_CHUTE)] = "DROGUE_CHUTE",
+    [FLIGHT_SST(MAIN_CHUTE)]   = "MAIN_CHUTE",
+    [FLIGHT_SST(TOUCHDOWN)]    = "TOUCHDOWN",
+};
+
+// Bit order of actuators_bitmap_t
+static const char *const actuator_names[SIM_ACTUATOR_BITS] = {
+    "pressurizing", "vent", "abort", "main",
+    "n2o_fill", "n2o_purge", "n2_fill", "n2_purge",
+    "ematch_ignition", "ematch_drogue", "ematch_main",
+    "n2o_quick_dc", "n2_quick_dc",
+};
+// clang-format on
+
+const char *sim_state_name(int state)
+{
+    if (state < 0 || state >= SM_STATE_COUNT || state_names[state] == NULL)
+    {
+        return "?";
+    }
+
+    return state_names[state];
+}
+
+const char *sim_actuator_name(int bit)
+{
+    return (bit >= 0 && bit < SIM_ACTUATOR_BITS) ? actuator_names[bit] : "?";
+}
+
+static int current_state(const struct sim *sim)
+{
+    return SMF_CTX(&sim->obj)->current - states;
+}
+
+void sim_reset(struct sim *sim, bool print_timeline)
+{
+    static DEFAULT_SM_CONFIG(defaults);
+
+    *sim = (struct sim){
+        .config = defaults,
+        .print_timeline = print_timeline,
+    };
+
+    sm_init(&sim->obj, &sim->config);
+    sim->state = current_state(sim);
+}
+
+void sim_step(struct sim *sim, const struct sim_sample *sample)
+{
+    struct sm_object *s = &sim->obj;
+    const uint16_t actuators_before = s->data.actuators.raw;
+
+    s->command = sample->command;
+    s->fill_command = sample->fill_command;
+    s->fresh = (SM_SRC_PRESSURES | SM_SRC_LOADCELLS | SM_SRC_THERMOCOUPLES) & ~sample->stale;
+    if (s->fresh & SM_SRC_PRESSURES)
+    {
+        s->data.pressures.n2o_tank_pressure = sample->n2o_tank_pressure;
+        s->data.pressures.n2_line_pressure = sample->n2_line_pressure;
+    }
+    if (s->fresh & SM_SRC_LOADCELLS)
+    {
+        s->data.loadcells.n2o_loadcell = sample->n2o_weight;
+    }
+    if (s->fresh & SM_SRC_THERMOCOUPLES)
+    {
+        s->data.thermocouples.n2o_tank_uf_t1 = sample->n2o_tank_temp;
+        s->data.thermocouples.chamber_thermo = sample->chamber_temp;
+    }
+    s->now_ms = sim->now_ms;
+
+    smf_run_state(SMF_CTX(s));
+
+    s->command = 0;
+    s->fill_command = 0;
+    s->fresh = 0;
+
+    const uint16_t opened = s->data.actuators.raw & ~actuators_before;
+    for (int bit = 0; bit < SIM_ACTUATOR_BITS; bit++)
+    {
+        sim->stats.actuations[bit] += (opened >> bit) & 1;
+    }
+
+    const int state = current_state(sim);
+    sim->stats.time_in_state_ms[sim->state] += CONFIG_SIM_STEP_MSEC;
+    sim->stats.steps++;
+    sim->now_ms += CONFIG_SIM_STEP_MSEC;
+
+    if (state != sim->state)
+    {
+        sim->stats.transitions++;
+        if (sim->print_timeline)
+        {
+            printk("%9u ms  %-18s -> %-18s valves 0x%04x\n", sim->now_ms,
+                   sim_state_name(sim->state), sim_state_name(state), s->data.actuators.raw);
+        }
+        sim->state = state;
+    }
+}
+
+int sim_replay(struct sim *sim, const struct sim_sample *trace, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        sim_step(sim, &trace[i]);
+    }
+
+    return sim->state;
+}
+
+static int32_t noisy(int32_t value, int16_t noise, uint32_t *seed)
+{
+    if (noise == 0)
+    {
+        return value;
+    }
+
+    return value + (int32_t)(sim_rand(seed) % (2 * noise + 1)) - noise;
+}
+
+void sim_plant_sample(struct sim_plant *plant, const struct sim *sim, struct sim_sample *out)
+{
+    static uint32_t noise_seed = CONFIG_SIM_SEED;
+    const actuators_bitmap_t act = sim->obj.data.actuators;
+
+    // NOTE: CLAMP() evaluates its argument more than once, draw the noise before
+    const int32_t tank_pressure = noisy(plant->n2o_tank_pressure, plant->noise, &noise_seed);
+    const int32_t line_pressure = noisy(plant->n2_line_pressure, plant->noise, &noise_seed);
+    const int32_t weight = noisy(plant->n2o_weight, plant->noise, &noise_seed);
+
+    *out = (struct sim_sample){
+        .n2o_tank_pressure = CLAMP(tank_pressure, 0, UINT16_MAX),
+        .n2_line_pressure = CLAMP(line_pressure, 0, UINT16_MAX),
+        .n2o_weight = CLAMP(weight, 0, UINT16_MAX),
+        .n2o_tank_temp = plant->n2o_tank_temp,
+    };
+
+    // Rates per step, only their signs and rough ratios matter to the state machine
+    if (act.v_vent)
+    {
+        plant->n2o_tank_pressure -= 4;
+        plant->n2_line_pressure -= act.v_n2_fill ? 6 : 0;
+    }
+    else if (act.v_n2_fill)
+    {
+        plant->n2_line_pressure += 4;
+        plant->n2o_tank_pressure += 1;
+    }
+
+    if (act.v_pressurizing)
+    {
+        plant->n2o_tank_pressure += 2;
+    }
+
+    if (act.v_n2o_fill)
+    {
+        plant->n2o_weight += 15;
+        plant->n2o_tank_pressure += 1;
+    }
+
+    plant->n2o_tank_pressure = MAX(plant->n2o_tank_pressure, 0);
+    plant->n2_line_pressure = MAX(plant->n2_line_pressure, 0);
+}
+
+uint32_t sim_actuations(const struct sim *sim, actuators_bitmap_t which)
+{
+    uint32_t count = 0;
+
+    for (int bit = 0; bit < SIM_ACTUATOR_BITS; bit++)
+    {
+        if (which.raw & BIT(bit))
+        {
+            count += sim->stats.actuations[bit];
+        }
+    }
+
+    return count;
+}
+
+void sim_print_stats(const struct sim *sim)
+{
+    printk("%u steps (%u ms simulated), %u transitions\n", sim->stats.steps, sim->now_ms,
+           sim->stats.transitions);
+
+    printk("actuations:");
+    for (int bit = 0; bit < SIM_ACTUATOR_BITS; bit++)
+    {
+        if (sim->stats.actuations[bit])
+        {
+            printk(" %s=%u", sim_actuator_name(bit), sim->stats.actuations[bit]);
+        }
+    }
+    printk("\n");
+
+    printk("time in state:");
+    for (int state = 0; state < SM_STATE_COUNT; state++)
+    {
+        if (sim->stats.time_in_state_ms[state])
+        {
+            printk(" %s=%ums", sim_state_name(state), sim->stats.time_in_state_ms[state]);
+        }
+    }
+    printk("\n");
+}
+
+uint32_t sim_rand(uint32_t *seed)
+{
+    uint32_t x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+    return x;
+}
@@ -0,0 +1,91 @@
+/*
+ * State machine simulator.
+ *
+ * Drives the OBC state machine directly through smf_run_state(), without zbus or the
+ * sensor services, one sensor sample per step. A step does what sm_work.c does on every
+ * sensor update: copy the sample into the object, run the machine, clear the commands and
+ * the fresh sources.
+ *
+ * Samples come either from a trace (recorded or synthetic) or from a simple plant model
+ * that reacts to the valves the state machine opens, so a whole fill can be replayed in
+ * closed loop. Every run keeps a state timeline and per-valve actuation counts.
+ */
+#ifndef SIM_H_
+#define SIM_H_
+
+#include "services/state_machine/main_sm.h"
+#include "services/state_machine/sm_table.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SIM_ACTUATOR_BITS 13 // Meaningful bits of actuators_bitmap_t
+
+struct sim_sample
+{
+    command_t command;
+    fill_command_t fill_command;
+
+    uint16_t n2o_tank_pressure; // deci-bar
+    uint16_t n2_line_pressure;  // deci-bar
+    uint16_t n2o_weight;        // grams
+    int16_t n2o_tank_temp;      // deci-ºC
+    int16_t chamber_temp;       // deci-ºC
+
+    uint8_t stale; // enum sm_source not carried by the sample, kept from the last one
+};
+
+struct sim_stats
+{
+    uint32_t steps;
+    uint32_t transitions;
+    uint32_t actuations[SIM_ACTUATOR_BITS]; // Closed -> open edges per actuator bit
+    uint32_t time_in_state_ms[SM_STATE_COUNT];
+};
+
+// Tank and line physics, in the units of struct sim_sample, advanced once per step
+struct sim_plant
+{
+    int32_t n2o_tank_pressure;
+    int32_t n2_line_pressure;
+    int32_t n2o_weight;
+    int16_t n2o_tank_temp;
+    int16_t noise; // Peak measurement noise added to the pressures and weight
+};
+
+struct sim
+{
+    struct sm_object obj;
+    struct sm_config config;
+    struct sim_stats stats;
+    uint32_t now_ms;
+    int state;
+    bool print_timeline;
+};
+
+// Fresh machine in its initial state, with the default configuration
+void sim_reset(struct sim *sim, bool print_timeline);
+
+// Apply one sample and run the machine once
+void sim_step(struct sim *sim, const struct sim_sample *sample);
+
+// Run a whole trace, returns the final state
+int sim_replay(struct sim *sim, const struct sim_sample *trace, size_t len);
+
+// Measure the plant into a sample (no command, with noise) and advance it with the current
+// valves
+void sim_plant_sample(struct sim_plant *plant, const struct sim *sim, struct sim_sample *out);
+
+// Valve openings so far, summed over the actuators set in which
+uint32_t sim_actuations(const struct sim *sim, actuators_bitmap_t which);
+
+const char *sim_state_name(int state);
+const char *sim_actuator_name(int bit);
+
+void sim_print_stats(const struct sim *sim);
+
+// xorshift32, deterministic for a given seed so failing traces can be replayed
+uint32_t sim_rand(uint32_t *seed);
+
+#endif // SIM_H_
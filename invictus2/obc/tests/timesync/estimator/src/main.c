@@ -0,0 +1,165 @@
+/*
+ * Time sync estimator tests: a slave clock with a fixed offset and drift against the
+ * master, synced once per second through a link with random latency jitter.
+ */
+#include <invictus2/timesync.h>
+
+#include <stdlib.h>
+
+#include <zephyr/ztest.h>
+
+#define SYNC_INTERVAL_US 1000000
+#define OFFSET_US        123456789LL // Master time at local time 0
+#define DRIFT_PPM        40          // The master clock runs this much faster
+#define JITTER_US        20          // Peak latency jitter of a sync frame
+
+static struct timesync ts;
+static uint32_t rng = 12345;
+
+static int32_t jitter(void)
+{
+    rng = rng * 1103515245 + 12345;
+    return (int32_t)((rng >> 16) % (2 * JITTER_US + 1)) - JITTER_US;
+}
+
+static uint64_t true_master(uint64_t local_us)
+{
+    return OFFSET_US + local_us + (int64_t)local_us * DRIFT_PPM / 1000000;
+}
+
+// Send a sync point at local time local_us, received with jitter
+static void sync_at(uint64_t local_us)
+{
+    timesync_update(&ts, true_master(local_us), local_us + jitter());
+}
+
+static void before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+    timesync_init(&ts);
+}
+
+ZTEST_SUITE(timesync_estimator, NULL, NULL, before, NULL, NULL);
+
+ZTEST(timesync_estimator, test_unsynced_passthrough)
+{
+    zassert_false(timesync_is_synced(&ts));
+    zassert_equal(timesync_to_master(&ts, 4242), 4242);
+}
+
+ZTEST(timesync_estimator, test_first_sync_sets_offset)
+{
+    timesync_update(&ts, 5000000, 1000);
+
+    zassert_true(timesync_is_synced(&ts));
+    zassert_equal(ts.steps, 0, "the first sync point is not a step");
+    zassert_equal(timesync_to_master(&ts, 1000), 5000000);
+    zassert_equal(timesync_to_master(&ts, 2000), 5001000);
+}
+
+ZTEST(timesync_estimator, test_tracks_drift)
+{
+    uint64_t local = 1000;
+    int64_t max_error = 0;
+
+    // Let the loop settle
+    for (int i = 0; i < 30; i++, local += SYNC_INTERVAL_US) {
+        sync_at(local);
+    }
+
+    // Then check the conversion in between sync points
+    for (int i = 0; i < 100; i++, local += SYNC_INTERVAL_US) {
+        sync_at(local);
+
+        for (uint64_t t = local; t < local + SYNC_INTERVAL_US; t += SYNC_INTERVAL_US / 10) {
+            const int64_t error = llabs((int64_t)(timesync_to_master(&ts, t) - true_master(t)));
+            max_error = MAX(max_error, error);
+        }
+    }
+
+    printk("max error %lld us, drift %d ppb\n", max_error, ts.drift_ppb);
+    zassert_true(max_error <= 2 * JITTER_US, "error %lld us", max_error);
+    zassert_within(ts.drift_ppb, DRIFT_PPM * 1000, 10000);
+    zassert_equal(ts.steps, 0);
+}
+
+ZTEST(timesync_estimator, test_monotonic_while_slewing)
+{
+    uint64_t local = 1000;
+    uint64_t prev = 0;
+
+    sync_at(local);
+
+    // An error just below the step threshold, absorbed without going back in time
+    local += SYNC_INTERVAL_US;
+    timesync_update(&ts, true_master(local) - (CONFIG_TIMESYNC_STEP_THRESHOLD_USEC - 1),
+                    local);
+    local += SYNC_INTERVAL_US;
+
+    for (int i = 0; i < 10; i++, local += SYNC_INTERVAL_US) {
+        sync_at(local);
+
+        for (uint64_t t = local; t < local + SYNC_INTERVAL_US; t += 100) {
+            const uint64_t now = timesync_to_master(&ts, t);
+            zassert_true(now > prev, "time went back at %llu", t);
+            prev = now;
+        }
+    }
+
+    zassert_equal(ts.steps, 0);
+}
+
+ZTEST(timesync_estimator, test_slew_stops_after_interval)
+{
+    uint64_t local = 1000;
+
+    sync_at(local);
+    local += SYNC_INTERVAL_US;
+    timesync_update(&ts, true_master(local) + 200, local);
+
+    const uint64_t at_sync = timesync_to_master(&ts, local);
+    const uint64_t end = local + SYNC_INTERVAL_US;
+    const int64_t slewed = (int64_t)(timesync_to_master(&ts, end) - at_sync);
+
+    // Sync points lost: past the interval the model runs on the drift alone
+    const uint64_t later = end + 10 * SYNC_INTERVAL_US;
+    const int64_t after =
+        (int64_t)(timesync_to_master(&ts, later) - timesync_to_master(&ts, end));
+    const int64_t drift_only = 10 * SYNC_INTERVAL_US +
+                               10LL * SYNC_INTERVAL_US * ts.drift_ppb / 1000000000LL;
+
+    zassert_true(ts.slew_ppb > 0);
+    zassert_true(slewed > SYNC_INTERVAL_US, "no slew within the interval");
+    zassert_within(after, drift_only, 1, "slewed %lld us past the interval",
+                   after - drift_only);
+}
+
+ZTEST(timesync_estimator, test_steps_on_master_reboot)
+{
+    uint64_t local = 1000;
+
+    for (int i = 0; i < 10; i++, local += SYNC_INTERVAL_US) {
+        sync_at(local);
+    }
+
+    const int32_t drift = ts.drift_ppb;
+
+    // The master restarted from 0: no slewing, and the drift estimate is kept
+    timesync_update(&ts, 2000, local);
+
+    zassert_equal(ts.steps, 1);
+    zassert_equal(ts.drift_ppb, drift);
+    zassert_equal(timesync_to_master(&ts, local), 2000);
+}
+
+ZTEST(timesync_estimator, test_register_round_trip)
+{
+    uint16_t regs[TIMESYNC_MODBUS_HR_COUNT];
+    const uint64_t time_us = 0x0123456789ABCDEFULL;
+
+    timesync_to_regs(time_us, regs);
+
+    zassert_equal(regs[0], 0xCDEF, "low word first");
+    zassert_equal(regs[3], 0x0123);
+    zassert_equal(timesync_from_regs(regs), time_us);
+}
@@ -0,0 +1,132 @@
+/*
+ * Trace probe tests: histogram and percentile bookkeeping, and the export format, with a
+ * ring small enough to wrap.
+ */
+#include <invictus2/trace.h>
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+static uint8_t export_buf[sizeof(struct trace_export_hdr) +
+                          CONFIG_TRACE_RING_EVENTS * sizeof(struct trace_event) +
+                          _TRACE_PROBE_MAX * sizeof(struct trace_hist)];
+static size_t export_len;
+
+static int write_buf(void *ctx, const void *data, size_t len)
+{
+    ARG_UNUSED(ctx);
+
+    if (export_len + len > sizeof(export_buf)) {
+        return -ENOSPC;
+    }
+
+    memcpy(&export_buf[export_len], data, len);
+    export_len += len;
+    return 0;
+}
+
+static void before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+    trace_reset();
+    export_len = 0;
+}
+
+ZTEST_SUITE(trace_probes, NULL, NULL, before, NULL, NULL);
+
+ZTEST(trace_probes, test_durations_are_bucketed)
+{
+    struct trace_hist hist;
+    struct trace_stats stats;
+
+    // 99 short ones and a long one
+    for (int i = 0; i < 99; i++) {
+        trace_end(TRACE_SM_RUN, k_cycle_get_32() - 100);
+    }
+    trace_end(TRACE_SM_RUN, k_cycle_get_32() - 100000);
+
+    trace_get_hist(TRACE_SM_RUN, &hist);
+    trace_get_stats(TRACE_SM_RUN, &stats);
+
+    zassert_equal(hist.count, 100);
+    zassert_true(hist.max_cycles >= 100000);
+    zassert_true(stats.p50_cycles >= 100 && stats.p50_cycles < 256, "p50 %u",
+                 stats.p50_cycles);
+    zassert_true(stats.p99_cycles < 256, "p99 %u", stats.p99_cycles);
+    zassert_equal(stats.max_cycles, hist.max_cycles);
+
+    trace_get_stats(TRACE_SD_WRITE, &stats);
+    zassert_equal(stats.count, 0, "other probes untouched");
+    zassert_equal(stats.p99_cycles, 0);
+}
+
+ZTEST(trace_probes, test_probe_pair)
+{
+    struct trace_stats stats;
+
+    TRACE_BEGIN(TRACE_MODBUS_XFER);
+    k_busy_wait(100);
+    TRACE_END(TRACE_MODBUS_XFER);
+
+    trace_get_stats(TRACE_MODBUS_XFER, &stats);
+    zassert_equal(stats.count, 1);
+    zassert_true(k_cyc_to_us_floor32(stats.max_cycles) >= 100);
+}
+
+ZTEST(trace_probes, test_export_is_oldest_first)
+{
+    const uint32_t recorded = CONFIG_TRACE_RING_EVENTS + 10;
+
+    for (uint32_t i = 0; i < recorded; i++) {
+        trace_mark(i % _TRACE_PROBE_MAX);
+    }
+    trace_end(TRACE_KALMAN_STEP, k_cycle_get_32()); // Recorded after the marks
+
+    zassert_ok(trace_export(write_buf, NULL));
+
+    struct trace_export_hdr hdr;
+    memcpy(&hdr, export_buf, sizeof(hdr));
+    zassert_equal(hdr.magic, TRACE_EXPORT_MAGIC);
+    zassert_equal(hdr.version, TRACE_EXPORT_VERSION);
+    zassert_equal(hdr.probes, _TRACE_PROBE_MAX);
+    zassert_equal(hdr.events, CONFIG_TRACE_RING_EVENTS, "the ring only keeps the latest");
+    zassert_equal(export_len, sizeof(hdr) + hdr.events * sizeof(struct trace_event) +
+                                  hdr.probes * sizeof(struct trace_hist));
+
+    // The first events recorded were overwritten
+    const struct trace_event *events = (const void *)&export_buf[sizeof(hdr)];
+    const uint32_t first = recorded + 1 - CONFIG_TRACE_RING_EVENTS;
+    for (uint32_t i = 0; i < hdr.events - 1; i++) {
+        zassert_equal(events[i].probe, (first + i) % _TRACE_PROBE_MAX, "event %u", i);
+        zassert_equal(events[i].type, TRACE_EVENT_MARK);
+        zassert_true((int32_t)(events[i + 1].cycles - events[i].cycles) >= 0);
+    }
+    zassert_equal(events[hdr.events - 1].probe, TRACE_KALMAN_STEP);
+    zassert_equal(events[hdr.events - 1].type, TRACE_EVENT_END);
+
+    struct trace_hist hist;
+    memcpy(&hist,
+           &export_buf[sizeof(hdr) + hdr.events * sizeof(struct trace_event) +
+                       TRACE_KALMAN_STEP * sizeof(struct trace_hist)],
+           sizeof(hist));
+    zassert_equal(hist.count, 1);
+}
+
+ZTEST(trace_probes, test_reset)
+{
+    trace_mark(TRACE_ZBUS_PUB);
+    trace_end(TRACE_ZBUS_PUB, k_cycle_get_32());
+    trace_reset();
+
+    zassert_ok(trace_export(write_buf, NULL));
+
+    struct trace_export_hdr hdr;
+    memcpy(&hdr, export_buf, sizeof(hdr));
+    zassert_equal(hdr.events, 0);
+
+    struct trace_stats stats;
+    trace_get_stats(TRACE_ZBUS_PUB, &stats);
+    zassert_equal(stats.count, 0);
+}
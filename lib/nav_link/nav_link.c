@@ -0,0 +1,167 @@
+#include <invictus2/nav_link.h>
+
+#include <string.h>
+
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/sys/util.h>
+
+#define CRC_SEED 0xFFFF
+
+BUILD_ASSERT(sizeof(struct nav_link_header) == 4, "nav_link header is part of the protocol");
+BUILD_ASSERT(sizeof(navigator_sample_t) == 48, "nav_link sample layout changed");
+BUILD_ASSERT(sizeof(kalman_sample_t) == 24, "nav_link sample layout changed");
+BUILD_ASSERT(sizeof(struct nav_link_sync) == 8, "nav_link sample layout changed");
+
+size_t nav_link_sample_size(uint8_t type)
+{
+    switch (type) {
+    case NAV_LINK_SENSORS:
+        return sizeof(navigator_sample_t);
+    case NAV_LINK_KALMAN:
+        return sizeof(kalman_sample_t);
+    case NAV_LINK_SYNC:
+        return sizeof(struct nav_link_sync);
+    default:
+        return 0;
+    }
+}
+
+// COBS encode len bytes of in, returns the encoded size (no delimiter)
+static size_t cobs_encode(const uint8_t *in, size_t len, uint8_t *out)
+{
+    size_t code_at = 0;
+    size_t o = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] != 0) {
+            out[o++] = in[i];
+            code++;
+        }
+
+        if (in[i] == 0 || code == 0xFF) {
+            out[code_at] = code;
+            code_at = o++;
+            code = 1;
+        }
+    }
+
+    out[code_at] = code;
+    return o;
+}
+
+// COBS decode in place, returns the decoded size or -1 if the block is malformed
+static int cobs_decode(uint8_t *buf, size_t len)
+{
+    size_t i = 0;
+    size_t o = 0;
+
+    while (i < len) {
+        const uint8_t code = buf[i++];
+        if (code == 0 || i + code - 1 > len) {
+            return -1;
+        }
+
+        for (uint8_t k = 1; k < code; k++) {
+            buf[o++] = buf[i++];
+        }
+
+        if (code != 0xFF && i < len) {
+            buf[o++] = 0;
+        }
+    }
+
+    return (int)o;
+}
+
+size_t nav_link_encode(uint8_t type, uint16_t seq, const void *samples, uint8_t count,
+                       uint8_t *out, size_t out_size)
+{
+    const size_t body = count * nav_link_sample_size(type);
+    if (count == 0 || count > NAV_LINK_MAX_BATCH || body == 0) {
+        return 0;
+    }
+
+    uint8_t payload[NAV_LINK_MAX_PAYLOAD];
+    const struct nav_link_header header = {.type = type, .count = count, .seq = seq};
+    const size_t len = sizeof(header) + body;
+
+    memcpy(payload, &header, sizeof(header));
+    memcpy(&payload[sizeof(header)], samples, body);
+    sys_put_le16(crc16_itu_t(CRC_SEED, payload, len), &payload[len]);
+
+    const size_t payload_len = len + NAV_LINK_CRC_SIZE;
+    if (out_size < payload_len + payload_len / 254 + 2) {
+        return 0;
+    }
+
+    const size_t n = cobs_encode(payload, payload_len, out);
+    out[n] = 0;
+    return n + 1;
+}
+
+void nav_link_decoder_init(struct nav_link_decoder *dec)
+{
+    memset(dec, 0, sizeof(*dec));
+}
+
+static void frame_done(struct nav_link_decoder *dec, nav_link_frame_cb_t cb, void *user_data)
+{
+    const int n = cobs_decode(dec->buf, dec->len);
+    if (n < (int)(sizeof(struct nav_link_header) + NAV_LINK_CRC_SIZE)) {
+        dec->stats.framing_errors++;
+        return;
+    }
+
+    const size_t len = n - NAV_LINK_CRC_SIZE;
+    if (crc16_itu_t(CRC_SEED, dec->buf, len) != sys_get_le16(&dec->buf[len])) {
+        dec->stats.crc_errors++;
+        return;
+    }
+
+    struct nav_link_frame frame = {.samples = &dec->buf[sizeof(frame.header)]};
+    memcpy(&frame.header, dec->buf, sizeof(frame.header));
+
+    const size_t size = nav_link_sample_size(frame.header.type);
+    if (size == 0 || frame.header.count == 0 || frame.header.count > NAV_LINK_MAX_BATCH ||
+        len != sizeof(frame.header) + frame.header.count * size) {
+        dec->stats.framing_errors++;
+        return;
+    }
+
+    if (dec->synced) {
+        dec->stats.lost_frames += (uint16_t)(frame.header.seq - dec->next_seq);
+    }
+
+    dec->synced = true;
+    dec->next_seq = frame.header.seq + 1;
+    dec->stats.frames++;
+
+    cb(&frame, user_data);
+}
+
+void nav_link_decode(struct nav_link_decoder *dec, const uint8_t *data, size_t len,
+                     nav_link_frame_cb_t cb, void *user_data)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] != 0) {
+            if (dec->len < sizeof(dec->buf)) {
+                dec->buf[dec->len++] = data[i];
+            } else {
+                dec->overflow = true;
+            }
+            continue;
+        }
+
+        // Delimiter: back to back delimiters are idle line, not empty frames
+        if (dec->overflow) {
+            dec->stats.framing_errors++;
+        } else if (dec->len > 0) {
+            frame_done(dec, cb, user_data);
+        }
+
+        dec->len = 0;
+        dec->overflow = false;
+    }
+}
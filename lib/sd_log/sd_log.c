@@ -0,0 +1,128 @@
+#include <invictus2/sd_log.h>
+
+#include <string.h>
+
+#include <zephyr/sys/crc.h>
+#include <zephyr/sys/util.h>
+
+BUILD_ASSERT(sizeof(struct sd_log_block_hdr) == 20, "sd_log block header is on the card");
+BUILD_ASSERT(sizeof(struct sd_log_block) == SD_LOG_BLOCK_SIZE, "sd_log blocks are sectors");
+BUILD_ASSERT(sizeof(struct sd_log_record_hdr) == 8, "sd_log record header is on the card");
+BUILD_ASSERT(sizeof(struct sd_log_file_hdr) == 16, "sd_log file header is on the card");
+
+static uint32_t block_crc(const struct sd_log_block *blk)
+{
+    struct sd_log_block_hdr hdr = blk->hdr;
+    hdr.crc = 0;
+
+    const uint32_t crc = crc32_ieee((const uint8_t *)&hdr, sizeof(hdr));
+    return crc32_ieee_update(crc, blk->data, sizeof(blk->data));
+}
+
+void sd_log_block_init(struct sd_log_block *blk, uint32_t session, uint32_t seq)
+{
+    memset(blk, 0, sizeof(*blk));
+    blk->hdr.magic = SD_LOG_BLOCK_MAGIC;
+    blk->hdr.session = session;
+    blk->hdr.seq = seq;
+}
+
+bool sd_log_block_append(struct sd_log_block *blk, const struct sd_log_record_hdr *hdr,
+                         const void *payload)
+{
+    const size_t size = sizeof(*hdr) + hdr->len;
+
+    if (blk->hdr.used + size > SD_LOG_BLOCK_PAYLOAD) {
+        return false;
+    }
+
+    memcpy(&blk->data[blk->hdr.used], hdr, sizeof(*hdr));
+    memcpy(&blk->data[blk->hdr.used + sizeof(*hdr)], payload, hdr->len);
+    blk->hdr.used += size;
+    blk->hdr.records++;
+    return true;
+}
+
+void sd_log_block_seal(struct sd_log_block *blk)
+{
+    blk->hdr.crc = block_crc(blk);
+}
+
+bool sd_log_block_is_valid(const struct sd_log_block *blk, uint32_t session, uint32_t seq)
+{
+    return blk->hdr.magic == SD_LOG_BLOCK_MAGIC && blk->hdr.session == session &&
+           blk->hdr.seq == seq && blk->hdr.used <= SD_LOG_BLOCK_PAYLOAD &&
+           blk->hdr.crc == block_crc(blk);
+}
+
+static bool read_valid(sd_log_read_block_t read, void *ctx, uint32_t index,
+                       struct sd_log_block *blk, struct sd_log_scan *result)
+{
+    result->reads++;
+    return read(ctx, index, blk) == 0 && sd_log_block_is_valid(blk, result->session, index);
+}
+
+void sd_log_scan(sd_log_read_block_t read, void *ctx, uint32_t block_count, uint32_t window,
+                 struct sd_log_block *blk, struct sd_log_scan *result)
+{
+    memset(result, 0, sizeof(*result));
+
+    if (block_count == 0) {
+        return;
+    }
+
+    // Block 0 gives the session the rest of the log must belong to
+    result->reads++;
+    if (read(ctx, 0, blk) != 0) {
+        return;
+    }
+
+    result->session = blk->hdr.session;
+    if (!sd_log_block_is_valid(blk, result->session, 0)) {
+        return;
+    }
+
+    // Invariant: block lo is valid and the highest one read so far, the log is taken to end
+    // before hi (block_count is past the log). The end is never put before a block seen
+    // valid, so recovery cannot cut the log short.
+    uint32_t lo = 0;
+    uint32_t hi = block_count;
+
+    while (hi - lo > 1) {
+        const uint32_t mid = lo + (hi - lo) / 2;
+
+        if (read_valid(read, ctx, mid, blk, result)) {
+            lo = mid;
+            continue;
+        }
+
+        // A failed write leaves a hole of up to a window of blocks, the log may go on after it
+        const uint32_t past = mid + window;
+        if (past < hi && read_valid(read, ctx, past, blk, result)) {
+            lo = past;
+        } else {
+            hi = mid;
+        }
+    }
+
+    // The blocks of the last write may have been torn in any order, around the block found:
+    // keep the last valid one and count the invalid ones before it. Every valid block
+    // extends the check to the block after a hole of window blocks following it.
+    const uint32_t first = lo + 1 > window ? lo + 1 - window : 1;
+    uint32_t last = MIN(block_count, lo + 2 + window);
+    uint32_t end = lo + 1;
+    uint32_t invalid = 0;
+
+    for (uint32_t i = first; i < last; i++) {
+        if (i == lo || read_valid(read, ctx, i, blk, result)) {
+            end = MAX(end, i + 1);
+            last = MAX(last, MIN(block_count, i + 2 + window));
+            result->lost += invalid;
+            invalid = 0;
+        } else {
+            invalid++;
+        }
+    }
+
+    result->blocks = end;
+}
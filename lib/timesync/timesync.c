@@ -0,0 +1,62 @@
+#include <invictus2/timesync.h>
+
+#include <string.h>
+
+#include <zephyr/sys/util.h>
+
+#define PPB               1000000000LL
+#define MAX_RATE_PPB      (CONFIG_TIMESYNC_MAX_DRIFT_PPM * 1000LL)
+#define STEP_THRESHOLD_US CONFIG_TIMESYNC_STEP_THRESHOLD_USEC
+
+void timesync_init(struct timesync *ts)
+{
+    memset(ts, 0, sizeof(*ts));
+}
+
+uint64_t timesync_to_master(const struct timesync *ts, uint64_t local_us)
+{
+    if (!timesync_is_synced(ts)) {
+        return local_us;
+    }
+
+    // The slew is over once the error it absorbs is, a late sync point must not overshoot
+    const int64_t dt = (int64_t)(local_us - ts->local_us);
+    const int64_t slew_dt = MIN(dt, (int64_t)ts->slew_us);
+
+    return ts->master_us + dt + dt * ts->drift_ppb / PPB + slew_dt * ts->slew_ppb / PPB;
+}
+
+static int32_t clamp_rate(int64_t rate_ppb)
+{
+    return (int32_t)CLAMP(rate_ppb, -MAX_RATE_PPB, MAX_RATE_PPB);
+}
+
+void timesync_update(struct timesync *ts, uint64_t master_us, uint64_t local_us)
+{
+    const uint64_t estimate = timesync_to_master(ts, local_us);
+    const int64_t error = (int64_t)(master_us - estimate);
+    const int64_t interval = (int64_t)(local_us - ts->local_us);
+    const bool first = !timesync_is_synced(ts);
+
+    ts->syncs++;
+    ts->last_error_us = (int32_t)CLAMP(error, INT32_MIN, INT32_MAX);
+
+    if (first || interval <= 0 || error > STEP_THRESHOLD_US || error < -STEP_THRESHOLD_US) {
+        // Keep the drift, it belongs to the oscillators and survives a reboot of either end
+        ts->steps += !first;
+        ts->local_us = local_us;
+        ts->master_us = master_us;
+        ts->slew_ppb = 0;
+        ts->slew_us = 0;
+        return;
+    }
+
+    // Restart from the current estimate, so the conversion stays continuous. A quarter of
+    // the error goes into the drift and half of it is absorbed over the next interval: a
+    // PI loop that settles in a few sync points and averages out the jitter of single ones.
+    ts->local_us = local_us;
+    ts->master_us = estimate;
+    ts->drift_ppb = clamp_rate(ts->drift_ppb + error * PPB / interval / 4);
+    ts->slew_ppb = clamp_rate(error * PPB / interval / 2);
+    ts->slew_us = (uint32_t)MIN(interval, UINT32_MAX);
+}
@@ -0,0 +1,212 @@
+#include <invictus2/trace.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+#define RING_MASK (CONFIG_TRACE_RING_EVENTS - 1)
+
+BUILD_ASSERT((CONFIG_TRACE_RING_EVENTS & RING_MASK) == 0,
+             "CONFIG_TRACE_RING_EVENTS must be a power of two");
+
+// Written by the CPU it belongs to only. Writers reserve a slot by incrementing head, so
+// ISRs preempting a probe get their own slot.
+struct trace_ring {
+    atomic_t head; // Events recorded, the next slot is head & RING_MASK
+    struct trace_event events[CONFIG_TRACE_RING_EVENTS];
+};
+
+struct probe_hist {
+    atomic_t count;
+    atomic_t max_cycles;
+    atomic_t buckets[TRACE_HIST_BUCKETS];
+};
+
+static struct trace_ring rings[CONFIG_MP_MAX_NUM_CPUS];
+static struct probe_hist hists[_TRACE_PROBE_MAX];
+static atomic_t paused;
+
+static const char *const probe_names[] = {
+    [TRACE_ZBUS_PUB] = "zbus_pub",
+    [TRACE_SM_RUN] = "sm_run",
+    [TRACE_SM_WORK] = "sm_work",
+    [TRACE_MODBUS_WORK] = "modbus_work",
+    [TRACE_MODBUS_XFER] = "modbus_xfer",
+    [TRACE_NAV_FRAME] = "nav_frame",
+    [TRACE_KALMAN_STEP] = "kalman_step",
+    [TRACE_SD_WRITE] = "sd_write",
+    [TRACE_SX128X_SPI] = "sx128x_spi",
+};
+
+BUILD_ASSERT(ARRAY_SIZE(probe_names) == _TRACE_PROBE_MAX, "Every probe needs a name");
+
+static inline uint8_t current_cpu(void)
+{
+#ifdef CONFIG_SMP
+    return arch_curr_cpu()->id;
+#else
+    return 0;
+#endif
+}
+
+static void record(enum trace_probe probe, enum trace_event_type type, uint32_t cycles)
+{
+    if (atomic_get(&paused)) {
+        return;
+    }
+
+    const uint8_t cpu = current_cpu();
+    struct trace_ring *const ring = &rings[cpu];
+    const atomic_val_t slot = atomic_inc(&ring->head) & RING_MASK;
+
+    ring->events[slot] = (struct trace_event){
+        .cycles = cycles,
+        .probe = probe,
+        .type = type,
+        .cpu = cpu,
+        .isr = k_is_in_isr(),
+    };
+}
+
+static void hist_add(struct probe_hist *hist, uint32_t cycles)
+{
+    const int bucket = cycles == 0 ? 0 : 31 - __builtin_clz(cycles);
+
+    atomic_inc(&hist->buckets[bucket]);
+    atomic_inc(&hist->count);
+
+    atomic_val_t max = atomic_get(&hist->max_cycles);
+    while ((uint32_t)max < cycles && !atomic_cas(&hist->max_cycles, max, cycles)) {
+        max = atomic_get(&hist->max_cycles);
+    }
+}
+
+uint32_t trace_begin(enum trace_probe probe)
+{
+    const uint32_t now = k_cycle_get_32();
+    record(probe, TRACE_EVENT_BEGIN, now);
+    return now;
+}
+
+void trace_end(enum trace_probe probe, uint32_t start)
+{
+    const uint32_t now = k_cycle_get_32();
+    record(probe, TRACE_EVENT_END, now);
+
+    if (!atomic_get(&paused)) {
+        hist_add(&hists[probe], now - start);
+    }
+}
+
+void trace_mark(enum trace_probe probe)
+{
+    record(probe, TRACE_EVENT_MARK, k_cycle_get_32());
+}
+
+const char *trace_probe_name(enum trace_probe probe)
+{
+    return probe < _TRACE_PROBE_MAX ? probe_names[probe] : "?";
+}
+
+void trace_get_hist(enum trace_probe probe, struct trace_hist *hist)
+{
+    const struct probe_hist *const src = &hists[probe];
+
+    hist->count = atomic_get(&src->count);
+    hist->max_cycles = atomic_get(&src->max_cycles);
+    for (int b = 0; b < TRACE_HIST_BUCKETS; b++) {
+        hist->buckets[b] = atomic_get(&src->buckets[b]);
+    }
+}
+
+// Upper bound of the bucket the permille percentile falls in
+static uint32_t percentile(const struct trace_hist *hist, uint32_t permille)
+{
+    const uint64_t rank = DIV_ROUND_UP((uint64_t)hist->count * permille, 1000);
+    uint64_t seen = 0;
+
+    for (int b = 0; b < TRACE_HIST_BUCKETS - 1; b++) {
+        seen += hist->buckets[b];
+        if (seen >= rank) {
+            return (2U << b) - 1;
+        }
+    }
+
+    return UINT32_MAX;
+}
+
+void trace_get_stats(enum trace_probe probe, struct trace_stats *stats)
+{
+    struct trace_hist hist;
+    trace_get_hist(probe, &hist);
+
+    // The histogram only bounds the percentiles, the max is exact
+    stats->count = hist.count;
+    stats->max_cycles = hist.max_cycles;
+    stats->p50_cycles = hist.count > 0 ? MIN(percentile(&hist, 500), hist.max_cycles) : 0;
+    stats->p99_cycles = hist.count > 0 ? MIN(percentile(&hist, 990), hist.max_cycles) : 0;
+}
+
+void trace_reset(void)
+{
+    atomic_set(&paused, 1);
+
+    for (int cpu = 0; cpu < ARRAY_SIZE(rings); cpu++) {
+        atomic_set(&rings[cpu].head, 0);
+    }
+
+    for (int p = 0; p < _TRACE_PROBE_MAX; p++) {
+        atomic_set(&hists[p].count, 0);
+        atomic_set(&hists[p].max_cycles, 0);
+        for (int b = 0; b < TRACE_HIST_BUCKETS; b++) {
+            atomic_set(&hists[p].buckets[b], 0);
+        }
+    }
+
+    atomic_set(&paused, 0);
+}
+
+int trace_export(trace_write_t write, void *ctx)
+{
+    atomic_set(&paused, 1);
+
+    uint32_t heads[ARRAY_SIZE(rings)];
+    uint32_t events = 0;
+    for (int cpu = 0; cpu < ARRAY_SIZE(rings); cpu++) {
+        heads[cpu] = atomic_get(&rings[cpu].head);
+        events += MIN(heads[cpu], CONFIG_TRACE_RING_EVENTS);
+    }
+
+    const struct trace_export_hdr hdr = {
+        .magic = TRACE_EXPORT_MAGIC,
+        .version = TRACE_EXPORT_VERSION,
+        .cpus = ARRAY_SIZE(rings),
+        .probes = _TRACE_PROBE_MAX,
+        .cycles_per_sec = sys_clock_hw_cycles_per_sec(),
+        .events = events,
+    };
+
+    int ret = write(ctx, &hdr, sizeof(hdr));
+
+    for (int cpu = 0; cpu < ARRAY_SIZE(rings) && ret == 0; cpu++) {
+        const struct trace_ring *const ring = &rings[cpu];
+        const uint32_t count = MIN(heads[cpu], CONFIG_TRACE_RING_EVENTS);
+        const uint32_t first = (heads[cpu] - count) & RING_MASK;
+
+        // Oldest first, the ring wraps at most once
+        const uint32_t tail = MIN(count, CONFIG_TRACE_RING_EVENTS - first);
+        ret = write(ctx, &ring->events[first], tail * sizeof(struct trace_event));
+        if (ret == 0 && count > tail) {
+            ret = write(ctx, &ring->events[0], (count - tail) * sizeof(struct trace_event));
+        }
+    }
+
+    for (int p = 0; p < _TRACE_PROBE_MAX && ret == 0; p++) {
+        struct trace_hist hist;
+        trace_get_hist(p, &hist);
+        ret = write(ctx, &hist, sizeof(hist));
+    }
+
+    atomic_set(&paused, 0);
+    return ret;
+}
@@ -0,0 +1,146 @@
+#include <invictus2/trace.h>
+
+#include <string.h>
+
+#include <zephyr/device.h>
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/util.h>
+
+#define TRACE_UART_NODE DT_CHOSEN(invictus_trace_uart)
+
+#if DT_NODE_EXISTS(TRACE_UART_NODE)
+#include <zephyr/drivers/uart.h>
+#endif
+
+static uint32_t cycles_to_ns(uint32_t cycles)
+{
+    return (uint32_t)MIN(k_cyc_to_ns_floor64(cycles), UINT32_MAX);
+}
+
+static int cmd_trace_stats(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    shell_print(sh, "%-12s %10s %10s %10s %10s", "probe", "count", "p50 ns", "p99 ns",
+                "max ns");
+
+    for (int p = 0; p < _TRACE_PROBE_MAX; p++) {
+        struct trace_stats stats;
+        trace_get_stats(p, &stats);
+
+        shell_print(sh, "%-12s %10u %10u %10u %10u", trace_probe_name(p), stats.count,
+                    cycles_to_ns(stats.p50_cycles), cycles_to_ns(stats.p99_cycles),
+                    cycles_to_ns(stats.max_cycles));
+    }
+
+    return 0;
+}
+
+static int cmd_trace_hist(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+
+    int probe = 0;
+    while (probe < _TRACE_PROBE_MAX && strcmp(argv[1], trace_probe_name(probe)) != 0) {
+        probe++;
+    }
+
+    if (probe == _TRACE_PROBE_MAX) {
+        shell_error(sh, "Unknown probe %s, see trace stats", argv[1]);
+        return -EINVAL;
+    }
+
+    struct trace_hist hist;
+    trace_get_hist(probe, &hist);
+
+    shell_print(sh, "%s: %u durations, max %u ns", trace_probe_name(probe), hist.count,
+                cycles_to_ns(hist.max_cycles));
+
+    for (int b = 0; b < TRACE_HIST_BUCKETS; b++) {
+        if (hist.buckets[b] > 0) {
+            shell_print(sh, "  < %10u ns: %u", cycles_to_ns(MIN((2ULL << b) - 1, UINT32_MAX)),
+                        hist.buckets[b]);
+        }
+    }
+
+    return 0;
+}
+
+static int cmd_trace_reset(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    trace_reset();
+    shell_print(sh, "Trace cleared");
+    return 0;
+}
+
+#if DT_NODE_EXISTS(TRACE_UART_NODE)
+
+// Raw binary on the trace UART, a USB CDC ACM instance of its own
+static int write_uart(void *ctx, const void *data, size_t len)
+{
+    const struct device *const dev = ctx;
+    const uint8_t *const bytes = data;
+
+    for (size_t i = 0; i < len; i++) {
+        uart_poll_out(dev, bytes[i]);
+    }
+    return 0;
+}
+
+static int cmd_trace_export(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    const struct device *const dev = DEVICE_DT_GET(TRACE_UART_NODE);
+    if (!device_is_ready(dev)) {
+        shell_error(sh, "Trace UART %s not ready", dev->name);
+        return -ENODEV;
+    }
+
+    const int ret = trace_export(write_uart, (void *)dev);
+    shell_print(sh, "Trace exported on %s: %d", dev->name, ret);
+    return ret;
+}
+
+#else
+
+// Hex lines on the shell, when there is no trace UART
+static int write_hex(void *ctx, const void *data, size_t len)
+{
+    const struct shell *const sh = ctx;
+    const uint8_t *const bytes = data;
+
+    for (size_t i = 0; i < len; i += 32) {
+        char line[2 * 32 + 1];
+        const size_t n = MIN(len - i, 32);
+
+        bin2hex(&bytes[i], n, line, sizeof(line));
+        shell_print(sh, "%s", line);
+    }
+    return 0;
+}
+
+static int cmd_trace_export(const struct shell *sh, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    return trace_export(write_hex, (void *)sh);
+}
+
+#endif // DT_NODE_EXISTS(TRACE_UART_NODE)
+
+SHELL_STATIC_SUBCMD_SET_CREATE(
+    trace_subcmd_set, SHELL_CMD(stats, NULL, "Probe latency summary", cmd_trace_stats),
+    SHELL_CMD_ARG(hist, NULL, "Probe latency histogram. Params: <probe name>", cmd_trace_hist, 2,
+                  0),
+    SHELL_CMD(reset, NULL, "Clear the events and histograms", cmd_trace_reset),
+    SHELL_CMD(export, NULL, "Binary snapshot, see invictus2/trace.h", cmd_trace_export),
+    SHELL_SUBCMD_SET_END);
+SHELL_CMD_REGISTER(trace, &trace_subcmd_set, "Hot path timing probes", NULL);
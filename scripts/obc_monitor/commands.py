@@ -61,7 +61,8 @@ class ManualCmd(IntEnum):
     MANUAL_CMD_VALVE_MS = 5
     MANUAL_CMD_LOADCELL_TARE = 6
     MANUAL_CMD_TANK_TARE = 7
-    _MANUAL_CMD_MAX = 8
+    MANUAL_CMD_FILL_CONTROL = 8
+    _MANUAL_CMD_MAX = 9
 
 
 # =============================================================================
@@ -232,6 +233,7 @@ def encode_manual_exec(
       - VALVE_STATE: struct { uint8_t valve_id; uint8_t open; }
       - VALVE_MS:    struct { uint8_t valve_id; uint32_t duration_ms; }
       - LOADCELL_TARE / TANK_TARE: struct { uint8_t id; }
+      - FILL_CONTROL: struct { uint16_t setpoint; uint8_t enable; }
       - SD_LOG_START / SD_LOG_STOP / SD_STATUS: no extra params
     """
     payload = bytearray()
@@ -255,6 +257,10 @@ def encode_manual_exec(
     ):
         payload.append(int(params["ID"]) & 0xFF)
 
+    elif manual_cmd == ManualCmd.MANUAL_CMD_FILL_CONTROL:
+        payload += _u16(end_sym, int(params.get("SetpointDbar", 0)))
+        payload.append(_bool8(params.get("Enable", True)) & 0xFF)
+
     elif manual_cmd in (
         ManualCmd.MANUAL_CMD_SD_LOG_START,
         ManualCmd.MANUAL_CMD_SD_LOG_STOP,
@@ -361,7 +367,8 @@ class CommandProcessor:
                     "      Subcmds: SD_LOG_START | SD_LOG_STOP | SD_STATUS |",
                     "               VALVE_STATE (ValveID=, Open=true/false) |",
                     "               VALVE_MS (ValveID=, DurationMs=) |",
-                    "               LOADCELL_TARE (ID=) | TANK_TARE (ID=)",
+                    "               LOADCELL_TARE (ID=) | TANK_TARE (ID=) |",
+                    "               FILL_CONTROL (SetpointDbar=, Enable=true/false)",
                     "  modbus <slave_id> <hr|coil|ir> <index> <value> - Set Modbus (unchanged)",
                     "  status | history | clear | save-config [file] | quit/exit",
                 ]
@@ -469,6 +476,14 @@ class CommandProcessor:
                             "✗ VALVE_MS requires ValveID=<id> DurationMs=<ms>"
                         )
                         return responses
+                elif manual_cmd == ManualCmd.MANUAL_CMD_FILL_CONTROL:
+                    if "Enable" in kv:
+                        kv["Enable"] = boolish(kv["Enable"])
+                    if kv.get("Enable", True) and "SetpointDbar" not in kv:
+                        responses.append(
+                            "✗ FILL_CONTROL requires SetpointDbar=<dbar> unless Enable=false"
+                        )
+                        return responses
                 elif manual_cmd in (
                     ManualCmd.MANUAL_CMD_LOADCELL_TARE,
                     ManualCmd.MANUAL_CMD_TANK_TARE,